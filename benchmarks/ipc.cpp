@@ -0,0 +1,365 @@
+/**
+ * Latency of the driver <-> server communication path: inter process events, the shared memory lock and bulk copies of the shared
+ * state. Each measurement runs between two processes, like the driver and the server.
+ *
+ * Usage: bench_ipc [--format csv|json] [--output <file>]
+ * Results are written to the standard output by default, progress is logged to the error output.
+ */
+
+#include <wvb_common/ipc.h>
+#include <wvb_common/server_shared_state.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define MUTEX_NAME "wvb_bench_ipc_mutex"
+// ftok needs an existing file: use the benchmark executable so that the key doesn't collide with the real shared memory
+#define MEMORY_NAME     "/proc/self/exe"
+#define PING_EVENT_NAME "wvb_bench_ipc_ping"
+#define PONG_EVENT_NAME "wvb_bench_ipc_pong"
+
+// Number of measured iterations per process, after the warmup
+#define NB_SAMPLES        100000
+#define NB_WARMUP_SAMPLES 1000
+#define NB_COPY_SAMPLES   10000
+#define EVENT_TIMEOUT_MS  1000
+
+struct BenchmarkResult
+{
+    std::string name;
+    /** Bytes written or read in shared memory per iteration. */
+    size_t   payload_size = 0;
+    size_t   nb_samples   = 0;
+    uint64_t p50_ns       = 0;
+    uint64_t p99_ns       = 0;
+    uint64_t p999_ns      = 0;
+    uint64_t max_ns       = 0;
+};
+
+/** Placed in the shared memory. Only the sample arrays and the copy buffer are large, the rest is synchronization. */
+struct BenchmarkState
+{
+    std::atomic<uint32_t> nb_ready_processes;
+    /** Incremented under the lock by both processes, to check that the lock is exclusive. */
+    uint64_t counter;
+    size_t   nb_child_samples;
+    uint64_t child_samples_ns[NB_SAMPLES];
+    /** Same size as the real shared state. It contains atomics and can't be copied as is, so only its size is reproduced. */
+    unsigned char shared_data[sizeof(wvb::ServerDriverSharedData)];
+};
+
+BenchmarkResult compute_result(const char *name, size_t payload_size, std::vector<uint64_t> &samples_ns)
+{
+    BenchmarkResult result {.name = name, .payload_size = payload_size, .nb_samples = samples_ns.size()};
+    if (samples_ns.empty())
+    {
+        return result;
+    }
+
+    std::sort(samples_ns.begin(), samples_ns.end());
+    result.p50_ns  = samples_ns[samples_ns.size() / 2];
+    result.p99_ns  = samples_ns[samples_ns.size() * 99 / 100];
+    result.p999_ns = samples_ns[samples_ns.size() * 999 / 1000];
+    result.max_ns  = samples_ns.back();
+    return result;
+}
+
+uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void write_csv(std::ostream &out, const std::vector<BenchmarkResult> &results)
+{
+    out << "benchmark,payload_size,nb_samples,p50_ns,p99_ns,p999_ns,max_ns\n";
+    for (const auto &result: results)
+    {
+        out << result.name << ',' << result.payload_size << ',' << result.nb_samples << ',' << result.p50_ns << ',' << result.p99_ns
+            << ',' << result.p999_ns << ',' << result.max_ns << '\n';
+    }
+}
+
+void write_json(std::ostream &out, const std::vector<BenchmarkResult> &results)
+{
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const auto &result = results[i];
+        out << "  {\"benchmark\": \"" << result.name << "\", \"payload_size\": " << result.payload_size
+            << ", \"nb_samples\": " << result.nb_samples << ", \"p50_ns\": " << result.p50_ns << ", \"p99_ns\": " << result.p99_ns
+            << ", \"p999_ns\": " << result.p999_ns << ", \"max_ns\": " << result.max_ns << "}" << (i + 1 < results.size() ? "," : "")
+            << '\n';
+    }
+    out << "]\n";
+}
+
+#ifdef __linux__
+
+/** Blocks until both processes reach it, so that the measurements start at the same time. */
+void wait_for_other_process(BenchmarkState *state, uint32_t nb_expected)
+{
+    state->nb_ready_processes.fetch_add(1);
+    while (state->nb_ready_processes.load() < nb_expected)
+    {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * Runs the measurement in a forked child process and in this process at the same time.
+ * The child's samples are passed back through the shared memory and merged with the ones of this process.
+ */
+template<typename F>
+bool run_in_two_processes(BenchmarkState *state, F &&measure, std::vector<uint64_t> &samples_ns)
+{
+    state->nb_ready_processes = 0;
+    state->nb_child_samples   = 0;
+
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        return false;
+    }
+    if (pid == 0)
+    {
+        std::vector<uint64_t> child_samples_ns;
+        child_samples_ns.reserve(NB_SAMPLES);
+        measure(true, child_samples_ns);
+
+        state->nb_child_samples = std::min(child_samples_ns.size(), static_cast<size_t>(NB_SAMPLES));
+        std::copy_n(child_samples_ns.begin(), state->nb_child_samples, state->child_samples_ns);
+
+        // Skip the destructors, the shared memory and the semaphores belong to the parent
+        _exit(0);
+    }
+
+    measure(false, samples_ns);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        return false;
+    }
+
+    samples_ns.insert(samples_ns.end(), state->child_samples_ns, state->child_samples_ns + state->nb_child_samples);
+    return true;
+}
+
+/** Round trip between two processes signaling each other, like a frame crossing the driver and the server. */
+bool measure_event_round_trips(BenchmarkState *state, wvb::EventBackend backend, std::vector<uint64_t> &samples_ns)
+{
+    return run_in_two_processes(
+        state,
+        [&](bool is_child, std::vector<uint64_t> &samples)
+        {
+            // Each process sends on one event and receives on the other
+            wvb::InterProcessEvent ping(PING_EVENT_NAME, !is_child, wvb::EventResetMode::AUTO, backend);
+            wvb::InterProcessEvent pong(PONG_EVENT_NAME, is_child, wvb::EventResetMode::AUTO, backend);
+            wait_for_other_process(state, 2);
+
+            for (uint32_t i = 0; i < NB_WARMUP_SAMPLES + NB_SAMPLES; i++)
+            {
+                if (is_child)
+                {
+                    if (!ping.wait(EVENT_TIMEOUT_MS))
+                    {
+                        return;
+                    }
+                    pong.signal();
+                    continue;
+                }
+
+                const auto start = std::chrono::steady_clock::now();
+                ping.signal();
+                if (!pong.wait(EVENT_TIMEOUT_MS))
+                {
+                    return;
+                }
+                if (i >= NB_WARMUP_SAMPLES)
+                {
+                    samples.push_back(elapsed_ns(start));
+                }
+            }
+        },
+        samples_ns);
+}
+
+/** Acquire and release of the shared memory lock while the other process does the same. */
+bool measure_contended_lock(wvb::SharedMemory<BenchmarkState> &memory, BenchmarkState *state, std::vector<uint64_t> &samples_ns)
+{
+    state->counter = 0;
+    const bool success = run_in_two_processes(
+        state,
+        [&](bool /*is_child*/, std::vector<uint64_t> &samples)
+        {
+            wait_for_other_process(state, 2);
+
+            for (uint32_t i = 0; i < NB_WARMUP_SAMPLES + NB_SAMPLES; i++)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                {
+                    auto lock = memory.lock();
+                    lock->counter++;
+                }
+                if (i >= NB_WARMUP_SAMPLES)
+                {
+                    samples.push_back(elapsed_ns(start));
+                }
+            }
+        },
+        samples_ns);
+
+    // Lost increments mean that both processes held the lock at the same time
+    return success && state->counter == 2 * (NB_WARMUP_SAMPLES + NB_SAMPLES);
+}
+
+/** Copy of the whole shared state under the lock, written by one process and read by the other. */
+bool measure_shared_data_copies(wvb::SharedMemory<BenchmarkState> &memory,
+                                BenchmarkState                     *state,
+                                std::vector<uint64_t>              &write_samples_ns,
+                                std::vector<uint64_t>              &read_samples_ns)
+{
+    std::vector<uint64_t> samples_ns;
+    const bool            success = run_in_two_processes(
+        state,
+        [&](bool is_child, std::vector<uint64_t> &samples)
+        {
+            // The child writes like the driver, the parent reads like the server
+            std::vector<unsigned char> local_copy(sizeof(wvb::ServerDriverSharedData), is_child ? 0xAB : 0);
+            wait_for_other_process(state, 2);
+
+            for (uint32_t i = 0; i < NB_WARMUP_SAMPLES + NB_COPY_SAMPLES; i++)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                {
+                    auto lock = memory.lock();
+                    if (is_child)
+                    {
+                        memcpy(lock->shared_data, local_copy.data(), local_copy.size());
+                    }
+                    else
+                    {
+                        memcpy(local_copy.data(), lock->shared_data, local_copy.size());
+                    }
+                }
+                if (i >= NB_WARMUP_SAMPLES)
+                {
+                    samples.push_back(elapsed_ns(start));
+                }
+            }
+        },
+        samples_ns);
+
+    // The parent's samples come first, then the child's
+    const auto nb_read_samples = samples_ns.size() - state->nb_child_samples;
+    read_samples_ns.assign(samples_ns.begin(), samples_ns.begin() + static_cast<ptrdiff_t>(nb_read_samples));
+    write_samples_ns.assign(samples_ns.begin() + static_cast<ptrdiff_t>(nb_read_samples), samples_ns.end());
+    return success;
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+    std::string format = "csv";
+    std::string output_path;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc)
+        {
+            format = argv[++i];
+        }
+        else if (arg == "--output" && i + 1 < argc)
+        {
+            output_path = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--format csv|json] [--output <file>]\n";
+            return 1;
+        }
+    }
+    if (format != "csv" && format != "json")
+    {
+        std::cerr << "Unknown format \"" << format << "\", expected csv or json\n";
+        return 1;
+    }
+
+#ifdef __linux__
+    wvb::SharedMemory<BenchmarkState> memory(MUTEX_NAME, MEMORY_NAME);
+    auto                             *state = memory.unlocked();
+    if (!memory.is_valid() || state == nullptr)
+    {
+        std::cerr << "Unable to create the shared memory\n";
+        return 1;
+    }
+
+    std::vector<BenchmarkResult> results;
+    bool                         success = true;
+    std::vector<uint64_t>        samples_ns;
+    std::vector<uint64_t>        other_samples_ns;
+
+    std::cerr << "Measuring event round trips (futex)...\n";
+    success = measure_event_round_trips(state, wvb::EventBackend::DEFAULT, samples_ns) && success;
+    results.push_back(compute_result("event_round_trip_futex", 0, samples_ns));
+
+    std::cerr << "Measuring event round trips (semaphore)...\n";
+    samples_ns.clear();
+    success = measure_event_round_trips(state, wvb::EventBackend::SEMAPHORE, samples_ns) && success;
+    results.push_back(compute_result("event_round_trip_semaphore", 0, samples_ns));
+
+    std::cerr << "Measuring contended lock acquire/release...\n";
+    samples_ns.clear();
+    success = measure_contended_lock(memory, state, samples_ns) && success;
+    results.push_back(compute_result("lock_contended", sizeof(uint64_t), samples_ns));
+
+    std::cerr << "Measuring shared data copies (" << sizeof(wvb::ServerDriverSharedData) << " bytes)...\n";
+    samples_ns.clear();
+    success = measure_shared_data_copies(memory, state, samples_ns, other_samples_ns) && success;
+    results.push_back(compute_result("shared_data_copy_write", sizeof(wvb::ServerDriverSharedData), samples_ns));
+    results.push_back(compute_result("shared_data_copy_read", sizeof(wvb::ServerDriverSharedData), other_samples_ns));
+
+    if (!success)
+    {
+        std::cerr << "Some measurements failed, results may be incomplete\n";
+    }
+
+    std::ofstream file;
+    if (!output_path.empty())
+    {
+        file.open(output_path);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to open " << output_path << '\n';
+            return 1;
+        }
+    }
+    std::ostream &out = output_path.empty() ? std::cout : file;
+    if (format == "json")
+    {
+        write_json(out, results);
+    }
+    else
+    {
+        write_csv(out, results);
+    }
+
+    return success ? 0 : 1;
+#else
+    std::cerr << "The IPC benchmark needs fork() and is only available on Linux\n";
+    return 1;
+#endif
+}
@@ -0,0 +1,167 @@
+/**
+ * Cost of recording a measurement in a bucket. Recording calls used to read the clock and evaluate the measurement window each
+ * time, they now only read the phase published by update_phase(). Both are measured on the per-packet socket counters.
+ *
+ * Usage: bench_measurement_phase [--format csv|json] [--output <file>]
+ * Results are written to the standard output by default, progress is logged to the error output.
+ */
+
+#include <wvb_common/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Each sample is the mean cost of a batch of calls, since a single call is shorter than the clock resolution
+#define NB_SAMPLES        2000
+#define NB_WARMUP_SAMPLES 100
+#define BATCH_SIZE        1000
+
+struct BenchmarkResult
+{
+    std::string name;
+    size_t      nb_samples = 0;
+    double      p50_ns     = 0;
+    double      p99_ns     = 0;
+    double      max_ns     = 0;
+};
+
+BenchmarkResult measure(const char *name, const std::function<void()> &call)
+{
+    std::vector<double> samples_ns;
+    samples_ns.reserve(NB_SAMPLES);
+    for (uint32_t i = 0; i < NB_WARMUP_SAMPLES + NB_SAMPLES; i++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t j = 0; j < BATCH_SIZE; j++)
+        {
+            call();
+        }
+        const auto duration = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+        if (i >= NB_WARMUP_SAMPLES)
+        {
+            samples_ns.push_back(duration.count() / BATCH_SIZE);
+        }
+    }
+
+    std::sort(samples_ns.begin(), samples_ns.end());
+    return {
+        .name       = name,
+        .nb_samples = samples_ns.size(),
+        .p50_ns     = samples_ns[samples_ns.size() / 2],
+        .p99_ns     = samples_ns[samples_ns.size() * 99 / 100],
+        .max_ns     = samples_ns.back(),
+    };
+}
+
+void write_csv(std::ostream &out, const std::vector<BenchmarkResult> &results)
+{
+    out << "benchmark,nb_samples,p50_ns,p99_ns,max_ns\n";
+    for (const auto &result: results)
+    {
+        out << result.name << ',' << result.nb_samples << ',' << result.p50_ns << ',' << result.p99_ns << ',' << result.max_ns << '\n';
+    }
+}
+
+void write_json(std::ostream &out, const std::vector<BenchmarkResult> &results)
+{
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const auto &result = results[i];
+        out << "  {\"benchmark\": \"" << result.name << "\", \"nb_samples\": " << result.nb_samples
+            << ", \"p50_ns\": " << result.p50_ns << ", \"p99_ns\": " << result.p99_ns << ", \"max_ns\": " << result.max_ns << "}"
+            << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    out << "]\n";
+}
+
+int main(int argc, char **argv)
+{
+    std::string format = "csv";
+    std::string output_path;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc)
+        {
+            format = argv[++i];
+        }
+        else if (arg == "--output" && i + 1 < argc)
+        {
+            output_path = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--format csv|json] [--output <file>]\n";
+            return 1;
+        }
+    }
+    if (format != "csv" && format != "json")
+    {
+        std::cerr << "Unknown format \"" << format << "\", expected csv or json\n";
+        return 1;
+    }
+
+    // Bucket in the middle of its timing phase
+    auto       rtp_clock = std::make_shared<wvb::rtp::RTPClock>();
+    const auto now       = rtp_clock->now();
+    auto       bucket    = std::make_shared<wvb::SocketMeasurementBucket>();
+    bucket->set_clock(rtp_clock);
+    bucket->set_window({
+        .start_timing_phase        = now - std::chrono::minutes(10),
+        .start_image_quality_phase = now + std::chrono::hours(1),
+        .end_measurements          = now + std::chrono::hours(2),
+        .end                       = now + std::chrono::hours(2),
+    });
+    const uint32_t storage_id = bucket->register_socket(wvb::SocketId::VIDEO_SOCKET, wvb::SocketType::SOCKET_TYPE_UDP);
+
+    std::vector<BenchmarkResult> results;
+
+    // What each recording call used to do
+    std::cerr << "Measuring recording with the window evaluation...\n";
+    results.push_back(measure("add_bytes_sent_evaluating_window",
+                              [&]
+                              {
+                                  bucket->update_phase();
+                                  bucket->add_bytes_sent(storage_id, 1);
+                              }));
+
+    std::cerr << "Measuring recording with the cached phase...\n";
+    results.push_back(measure("add_bytes_sent_cached_phase", [&] { bucket->add_bytes_sent(storage_id, 1); }));
+
+    std::cerr << "Measuring the phase update...\n";
+    results.push_back(measure("update_phase", [&] { bucket->update_phase(); }));
+
+    // Outside of the window, measurements are only discarded
+    bucket->reset_window();
+    std::cerr << "Measuring discarded recording with the cached phase...\n";
+    results.push_back(measure("add_bytes_sent_discarded", [&] { bucket->add_bytes_sent(storage_id, 1); }));
+
+    std::ofstream file;
+    if (!output_path.empty())
+    {
+        file.open(output_path);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to open " << output_path << '\n';
+            return 1;
+        }
+    }
+    std::ostream &out = output_path.empty() ? std::cout : file;
+    if (format == "json")
+    {
+        write_json(out, results);
+    }
+    else
+    {
+        write_csv(out, results);
+    }
+
+    return 0;
+}
@@ -1,15 +1,30 @@
 #pragma once
 
+#include <wvb_common/columnar_file.h>
+#include <wvb_common/latency_histogram.h>
+#include <wvb_common/measurement_log.h>
 #include <wvb_common/rtp_clock.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <fstream>
+#include <memory>
 #include <vector>
 
 namespace wvb
 {
 #define WVB_BENCHMARK_TIMING_PHASE_CAPACITY        2000
 #define WVB_BENCHMARK_IMAGE_QUALITY_PHASE_CAPACITY 500
+// Chunks allocated ahead in each measurement log, so that the recording threads don't allocate during a timing phase
+#define WVB_BENCHMARK_RESERVED_CHUNKS 2
+// Number of frames captured by the server and the client for the image quality measurements
+#define WVB_BENCHMARK_NB_SAVED_FRAMES 10
+// Component column of the exported tables that mix the measurements of several components
+#define EXPORT_FILE_SERVER_ID "server"
+#define EXPORT_FILE_DRIVER_ID "driver"
+#define EXPORT_FILE_CLIENT_ID "client"
 
     template<typename T>
     T compute_median(std::vector<T> &array)
@@ -84,6 +99,19 @@ namespace wvb
         [[nodiscard]] constexpr bool is_after_window(rtp::RTPClock::time_point time) { return time > end; }
     };
 
+    /** Phase of the measurement window in which a bucket is. */
+    enum class MeasurementPhase : uint8_t
+    {
+        /** Before or between the measurement phases, or no window yet. Measurements are refused. */
+        IDLE = 0,
+        TIMING,
+        IMAGE_QUALITY,
+        /** The window is over, or the bucket was finished. */
+        COMPLETE,
+        /** All measurements are accepted, regardless of the window. */
+        ACCEPT_ALL,
+    };
+
     enum class SocketId : uint8_t
     {
         UNKNOWN_SOCKET    = 0,
@@ -104,6 +132,23 @@ namespace wvb
 
     std::string to_string(SocketType socket_type);
 
+    /** Priority classes of the reliable send scheduler, from the most to the least urgent. */
+    enum class SendPriority : uint8_t
+    {
+        /** Session control messages (sync, benchmark info, next pass...). */
+        CONTROL = 0,
+        /** Messages that are on the critical path of tracking or frame pacing. */
+        TRACKING = 1,
+        /** Measurement rows sent at the end of a run. */
+        MEASUREMENTS = 2,
+        /** Large transfers such as frame captures. */
+        BULK = 3,
+    };
+
+#define WVB_SEND_PRIORITY_COUNT 4
+
+    std::string to_string(SendPriority priority);
+
     /**
      * Storage for socket measurements (bitrate, packet loss, etc.)
      */
@@ -121,100 +166,194 @@ namespace wvb
         static void export_csv_header(std::ofstream &file);
 
         static void export_csv_body(std::ofstream &file, const std::vector<SocketMeasurements> &measurements, const char *component);
+
+        static void export_columns(ColumnarFileWriter                    &file,
+                                   const std::string                     &table_name,
+                                   const std::vector<SocketMeasurements> &server_measurements,
+                                   const std::vector<SocketMeasurements> &client_measurements);
+    };
+
+    /**
+     * Queueing delay of one priority class of a send scheduler.
+     * The delay is measured between the moment a packet is queued and the moment it is fully handed to the socket.
+     */
+    struct SendQueueMeasurements
+    {
+        SendPriority priority       = SendPriority::CONTROL;
+        uint32_t     packets_sent   = 0;
+        uint32_t     bytes_sent     = 0;
+        uint64_t     total_delay_us = 0;
+        uint32_t     max_delay_us   = 0;
+
+        static void export_csv_header(std::ofstream &file);
+
+        static void export_csv_body(std::ofstream                                                    &file,
+                                    const std::array<SendQueueMeasurements, WVB_SEND_PRIORITY_COUNT> &measurements,
+                                    const char                                                       *component);
+
+        static void export_columns(ColumnarFileWriter                                               &file,
+                                   const std::string                                                &table_name,
+                                   const std::array<SendQueueMeasurements, WVB_SEND_PRIORITY_COUNT> &server_measurements,
+                                   const std::array<SendQueueMeasurements, WVB_SEND_PRIORITY_COUNT> &client_measurements);
     };
 
+    // Times of the measurements are in nanoseconds on the synchronized timeline of the RTP clock (see RTPClock::now_ns()), so that
+    // short stages can be measured and they never wrap. Pose timestamps are the RTP timestamps of the poses, which identify them.
+
     struct ServerFrameTimeMeasurements
     {
         bool     dropped  = false;
         uint32_t frame_id = 0;
         // NEW_PRESENT_INFO event received from driver
-        uint32_t frame_event_received_timestamp = 0;
+        int64_t frame_event_received_ns = 0;
         // After shared memory is locked, opened and read
-        uint32_t present_info_received_timestamp       = 0;
-        uint32_t shared_texture_opened_timestamp       = 0; // optional
-        uint32_t shared_texture_acquired_timestamp     = 0; // optional
-        uint32_t staging_texture_mapped_timestamp      = 0; // optional
-        uint32_t frame_pushed_timestamp                = 0;
-        uint32_t frame_pulled_timestamp                = 0;
-        uint32_t before_last_get_next_packet_timestamp = 0;
-        uint32_t after_last_get_next_packet_timestamp  = 0;
-        uint32_t before_last_send_packet_timestamp     = 0;
-        uint32_t after_last_send_packet_timestamp      = 0;
-        uint32_t finished_signal_sent_timestamp        = 0;
-
-        static void
-            export_csv(std::ofstream &file, const rtp::RTPClock &clock, const std::vector<ServerFrameTimeMeasurements> &measurements);
+        int64_t present_info_received_ns       = 0;
+        int64_t shared_texture_opened_ns       = 0; // optional
+        int64_t shared_texture_acquired_ns     = 0; // optional
+        int64_t staging_texture_mapped_ns      = 0; // optional
+        int64_t frame_pushed_ns                = 0;
+        int64_t frame_pulled_ns                = 0;
+        int64_t before_last_get_next_packet_ns = 0;
+        int64_t after_last_get_next_packet_ns  = 0;
+        int64_t before_last_send_packet_ns     = 0;
+        int64_t after_last_send_packet_ns      = 0;
+        int64_t finished_signal_sent_ns        = 0;
+
+        static void export_csv(std::ofstream &file, const std::vector<ServerFrameTimeMeasurements> &measurements);
+
+        static void export_columns(ColumnarFileWriter                             &file,
+                                   const std::string                              &table_name,
+                                   const std::vector<ServerFrameTimeMeasurements> &measurements);
     };
 
     struct ClientFrameTimeMeasurements
     {
-        uint32_t frame_index                    = 0;
-        uint32_t frame_id                       = 0;
-        uint32_t tracking_timestamp             = 0;
-        uint32_t last_packet_received_timestamp = 0;
-        uint32_t pushed_to_decoder_timestamp    = 0;
-        uint32_t begin_wait_frame_timestamp     = 0;
-        uint32_t begin_frame_timestamp          = 0;
-        uint32_t after_wait_swapchain_timestamp = 0;
-        uint32_t after_render_timestamp         = 0;
-        uint32_t end_frame_timestamp            = 0;
-        uint32_t predicted_present_timestamp    = 0;
-        uint32_t pose_timestamp                 = 0;
-        uint32_t frame_delay                    = 0;
+        uint32_t frame_index             = 0;
+        uint32_t frame_id                = 0;
+        int64_t  tracking_ns             = 0;
+        int64_t  last_packet_received_ns = 0;
+        int64_t  pushed_to_decoder_ns    = 0;
+        int64_t  begin_wait_frame_ns     = 0;
+        int64_t  begin_frame_ns          = 0;
+        int64_t  after_wait_swapchain_ns = 0;
+        int64_t  after_render_ns         = 0;
+        int64_t  end_frame_ns            = 0;
+        int64_t  predicted_present_ns    = 0;
+        uint32_t pose_timestamp          = 0;
+        uint32_t frame_delay             = 0;
 
-        static void
-            export_csv(std::ofstream &file, const rtp::RTPClock &clock, const std::vector<ClientFrameTimeMeasurements> &measurements);
+        static void export_csv(std::ofstream                                  &file,
+                               const rtp::RTPClock                            &clock,
+                               const std::vector<ClientFrameTimeMeasurements> &measurements);
+
+        static void export_columns(ColumnarFileWriter                             &file,
+                                   const std::string                              &table_name,
+                                   const rtp::RTPClock                            &clock,
+                                   const std::vector<ClientFrameTimeMeasurements> &measurements);
     };
 
     struct DriverFrameTimeMeasurements
     {
-        uint32_t frame_id                          = 0;
-        uint32_t present_called_timestamp          = 0;
-        uint32_t vsync_timestamp                   = 0;
-        uint32_t frame_sent_timestamp              = 0;
-        uint32_t wait_for_present_called_timestamp = 0;
-        uint32_t server_finished_timestamp         = 0;
-        uint32_t pose_updated_event_timestamp      = 0;
-
-        static void
-            export_csv(std::ofstream &file, const rtp::RTPClock &clock, const std::vector<DriverFrameTimeMeasurements> &measurements);
+        uint32_t frame_id                   = 0;
+        int64_t  present_called_ns          = 0;
+        int64_t  vsync_ns                   = 0;
+        int64_t  frame_sent_ns              = 0;
+        int64_t  wait_for_present_called_ns = 0;
+        int64_t  server_finished_ns         = 0;
+        int64_t  pose_updated_event_ns      = 0;
+        /** Time between the targeted present time and the actual one. Positive if the frame was presented late. */
+        int32_t present_deadline_error_us = 0;
+
+        static void export_csv(std::ofstream &file, const std::vector<DriverFrameTimeMeasurements> &measurements);
+
+        static void export_columns(ColumnarFileWriter                             &file,
+                                   const std::string                              &table_name,
+                                   const std::vector<DriverFrameTimeMeasurements> &measurements);
     };
 
     struct TrackingTimeMeasurements
     {
-        uint32_t pose_timestamp               = 0;
-        uint32_t tracking_received_timestamp  = 0;
-        uint32_t tracking_processed_timestamp = 0;
+        uint32_t pose_timestamp        = 0;
+        int64_t  tracking_received_ns  = 0;
+        int64_t  tracking_processed_ns = 0;
 
         static void
             export_csv(std::ofstream &file, const rtp::RTPClock &clock, const std::vector<TrackingTimeMeasurements> &measurements);
+
+        static void export_columns(ColumnarFileWriter                          &file,
+                                   const std::string                           &table_name,
+                                   const rtp::RTPClock                         &clock,
+                                   const std::vector<TrackingTimeMeasurements> &measurements);
     };
 
     struct PoseAccessTimeMeasurements
     {
-        uint32_t pose_timestamp          = 0;
-        uint32_t pose_accessed_timestamp = 0;
+        uint32_t pose_timestamp   = 0;
+        int64_t  pose_accessed_ns = 0;
 
         static void
             export_csv(std::ofstream &file, const rtp::RTPClock &clock, const std::vector<PoseAccessTimeMeasurements> &measurements);
+
+        static void export_columns(ColumnarFileWriter                            &file,
+                                   const std::string                             &table_name,
+                                   const rtp::RTPClock                           &clock,
+                                   const std::vector<PoseAccessTimeMeasurements> &measurements);
     };
 
+    struct PosePredictionMeasurements
+    {
+        // Latest received pose when the prediction was made
+        uint32_t pose_timestamp = 0;
+        // Time for which the pose was predicted
+        int64_t target_ns = 0;
+        // In degrees
+        float orientation_error = 0;
+        // In millimeters
+        float position_error = 0;
+
+        static void
+            export_csv(std::ofstream &file, const rtp::RTPClock &clock, const std::vector<PosePredictionMeasurements> &measurements);
+
+        static void export_columns(ColumnarFileWriter                            &file,
+                                   const std::string                             &table_name,
+                                   const rtp::RTPClock                           &clock,
+                                   const std::vector<PosePredictionMeasurements> &measurements);
+    };
+
+    /**
+     * Sizes of a frame, and its quality as decoded by the client compared to the frame captured by the server.
+     * The quality is only measured for the saved frames, during the export of the run. It is 0 for the others.
+     */
     struct ImageQualityMeasurements
     {
         uint32_t frame_id        = 0;
         uint32_t codestream_size = 0;
         uint32_t raw_size        = 0;
         float    psnr            = 0;
+        float    ssim            = 0;
+        float    ms_ssim         = 0;
 
         static void export_csv(std::ofstream &file, const std::vector<ImageQualityMeasurements> &measurements);
+
+        static void export_columns(ColumnarFileWriter                          &file,
+                                   const std::string                           &table_name,
+                                   const std::vector<ImageQualityMeasurements> &measurements);
     };
 
     struct NetworkMeasurements
     {
         uint32_t rtt_us         = 0;
         int32_t  clock_error_us = 0;
+        /** Estimated drift of the server clock relative to the client one, in parts per million. */
+        float drift_ppm = 0;
+        /** Standard deviation of the clock offset samples around the estimated offset and drift. */
+        uint32_t residual_us = 0;
 
         static void export_csv(std::ofstream &file, const std::vector<NetworkMeasurements> &measurements);
+
+        static void export_columns(ColumnarFileWriter                     &file,
+                                   const std::string                      &table_name,
+                                   const std::vector<NetworkMeasurements> &measurements);
     };
 
     void export_misc_measurements_csv(std::ofstream &file,
@@ -222,10 +361,100 @@ namespace wvb
                                       uint32_t       nb_dropped_frames_client,
                                       uint32_t       nb_catched_up_frames_client,
                                       uint32_t       encoder_delay,
-                                      uint32_t       decoder_delay);
+                                      uint32_t       decoder_delay,
+                                      uint32_t       sync_duration_us,
+                                      uint32_t       sync_error_bound_us);
+
+    void export_misc_measurements_columns(ColumnarFileWriter &file,
+                                          const std::string  &table_name,
+                                          uint32_t            nb_dropped_frames_server,
+                                          uint32_t            nb_dropped_frames_client,
+                                          uint32_t            nb_catched_up_frames_client,
+                                          uint32_t            encoder_delay,
+                                          uint32_t            decoder_delay,
+                                          uint32_t            sync_duration_us,
+                                          uint32_t            sync_error_bound_us);
+
+    /** Stages of the video pipeline whose latency distributions are computed at the end of each run. */
+    enum class LatencyStage : uint8_t
+    {
+        /** From the acquisition of the frame by the server to its last encoded packet. */
+        ENCODE = 0,
+        /** From the last encoded packet to the end of its sending. */
+        SEND = 1,
+        /** From the end of the sending to the reception of the last packet by the client. Includes the clock sync error. */
+        NETWORK = 2,
+        /** From the push of the frame to the decoder to the end of its rendering into the swapchain. */
+        DECODE = 3,
+        /** From the end of the rendering to the submission of the frame to the compositor. */
+        RENDER = 4,
+        /** From the sampling of the pose used by the frame to its predicted display. */
+        MOTION_TO_PHOTON = 5,
+    };
+
+#define WVB_LATENCY_STAGE_COUNT 6
+
+    std::string to_string(LatencyStage stage);
+
+    /** Latency distribution of each stage of the video pipeline during a run, in nanoseconds. */
+    struct StageLatencyHistograms
+    {
+        std::array<LatencyHistogram, WVB_LATENCY_STAGE_COUNT> stages;
+
+        inline void record(LatencyStage stage, int64_t latency_ns) { stages[static_cast<size_t>(stage)].record(latency_ns); }
+
+        /** Records the time between two events, if both were measured. */
+        inline void record_between(LatencyStage stage, int64_t start_ns, int64_t end_ns)
+        {
+            if (start_ns != 0 && end_ns != 0)
+            {
+                record(stage, end_ns - start_ns);
+            }
+        }
+
+        /** Records the server stages of a frame, as soon as the server measured it. Dropped frames are ignored. */
+        void record_server_frame(const ServerFrameTimeMeasurements &server_frame);
+
+        /** Records the client stages of a frame, and its network stage if the server measured it too (server_frame not null). */
+        void record_client_frame(const ClientFrameTimeMeasurements &client_frame, const ServerFrameTimeMeasurements *server_frame);
+
+        /** Records the stages of measurements loaded after the run, matching the frames of both sides by frame id. */
+        void record_frames(const std::vector<ServerFrameTimeMeasurements> &server_measurements,
+                           const std::vector<ClientFrameTimeMeasurements> &client_measurements);
+
+        void merge(const StageLatencyHistograms &other);
+
+        void reset();
+
+        static void export_csv(std::ofstream &file, const StageLatencyHistograms &latencies);
+
+        static void export_columns(ColumnarFileWriter &file, const std::string &table_name, const StageLatencyHistograms &latencies);
+    };
+
+    /** Compact summary of the stage latencies of several runs, which can be merged across passes. */
+    struct StageLatencySketches
+    {
+        std::array<QuantileSketch, WVB_LATENCY_STAGE_COUNT> stages;
+
+        void add(const StageLatencyHistograms &histograms);
+
+        void merge(const StageLatencySketches &other);
+
+        void reset();
+
+        static void export_csv(std::ofstream &file, const StageLatencySketches &latencies);
+
+        static void export_columns(ColumnarFileWriter &file, const std::string &table_name, const StageLatencySketches &latencies);
+    };
 
     // ---- Buckets ----
 
+    /** Logs sized so that all the measurements of a thread in a phase fit in their first chunk. */
+    template<typename T>
+    using TimingPhaseLog = MeasurementLog<T, WVB_BENCHMARK_TIMING_PHASE_CAPACITY>;
+    template<typename T>
+    using ImageQualityPhaseLog = MeasurementLog<T, WVB_BENCHMARK_IMAGE_QUALITY_PHASE_CAPACITY>;
+
     /**
      * A measurement bucket accumulates measurements from all over the app.
      *
@@ -234,6 +463,14 @@ namespace wvb
      *
      * Once the window is over, measurements can be exported to a VRCP packet in order to be sent to the
      * server.
+     *
+     * Reading the clock and evaluating the window for each measurement would cost more than saving it, especially for the
+     * per-packet socket counters. Instead, the phase is computed by update_phase(), which the thread driving the measurements calls
+     * once per frame, and published in an atomic. Save methods only read it, so phase changes are detected with a precision of one
+     * frame.
+     *
+     * Measurement records are saved in a log per thread, so that they can be saved from several threads without locks. The getters
+     * merge the logs and sort the records, so they should only be called to export the measurements.
      */
     class MeasurementBucket
     {
@@ -254,6 +491,43 @@ namespace wvb
         std::shared_ptr<rtp::RTPClock> m_rtp_clock = nullptr;
         MeasurementWindow              m_window;
         BucketMode                     m_mode = BucketMode::WINDOW;
+        /** Phase at the last update, read by the save methods. */
+        std::atomic<MeasurementPhase> m_phase = MeasurementPhase::IDLE;
+
+        [[nodiscard]] MeasurementPhase compute_phase()
+        {
+            if (m_rtp_clock == nullptr)
+            {
+                return MeasurementPhase::IDLE;
+            }
+            if (m_mode == BucketMode::ACCEPT_ALL)
+            {
+                return MeasurementPhase::ACCEPT_ALL;
+            }
+            if (m_mode == BucketMode::FINISHED)
+            {
+                return MeasurementPhase::COMPLETE;
+            }
+            if (!m_window.is_valid())
+            {
+                return MeasurementPhase::IDLE;
+            }
+
+            const auto now = m_rtp_clock->now();
+            if (m_window.is_in_timing_phase(now))
+            {
+                return MeasurementPhase::TIMING;
+            }
+            if (m_window.is_in_image_quality_phase(now))
+            {
+                return MeasurementPhase::IMAGE_QUALITY;
+            }
+            if (m_window.is_after_window(now))
+            {
+                return MeasurementPhase::COMPLETE;
+            }
+            return MeasurementPhase::IDLE;
+        }
 
       public:
         virtual ~MeasurementBucket() = default;
@@ -262,49 +536,76 @@ namespace wvb
         {
             m_mode   = BucketMode::WINDOW;
             m_window = {};
+            update_phase();
         };
 
+        /** Reads the clock and publishes the current phase. Must be called regularly, typically once per frame, by the thread
+         * that drives the measurements. Setters update it as well. */
+        inline void update_phase() { m_phase.store(compute_phase(), std::memory_order_relaxed); }
+
+        [[nodiscard]] inline MeasurementPhase phase() const { return m_phase.load(std::memory_order_relaxed); }
+
+        /** Also updates the phase, since it is polled to know when to send the measurements. */
         [[nodiscard]] bool measurements_complete()
         {
-            return m_rtp_clock != nullptr
-                   && ((m_mode == BucketMode::WINDOW && m_window.is_valid() && m_window.is_after_window(m_rtp_clock->now()))
-                       || m_mode == BucketMode::FINISHED);
+            update_phase();
+            return phase() == MeasurementPhase::COMPLETE;
         }
 
-        [[nodiscard]] inline bool is_in_timing_phase()
+        [[nodiscard]] inline bool is_in_timing_phase() const
         {
-            return m_rtp_clock != nullptr
-                   && ((m_mode == BucketMode::WINDOW && m_window.is_valid() && m_window.is_in_timing_phase(m_rtp_clock->now()))
-                       || m_mode == BucketMode::ACCEPT_ALL);
+            const MeasurementPhase phase = m_phase.load(std::memory_order_relaxed);
+            return phase == MeasurementPhase::TIMING || phase == MeasurementPhase::ACCEPT_ALL;
         }
 
-        [[nodiscard]] inline bool is_in_image_quality_phase()
+        [[nodiscard]] inline bool is_in_image_quality_phase() const
         {
-            return m_rtp_clock != nullptr
-                   && ((m_mode == BucketMode::WINDOW && m_window.is_valid() && m_window.is_in_image_quality_phase(m_rtp_clock->now()))
-                       || m_mode == BucketMode::ACCEPT_ALL);
+            const MeasurementPhase phase = m_phase.load(std::memory_order_relaxed);
+            return phase == MeasurementPhase::IMAGE_QUALITY || phase == MeasurementPhase::ACCEPT_ALL;
         }
 
         [[nodiscard]] constexpr bool has_window() { return m_window.is_valid(); }
 
         /** Resets the window so that measurements stop early if they were in progress. */
-        void reset_window() { m_window = MeasurementWindow(); }
+        void reset_window()
+        {
+            m_window = MeasurementWindow();
+            update_phase();
+        }
 
         /** Disable window checks - all measurements are now accepted. */
-        inline void set_as_accept_all() { m_mode = BucketMode::ACCEPT_ALL; }
+        inline void set_as_accept_all()
+        {
+            m_mode = BucketMode::ACCEPT_ALL;
+            update_phase();
+        }
 
-        inline void set_as_finished() { m_mode = BucketMode::FINISHED; }
+        inline void set_as_finished()
+        {
+            m_mode = BucketMode::FINISHED;
+            update_phase();
+        }
 
-        inline void set_clock(std::shared_ptr<rtp::RTPClock> rtp_clock) { m_rtp_clock = std::move(rtp_clock); }
+        inline void set_clock(std::shared_ptr<rtp::RTPClock> rtp_clock)
+        {
+            m_rtp_clock = std::move(rtp_clock);
+            update_phase();
+        }
 
-        constexpr void set_window(MeasurementWindow window) { m_window = window; }
+        inline void set_window(MeasurementWindow window)
+        {
+            m_window = window;
+            update_phase();
+        }
     };
 
     class SocketMeasurementBucket : public MeasurementBucket
     {
-        std::vector<SocketMeasurements> m_socket_measurements;
+        std::vector<SocketMeasurements>                            m_socket_measurements;
+        std::array<SendQueueMeasurements, WVB_SEND_PRIORITY_COUNT> m_send_queue_measurements = {};
 
       public:
+        SocketMeasurementBucket() { reset_send_queue_measurements(); }
         ~SocketMeasurementBucket() override = default;
 
         void reset() override
@@ -318,6 +619,15 @@ namespace wvb
                 socket.packets_received = 0;
                 socket.packets_sent     = 0;
             }
+            reset_send_queue_measurements();
+        }
+
+        void reset_send_queue_measurements()
+        {
+            for (size_t i = 0; i < m_send_queue_measurements.size(); i++)
+            {
+                m_send_queue_measurements[i] = {.priority = static_cast<SendPriority>(i)};
+            }
         }
 
         /** Adds a new socket measurements storage for the given socket. Returns the storage id, that can be used to
@@ -365,6 +675,33 @@ namespace wvb
         }
 
         const std::vector<SocketMeasurements> &get_socket_measurements() const { return m_socket_measurements; }
+
+        /** Register a packet that left the send queue of the given priority after waiting delay_us. */
+        inline void add_send_queue_delay(SendPriority priority, uint32_t bytes, uint32_t delay_us)
+        {
+            if (is_in_timing_phase())
+            {
+                auto &measurements = m_send_queue_measurements[static_cast<uint8_t>(priority)];
+                measurements.packets_sent++;
+                measurements.bytes_sent += bytes;
+                measurements.total_delay_us += delay_us;
+                measurements.max_delay_us = std::max(measurements.max_delay_us, delay_us);
+            }
+        }
+
+        /** Replace the aggregated measurements of a class, e.g. when they are received from another device. */
+        void add_send_queue_measurements(const SendQueueMeasurements &measurements)
+        {
+            if (is_in_timing_phase() && static_cast<uint8_t>(measurements.priority) < WVB_SEND_PRIORITY_COUNT)
+            {
+                m_send_queue_measurements[static_cast<uint8_t>(measurements.priority)] = measurements;
+            }
+        }
+
+        const std::array<SendQueueMeasurements, WVB_SEND_PRIORITY_COUNT> &get_send_queue_measurements() const
+        {
+            return m_send_queue_measurements;
+        }
     };
 
     class ServerMeasurementBucket : public SocketMeasurementBucket
@@ -373,20 +710,27 @@ namespace wvb
         uint32_t m_pass_id = 0;
         uint32_t m_run_id  = 0;
 
-        std::vector<ServerFrameTimeMeasurements> m_frame_measurements;
-        std::vector<TrackingTimeMeasurements>    m_tracking_measurements;
-        std::vector<ImageQualityMeasurements>    m_image_quality_measurements;
-        uint32_t                                 m_dropped_frames  = 0; // Dropped frames because of delay
-        uint32_t                                 m_nb_saved_frames = 0; // Whether a frame was saved for image quality measurements
-
-      public:
-        ServerMeasurementBucket() : SocketMeasurementBucket()
+        TimingPhaseLog<ServerFrameTimeMeasurements>    m_frame_measurements;
+        TimingPhaseLog<TrackingTimeMeasurements>       m_tracking_measurements;
+        ImageQualityPhaseLog<ImageQualityMeasurements> m_image_quality_measurements;
+        uint32_t                                       m_dropped_frames = 0; // Dropped frames because of delay
+        // Encode and send latencies of the frames of the timing phase, recorded by the video thread as they are measured
+        StageLatencyHistograms m_stage_latencies;
+        // Frames saved for image quality measurements, in the order of the captures. They are added by the video thread, and the
+        // count is published after the id, so the main thread can read the ids below it.
+        std::array<uint32_t, WVB_BENCHMARK_NB_SAVED_FRAMES> m_saved_frame_ids {};
+        std::atomic<uint32_t>                               m_nb_saved_frames {0};
+
+        void reserve_measurement_logs()
         {
-            m_frame_measurements.reserve(WVB_BENCHMARK_TIMING_PHASE_CAPACITY);
-            m_tracking_measurements.reserve(WVB_BENCHMARK_TIMING_PHASE_CAPACITY);
-            m_image_quality_measurements.reserve(WVB_BENCHMARK_IMAGE_QUALITY_PHASE_CAPACITY);
+            m_frame_measurements.reserve(WVB_BENCHMARK_RESERVED_CHUNKS);
+            m_tracking_measurements.reserve(WVB_BENCHMARK_RESERVED_CHUNKS);
+            m_image_quality_measurements.reserve(WVB_BENCHMARK_RESERVED_CHUNKS);
         }
 
+      public:
+        ServerMeasurementBucket() : SocketMeasurementBucket() { reserve_measurement_logs(); }
+
         ~ServerMeasurementBucket() override = default;
 
         void reset() override
@@ -396,15 +740,18 @@ namespace wvb
             m_frame_measurements.clear();
             m_tracking_measurements.clear();
             m_image_quality_measurements.clear();
-            m_dropped_frames  = 0;
-            m_nb_saved_frames = 0;
+            m_dropped_frames = 0;
+            m_stage_latencies.reset();
+            m_nb_saved_frames.store(0, std::memory_order_relaxed);
+            reserve_measurement_logs();
         }
 
         inline void add_frame_time_measurement(const ServerFrameTimeMeasurements &measurement)
         {
             if (is_in_timing_phase())
             {
-                m_frame_measurements.push_back(measurement);
+                m_frame_measurements.append(measurement);
+                m_stage_latencies.record_server_frame(measurement);
             }
         }
 
@@ -412,7 +759,7 @@ namespace wvb
         {
             if (is_in_timing_phase())
             {
-                m_tracking_measurements.push_back(measurement);
+                m_tracking_measurements.append(measurement);
             }
         }
 
@@ -420,7 +767,7 @@ namespace wvb
         {
             if (is_in_image_quality_phase())
             {
-                m_image_quality_measurements.push_back(measurement);
+                m_image_quality_measurements.append(measurement);
             }
         }
 
@@ -432,11 +779,25 @@ namespace wvb
             }
         }
 
-        inline void add_saved_frame() { m_nb_saved_frames++; }
+        /** Only called by the video thread. Frames past WVB_BENCHMARK_NB_SAVED_FRAMES are ignored. */
+        inline void add_saved_frame(uint32_t frame_id)
+        {
+            const uint32_t nb_saved_frames = m_nb_saved_frames.load(std::memory_order_relaxed);
+            if (nb_saved_frames < WVB_BENCHMARK_NB_SAVED_FRAMES)
+            {
+                m_saved_frame_ids[nb_saved_frames] = frame_id;
+                m_nb_saved_frames.store(nb_saved_frames + 1, std::memory_order_release);
+            }
+        }
 
-        inline bool has_saved_frames() const { return m_nb_saved_frames == 10; }
+        inline bool has_saved_frames() const { return get_nb_saved_frames() == WVB_BENCHMARK_NB_SAVED_FRAMES; }
 
-        inline uint32_t get_nb_saved_frames() const { return m_nb_saved_frames; }
+        inline uint32_t get_nb_saved_frames() const { return m_nb_saved_frames.load(std::memory_order_acquire); }
+
+        inline std::vector<uint32_t> get_saved_frame_ids() const
+        {
+            return {m_saved_frame_ids.begin(), m_saved_frame_ids.begin() + get_nb_saved_frames()};
+        }
 
         inline void set_pass_id(uint32_t pass_id) { m_pass_id = pass_id; }
 
@@ -446,30 +807,51 @@ namespace wvb
 
         inline uint32_t get_run_id() const { return m_run_id; }
 
-        inline const std::vector<ServerFrameTimeMeasurements> &get_frame_time_measurements() const { return m_frame_measurements; }
+        inline std::vector<ServerFrameTimeMeasurements> get_frame_time_measurements() const
+        {
+            return m_frame_measurements.merged(&ServerFrameTimeMeasurements::frame_id);
+        }
 
-        inline const std::vector<TrackingTimeMeasurements> &get_tracking_time_measurements() const { return m_tracking_measurements; }
+        inline std::vector<TrackingTimeMeasurements> get_tracking_time_measurements() const
+        {
+            return m_tracking_measurements.merged(&TrackingTimeMeasurements::tracking_received_ns);
+        }
 
-        inline const std::vector<ImageQualityMeasurements> &get_image_quality_measurements() const
+        inline std::vector<ImageQualityMeasurements> get_image_quality_measurements() const
         {
-            return m_image_quality_measurements;
+            return m_image_quality_measurements.merged(&ImageQualityMeasurements::frame_id);
         }
 
         inline uint32_t get_dropped_frames() const { return m_dropped_frames; }
+
+        /** Server stages of the run. Only read once the timing phase is over, the video thread records them until then. */
+        inline const StageLatencyHistograms &get_stage_latencies() const { return m_stage_latencies; }
     };
 
     class ClientMeasurementBucket : public SocketMeasurementBucket
     {
       private:
-        std::vector<ClientFrameTimeMeasurements> m_frame_measurements;
-        std::vector<TrackingTimeMeasurements>    m_tracking_measurements;
-        std::vector<ImageQualityMeasurements>    m_image_quality_measurements;
-        std::vector<NetworkMeasurements>         m_network_measurements;
-        uint32_t                                 m_decoder_nb_pushed_frames = 0;
-        uint32_t                                 m_decoder_nb_pulled_frames = 0;
-        uint32_t                                 m_nb_saved_frames   = 0; // Whether a frame was saved for image quality measurements
-        uint32_t                                 m_nb_dropped_frames = 0;
+        TimingPhaseLog<ClientFrameTimeMeasurements>    m_frame_measurements;
+        TimingPhaseLog<TrackingTimeMeasurements>       m_tracking_measurements;
+        ImageQualityPhaseLog<ImageQualityMeasurements> m_image_quality_measurements;
+        MeasurementLog<NetworkMeasurements>            m_network_measurements;
+        uint32_t                                       m_decoder_nb_pushed_frames = 0;
+        uint32_t                                       m_decoder_nb_pulled_frames = 0;
+        uint32_t                                       m_nb_dropped_frames        = 0;
+        // Whether a frame was saved for image quality measurements
+        uint32_t m_nb_saved_frames = 0;
         uint32_t m_nb_catched_up_frames = 0; // Number of times we successfully pulled two frames at once to catch up with delay
+        // The clock sync only happens at the start of the session, so these are kept across passes
+        uint32_t m_sync_duration_us    = 0;
+        uint32_t m_sync_error_bound_us = 0;
+
+        void reserve_measurement_logs()
+        {
+            m_frame_measurements.reserve(WVB_BENCHMARK_RESERVED_CHUNKS);
+            m_tracking_measurements.reserve(WVB_BENCHMARK_RESERVED_CHUNKS);
+            m_image_quality_measurements.reserve(WVB_BENCHMARK_RESERVED_CHUNKS);
+            m_network_measurements.reserve(WVB_BENCHMARK_RESERVED_CHUNKS);
+        }
 
       public:
         void reset() override
@@ -484,15 +866,10 @@ namespace wvb
             m_decoder_nb_pulled_frames = 0;
             m_nb_saved_frames          = 0;
             m_nb_dropped_frames        = 0;
+            reserve_measurement_logs();
         }
 
-        ClientMeasurementBucket() : SocketMeasurementBucket()
-        {
-            m_frame_measurements.reserve(WVB_BENCHMARK_TIMING_PHASE_CAPACITY);
-            m_tracking_measurements.reserve(WVB_BENCHMARK_TIMING_PHASE_CAPACITY);
-            m_image_quality_measurements.reserve(WVB_BENCHMARK_IMAGE_QUALITY_PHASE_CAPACITY);
-            m_network_measurements.reserve(20);
-        }
+        ClientMeasurementBucket() : SocketMeasurementBucket() { reserve_measurement_logs(); }
 
         ~ClientMeasurementBucket() override = default;
 
@@ -500,7 +877,7 @@ namespace wvb
         {
             if (is_in_timing_phase())
             {
-                m_frame_measurements.push_back(measurement);
+                m_frame_measurements.append(measurement);
             }
         }
 
@@ -508,7 +885,7 @@ namespace wvb
         {
             if (is_in_timing_phase())
             {
-                m_tracking_measurements.push_back(measurement);
+                m_tracking_measurements.append(measurement);
             }
         }
 
@@ -516,11 +893,11 @@ namespace wvb
         {
             if (is_in_image_quality_phase())
             {
-                m_image_quality_measurements.push_back(measurement);
+                m_image_quality_measurements.append(measurement);
             }
         }
 
-        inline void add_network_measurement(NetworkMeasurements &&measurement) { m_network_measurements.push_back(measurement); }
+        inline void add_network_measurement(NetworkMeasurements &&measurement) { m_network_measurements.append(measurement); }
         inline void add_decoder_pushed_frame() { m_decoder_nb_pushed_frames++; }
         inline void add_decoder_pulled_frame() { m_decoder_nb_pulled_frames++; }
         inline void set_decoder_frame_delay(uint32_t delay) { m_decoder_nb_pushed_frames = delay; }
@@ -539,27 +916,52 @@ namespace wvb
                 m_nb_catched_up_frames++;
             }
         }
-        inline bool     has_saved_frames() const { return m_nb_saved_frames == 10; }
+        inline bool     has_saved_frames() const { return m_nb_saved_frames == WVB_BENCHMARK_NB_SAVED_FRAMES; }
         inline uint32_t get_nb_saved_frames() const { return m_nb_saved_frames; }
         inline uint32_t get_nb_dropped_frames() const { return m_nb_dropped_frames; }
         inline uint32_t get_nb_catched_up_frames() const { return m_nb_catched_up_frames; }
         inline void     set_nb_dropped_frames(uint32_t nb_dropped_frames) { m_nb_dropped_frames = nb_dropped_frames; }
         inline void     set_nb_catched_up_frames(uint32_t nb_catched_up_frames) { m_nb_catched_up_frames = nb_catched_up_frames; }
+        inline void     set_sync_stats(uint32_t sync_duration_us, uint32_t sync_error_bound_us)
+        {
+            m_sync_duration_us    = sync_duration_us;
+            m_sync_error_bound_us = sync_error_bound_us;
+        }
+        inline uint32_t get_sync_duration_us() const { return m_sync_duration_us; }
+        inline uint32_t get_sync_error_bound_us() const { return m_sync_error_bound_us; }
         void            get_rtt_stats(uint32_t &min_rtt, uint32_t &max_rtt, uint32_t &avg_rtt, uint32_t &med_rtt) const;
         void            get_clock_error_stats(uint32_t &min_clock_error, uint32_t &max_clock_error, uint32_t &med_clock_error) const;
-        const std::vector<NetworkMeasurements>         &get_network_measurements() const { return m_network_measurements; }
-        const std::vector<ClientFrameTimeMeasurements> &get_frame_time_measurements() const { return m_frame_measurements; }
-        const std::vector<TrackingTimeMeasurements>    &get_tracking_measurements() const { return m_tracking_measurements; }
-        const std::vector<ImageQualityMeasurements>    &get_image_quality_measurements() const { return m_image_quality_measurements; }
+        std::vector<NetworkMeasurements>         get_network_measurements() const { return m_network_measurements.merged(); }
+        std::vector<ClientFrameTimeMeasurements> get_frame_time_measurements() const
+        {
+            return m_frame_measurements.merged(&ClientFrameTimeMeasurements::frame_index);
+        }
+        std::vector<TrackingTimeMeasurements> get_tracking_measurements() const
+        {
+            return m_tracking_measurements.merged(&TrackingTimeMeasurements::tracking_received_ns);
+        }
+        std::vector<ImageQualityMeasurements> get_image_quality_measurements() const
+        {
+            return m_image_quality_measurements.merged(&ImageQualityMeasurements::frame_id);
+        }
         uint32_t get_decoder_frame_delay() const { return m_decoder_nb_pushed_frames - m_decoder_nb_pulled_frames; }
     };
 
     class DriverMeasurementBucket : public MeasurementBucket
     {
       private:
-        std::vector<DriverFrameTimeMeasurements> m_frame_measurements;
-        std::vector<TrackingTimeMeasurements>    m_tracking_measurements;
-        std::vector<PoseAccessTimeMeasurements>  m_pose_accesses_measurements;
+        TimingPhaseLog<DriverFrameTimeMeasurements> m_frame_measurements;
+        TimingPhaseLog<TrackingTimeMeasurements>    m_tracking_measurements;
+        TimingPhaseLog<PoseAccessTimeMeasurements>  m_pose_accesses_measurements;
+        TimingPhaseLog<PosePredictionMeasurements>  m_pose_prediction_measurements;
+
+        void reserve_measurement_logs()
+        {
+            m_frame_measurements.reserve(WVB_BENCHMARK_RESERVED_CHUNKS);
+            m_tracking_measurements.reserve(WVB_BENCHMARK_RESERVED_CHUNKS);
+            m_pose_accesses_measurements.reserve(WVB_BENCHMARK_RESERVED_CHUNKS);
+            m_pose_prediction_measurements.reserve(WVB_BENCHMARK_RESERVED_CHUNKS);
+        }
 
       public:
         void reset() override
@@ -569,14 +971,11 @@ namespace wvb
             m_frame_measurements.clear();
             m_tracking_measurements.clear();
             m_pose_accesses_measurements.clear();
+            m_pose_prediction_measurements.clear();
+            reserve_measurement_logs();
         }
 
-        DriverMeasurementBucket() : MeasurementBucket()
-        {
-            m_frame_measurements.reserve(WVB_BENCHMARK_TIMING_PHASE_CAPACITY);
-            m_tracking_measurements.reserve(WVB_BENCHMARK_TIMING_PHASE_CAPACITY);
-            m_pose_accesses_measurements.reserve(WVB_BENCHMARK_TIMING_PHASE_CAPACITY);
-        }
+        DriverMeasurementBucket() : MeasurementBucket() { reserve_measurement_logs(); }
 
         DriverMeasurementBucket(const DriverMeasurementBucket &other);
 
@@ -588,7 +987,7 @@ namespace wvb
         {
             if (is_in_timing_phase())
             {
-                m_frame_measurements.push_back(measurement);
+                m_frame_measurements.append(measurement);
             }
         }
 
@@ -596,7 +995,7 @@ namespace wvb
         {
             if (is_in_timing_phase())
             {
-                m_tracking_measurements.push_back(measurement);
+                m_tracking_measurements.append(measurement);
             }
         }
 
@@ -604,17 +1003,36 @@ namespace wvb
         {
             if (is_in_timing_phase())
             {
-                m_pose_accesses_measurements.push_back(measurement);
+                m_pose_accesses_measurements.append(measurement);
             }
         }
 
-        inline const std::vector<DriverFrameTimeMeasurements> &get_frame_time_measurements() const { return m_frame_measurements; }
+        inline void add_pose_prediction_measurement(const PosePredictionMeasurements &measurement)
+        {
+            if (is_in_timing_phase())
+            {
+                m_pose_prediction_measurements.append(measurement);
+            }
+        }
+
+        inline std::vector<DriverFrameTimeMeasurements> get_frame_time_measurements() const
+        {
+            return m_frame_measurements.merged(&DriverFrameTimeMeasurements::frame_id);
+        }
 
-        inline const std::vector<TrackingTimeMeasurements> &get_tracking_measurements() const { return m_tracking_measurements; }
+        inline std::vector<TrackingTimeMeasurements> get_tracking_measurements() const
+        {
+            return m_tracking_measurements.merged(&TrackingTimeMeasurements::tracking_received_ns);
+        }
+
+        inline std::vector<PoseAccessTimeMeasurements> get_pose_access_measurements() const
+        {
+            return m_pose_accesses_measurements.merged(&PoseAccessTimeMeasurements::pose_accessed_ns);
+        }
 
-        inline const std::vector<PoseAccessTimeMeasurements> &get_pose_access_measurements() const
+        inline std::vector<PosePredictionMeasurements> get_pose_prediction_measurements() const
         {
-            return m_pose_accesses_measurements;
+            return m_pose_prediction_measurements.merged(&PosePredictionMeasurements::target_ns);
         }
     };
 
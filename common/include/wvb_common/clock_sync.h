@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+// Number of recent samples among which the one with the lowest RTT is selected
+#define WVB_CLOCK_SYNC_FILTER_SIZE 8
+// Number of filtered samples used for the offset and drift regression
+#define WVB_CLOCK_SYNC_REGRESSION_SIZE 32
+// Below this time span, the drift can't be distinguished from the noise, so only the offset is estimated
+#define WVB_CLOCK_SYNC_MIN_DRIFT_SPAN_US 5000000
+// Maximum rate at which a correction is slewed into the clock, in microseconds per second
+#define WVB_CLOCK_SYNC_MAX_SLEW_PPM 500
+// Errors larger than this are corrected at once instead of being slewed
+#define WVB_CLOCK_SYNC_STEP_THRESHOLD_US 10000
+// Number of lowest-RTT samples kept during the startup sync
+#define WVB_CLOCK_SYNC_BURST_KEPT_SAMPLES 5
+// Minimum number of kept samples before trusting the confidence interval, since two close samples can be a coincidence
+#define WVB_CLOCK_SYNC_BURST_MIN_SAMPLES 3
+
+namespace wvb
+{
+    /**
+     * Result of a ping round trip, used to compare a local clock with a remote one.
+     *
+     * Local times should come from a clock that is never adjusted (e.g. steady clock), so that the estimation isn't
+     * disturbed by the corrections it produces.
+     */
+    struct ClockSyncSample
+    {
+        /** Local time at which the ping was sent. */
+        int64_t local_send_us = 0;
+        /** Local time at which the reply was received. */
+        int64_t local_receive_us = 0;
+        /** Remote time at which the reply was sent. */
+        int64_t remote_us = 0;
+
+        [[nodiscard]] constexpr int64_t rtt_us() const { return local_receive_us - local_send_us; }
+
+        /** Local time at which the remote timestamp is assumed to be taken, in the middle of the round trip. */
+        [[nodiscard]] constexpr int64_t local_mid_us() const { return local_send_us + rtt_us() / 2; }
+
+        /** Amount to add to the local time to obtain the remote time, assuming a symmetric path. */
+        [[nodiscard]] constexpr int64_t offset_us() const { return remote_us - local_mid_us(); }
+    };
+
+    /**
+     * Estimates the offset and the drift between a local clock and a remote one.
+     *
+     * Samples first go through a minimum-RTT filter: among the last few samples, only the one with the lowest RTT is kept,
+     * since it is the one whose offset is the least affected by queueing delays. A linear regression is then done over the
+     * filtered samples to estimate the offset and its evolution over time (drift between the two oscillators).
+     */
+    class ClockSyncEstimator
+    {
+      private:
+        size_t m_filter_size     = WVB_CLOCK_SYNC_FILTER_SIZE;
+        size_t m_regression_size = WVB_CLOCK_SYNC_REGRESSION_SIZE;
+
+        std::deque<ClockSyncSample> m_recent_samples;
+        std::deque<ClockSyncSample> m_filtered_samples;
+
+        // Result of the regression: offset = m_offset_us + m_drift * (local - m_reference_us)
+        int64_t m_reference_us = 0;
+        double  m_offset_us    = 0;
+        double  m_drift        = 0;
+        double  m_residual_us  = 0;
+
+        void fit();
+
+      public:
+        ClockSyncEstimator() = default;
+        ClockSyncEstimator(size_t filter_size, size_t regression_size);
+
+        /** Adds a new sample. Returns true if it went through the filter and the estimation was updated. */
+        bool add_sample(const ClockSyncSample &sample);
+
+        void reset();
+
+        [[nodiscard]] inline bool has_estimate() const { return !m_filtered_samples.empty(); }
+
+        /** Number of samples that went through the filter and are currently used for the estimation. */
+        [[nodiscard]] inline size_t nb_filtered_samples() const { return m_filtered_samples.size(); }
+
+        /** Estimated amount to add to the given local time to obtain the remote time. */
+        [[nodiscard]] double offset_at(int64_t local_us) const;
+
+        /** Estimated drift of the remote clock relative to the local one, in parts per million. */
+        [[nodiscard]] inline double drift_ppm() const { return m_drift * 1e6; }
+
+        /** Standard deviation of the filtered samples around the estimation. */
+        [[nodiscard]] inline double residual_us() const { return m_residual_us; }
+    };
+
+    /**
+     * Estimates the offset between a local clock and a remote one from a short burst of pings, as done when a session starts.
+     *
+     * Only the samples with the lowest RTT are kept, and the offset is their mean. The drift is neglected, since the whole
+     * burst only lasts a fraction of a second. A confidence interval is computed on the mean, so that the sync can stop as soon
+     * as it is precise enough instead of always sending the same number of pings.
+     */
+    class ClockSyncBurstFilter
+    {
+      private:
+        size_t m_nb_kept_samples = WVB_CLOCK_SYNC_BURST_KEPT_SAMPLES;
+        size_t m_nb_samples      = 0;
+
+        // Sorted by increasing RTT
+        std::vector<ClockSyncSample> m_best_samples;
+
+        double m_offset_us     = 0;
+        double m_confidence_us = std::numeric_limits<double>::infinity();
+
+        void update_estimate();
+
+      public:
+        ClockSyncBurstFilter() = default;
+        /** Below WVB_CLOCK_SYNC_BURST_MIN_SAMPLES kept samples, there will never be a confidence interval. */
+        explicit ClockSyncBurstFilter(size_t nb_kept_samples);
+
+        void add_sample(const ClockSyncSample &sample);
+
+        void reset();
+
+        /** Total number of samples received, including the ones that were discarded. */
+        [[nodiscard]] inline size_t nb_samples() const { return m_nb_samples; }
+
+        /** Number of samples currently used for the estimation. */
+        [[nodiscard]] inline size_t nb_kept_samples() const { return m_best_samples.size(); }
+
+        [[nodiscard]] inline bool has_estimate() const { return !m_best_samples.empty(); }
+
+        /** Estimated amount to add to the local time to obtain the remote time. */
+        [[nodiscard]] inline double offset_us() const { return m_offset_us; }
+
+        /**
+         * Half-width of the 95% confidence interval of the offset, in microseconds.
+         * Infinite until enough samples were kept to compute it.
+         */
+        [[nodiscard]] inline double confidence_us() const { return m_confidence_us; }
+    };
+} // namespace wvb
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#define WVB_COLUMNAR_FILE_MAGIC   "WVBC"
+#define WVB_COLUMNAR_FILE_VERSION 1
+
+namespace wvb
+{
+    enum class ColumnType : uint8_t
+    {
+        /** One byte per value, 0 or 1. */
+        BOOL    = 0,
+        INT32   = 1,
+        UINT32  = 2,
+        INT64   = 3,
+        FLOAT32 = 4,
+        /** Each value is its length as a uint32, followed by its characters. */
+        STRING = 5,
+    };
+
+    template<typename T>
+    [[nodiscard]] constexpr ColumnType column_type_of()
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            return ColumnType::BOOL;
+        }
+        else if constexpr (std::is_same_v<T, int32_t>)
+        {
+            return ColumnType::INT32;
+        }
+        else if constexpr (std::is_same_v<T, uint32_t>)
+        {
+            return ColumnType::UINT32;
+        }
+        else if constexpr (std::is_same_v<T, int64_t>)
+        {
+            return ColumnType::INT64;
+        }
+        else
+        {
+            static_assert(std::is_same_v<T, float>, "Unsupported column type");
+            return ColumnType::FLOAT32;
+        }
+    }
+
+    /**
+     * Writes measurement tables in a binary columnar file, which is much faster to write and to load than CSV.
+     *
+     * The file starts with the WVB_COLUMNAR_FILE_MAGIC characters and the version as a uint32, followed by the tables until the end
+     * of the file. A table is its name, its number of columns and its number of rows as uint32. Then, each column is its name, its
+     * ColumnType as a uint8, the size of its data in bytes as a uint64, and its data. Names are stored like string values.
+     *
+     * Values are stored in the byte order of the machine, which is little-endian on all supported platforms. Each column is written
+     * with a single write, from a contiguous copy of the field when the rows are structs.
+     */
+    class ColumnarFileWriter
+    {
+        std::ofstream m_file;
+        uint32_t      m_nb_rows              = 0;
+        uint32_t      m_nb_remaining_columns = 0;
+
+        template<typename T>
+        inline void write_value(const T &value)
+        {
+            m_file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        void write_string(const std::string &value);
+
+        /** Writes the header of the next column of the table. */
+        void begin_column(const std::string &name, ColumnType type, uint64_t size);
+
+      public:
+        explicit ColumnarFileWriter(const std::string &path);
+
+        [[nodiscard]] inline bool is_open() const { return m_file.is_open(); }
+
+        /** Writes the buffered data and closes the file. Returns false if any write failed. */
+        bool close();
+
+        /** Starts a table. Exactly nb_columns columns of nb_rows values must then be written. */
+        void begin_table(const std::string &name, uint32_t nb_columns, uint32_t nb_rows);
+
+        template<typename T>
+        void write_column(const std::string &name, const std::vector<T> &values)
+        {
+            if (values.size() != m_nb_rows)
+            {
+                throw std::invalid_argument("ColumnarFileWriter: column \"" + name + "\" doesn't have the row count of its table");
+            }
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                // std::vector<bool> isn't contiguous
+                write_column(name, std::vector<uint8_t>(values.begin(), values.end()), ColumnType::BOOL);
+            }
+            else
+            {
+                begin_column(name, column_type_of<T>(), values.size() * sizeof(T));
+                m_file.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+            }
+        }
+
+        void write_column(const std::string &name, const std::vector<uint8_t> &values, ColumnType type);
+
+        void write_column(const std::string &name, const std::vector<std::string> &values);
+
+        /** Writes a field of each row. */
+        template<typename Row, typename T>
+        void write_column(const std::string &name, const std::vector<Row> &rows, T Row::*field)
+        {
+            using Stored = std::conditional_t<std::is_same_v<T, bool>, uint8_t, T>;
+
+            std::vector<Stored> values(rows.size());
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                values[i] = static_cast<Stored>(rows[i].*field);
+            }
+
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                write_column(name, values, ColumnType::BOOL);
+            }
+            else
+            {
+                write_column(name, values);
+            }
+        }
+    };
+
+    struct ColumnarColumn
+    {
+        std::string          name;
+        ColumnType           type = ColumnType::BOOL;
+        std::vector<uint8_t> data;
+
+        /** Returns the values of a numerical column, which must have the type T. */
+        template<typename T>
+        [[nodiscard]] std::vector<T> values() const
+        {
+            using Stored = std::conditional_t<std::is_same_v<T, bool>, uint8_t, T>;
+            if (type != column_type_of<T>())
+            {
+                throw std::runtime_error("ColumnarColumn: column \"" + name + "\" doesn't have the requested type");
+            }
+
+            std::vector<Stored> stored(data.size() / sizeof(Stored));
+            std::memcpy(stored.data(), data.data(), stored.size() * sizeof(Stored));
+            return std::vector<T>(stored.begin(), stored.end());
+        }
+
+        [[nodiscard]] std::vector<std::string> strings() const;
+
+        /** Returns the values of a numerical column of any type, converted to int64. Floats are truncated. */
+        [[nodiscard]] std::vector<int64_t> int64_values() const;
+    };
+
+    struct ColumnarTable
+    {
+        std::string                 name;
+        uint32_t                    nb_rows = 0;
+        std::vector<ColumnarColumn> columns;
+
+        /** Returns the column with the given name, or nullptr. */
+        [[nodiscard]] const ColumnarColumn *column(const std::string &column_name) const;
+    };
+
+    /** Reads all the tables of a columnar file. Throws a std::runtime_error if it can't be read or is malformed. */
+    std::vector<ColumnarTable> read_columnar_file(const std::string &path);
+} // namespace wvb
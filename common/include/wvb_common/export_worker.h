@@ -0,0 +1,59 @@
+#pragma once
+
+#include "macros.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Number of exports that can wait for the worker before submit() blocks
+#define WVB_EXPORT_WORKER_QUEUE_CAPACITY 8
+
+namespace wvb
+{
+    /** Outcome of an export, reported once its file is written and synced to disk. */
+    struct ExportResult
+    {
+        std::string path;
+        bool        success = false;
+    };
+
+    /**
+     * Writes measurement files in a background thread, so that the thread handing them off can move on without waiting for the disk.
+     *
+     * Each export writes a single file, from data that it owns: typically a snapshot of the measurement buckets moved into its write
+     * function. Exports are processed in batches: all the exports waiting in the queue are written, then their files are synced to
+     * disk together. Results are reported to on_result from the worker thread, which should hand them back to the thread that
+     * submitted the exports, e.g. with Reactor::post().
+     *
+     * The queue is bounded: submit() blocks while it is full, so that snapshots can't pile up in memory when the disk can't keep up.
+     * Pending exports are completed before the worker is destroyed.
+     */
+    class ExportWorker
+    {
+        PIMPL_CLASS(ExportWorker);
+
+      public:
+        /** Writes the file at the given path. Returns false if it couldn't be written. Called from the worker thread. */
+        typedef std::function<bool(const std::string &path)> WriteFunction;
+        typedef std::function<void(const ExportResult &result)> ResultCallback;
+
+        explicit ExportWorker(ResultCallback on_result = nullptr, size_t queue_capacity = WVB_EXPORT_WORKER_QUEUE_CAPACITY);
+
+        /** Thread-safe. Queues the export of a file, and blocks while the queue is full. */
+        void submit(std::string path, WriteFunction write);
+
+        /** Thread-safe. Blocks until all the submitted exports are complete and reported. */
+        void wait_idle();
+
+        /** Number of exports that were submitted, but not reported yet. */
+        [[nodiscard]] size_t nb_pending() const;
+
+        /** Number of exports that failed since the worker was created. */
+        [[nodiscard]] uint32_t nb_failed() const;
+    };
+
+    /** Flushes the content of a file to the disk. Returns false if it failed. */
+    bool sync_file(const std::string &path);
+} // namespace wvb
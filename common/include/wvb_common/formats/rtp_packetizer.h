@@ -51,6 +51,7 @@ namespace wvb
 
         uint32_t                              m_current_rtp_timestamp      = 0;
         uint32_t                              m_current_rtp_pose_timestamp = 0;
+        Pose                                  m_current_rendered_pose      = {};
         uint32_t                              m_current_frame_id           = 0;
         std::chrono::steady_clock::time_point m_last_packet_received_time ;
 
@@ -75,6 +76,7 @@ namespace wvb
                                 bool *__restrict out_eos,
                                 uint32_t *__restrict out_rtp_timestamp,
                                 uint32_t *__restrict out_rtp_pose_timestamp,
+                                Pose *__restrict out_rendered_pose,
                                 std::chrono::steady_clock::time_point *out_last_packet_received_time,
                                 bool *__restrict out_save_frame) override;
         void release_frame_data() override {/** TODO */};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "video_encoder.h"
+
+#include <cstdint>
+
+// Side of the square window of the SSIM, like scikit-image's structural_similarity
+#define WVB_SSIM_WINDOW_SIZE 7
+// MS-SSIM scales, with the weights of Wang et al.
+#define WVB_MS_SSIM_NB_SCALES 5
+// Rows of a tile, the unit of work of the threads
+#define WVB_IMAGE_QUALITY_TILE_ROWS 64
+
+namespace wvb
+{
+    struct ImageQualityMetrics
+    {
+        /** In dB, infinite if the images are identical. */
+        double psnr    = 0;
+        double ssim    = 0;
+        double ms_ssim = 0;
+    };
+
+    /**
+     * Measures the quality of a distorted image, typically a decoded frame, compared to the reference one.
+     *
+     * Supported formats are R8G8B8A8_UNORM and B8G8R8A8_UNORM, for which alpha is ignored, and NV12. The metrics are computed on
+     * each channel, and averaged with the weight of their number of samples: the channels have the same weight in RGB, and the
+     * chroma planes of NV12 have a quarter of the weight of its luma plane.
+     *
+     * - PSNR is computed from the mean squared error of all the samples.
+     * - SSIM follows the default parameters of scikit-image: uniform 7x7 window, sample covariance, K1 = 0.01, K2 = 0.03, and the
+     *   mean over the pixels whose window fits in the image.
+     * - MS-SSIM combines the contrast-structure terms of the first scales and the SSIM of the last one, each clamped at 0, with the
+     *   weights of Wang et al. Each scale is downsampled by averaging 2x2 blocks. Smaller images use fewer scales.
+     *
+     * The images are split in tiles of rows that are processed by nb_threads threads, or one per core if it is 0. The results don't
+     * depend on the number of threads. Throws std::invalid_argument if the images don't have the same supported format and size, or
+     * are smaller than the SSIM window.
+     */
+    ImageQualityMetrics compute_image_quality(const RawFrame &reference, const RawFrame &distorted, uint32_t nb_threads = 0);
+} // namespace wvb
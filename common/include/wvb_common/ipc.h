@@ -5,8 +5,11 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 namespace wvb
 {
@@ -54,6 +57,9 @@ namespace wvb
 
             /** Unlocks the mutex. Unsafe if the pointer is used afterwards. */
             void unsafe_release() const;
+
+            /** Returns a pointer to the data without locking the mutex. */
+            [[nodiscard]] void *unsafe_data() const;
         };
     } // namespace _impl
 
@@ -133,14 +139,207 @@ namespace wvb
 
         // Smart pointer to lock the mutex
         [[nodiscard]] inline LockedDataPtr<T> lock(uint32_t timeout_ms = NO_TIMEOUT) { return LockedDataPtr<T>(&m_impl, timeout_ms); }
+
+        /** Pointer to the data, without locking the mutex. Only use it for fields that synchronize themselves, like a SeqLock. */
+        [[nodiscard]] inline T *unlocked() const { return static_cast<T *>(m_impl.unsafe_data()); }
     };
 
     // endregion Shared Memory
 
+    // region Lock-free publication
+
+#define WVB_SEQLOCK_MAX_READ_ATTEMPTS 1000
+
+    /**
+     * Lock-free publication of a value by a single writer to any number of readers (seqlock). Designed to be placed in a shared
+     * memory: writes never wait, and readers retry if a write happened during their copy, so they never see a torn value.
+     *
+     * The value is stored as atomic words so that concurrent copies are well-defined. Memory filled with zeros is a valid
+     * empty SeqLock, which is the case of a newly created shared memory.
+     */
+    template<typename T>
+    class SeqLock
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "SeqLock can only contain trivially copyable values");
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "Lock-free 64 bit atomics are required in shared memory");
+
+      private:
+        static constexpr size_t NB_WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        /** Odd while a write is in progress. */
+        std::atomic<uint32_t> m_sequence {0};
+        std::atomic<uint64_t> m_words[NB_WORDS] {};
+
+      public:
+        /** Publishes a new value. Only one thread may write at a time. */
+        void store(const T &value)
+        {
+            uint64_t words[NB_WORDS] = {};
+            std::memcpy(words, &value, sizeof(T));
+
+            // If a previous writer crashed during a write, the sequence is already odd
+            const uint32_t begin = m_sequence.load(std::memory_order_relaxed) | 1;
+            m_sequence.store(begin, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for (size_t i = 0; i < NB_WORDS; i++)
+            {
+                m_words[i].store(words[i], std::memory_order_relaxed);
+            }
+
+            m_sequence.store(begin + 1, std::memory_order_release);
+        }
+
+        /**
+         * Reads the latest published value. Returns false if no consistent value could be read after the given number of attempts,
+         * which happens if the writer died during a write, or if it writes continuously without any pause.
+         */
+        bool load(T &value, uint32_t max_attempts = WVB_SEQLOCK_MAX_READ_ATTEMPTS) const
+        {
+            uint64_t words[NB_WORDS];
+            for (uint32_t attempt = 0; attempt < max_attempts; attempt++)
+            {
+                const uint32_t begin = m_sequence.load(std::memory_order_acquire);
+                if ((begin & 1) != 0)
+                {
+                    // Write in progress
+                    continue;
+                }
+
+                for (size_t i = 0; i < NB_WORDS; i++)
+                {
+                    words[i] = m_words[i].load(std::memory_order_relaxed);
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_sequence.load(std::memory_order_relaxed) == begin)
+                {
+                    std::memcpy(&value, words, sizeof(T));
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /** Number of values published so far. Can be used by readers to know if there is a new value. */
+        [[nodiscard]] inline uint32_t version() const { return m_sequence.load(std::memory_order_acquire) / 2; }
+    };
+
+    /**
+     * Lock-free queue between a single producer and a single consumer (SPSC ring). Designed to be placed in a shared memory, like
+     * SeqLock: the producer never waits, and values are dropped and counted if the ring is full. Memory filled with zeros is a valid
+     * empty ring.
+     *
+     * Several producer threads are allowed if they are serialized by another mechanism, e.g. a mutex. Same for consumers.
+     */
+    template<typename T, size_t CAPACITY>
+    class SharedRing
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "SharedRing can only contain trivially copyable values");
+        static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "SharedRing capacity must be a power of two");
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "Lock-free 64 bit atomics are required in shared memory");
+
+      private:
+        // Indices only grow, the slot is the index modulo the capacity. They are on separate cache lines, so that the producer and
+        // the consumer don't invalidate each other's cache.
+        /** Next index to write. Only written by the producer. */
+        alignas(64) std::atomic<uint64_t> m_head {0};
+        /** Next index to read. Only written by the consumer. */
+        alignas(64) std::atomic<uint64_t> m_tail {0};
+        alignas(64) std::atomic<uint64_t> m_nb_dropped {0};
+        T m_values[CAPACITY] {};
+
+      public:
+        /** Adds a value at the end of the ring. If it is full, the value is dropped and false is returned. Never waits. */
+        bool push(const T &value)
+        {
+            const uint64_t head = m_head.load(std::memory_order_relaxed);
+            if (head - m_tail.load(std::memory_order_acquire) >= CAPACITY)
+            {
+                m_nb_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            m_values[head % CAPACITY] = value;
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** Removes the oldest value from the ring. Returns false if it is empty. */
+        bool pop(T &value)
+        {
+            const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail == m_head.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            value = m_values[tail % CAPACITY];
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** Removes all the available values, from the oldest to the newest, and passes them to the callback. Returns their number. */
+        template<typename F>
+        size_t drain(F &&callback)
+        {
+            const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+            const uint64_t head = m_head.load(std::memory_order_acquire);
+            for (uint64_t i = tail; i < head; i++)
+            {
+                callback(static_cast<const T &>(m_values[i % CAPACITY]));
+            }
+
+            // Release the slots all at once
+            m_tail.store(head, std::memory_order_release);
+            return static_cast<size_t>(head - tail);
+        }
+
+        /** Discards the available values and resets the number of dropped values. Must be called by the consumer, while the producer
+         * is not pushing. */
+        void clear()
+        {
+            m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+            m_nb_dropped.store(0, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] inline size_t size() const
+        {
+            // Read the tail first: the head can only grow, so it can't be behind it
+            const uint64_t tail = m_tail.load(std::memory_order_acquire);
+            return static_cast<size_t>(m_head.load(std::memory_order_acquire) - tail);
+        }
+        [[nodiscard]] inline bool     empty() const { return size() == 0; }
+        [[nodiscard]] inline bool     full() const { return size() >= CAPACITY; }
+        [[nodiscard]] inline uint64_t nb_dropped() const { return m_nb_dropped.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] static constexpr size_t capacity() { return CAPACITY; }
+    };
+
+    // endregion Lock-free publication
+
     // region Events
 
+    /** What happens to a signaled event when a wait succeeds. */
+    enum class EventResetMode
+    {
+        /** A successful wait consumes the signal: only one waiter is woken up per signal. */
+        AUTO,
+        /** The event stays signaled until reset() is called: all the waiters are woken up. */
+        MANUAL,
+    };
+
+    /** Primitive used by the event. Only Linux has several implementations, the other platforms ignore it. */
+    enum class EventBackend
+    {
+        /** Fastest available primitive. On Linux, a futex word placed in shared memory. */
+        DEFAULT,
+        /** Named POSIX semaphore. Kept to compare the implementations. */
+        SEMAPHORE,
+    };
+
     /** Inter process event that can be used to signal the other process, for example that new data is available on the shared memory.
-     * An event is unidirectional: it has a sender side and a receiver side. */
+     * An event is unidirectional: it has a sender side and a receiver side. Both sides must use the same reset mode and backend. */
     class InterProcessEvent
     {
       private:
@@ -150,7 +349,10 @@ namespace wvb
 
       public:
         InterProcessEvent() = default;
-        explicit InterProcessEvent(const char *event_name, bool is_sender);
+        explicit InterProcessEvent(const char    *event_name,
+                                   bool           is_sender,
+                                   EventResetMode reset_mode = EventResetMode::AUTO,
+                                   EventBackend   backend    = EventBackend::DEFAULT);
         InterProcessEvent(const InterProcessEvent &other) = delete;
         InterProcessEvent(InterProcessEvent &&other) noexcept : m_data(other.m_data) { other.m_data = nullptr; }
         ~InterProcessEvent();
@@ -169,7 +371,8 @@ namespace wvb
 
         [[nodiscard]] inline bool is_valid() const { return m_data != nullptr; }
 
-        /** Waits for the event to be triggered. Return false in case of timeout. Resets the event once received. */
+        /** Waits for the event to be triggered. Return false in case of timeout. In auto reset mode, resets the event once received.
+         * The timeout is measured with a monotonic clock where available. */
         bool wait(uint32_t timeout_ms = NO_TIMEOUT) const; // NOLINT(modernize-use-nodiscard)
 
         /** Signals the event. */
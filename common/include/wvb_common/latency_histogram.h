@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+// Number of bits kept exactly in the values of a histogram bucket, after the leading one. Values are recorded with a relative
+// precision of 2^-7, i.e. better than 1%.
+#define WVB_LATENCY_HISTOGRAM_PRECISION_BITS 7
+// Values must fit in this number of bits to be recorded exactly. 2^36 ns is about 68 s.
+#define WVB_LATENCY_HISTOGRAM_MAX_VALUE_BITS 36
+// Relative error of the quantiles returned by a QuantileSketch
+#define WVB_QUANTILE_SKETCH_RELATIVE_ACCURACY 0.01
+// Maximum number of buckets of a QuantileSketch. Past it, the lowest buckets are merged, so the high quantiles stay accurate.
+#define WVB_QUANTILE_SKETCH_MAX_BUCKETS 2048
+
+namespace wvb
+{
+    /**
+     * Log-bucketed histogram of non-negative integer values, like HdrHistogram.
+     *
+     * Values are grouped by power of 2, and each group is split in 2^WVB_LATENCY_HISTOGRAM_PRECISION_BITS linear sub-buckets, so
+     * that the bucket of a value is found with a bit scan. Recording is O(1) and never allocates, which makes it usable on the
+     * threads that take measurements. Quantiles are computed from the counts, with the precision of a bucket. Histograms have the
+     * same layout, so merging them is exact.
+     *
+     * Values outside of [0, 2^WVB_LATENCY_HISTOGRAM_MAX_VALUE_BITS[, e.g. negative latencies caused by a clock synchronization
+     * error, are clamped to that range and counted separately.
+     */
+    class LatencyHistogram
+    {
+      public:
+        static constexpr uint32_t SUB_BUCKET_HALF_COUNT = 1u << WVB_LATENCY_HISTOGRAM_PRECISION_BITS;
+        static constexpr int64_t  MAX_VALUE             = (int64_t(1) << WVB_LATENCY_HISTOGRAM_MAX_VALUE_BITS) - 1;
+        static constexpr size_t   NB_BUCKETS =
+            (WVB_LATENCY_HISTOGRAM_MAX_VALUE_BITS - WVB_LATENCY_HISTOGRAM_PRECISION_BITS + 1) * SUB_BUCKET_HALF_COUNT;
+
+      private:
+        std::vector<uint64_t> m_counts;
+        uint64_t              m_count           = 0;
+        uint64_t              m_nb_out_of_range = 0;
+        int64_t               m_min             = MAX_VALUE;
+        int64_t               m_max             = 0;
+        int64_t               m_sum             = 0;
+
+      public:
+        LatencyHistogram() : m_counts(NB_BUCKETS, 0) {}
+
+        /** Index of the bucket of a value in [0, MAX_VALUE]. Values below 2 * SUB_BUCKET_HALF_COUNT have their own bucket. */
+        [[nodiscard]] static constexpr size_t bucket_index(int64_t value) noexcept
+        {
+            constexpr uint32_t exact_bits     = WVB_LATENCY_HISTOGRAM_PRECISION_BITS + 1;
+            const auto         unsigned_value = static_cast<uint64_t>(value);
+            // Values with at most exact_bits bits have their own bucket
+            const uint32_t shift = std::max(static_cast<uint32_t>(std::bit_width(unsigned_value)), exact_bits) - exact_bits;
+            return shift * SUB_BUCKET_HALF_COUNT + (unsigned_value >> shift);
+        }
+
+        /** Smallest value of a bucket. */
+        [[nodiscard]] static constexpr int64_t bucket_lowest_value(size_t index) noexcept
+        {
+            if (index < 2 * SUB_BUCKET_HALF_COUNT)
+            {
+                return static_cast<int64_t>(index);
+            }
+            const size_t shift = index / SUB_BUCKET_HALF_COUNT - 1;
+            return static_cast<int64_t>((index - shift * SUB_BUCKET_HALF_COUNT) << shift);
+        }
+
+        /** Largest value of a bucket. */
+        [[nodiscard]] static constexpr int64_t bucket_highest_value(size_t index) noexcept
+        {
+            return bucket_lowest_value(index + 1) - 1;
+        }
+
+        inline void record(int64_t value) noexcept
+        {
+            if (value < 0 || value > MAX_VALUE)
+            {
+                value = value < 0 ? 0 : MAX_VALUE;
+                m_nb_out_of_range++;
+            }
+            m_counts[bucket_index(value)]++;
+            m_count++;
+            m_min = std::min(m_min, value);
+            m_max = std::max(m_max, value);
+            m_sum += value;
+        }
+
+        /** Adds the values of another histogram to this one. */
+        void merge(const LatencyHistogram &other);
+
+        void reset();
+
+        [[nodiscard]] inline uint64_t count() const { return m_count; }
+        [[nodiscard]] inline bool     empty() const { return m_count == 0; }
+        /** Number of values that were clamped to the recordable range. */
+        [[nodiscard]] inline uint64_t nb_out_of_range() const { return m_nb_out_of_range; }
+        [[nodiscard]] inline int64_t  min() const { return empty() ? 0 : m_min; }
+        [[nodiscard]] inline int64_t  max() const { return m_max; }
+        [[nodiscard]] inline double   mean() const { return empty() ? 0 : static_cast<double>(m_sum) / static_cast<double>(m_count); }
+
+        /**
+         * Returns the value below which the given fraction of the values are, e.g. 0.99 for the 99th percentile.
+         * It is the largest value of the bucket holding that quantile, so it is at most one bucket width above the exact one.
+         */
+        [[nodiscard]] int64_t value_at_quantile(double quantile) const;
+
+        /** Calls fn(bucket_lowest_value, bucket_highest_value, count) for each non-empty bucket, in increasing order. */
+        template<typename Fn>
+        void for_each_bucket(Fn &&fn) const
+        {
+            for (size_t i = 0; i < m_counts.size(); i++)
+            {
+                if (m_counts[i] != 0)
+                {
+                    fn(bucket_lowest_value(i), bucket_highest_value(i), m_counts[i]);
+                }
+            }
+        }
+    };
+
+    /**
+     * Mergeable quantile sketch with a relative error guarantee, like DDSketch.
+     *
+     * Positive values are mapped to buckets of logarithmically growing width, so that every value of a bucket is within
+     * WVB_QUANTILE_SKETCH_RELATIVE_ACCURACY of its representative value. Unlike LatencyHistogram, the range of the values isn't fixed
+     * and only the buckets between the smallest and the largest values are allocated, which makes it compact enough to summarize
+     * whole passes. Values below 1, e.g. negative latencies, are counted in a zero bucket.
+     *
+     * Adding a value is O(1), except when the range of buckets grows. Sketches merge without losing accuracy.
+     */
+    class QuantileSketch
+    {
+        /** Counts of the buckets, from m_min_key. */
+        std::vector<uint64_t> m_counts;
+        int32_t               m_min_key    = 0;
+        uint64_t              m_zero_count = 0;
+        uint64_t              m_count      = 0;
+        double                m_min        = 0;
+        double                m_max        = 0;
+        double                m_sum        = 0;
+
+        void add_to_bucket(int32_t key, uint64_t count);
+
+      public:
+        /** Adds count occurrences of the value. */
+        void add(double value, uint64_t count = 1);
+
+        /** Adds all the values of a histogram, each bucket being represented by its middle value. The statistics stay exact. */
+        void add(const LatencyHistogram &histogram);
+
+        void merge(const QuantileSketch &other);
+
+        void reset();
+
+        [[nodiscard]] inline uint64_t count() const { return m_count; }
+        [[nodiscard]] inline bool     empty() const { return m_count == 0; }
+        [[nodiscard]] inline double   min() const { return m_min; }
+        [[nodiscard]] inline double   max() const { return m_max; }
+        [[nodiscard]] inline double   mean() const { return empty() ? 0 : m_sum / static_cast<double>(m_count); }
+
+        /** Returns the value below which the given fraction of the values are, within the relative accuracy of the sketch. */
+        [[nodiscard]] double value_at_quantile(double quantile) const;
+    };
+} // namespace wvb
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "benchmark.h"
+#include "columnar_file.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Prefix of the measurement files of the runs, followed by "<pass>_run_<run>" and the extension of their format
+#define WVB_MEASUREMENT_FILE_PREFIX "wvb_measurements_pass_"
+
+namespace wvb
+{
+    /**
+     * Reads all the tables of a measurement file, in the binary columnar format or in the CSV one. Columns of CSV files are INT64 if
+     * all their values are integers, FLOAT32 if they are numbers, and STRING otherwise. Throws a std::runtime_error if the file can't
+     * be read or is malformed.
+     */
+    std::vector<ColumnarTable> read_measurement_file(const std::string &path);
+
+    /**
+     * Frame times of a run, loaded from its measurement file. Times are in nanoseconds.
+     *
+     * The tables are joined like wvb_combine_all_times() of wvb_measurements.py: on the frame id for the frame times, and on the pose
+     * timestamp for the tracking times.
+     */
+    struct RunFrameTimes
+    {
+        uint32_t pass_id = 0;
+        uint32_t run_id  = 0;
+        /** Frames measured by both the driver and the server, in the same order. */
+        std::vector<DriverFrameTimeMeasurements> driver_frames;
+        std::vector<ServerFrameTimeMeasurements> server_frames;
+        std::vector<ClientFrameTimeMeasurements> client_frames;
+
+        /** Sample of the clock error of the client for ClientClockErrorFit, only set if a frame could be matched to its pose. */
+        bool has_clock_error = false;
+        /** Time at which the frame of the sample was presented by the driver. */
+        int64_t clock_error_time_ns = 0;
+        /** Minimum time between the sampling of the pose of a frame by the client and its reception by the server. */
+        int64_t clock_error_ns = 0;
+
+        /** Throws a std::runtime_error if the file can't be read, or a table or a column is missing. */
+        static RunFrameTimes load(const std::string &path, uint32_t pass_id, uint32_t run_id);
+    };
+
+    /**
+     * Linear model of the clock error of the client, fitted across runs like wvb_get_client_clock_error_fn() of wvb_measurements.py.
+     *
+     * The client samples the tracking data before the server receives it, so the time between the two can't be negative with
+     * synchronized clocks. The minimum of that time in each run, at the time of its frame, gives a sample of the error of the client
+     * clock. A line fitted to the samples gives the offset to remove from the client times.
+     */
+    struct ClientClockErrorFit
+    {
+        double   slope        = 0;
+        double   intercept_ns = 0;
+        uint32_t nb_samples   = 0;
+
+        /** With a single sample, the error is constant. Without any, no correction is applied. */
+        static ClientClockErrorFit fit(const std::vector<RunFrameTimes> &runs);
+
+        /** Moves the times of the client frames to the timeline of the server. Times that weren't measured are left at 0. */
+        void correct(std::vector<ClientFrameTimeMeasurements> &client_frames) const;
+
+        static void export_csv(std::ofstream &file, const ClientClockErrorFit &fit);
+
+        static void export_columns(ColumnarFileWriter &file, const std::string &table_name, const ClientClockErrorFit &fit);
+    };
+
+    /** Summary of the runs of a pass. */
+    struct PassAnalysis
+    {
+        uint32_t pass_id   = 0;
+        uint32_t nb_runs   = 0;
+        uint64_t nb_frames = 0;
+        /** Rate of the frames presented by the driver, and of the frames submitted by the client, averaged over the runs. */
+        double                 driver_fps = 0;
+        double                 client_fps = 0;
+        StageLatencyHistograms latencies;
+
+        /** Writes the frame rates. The latencies are exported with StageLatencyHistograms. */
+        static void export_csv(std::ofstream &file, const PassAnalysis &analysis);
+
+        static void export_columns(ColumnarFileWriter &file, const std::string &table_name, const PassAnalysis &analysis);
+    };
+
+    struct MeasurementAnalysis
+    {
+        ClientClockErrorFit       client_clock_error;
+        std::vector<PassAnalysis> passes;
+    };
+
+    /**
+     * Analyzes all the measurement files of a directory. A run exported in both formats is loaded from its binary file.
+     *
+     * Runs are loaded and summarized from nb_threads threads, or one per core if it is 0. The clock error of the client is fitted
+     * across all the runs, and removed from the client times before the stage latencies are computed if correct_client_clock is set.
+     * Throws a std::runtime_error if a file can't be loaded.
+     */
+    MeasurementAnalysis analyze_measurements(const std::string &directory, bool correct_client_clock = true, uint32_t nb_threads = 0);
+} // namespace wvb
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace wvb
+{
+    /** Size of the cache lines, to keep the data written by different threads apart. */
+#define WVB_CACHE_LINE_SIZE 64
+
+    /** Returns a new id for a measurement log. Ids are never reused, so that thread-local caches can't point to a destroyed log. */
+    inline uint64_t next_measurement_log_id()
+    {
+        static std::atomic<uint64_t> next_id {1};
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Append-only list of measurements that can be recorded from several threads without locks.
+     *
+     * Each thread appends to its own log, registered with this one the first time it records a measurement. Thread logs are made
+     * of fixed-size chunks: once written, records never move, and a chunk is only allocated when the previous one is full. The
+     * chunks are kept on reset, so that in steady state, recording a measurement never allocates. Chunks can also be allocated
+     * ahead with reserve(), so that the first records of a thread don't allocate either. Thread logs and chunks are aligned on
+     * cache lines, so that threads never write to the same line.
+     *
+     * All the thread logs are merged and sorted when the measurements are exported, which can be done from any thread, while
+     * measurements are recorded. Only clear() must not be called at the same time as append().
+     */
+    template<typename T, size_t CHUNK_SIZE = 512, size_t MAX_CHUNKS = 64>
+    class MeasurementLog
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "MeasurementLog can only contain trivially copyable values");
+
+      private:
+        struct alignas(WVB_CACHE_LINE_SIZE) Chunk
+        {
+            T records[CHUNK_SIZE];
+        };
+
+        struct alignas(WVB_CACHE_LINE_SIZE) ThreadLog
+        {
+            std::thread::id owner;
+            /** Number of published records. Only written by the owner, except when the log is cleared. */
+            std::atomic<size_t> size {0};
+            /** Records that didn't fit in the chunks. */
+            std::atomic<size_t> nb_dropped {0};
+            /** Only written by the owner, before publishing the first record of the chunk. */
+            std::array<std::unique_ptr<Chunk>, MAX_CHUNKS> chunks;
+            /** Immutable once the log is registered. */
+            ThreadLog *next = nullptr;
+        };
+
+        /** Thread logs last used by a thread. There are several entries because a thread often records in several buckets. */
+        struct ThreadLogCache
+        {
+            static constexpr size_t SIZE = 4;
+
+            std::array<uint64_t, SIZE>    log_ids {};
+            std::array<ThreadLog *, SIZE> logs {};
+            size_t                        next_slot = 0;
+        };
+
+        const uint64_t m_id = next_measurement_log_id();
+        /** Registered thread logs. They are only added at the front, and only removed when this log is destroyed. */
+        std::atomic<ThreadLog *> m_thread_logs {nullptr};
+        /** Chunks allocated by reserve(). The first m_nb_spare_chunks ones are available, the others were taken by thread logs. */
+        std::vector<std::unique_ptr<Chunk>> m_spare_chunks;
+        std::atomic<size_t>                 m_nb_spare_chunks {0};
+
+        /** Returns the log of the calling thread, and registers it if needed. */
+        ThreadLog &thread_log()
+        {
+            // Fast path: the thread recorded in this log recently
+            static thread_local ThreadLogCache cache;
+            for (size_t i = 0; i < ThreadLogCache::SIZE; i++)
+            {
+                if (cache.log_ids[i] == m_id)
+                {
+                    return *cache.logs[i];
+                }
+            }
+
+            // Thread ids can be reused once a thread exits. Its log is taken over, since it can't be appended to anymore.
+            ThreadLog *log = &find_or_register(std::this_thread::get_id());
+
+            cache.log_ids[cache.next_slot] = m_id;
+            cache.logs[cache.next_slot]    = log;
+            cache.next_slot                = (cache.next_slot + 1) % ThreadLogCache::SIZE;
+            return *log;
+        }
+
+        ThreadLog &find_or_register(std::thread::id owner)
+        {
+            ThreadLog *log = m_thread_logs.load(std::memory_order_acquire);
+            while (log != nullptr && log->owner != owner)
+            {
+                log = log->next;
+            }
+
+            if (log == nullptr)
+            {
+                log        = new ThreadLog();
+                log->owner = owner;
+                log->next  = m_thread_logs.load(std::memory_order_relaxed);
+                while (!m_thread_logs.compare_exchange_weak(log->next, log, std::memory_order_release, std::memory_order_relaxed))
+                {
+                }
+            }
+            return *log;
+        }
+
+        /** Takes a chunk allocated by reserve(), or allocates one if there are none left. */
+        std::unique_ptr<Chunk> take_chunk()
+        {
+            size_t nb_spare = m_nb_spare_chunks.load(std::memory_order_acquire);
+            do
+            {
+                if (nb_spare == 0)
+                {
+                    return std::make_unique<Chunk>();
+                }
+            } while (!m_nb_spare_chunks.compare_exchange_weak(nb_spare,
+                                                             nb_spare - 1,
+                                                             std::memory_order_acquire,
+                                                             std::memory_order_relaxed));
+
+            // Each thread gets a different index, and reserve() doesn't run at the same time
+            return std::move(m_spare_chunks[nb_spare - 1]);
+        }
+
+        bool push(ThreadLog &log, const T &record)
+        {
+            const size_t index = log.size.load(std::memory_order_relaxed);
+            const size_t chunk = index / CHUNK_SIZE;
+            if (chunk >= MAX_CHUNKS)
+            {
+                log.nb_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (log.chunks[chunk] == nullptr)
+            {
+                log.chunks[chunk] = take_chunk();
+            }
+
+            log.chunks[chunk]->records[index % CHUNK_SIZE] = record;
+            log.size.store(index + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** Copies the thread logs one by one, so that the copy has the same capacity. */
+        void append_thread_logs(const MeasurementLog &other)
+        {
+            other.for_each_thread_log(
+                [this](const ThreadLog &other_log)
+                {
+                    ThreadLog   &log  = find_or_register(other_log.owner);
+                    const size_t size = other_log.size.load(std::memory_order_acquire);
+                    for (size_t i = 0; i < size; i++)
+                    {
+                        push(log, other_log.chunks[i / CHUNK_SIZE]->records[i % CHUNK_SIZE]);
+                    }
+                });
+        }
+
+        template<typename F>
+        void for_each_thread_log(F &&callback) const
+        {
+            for (ThreadLog *log = m_thread_logs.load(std::memory_order_acquire); log != nullptr; log = log->next)
+            {
+                callback(*log);
+            }
+        }
+
+      public:
+        MeasurementLog() = default;
+
+        /** Copies can be made while threads append to the other log, but not to this one. */
+        MeasurementLog(const MeasurementLog &other) { append_thread_logs(other); }
+
+        MeasurementLog &operator=(const MeasurementLog &other)
+        {
+            if (this != &other)
+            {
+                clear();
+                append_thread_logs(other);
+            }
+            return *this;
+        }
+
+        ~MeasurementLog()
+        {
+            ThreadLog *log = m_thread_logs.load(std::memory_order_acquire);
+            while (log != nullptr)
+            {
+                ThreadLog *next = log->next;
+                delete log;
+                log = next;
+            }
+        }
+
+        /** Records a measurement in the log of the calling thread. Never waits. Returns false if the thread log is full. */
+        inline bool append(const T &record) { return push(thread_log(), record); }
+
+        /**
+         * Allocates chunks ahead, so that up to nb_chunks threads can start recording, or start a new chunk, without allocating.
+         * Chunks that are still available count towards nb_chunks. Must not be called while a thread is appending.
+         */
+        void reserve(size_t nb_chunks)
+        {
+            const size_t nb_spare = m_nb_spare_chunks.load(std::memory_order_relaxed);
+            if (nb_spare >= nb_chunks)
+            {
+                return;
+            }
+
+            if (m_spare_chunks.size() < nb_chunks)
+            {
+                m_spare_chunks.resize(nb_chunks);
+            }
+            for (size_t i = nb_spare; i < nb_chunks; i++)
+            {
+                m_spare_chunks[i] = std::make_unique<Chunk>();
+            }
+            m_nb_spare_chunks.store(nb_chunks, std::memory_order_release);
+        }
+
+        /** Number of chunks allocated by reserve() that weren't taken yet. */
+        [[nodiscard]] size_t nb_spare_chunks() const { return m_nb_spare_chunks.load(std::memory_order_relaxed); }
+
+        /** Forgets the records, but keeps the chunks for the next ones. Must not be called while a thread is appending. */
+        void clear()
+        {
+            for_each_thread_log(
+                [](ThreadLog &log)
+                {
+                    log.size.store(0, std::memory_order_relaxed);
+                    log.nb_dropped.store(0, std::memory_order_relaxed);
+                });
+        }
+
+        /** Number of published records, in all the thread logs. */
+        [[nodiscard]] size_t size() const
+        {
+            size_t size = 0;
+            for_each_thread_log([&size](const ThreadLog &log) { size += log.size.load(std::memory_order_acquire); });
+            return size;
+        }
+
+        [[nodiscard]] bool empty() const { return size() == 0; }
+
+        /** Number of records that were dropped because a thread log was full. */
+        [[nodiscard]] size_t nb_dropped() const
+        {
+            size_t nb_dropped = 0;
+            for_each_thread_log([&nb_dropped](const ThreadLog &log) { nb_dropped += log.nb_dropped.load(std::memory_order_relaxed); });
+            return nb_dropped;
+        }
+
+        /** Copies the records of all the threads. Records of a thread stay in the order in which they were appended. */
+        [[nodiscard]] std::vector<T> merged() const
+        {
+            std::vector<T> records;
+            records.reserve(size());
+            for_each_thread_log(
+                [&records](const ThreadLog &log)
+                {
+                    const size_t size = log.size.load(std::memory_order_acquire);
+                    for (size_t i = 0; i < size; i++)
+                    {
+                        records.push_back(log.chunks[i / CHUNK_SIZE]->records[i % CHUNK_SIZE]);
+                    }
+                });
+            return records;
+        }
+
+        /** Copies the records of all the threads, sorted by the given member, typically a timestamp. The sort is stable, so records
+         * with the same key stay in the order in which their thread appended them. */
+        template<typename K>
+        [[nodiscard]] std::vector<T> merged(K T::*key) const
+        {
+            std::vector<T> records = merged();
+            std::stable_sort(records.begin(), records.end(), [key](const T &a, const T &b) { return a.*key < b.*key; });
+            return records;
+        }
+    };
+} // namespace wvb
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <wvb_common/vr_structs.h>
+
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
@@ -25,6 +27,8 @@ namespace wvb
          *
          * Frame ID, end of stream and save frame and pose timestamp are used by the client for measurements. They should be passed alongside
          * the frame data.
+         * The rendered pose is the one the frame was rendered with, which may have been predicted. The client displays the frame with
+         * it.
          */
         virtual void add_frame_data(const uint8_t *h264_data,
                                     size_t         h264_size,
@@ -32,6 +36,7 @@ namespace wvb
                                     bool           end_of_stream,
                                     uint32_t       rtp_sampling_timestamp,
                                     uint32_t       rtp_pose_timestamp,
+                                    const Pose    &rendered_pose,
                                     bool save_frame = false, // If set, the client will save the decoded frame and send it back to
                                                              // the server for PSNR calculation.
                                     bool last = true) = 0;
@@ -81,6 +86,7 @@ namespace wvb
                                         bool *__restrict out_end_of_stream,
                                         uint32_t *__restrict out_rtp_sampling_timestamp,
                                         uint32_t *__restrict out_rtp_pose_timestamp,
+                                        Pose *__restrict out_rendered_pose,
                                         std::chrono::steady_clock::time_point *out_last_packet_received_timestamp,
                                         bool *__restrict out_save_frame) = 0;
 
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wvb
+{
+    /** Number of threads used when the caller doesn't choose it: one per core. */
+    inline uint32_t default_nb_threads() { return std::max(std::thread::hardware_concurrency(), 1u); }
+
+    /**
+     * Calls task(i) for each i in [0, nb_tasks), from up to nb_threads threads including the calling one.
+     *
+     * Threads take the next task as soon as they are done with the previous one, so the tasks can be completed in any order: each
+     * should write its result to its own slot, and the slots be reduced in order afterwards to get results that don't depend on the
+     * threads. If a task throws, no other task is started and the first exception is rethrown once the threads are joined.
+     */
+    template<typename F>
+    void parallel_for(size_t nb_tasks, uint32_t nb_threads, const F &task)
+    {
+        std::atomic<size_t> next_task {0};
+        std::mutex          error_mutex;
+        std::exception_ptr  error = nullptr;
+        const auto          run_tasks = [&]
+        {
+            for (size_t i = next_task++; i < nb_tasks; i = next_task++)
+            {
+                try
+                {
+                    task(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(error_mutex);
+                    if (error == nullptr)
+                    {
+                        error = std::current_exception();
+                    }
+                    next_task = nb_tasks;
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < std::min(static_cast<size_t>(nb_threads), nb_tasks); i++)
+        {
+            threads.emplace_back(run_tasks);
+        }
+        run_tasks();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        if (error != nullptr)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+} // namespace wvb
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <wvb_common/settings.h>
+#include <wvb_common/vr_structs.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Number of received poses kept in the history
+#define WVB_POSE_HISTORY_CAPACITY 32
+// Minimum time between the two poses used to compute the velocities, to limit the impact of the noise
+#define WVB_POSE_VELOCITY_MIN_SPAN_US 5000
+// Number of predictions that can wait for the real pose to be received, to compute their error
+#define WVB_POSE_PREDICTION_PENDING_CAPACITY 32
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                   Quaternion math                                   =
+    // =======================================================================================
+
+    [[nodiscard]] Quaternion quaternion_multiply(const Quaternion &a, const Quaternion &b);
+
+    [[nodiscard]] constexpr Quaternion quaternion_conjugate(const Quaternion &q)
+    {
+        return {-q.x, -q.y, -q.z, q.w};
+    }
+
+    [[nodiscard]] Quaternion quaternion_normalize(const Quaternion &q);
+
+    /**
+     * Spherical linear interpolation between a (t = 0) and b (t = 1), along the shortest path.
+     * Values of t outside of [0, 1] extrapolate the rotation at the same angular velocity.
+     */
+    [[nodiscard]] Quaternion quaternion_slerp(const Quaternion &a, const Quaternion &b, double t);
+
+    /** Returns the angle in radians of the rotation between the two orientations. */
+    [[nodiscard]] float quaternion_angle(const Quaternion &a, const Quaternion &b);
+
+    /** Rotates the vector by the given orientation. */
+    [[nodiscard]] Vector3<float> quaternion_rotate(const Quaternion &q, const Vector3<float> &v);
+
+    /**
+     * Applies the motion from "from" to "to" to the pose, keeping its offset from the reference.
+     * For example, moves an eye pose sampled with the head at "from" to where it is when the head is at "to".
+     */
+    [[nodiscard]] Pose pose_apply_motion(const Pose &pose, const Pose &from, const Pose &to);
+
+    // =======================================================================================
+    // =                                    Pose history                                     =
+    // =======================================================================================
+
+    struct TimedPose
+    {
+        /** Time at which the pose was sampled, in microseconds since RTP epoch. */
+        int64_t timestamp_us = 0;
+        Pose    pose {};
+    };
+
+    /** Ring buffer containing the latest received poses, sorted by timestamp. */
+    class PoseHistory
+    {
+      private:
+        std::array<TimedPose, WVB_POSE_HISTORY_CAPACITY> m_poses {};
+        size_t                                           m_next  = 0;
+        size_t                                           m_count = 0;
+
+      public:
+        /** Adds a new pose. Returns false if it is older than the latest one, in which case it is ignored. */
+        bool add(const TimedPose &pose);
+
+        void clear();
+
+        [[nodiscard]] inline size_t size() const { return m_count; }
+
+        [[nodiscard]] inline bool empty() const { return m_count == 0; }
+
+        /** Returns the pose received "age" poses before the latest one. 0 is the latest one. */
+        [[nodiscard]] const TimedPose &get(size_t age) const;
+
+        [[nodiscard]] inline const TimedPose &latest() const { return get(0); }
+
+        /** Interpolates the pose at the given time. Returns false if the time is outside of the history. */
+        bool interpolate(int64_t timestamp_us, Pose &pose) const;
+    };
+
+    // =======================================================================================
+    // =                                   Pose prediction                                   =
+    // =======================================================================================
+
+    /** Difference between a predicted pose and the real one, once it is received. */
+    struct PosePredictionError
+    {
+        /** Timestamp of the latest received pose when the prediction was made. */
+        int64_t pose_timestamp_us = 0;
+        /** Time for which the pose was predicted. */
+        int64_t target_timestamp_us = 0;
+        /** Angle between the predicted orientation and the real one, in radians. */
+        float orientation_error = 0;
+        /** Distance between the predicted position and the real one, in meters. */
+        float position_error = 0;
+    };
+
+    struct PosePrediction
+    {
+        /** Timestamp of the latest received pose when the prediction was made. */
+        int64_t pose_timestamp_us = 0;
+        /** Time for which the pose was predicted. */
+        int64_t target_timestamp_us = 0;
+        Pose    predicted_pose {};
+    };
+
+    /** Part of the predictor's state needed to extrapolate a pose. It can be copied to another thread to predict there. */
+    struct PoseExtrapolation
+    {
+        PosePredictionSettings settings {};
+        TimedPose              latest {};
+        /** Older pose used to compute the velocities. Same as the latest one if they can't or shouldn't be computed. */
+        TimedPose reference {};
+        bool      is_valid = false;
+
+        /** Extrapolates the pose at the given time. The horizon from the settings is not added: the target should already include
+         * it. */
+        [[nodiscard]] Pose predict(int64_t target_timestamp_us) const;
+    };
+
+    /**
+     * Predicts the pose at a given time from the history of received poses.
+     *
+     * Each prediction is kept until the real poses around its target time are received, so that its error can be measured.
+     */
+    class PosePredictor
+    {
+      private:
+        PosePredictionSettings m_settings {};
+        PoseHistory            m_history {};
+
+        std::array<PosePrediction, WVB_POSE_PREDICTION_PENDING_CAPACITY> m_pending {};
+        size_t                                                           m_pending_start = 0;
+        size_t                                                           m_pending_count = 0;
+
+        std::array<PosePredictionError, WVB_POSE_PREDICTION_PENDING_CAPACITY> m_errors {};
+        size_t                                                                m_errors_start = 0;
+        size_t                                                                m_errors_count = 0;
+
+        void evaluate_pending_predictions();
+
+      public:
+        PosePredictor() = default;
+        explicit PosePredictor(const PosePredictionSettings &settings) : m_settings(settings) {}
+
+        inline void set_settings(const PosePredictionSettings &settings) { m_settings = settings; }
+
+        [[nodiscard]] inline const PosePredictionSettings &settings() const { return m_settings; }
+
+        [[nodiscard]] inline const PoseHistory &history() const { return m_history; }
+
+        /** Adds a newly received pose. Returns false if it is older than the latest one, in which case it is ignored. */
+        bool add_pose(const TimedPose &pose);
+
+        /**
+         * Predicts the pose at the given time with the selected model. If there is no pose yet, returns false.
+         * The horizon from the settings is not added: the target should already include it.
+         */
+        bool predict(int64_t target_timestamp_us, Pose &pose);
+
+        /** Returns what is needed to extrapolate the pose from the current history, to predict on another thread. */
+        [[nodiscard]] PoseExtrapolation extrapolation() const;
+
+        /** Keeps a prediction made elsewhere, e.g. with extrapolation(), to measure its error once the real pose is received. */
+        void add_prediction(const PosePrediction &prediction);
+
+        /** Gets the error of the oldest evaluated prediction. Returns false if there is none. */
+        bool pop_error(PosePredictionError &error);
+
+        void reset();
+    };
+} // namespace wvb
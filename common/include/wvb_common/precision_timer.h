@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Number of sleep wakeup errors used to adapt the spin margin
+#define WVB_PRECISION_TIMER_HISTORY_SIZE 128
+// Spin margin before enough wakeup errors are known
+#define WVB_PRECISION_TIMER_INITIAL_MARGIN_US 1000
+#define WVB_PRECISION_TIMER_MIN_MARGIN_US     20
+#define WVB_PRECISION_TIMER_MAX_MARGIN_US     2000
+// Added to the observed wakeup error, to cover the rare late wakeups that aren't in the history
+#define WVB_PRECISION_TIMER_MARGIN_SAFETY_US 20
+
+namespace wvb
+{
+    /**
+     * Waits until a deadline with microsecond precision, without busy waiting the whole time.
+     *
+     * The timer sleeps with an absolute OS timer until shortly before the deadline, then spins for the remaining time. The spin
+     * margin is adapted to the wakeup errors observed in the previous sleeps: it covers their 99th percentile, so that the spin
+     * is as short as possible on a system with a precise timer, and still ends on time on a less precise one.
+     *
+     * Not thread-safe: each waiting thread should have its own timer.
+     */
+    class PrecisionTimer
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+      private:
+        /** Latest wakeup errors of the sleep phase, in microseconds. */
+        std::array<int64_t, WVB_PRECISION_TIMER_HISTORY_SIZE> m_wakeup_errors_us {};
+        size_t                                                m_next_wakeup_error = 0;
+        size_t                                                m_nb_wakeup_errors  = 0;
+        std::chrono::microseconds                             m_spin_margin {WVB_PRECISION_TIMER_INITIAL_MARGIN_US};
+
+#ifdef _WIN32
+        /** High resolution waitable timer. */
+        void *m_timer = nullptr;
+#endif
+
+        void sleep_until(clock::time_point time);
+        void add_wakeup_error(std::chrono::microseconds error);
+
+      public:
+        PrecisionTimer();
+        PrecisionTimer(const PrecisionTimer &other) = delete;
+        PrecisionTimer &operator=(const PrecisionTimer &other) = delete;
+        ~PrecisionTimer();
+
+        /** Waits until the deadline. Returns the time at which the wait ended, which is at or just after the deadline. */
+        clock::time_point wait_until(clock::time_point deadline);
+
+        inline clock::time_point wait_for(clock::duration duration) { return wait_until(clock::now() + duration); }
+
+        /** Time spent spinning before the deadline, adapted to the observed wakeup errors. */
+        [[nodiscard]] inline std::chrono::microseconds spin_margin() const { return m_spin_margin; }
+    };
+} // namespace wvb
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                 Duration estimation                                 =
+    // =======================================================================================
+
+    /**
+     * Running estimate of a noisy duration, like a frame's render time.
+     *
+     * Both the mean and the mean absolute deviation are exponentially weighted moving averages, so the estimate follows slow
+     * changes without reacting to every outlier. The estimate is the mean plus a multiple of the deviation, which approximates a
+     * high percentile of the recent durations.
+     */
+    class DurationEstimator
+    {
+      private:
+        double m_alpha            = 0.1;
+        double m_deviation_factor = 2.0;
+        double m_mean_us          = 0;
+        double m_deviation_us     = 0;
+        bool   m_has_sample       = false;
+
+      public:
+        DurationEstimator() = default;
+        DurationEstimator(double alpha, double deviation_factor) : m_alpha(alpha), m_deviation_factor(deviation_factor) {}
+
+        void add(int64_t duration_us);
+
+        void reset();
+
+        [[nodiscard]] inline bool has_sample() const { return m_has_sample; }
+
+        [[nodiscard]] inline int64_t mean_us() const { return static_cast<int64_t>(m_mean_us); }
+
+        [[nodiscard]] inline int64_t deviation_us() const { return static_cast<int64_t>(m_deviation_us); }
+
+        /** Mean plus the deviation factor times the deviation. 0 if there is no sample yet. */
+        [[nodiscard]] int64_t estimate_us() const;
+    };
+
+    // =======================================================================================
+    // =                                   Present pacing                                    =
+    // =======================================================================================
+
+    struct PresentPacingSettings
+    {
+        /** Time before the vsync at which frames should be presented. It absorbs the render times that are longer than estimated. */
+        uint32_t target_lead_us = 1000;
+        /** Weight of the newest sample in the render and encode time estimates. */
+        double estimate_alpha = 0.1;
+        /** Number of mean deviations added to the mean render time. */
+        double deviation_factor = 2.0;
+        /** Proportional gain of the margin correction, per microsecond of deadline error. */
+        double kp = 0.2;
+        /** Integral gain of the margin correction, per microsecond of deadline error. */
+        double ki = 0.05;
+    };
+
+    /**
+     * Decides when to let the app render the next frame, so that it is presented just before the vsync.
+     *
+     * Releasing the app too early makes the rendered pose older than needed when the frame is displayed, and releasing it too
+     * late makes the frame miss the vsync. The wait margin, i.e. the time between the release and the targeted vsync, is the
+     * estimated render time plus the target lead, corrected by a PI loop on the achieved deadline error. The margin is capped so
+     * that the release never has to happen before the server finished encoding the previous frame.
+     *
+     * All timestamps are in microseconds, from the same steady clock.
+     */
+    class PresentPacer
+    {
+      private:
+        PresentPacingSettings m_settings {};
+        uint32_t              m_frame_interval_us = 0;
+
+        DurationEstimator m_render_time {};
+        DurationEstimator m_encode_time {};
+
+        int64_t m_frame_started_timestamp_us = 0;
+        bool    m_is_frame_started           = false;
+        /** Accumulated integral term of the margin correction. */
+        double  m_integral_us       = 0;
+        int64_t m_correction_us     = 0;
+        int64_t m_wait_margin_us    = 0;
+        int64_t m_deadline_error_us = 0;
+
+        void update_wait_margin();
+
+      public:
+        PresentPacer() = default;
+        explicit PresentPacer(uint32_t frame_interval_us, const PresentPacingSettings &settings = {});
+
+        void set_frame_interval_us(uint32_t frame_interval_us);
+
+        /** Called when the app is released to render the next frame. */
+        void on_frame_started(int64_t timestamp_us);
+
+        /**
+         * Called when the frame is presented, with the time of the vsync it targets. Returns the deadline error: positive if the
+         * frame was presented after the target time, i.e. closer to the vsync than the target lead, or after it.
+         */
+        int64_t on_frame_presented(int64_t present_timestamp_us, int64_t vsync_timestamp_us);
+
+        /** Called when the server finished encoding the frame sent at the given vsync. */
+        void on_frame_encoded(int64_t vsync_timestamp_us, int64_t finished_timestamp_us);
+
+        /** Time at which the app should be released to render the frame displayed at the given vsync. */
+        [[nodiscard]] inline int64_t release_deadline_us(int64_t vsync_timestamp_us) const
+        {
+            return vsync_timestamp_us - m_wait_margin_us;
+        }
+
+        /** Time between the release of the app and the targeted vsync. */
+        [[nodiscard]] inline int64_t wait_margin_us() const { return m_wait_margin_us; }
+
+        /** Deadline error of the latest presented frame. */
+        [[nodiscard]] inline int64_t deadline_error_us() const { return m_deadline_error_us; }
+
+        [[nodiscard]] inline const DurationEstimator &render_time() const { return m_render_time; }
+
+        [[nodiscard]] inline const DurationEstimator &encode_time() const { return m_encode_time; }
+
+        void reset();
+    };
+} // namespace wvb
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ipc.h"
+#include "macros.h"
+#include "socket.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace wvb
+{
+    /** Identifies a handler registered on a reactor, to remove it later. 0 is never a valid id. */
+    typedef uint32_t ReactorHandlerId;
+#define INVALID_REACTOR_HANDLER_ID 0
+
+    /**
+     * Event loop waiting on sockets, timers and inter-process events at the same time, and calling the callbacks registered for
+     * them when they are ready. The thread sleeps in the kernel until something happens, so that events are dispatched as soon as
+     * they arrive, without polling.
+     *
+     * Uses epoll on Linux, and WSAPoll on Windows.
+     *
+     * Callbacks are always called from the thread running the loop, so they don't need any synchronization with each other.
+     * Except post() and stop(), the reactor must only be used from that thread. Handlers can be added and removed from callbacks,
+     * including the handler being called.
+     */
+    class Reactor
+    {
+        PIMPL_CLASS(Reactor);
+
+      public:
+        typedef std::function<void()> Callback;
+
+        Reactor();
+
+        /**
+         * Calls on_ready as long as the socket can be read, or was closed by the peer. If on_writable is set, it is called when the
+         * socket can be written, as long as writable notifications are enabled with set_writable_notifications().
+         */
+        ReactorHandlerId add_socket(NativeSocketHandle socket, Callback on_ready, Callback on_writable = nullptr);
+
+        /** Enables or disables the calls to on_writable for a socket, e.g. only while data is waiting to be sent. Disabled by default.
+         * Cheap to call when the state doesn't change. */
+        void set_writable_notifications(ReactorHandlerId id, bool enabled) const;
+
+        /** Calls on_timer once after the delay, then at the given interval if it isn't zero. */
+        ReactorHandlerId add_timer(std::chrono::microseconds delay,
+                                   Callback                  on_timer,
+                                   std::chrono::microseconds interval = std::chrono::microseconds::zero());
+
+        /**
+         * Calls on_event each time the event is signaled. Inter-process events can't be polled by the system, so a helper thread
+         * waits on it and wakes up the loop. The event is consumed by the reactor: it must be in auto reset mode, and must
+         * outlive the handler.
+         */
+        ReactorHandlerId add_event(const InterProcessEvent &event, Callback on_event);
+
+        /** Stops calling the handler. Ids of removed handlers are ignored. When a socket is replaced, its handler must be removed
+         * before registering the new one, since the OS may reuse the handle. */
+        void remove(ReactorHandlerId id);
+
+        /** Thread-safe. Calls the callback once from the loop, and wakes it up if it is waiting. */
+        void post(Callback callback) const;
+
+        /**
+         * Waits until a handler is ready or the timeout expires, then calls all the ready handlers.
+         * Returns the number of callbacks called.
+         */
+        uint32_t run_once(uint32_t timeout_ms = NO_TIMEOUT);
+
+        /** Dispatches events until stop() is called. */
+        void run();
+
+        /** Thread-safe. Makes run() return once the ready callbacks have been called. */
+        void stop() const;
+    };
+} // namespace wvb
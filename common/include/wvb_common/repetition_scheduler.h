@@ -0,0 +1,95 @@
+#pragma once
+
+#include "benchmark.h"
+#include "columnar_file.h"
+#include "settings.h"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace wvb
+{
+    /** Mean and variance of a stream of samples, updated in a single pass with Welford's algorithm. */
+    struct RunningStatistics
+    {
+        uint32_t count = 0;
+        double   mean  = 0;
+        /** Sum of the squared differences to the mean. */
+        double m2 = 0;
+
+        void add(double value);
+
+        /** Unbiased variance of the samples, 0 with less than 2 samples. */
+        [[nodiscard]] double variance() const;
+
+        /** Half-width of the 95% confidence interval of the mean, from the Student t distribution. Infinite below 2 samples. */
+        [[nodiscard]] double confidence_half_width() const;
+    };
+
+    /** Two-sided 95% quantile of the Student t distribution with the given degrees of freedom, which must be at least 1. */
+    double student_t_95(uint32_t degrees_of_freedom);
+
+    enum class RepetitionStopReason : uint8_t
+    {
+        /** The pass needs more runs. */
+        NONE = 0,
+        /** The confidence intervals of all the measured stages are within the target. */
+        PRECISION_REACHED = 1,
+        /** The maximum number of runs was reached, which is the only stop condition of the passes without a target. */
+        MAX_REPETITIONS = 2,
+    };
+
+    std::string to_string(RepetitionStopReason reason);
+
+    /**
+     * Decides after each run of a benchmark pass whether it should be repeated.
+     *
+     * The mean latency of each stage in a run is a sample of the latency of the configuration. Once the pass has run
+     * min_repetitions times, it stops as soon as the 95% confidence interval of the mean of every measured stage is narrower than
+     * the target, or after num_repetitions runs. Stable configurations thus stop early, while noisy ones run up to the maximum.
+     */
+    class RepetitionScheduler
+    {
+        uint32_t                                               m_min_repetitions   = 1;
+        uint32_t                                               m_max_repetitions   = 1;
+        double                                                 m_target_half_width = 0;
+        uint32_t                                               m_nb_runs           = 0;
+        RepetitionStopReason                                   m_stop_reason       = RepetitionStopReason::NONE;
+        std::array<RunningStatistics, WVB_LATENCY_STAGE_COUNT> m_stages;
+
+      public:
+        RepetitionScheduler() = default;
+
+        /** A target of 0 disables the adaptive stop: the pass then always runs max_repetitions times. */
+        RepetitionScheduler(uint32_t min_repetitions, uint32_t max_repetitions, double target_half_width_ns);
+
+        explicit RepetitionScheduler(const BenchmarkPass &pass);
+
+        /**
+         * Adds the mean latency of each stage in a run, in nanoseconds. Stages that weren't measured are NaN, and are ignored.
+         * Returns why the pass should stop, or NONE if it needs another run.
+         */
+        RepetitionStopReason add_run(const std::array<double, WVB_LATENCY_STAGE_COUNT> &stage_means_ns);
+
+        RepetitionStopReason add_run(const StageLatencyHistograms &latencies);
+
+        [[nodiscard]] inline uint32_t             nb_runs() const { return m_nb_runs; }
+        [[nodiscard]] inline RepetitionStopReason stop_reason() const { return m_stop_reason; }
+        [[nodiscard]] inline double               target_half_width() const { return m_target_half_width; }
+
+        [[nodiscard]] inline const RunningStatistics &stage(LatencyStage stage) const
+        {
+            return m_stages[static_cast<size_t>(stage)];
+        }
+
+        /** Widest confidence interval of the measured stages, i.e. the achieved precision. Infinite if none was measured. */
+        [[nodiscard]] double max_half_width() const;
+
+        /** Writes the statistics of each stage, with the stop reason of the pass. */
+        static void export_csv(std::ofstream &file, const RepetitionScheduler &scheduler);
+
+        static void export_columns(ColumnarFileWriter &file, const std::string &table_name, const RepetitionScheduler &scheduler);
+    };
+} // namespace wvb
@@ -56,6 +56,9 @@ namespace wvb::rtp
         // Custom extension to the header for additional VR data
         uint32_t pose_timestamp_ext = 0;
         uint32_t frame_id_ext       = 0;
+        // Pose the frame was rendered with, as floats in network order
+        uint32_t rendered_orientation_ext[4] = {0};
+        uint32_t rendered_position_ext[3]    = {0};
 
         // === Helper functions ===
 
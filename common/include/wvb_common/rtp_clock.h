@@ -1,7 +1,11 @@
 #pragma once
 
+#include "ipc.h"
+#include "timestamp_source.h"
+
 #include <chrono>
 #include <cstdint>
+#include <memory>
 #ifdef __linux__
 #include <stdexcept>
 #include <time.h>
@@ -12,12 +16,18 @@
 #define UNIX_EPOCH_NTP   2208988800
 #define NS_PER_SEC       1000000000
 #define RTP_EPOCH_OFFSET std::chrono::minutes(30) // Put epoch 30min before now, so that if we need to adjust it we don't underflow
+// 2^64 * 90000 / 10^9, rounded up: ticks = ns * 90000 / 10^9 = (ns * NS_TO_RTP_TICKS_MULT) >> 64
+// Rounding up keeps the result equal to the truncated division for durations up to a few days.
+#define NS_TO_RTP_TICKS_MULT 1660206966633860ULL
 
 namespace wvb::rtp
 {
     /**
      * Steady 90kHz clock for RTP timestamps.
      * It needs to be syncable between devices, so its epoch needs to be configurable.
+     *
+     * The current time is read from a timestamp source, the cheapest available one by default, and converted to ticks with a
+     * multiplication instead of a division.
      */
     class RTPClock
     {
@@ -33,48 +43,157 @@ namespace wvb::rtp
         int64_t offset = 0;
 
       private:
-        std::chrono::system_clock::time_point m_system_epoch;
-        std::chrono::steady_clock::time_point m_steady_epoch;
+        /**
+         * Epochs and slew of the clock. The epoch is moved by the synchronization thread while other threads read the time, so
+         * it is published as a whole to never be read half-updated.
+         */
+        struct Epoch
+        {
+            std::chrono::system_clock::time_point system;
+            std::chrono::steady_clock::time_point steady;
+#ifdef __linux__
+            timespec monotonic {};
+#endif
+            // Slew: epoch correction that is progressively applied instead of making the timestamps jump.
+            // The applied part grows linearly from 0 to slew_amount between slew_start and slew_start + slew_duration.
+            // Nanosecond resolution is needed so that the clock stays monotonic while the slew progresses.
+            std::chrono::steady_clock::time_point slew_start {};
+            std::chrono::nanoseconds              slew_amount {0};
+            std::chrono::nanoseconds              slew_duration {0};
+        };
+
+        std::shared_ptr<TimestampSource> m_source = TimestampSource::best();
+        /** Only one thread may change the epoch at a time, any thread can read it. */
+        SeqLock<Epoch> m_epoch;
+
+        [[nodiscard]] inline std::chrono::steady_clock::time_point source_now() const noexcept { return m_source->now(); }
+
+        [[nodiscard]] inline Epoch epoch() const noexcept
+        {
+            // The epoch is rarely written, and never by a dead writer, so the read always ends up succeeding
+            Epoch epoch;
+            m_epoch.load(epoch, UINT32_MAX);
+            return epoch;
+        }
+
+        /** Returns the part of the slew of the epoch that is applied at the given time. */
+        [[nodiscard]] static inline std::chrono::nanoseconds applied_slew(const Epoch                          &epoch,
+                                                                          std::chrono::steady_clock::time_point steady_time) noexcept
+        {
+            if (epoch.slew_amount.count() == 0 || steady_time <= epoch.slew_start)
+            {
+                return std::chrono::nanoseconds(0);
+            }
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(steady_time - epoch.slew_start);
+            if (elapsed >= epoch.slew_duration)
+            {
+                return epoch.slew_amount;
+            }
+            const auto progress = static_cast<double>(elapsed.count()) / static_cast<double>(epoch.slew_duration.count());
+            return std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(epoch.slew_amount.count()) * progress));
+        }
+
+        /** Nanoseconds between the steady epoch and the given time, slew included. */
+        [[nodiscard]] static inline std::chrono::nanoseconds since_epoch(const Epoch                          &epoch,
+                                                                         std::chrono::steady_clock::time_point tp) noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(tp - epoch.steady - applied_slew(epoch, tp));
+        }
+
+        static void shift_epoch(Epoch &epoch, std::chrono::microseconds amount)
+        {
+            epoch.system += amount;
+            epoch.steady += amount;
+
 #ifdef __linux__
-        timespec m_timespec_epoch {};
+            const auto delay_s      = amount.count() / 1000000;
+            const auto remainder_ns = (amount.count() * 1000) % NS_PER_SEC;
+
+            epoch.monotonic.tv_sec += delay_s;
+            epoch.monotonic.tv_nsec += remainder_ns;
+            if (epoch.monotonic.tv_nsec < 0)
+            {
+                epoch.monotonic.tv_sec--;
+                epoch.monotonic.tv_nsec += NS_PER_SEC;
+            }
+            else if (epoch.monotonic.tv_nsec >= NS_PER_SEC)
+            {
+                epoch.monotonic.tv_sec++;
+                epoch.monotonic.tv_nsec -= NS_PER_SEC;
+            }
 #endif
+        }
 
       public:
         RTPClock() { reset_epoch(); }
 
         explicit RTPClock(uint64_t ntp_epoch) { set_epoch(ntp_epoch); }
 
+        RTPClock(const RTPClock &other) : offset(other.offset), m_source(other.m_source) { m_epoch.store(other.epoch()); }
+
+        RTPClock &operator=(const RTPClock &other)
+        {
+            if (this != &other)
+            {
+                offset   = other.offset;
+                m_source = other.m_source;
+                m_epoch.store(other.epoch());
+            }
+            return *this;
+        }
+
+        /** All sources share the time base of steady_clock, so the source can be changed without moving the epoch. */
+        inline void set_timestamp_source(std::shared_ptr<TimestampSource> source)
+        {
+            if (source != nullptr)
+            {
+                m_source = std::move(source);
+            }
+        }
+
+        [[nodiscard]] inline const std::shared_ptr<TimestampSource> &timestamp_source() const { return m_source; }
+
+        /** Converts nanoseconds to ticks, truncated toward zero like duration_cast. */
+        [[nodiscard]] static inline ticks to_ticks(std::chrono::nanoseconds duration) noexcept
+        {
+            const int64_t  ns        = duration.count();
+            const uint64_t magnitude = ns < 0 ? 0 - static_cast<uint64_t>(ns) : static_cast<uint64_t>(ns);
+            const auto     ticks     = static_cast<int64_t>(mul_high(magnitude, NS_TO_RTP_TICKS_MULT));
+            return RTPClock::ticks(ns < 0 ? -ticks : ticks);
+        }
+
         /** Set the epoch to the current time */
         void reset_epoch()
         {
+            Epoch epoch {};
+
             // Get current system time (secs since 1/1/1970)
             const auto system_now = std::chrono::system_clock::now();
             // Get current steady clock time (nb of ticks since steady_clock epoch, typically since boot)
-            const auto steady_now = std::chrono::steady_clock::now();
+            const auto steady_now = source_now();
 #ifdef __linux__
             timespec timespec_now {};
             clock_gettime(CLOCK_MONOTONIC, &timespec_now);
 #endif
 
-            m_system_epoch = std::chrono::time_point_cast<std::chrono::seconds>(system_now) - RTP_EPOCH_OFFSET;
+            epoch.system = std::chrono::time_point_cast<std::chrono::seconds>(system_now) - RTP_EPOCH_OFFSET;
             // Delay between system_now and the nearest second
-            const auto delay = system_now - m_system_epoch;
+            const auto delay = system_now - epoch.system;
 
             // Remove delay from steady_now to get the same time as rounded system_now
-            m_steady_epoch = steady_now - delay;
+            epoch.steady = steady_now - delay;
 #ifdef __linux__
             // Remove delay from timespec_now to get the same time as rounded system_now
             const std::chrono::nanoseconds delay_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(delay);
-            m_timespec_epoch.tv_sec                 = timespec_now.tv_sec - (delay_ns.count() / NS_PER_SEC);
-            m_timespec_epoch.tv_nsec                = timespec_now.tv_nsec - (delay_ns.count() % NS_PER_SEC);
-            if (m_timespec_epoch.tv_nsec < 0)
+            epoch.monotonic.tv_sec                  = timespec_now.tv_sec - (delay_ns.count() / NS_PER_SEC);
+            epoch.monotonic.tv_nsec                 = timespec_now.tv_nsec - (delay_ns.count() % NS_PER_SEC);
+            if (epoch.monotonic.tv_nsec < 0)
             {
-                m_timespec_epoch.tv_sec--;
-                m_timespec_epoch.tv_nsec += NS_PER_SEC;
+                epoch.monotonic.tv_sec--;
+                epoch.monotonic.tv_nsec += NS_PER_SEC;
             }
-            timespec ts = to_timespec(now());
-
 #endif
+            m_epoch.store(epoch);
         }
 
         /** Set the epoch to the given NTP time */
@@ -85,13 +204,15 @@ namespace wvb::rtp
                 throw std::runtime_error("RTPClock: NTP epoch is too far in the past");
             }
 
+            Epoch epoch {};
+
             // Compute system epoch from ntp epoch
-            m_system_epoch = std::chrono::system_clock::time_point(std::chrono::seconds(ntp_epoch - UNIX_EPOCH_NTP));
+            epoch.system = std::chrono::system_clock::time_point(std::chrono::seconds(ntp_epoch - UNIX_EPOCH_NTP));
             // Get current steady clock time (nb of 90Khz ticks since steady_clock epoch, typically since boot)
-            const auto steady_now   = std::chrono::steady_clock::now();
+            const auto steady_now   = source_now();
             const auto system_now   = std::chrono::system_clock::now();
-            const auto system_delay = system_now - m_system_epoch;
-            m_steady_epoch          = steady_now - system_delay;
+            const auto system_delay = system_now - epoch.system;
+            epoch.steady            = steady_now - system_delay;
 #ifdef __linux__
             // Get current monotonic clock time (nb of ticks since monotonic_clock epoch, typically since boot)
             timespec timespec_now {};
@@ -105,71 +226,116 @@ namespace wvb::rtp
                 throw std::runtime_error("RTPClock: NTP epoch is too far in the past");
             }
 
-            m_timespec_epoch.tv_sec  = timespec_now.tv_sec - delay_s;
-            m_timespec_epoch.tv_nsec = timespec_now.tv_nsec - remainder_ns;
-            if (m_timespec_epoch.tv_nsec < 0)
+            epoch.monotonic.tv_sec  = timespec_now.tv_sec - delay_s;
+            epoch.monotonic.tv_nsec = timespec_now.tv_nsec - remainder_ns;
+            if (epoch.monotonic.tv_nsec < 0)
             {
-                m_timespec_epoch.tv_sec--;
-                m_timespec_epoch.tv_nsec += NS_PER_SEC;
+                epoch.monotonic.tv_sec--;
+                epoch.monotonic.tv_nsec += NS_PER_SEC;
             }
 #endif
+            m_epoch.store(epoch);
         }
 
         void move_epoch(std::chrono::microseconds amount)
         {
-            m_system_epoch += amount;
-            m_steady_epoch += amount;
+            Epoch epoch = this->epoch();
+            shift_epoch(epoch, amount);
+            m_epoch.store(epoch);
+        }
 
-#ifdef __linux__
-            const auto delay_s      = amount.count() / NS_PER_SEC;
-            const auto remainder_ns = (amount.count() * 1000) % NS_PER_SEC;
+        /**
+         * Move the epoch by the given amount, but progressively over the given duration instead of all at once.
+         * This way, the clock stays monotonic and timestamps taken during the correction stay consistent with each other.
+         *
+         * If a slew is already in progress, the part that was already applied is kept, and the remaining part is added to the new one.
+         * The clock is only guaranteed to stay monotonic if the amount is smaller than the duration.
+         */
+        void slew_epoch(std::chrono::microseconds amount, std::chrono::microseconds duration)
+        {
+            Epoch      epoch      = this->epoch();
+            const auto steady_now = source_now();
 
-            m_timespec_epoch.tv_sec += delay_s;
-            m_timespec_epoch.tv_nsec += remainder_ns;
-            if (m_timespec_epoch.tv_nsec < 0)
-            {
-                m_timespec_epoch.tv_sec--;
-                m_timespec_epoch.tv_nsec += NS_PER_SEC;
-            }
-            else if (m_timespec_epoch.tv_nsec >= NS_PER_SEC)
+            // Commit the part of the previous slew that was already applied. Round it down so that the clock never goes back.
+            const auto applied = std::chrono::floor<std::chrono::microseconds>(applied_slew(epoch, steady_now));
+            shift_epoch(epoch, applied);
+
+            epoch.slew_start    = steady_now;
+            epoch.slew_amount   = epoch.slew_amount - applied + amount;
+            epoch.slew_duration = duration;
+
+            if (epoch.slew_duration.count() <= 0)
             {
-                m_timespec_epoch.tv_sec++;
-                m_timespec_epoch.tv_nsec -= NS_PER_SEC;
+                // Nothing to slew, jump directly
+                const auto remaining = std::chrono::round<std::chrono::microseconds>(epoch.slew_amount);
+                shift_epoch(epoch, remaining);
+                epoch.slew_amount   = epoch.slew_amount - remaining;
+                epoch.slew_duration = std::chrono::nanoseconds(0);
             }
-#endif
+
+            // The new epoch and slew are seen together by the readers
+            m_epoch.store(epoch);
         }
 
-        [[nodiscard]] inline std::chrono::system_clock::time_point system_time_epoch() const { return m_system_epoch; }
+        /** Returns the part of the current slew that is not applied yet. */
+        [[nodiscard]] inline std::chrono::microseconds remaining_slew() const noexcept
+        {
+            const Epoch epoch = this->epoch();
+            return std::chrono::duration_cast<std::chrono::microseconds>(epoch.slew_amount - applied_slew(epoch, source_now()));
+        }
+
+        [[nodiscard]] inline std::chrono::system_clock::time_point system_time_epoch() const { return epoch().system; }
 
-        [[nodiscard]] inline std::chrono::steady_clock::time_point steady_time_epoch() const { return m_steady_epoch; }
+        [[nodiscard]] inline std::chrono::steady_clock::time_point steady_time_epoch() const { return epoch().steady; }
 
 #ifdef __linux__
-        [[nodiscard]] inline timespec timespec_epoch() const { return m_timespec_epoch; }
+        [[nodiscard]] inline timespec timespec_epoch() const { return epoch().monotonic; }
 #endif
 
         /** Return the number of seconds of epoch since 1/1/1900 */
         [[nodiscard]] inline uint64_t ntp_epoch() const
         {
             // Nb of seconds since 1/1/1970
-            uint64_t system_epoch_sec = std::chrono::duration_cast<std::chrono::seconds>(m_system_epoch.time_since_epoch()).count();
+            uint64_t system_epoch_sec = std::chrono::duration_cast<std::chrono::seconds>(epoch().system.time_since_epoch()).count();
 
             // Nb of seconds since 1/1/1900
             return system_epoch_sec + UNIX_EPOCH_NTP;
         }
 
         /** Returns the current time since RTP steady_epoch */
-        [[nodiscard]] inline time_point now() const noexcept
-        {
-            const auto steady_now = std::chrono::steady_clock::now();
-            return time_point(std::chrono::duration_cast<duration>(steady_now - m_steady_epoch));
-        }
+        [[nodiscard]] inline time_point now() const noexcept { return from_steady_timepoint(source_now()); }
 
         /** Returns the current time since RTP steady_epoch */
         [[nodiscard]] inline uint32_t now_rtp_timestamp() const noexcept
         {
-            const auto now = std::chrono::steady_clock::now();
             // Return the time in 90kHz ticks, wrapped around 32 bits if needed
-            return static_cast<uint32_t>(std::chrono::duration_cast<duration>(now - m_steady_epoch).count()) + offset;
+            return static_cast<uint32_t>(now().time_since_epoch().count()) + offset;
+        }
+
+        /**
+         * Returns the current time in nanoseconds since the epoch. This timeline is synchronized between devices like the RTP
+         * timestamps, but it has a nanosecond resolution and doesn't wrap, so it is used for measurements. RTP timestamps are kept
+         * for the timestamps sent with the media.
+         */
+        [[nodiscard]] inline int64_t now_ns() const noexcept { return ns_from_steady_timepoint(source_now()); }
+
+        [[nodiscard]] inline int64_t ns_from_steady_timepoint(std::chrono::steady_clock::time_point tp) const noexcept
+        {
+            return since_epoch(epoch(), tp).count();
+        }
+
+        /**
+         * Places a RTP timestamp, e.g. the one of a pose, on the nanosecond timeline.
+         * Rounded up, so that it converts back to the same RTP timestamp.
+         */
+        [[nodiscard]] inline int64_t ns_from_rtp_timestamp(uint32_t rtp_timestamp) const noexcept
+        {
+            return std::chrono::ceil<std::chrono::nanoseconds>(from_rtp_timestamp(rtp_timestamp).time_since_epoch()).count();
+        }
+
+        [[nodiscard]] inline uint32_t rtp_timestamp_from_ns(int64_t ns) const noexcept
+        {
+            return static_cast<uint32_t>(to_ticks(std::chrono::nanoseconds(ns)).count()) + offset;
         }
 
         /** Returns a time point from a RTP timestamp */
@@ -185,7 +351,7 @@ namespace wvb::rtp
 
         [[nodiscard]] inline time_point from_steady_timepoint(std::chrono::steady_clock::time_point tp) const noexcept
         {
-            return time_point(std::chrono::duration_cast<duration>(tp - m_steady_epoch));
+            return time_point(to_ticks(since_epoch(epoch(), tp)));
         }
 
 #ifdef __linux__
@@ -193,12 +359,14 @@ namespace wvb::rtp
         /** Converts a RTP time point to a timespec */
         [[nodiscard]] inline timespec to_timespec(time_point tp) const noexcept
         {
-            const auto duration    = tp.time_since_epoch();
+            const Epoch epoch = this->epoch();
+            // The slew changes slowly, so the part applied now is a good approximation of the one applied at tp
+            const auto duration    = tp.time_since_epoch() + applied_slew(epoch, source_now());
             const auto duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
 
             timespec ts;
-            ts.tv_sec  = m_timespec_epoch.tv_sec + (duration_ns.count() / NS_PER_SEC);
-            ts.tv_nsec = m_timespec_epoch.tv_nsec + (duration_ns.count() % NS_PER_SEC);
+            ts.tv_sec  = epoch.monotonic.tv_sec + (duration_ns.count() / NS_PER_SEC);
+            ts.tv_nsec = epoch.monotonic.tv_nsec + (duration_ns.count() % NS_PER_SEC);
             if (ts.tv_nsec >= NS_PER_SEC)
             {
                 ts.tv_sec++;
@@ -216,10 +384,17 @@ namespace wvb::rtp
         /** Converts a timespec to a RTP time point */
         [[nodiscard]] inline time_point from_timespec(timespec ts) const noexcept
         {
-            const auto seconds     = std::chrono::seconds(ts.tv_sec - m_timespec_epoch.tv_sec);
-            const auto nanoseconds = std::chrono::nanoseconds(ts.tv_nsec - m_timespec_epoch.tv_nsec);
+            return time_point(to_ticks(std::chrono::nanoseconds(ns_from_timespec(ts))));
+        }
+
+        /** Converts a timespec to the nanosecond timeline */
+        [[nodiscard]] inline int64_t ns_from_timespec(timespec ts) const noexcept
+        {
+            const Epoch epoch       = this->epoch();
+            const auto  seconds     = std::chrono::seconds(ts.tv_sec - epoch.monotonic.tv_sec);
+            const auto  nanoseconds = std::chrono::nanoseconds(ts.tv_nsec - epoch.monotonic.tv_nsec);
 
-            return time_point(std::chrono::duration_cast<duration>(seconds + nanoseconds));
+            return (seconds + nanoseconds - applied_slew(epoch, source_now())).count();
         }
 
         /** Converts a timespec to a RTP time stamp */
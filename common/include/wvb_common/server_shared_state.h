@@ -6,6 +6,7 @@
 
 #include <wvb_common/benchmark.h>
 #include <wvb_common/ipc.h>
+#include <wvb_common/settings.h>
 #include <wvb_common/vr_structs.h>
 
 namespace wvb
@@ -24,6 +25,12 @@ namespace wvb
 #define WVB_EVENT_DRIVER_NEW_PRESENT_INFO "WVB_EVENT_DRIVER_NEW_PRESENT_INFO"
 #define WVB_EVENT_DRIVER_NEW_MEASUREMENTS "WVB_EVENT_DRIVER_NEW_MEASUREMENTS"
 
+/** Number of measurements of each type that the driver can publish before the server drains them. */
+#define WVB_DRIVER_MEASUREMENT_RING_CAPACITY 1024
+
+/** Time between the driver vsync and the moment the frame is shown. Should match Prop_SecondsFromVsyncToPhotons_Float. */
+#define WVB_VSYNC_TO_PHOTONS_US 10000
+
     // =======================================================================================
     // =                                     Shared state                                    =
     // =======================================================================================
@@ -69,29 +76,64 @@ namespace wvb
         /** Nb of 90KHz ticks since RTP epoch */
         uint32_t sample_rtp_timestamp = 0;
         uint32_t pose_rtp_timestamp   = 0;
+        /** Pose returned to SteamVR for this frame, predicted from the one of pose_rtp_timestamp if prediction is enabled. */
+        Pose rendered_pose = {};
+    };
+
+    /** Refresh timing of the client's display, on which the driver locks the phase of its vsync. */
+    struct DisplayTiming
+    {
+        /** RTP timestamp at which a frame is displayed by the client. */
+        uint32_t display_timestamp = 0;
+        /** Time between two refreshes of the display. 0 if the client didn't send its timing yet. */
+        uint32_t display_period_ns = 0;
+        /** Desired time between a driver vsync and the display of the frame on the client. */
+        uint32_t phase_offset_us = 0;
+    };
+
+    /** Measurements published by the driver as soon as they are taken, and drained continuously by the server. */
+    struct DriverMeasurementRings
+    {
+        SharedRing<DriverFrameTimeMeasurements, WVB_DRIVER_MEASUREMENT_RING_CAPACITY> frame_time;
+        SharedRing<TrackingTimeMeasurements, WVB_DRIVER_MEASUREMENT_RING_CAPACITY>    tracking_time;
+        SharedRing<PoseAccessTimeMeasurements, WVB_DRIVER_MEASUREMENT_RING_CAPACITY>  pose_access_time;
+        SharedRing<PosePredictionMeasurements, WVB_DRIVER_MEASUREMENT_RING_CAPACITY>  pose_prediction;
+
+        /** Must be called by the server, while the driver isn't measuring. */
+        void clear()
+        {
+            frame_time.clear();
+            tracking_time.clear();
+            pose_access_time.clear();
+            pose_prediction.clear();
+        }
+
+        [[nodiscard]] uint64_t nb_dropped() const
+        {
+            return frame_time.nb_dropped() + tracking_time.nb_dropped() + pose_access_time.nb_dropped() + pose_prediction.nb_dropped();
+        }
     };
 
     struct ServerDriverSharedData
     {
         // Set by driver, read by server
-        DriverState                 driver_state = DriverState::NOT_RUNNING;
-        OpenVRPresentInfo           latest_present_info {};
-        uint32_t                    frame_time_measurements_count                                      = 0;
-        uint32_t                    tracking_time_measurements_count                                   = 0;
-        uint32_t                    pose_access_time_measurements_count                                = 0;
-        DriverFrameTimeMeasurements frame_time_measurements[WVB_BENCHMARK_TIMING_PHASE_CAPACITY]       = {0};
-        TrackingTimeMeasurements    tracking_time_measurements[WVB_BENCHMARK_TIMING_PHASE_CAPACITY]    = {0};
-        PoseAccessTimeMeasurements  pose_access_time_measurements[WVB_BENCHMARK_TIMING_PHASE_CAPACITY] = {0};
+        // latest_present_info and driver_measurements are published without the mutex: access them with unlocked()
+        DriverState                driver_state = DriverState::NOT_RUNNING;
+        SeqLock<OpenVRPresentInfo> latest_present_info {};
+        DriverMeasurementRings     driver_measurements {};
 
         // Set by server, read by driver
+        // tracking_state and display_timing are published without the mutex: access them with unlocked()
         ServerState server_state = ServerState::NOT_RUNNING;
         /** Offset of ticks applied to the RTP timestamp */
         uint32_t rtp_offset = 0;
         /** NTP timestamp of RTP epoch (nb of seconds since 1/1/1900) */
-        uint64_t          ntp_epoch = 0;
-        VRSystemSpecs     vr_system_specs {};
-        TrackingState     tracking_state {};
-        MeasurementWindow measurement_window {};
+        uint64_t               ntp_epoch = 0;
+        VRSystemSpecs          vr_system_specs {};
+        PosePredictionSettings pose_prediction_settings {};
+        SeqLock<TrackingState> tracking_state {};
+        SeqLock<DisplayTiming> display_timing {};
+        MeasurementWindow      measurement_window {};
     };
 
     typedef SharedMemory<ServerDriverSharedData> ServerDriverSharedMemory;
@@ -44,11 +44,24 @@ namespace wvb
         CodecSettings codec_settings {};
         /**
          * Number of times that measurements with this config should be repeated,
-         * in order to limit the impact of randomness.
+         * in order to limit the impact of randomness. Maximum number of runs if target_ci_half_width_us is set.
          *
          * CLI key: 'n'
          */
         uint32_t num_repetitions = 10;
+        /**
+         * Number of runs after which the pass can stop early, once the target precision is reached (see RepetitionScheduler).
+         *
+         * CLI key: 'nmin'
+         */
+        uint32_t min_repetitions = 3;
+        /**
+         * Target half-width of the 95% confidence interval of the mean latency of each stage across the runs, in microseconds.
+         * The pass stops as soon as all the stages reach it. 0 to always run num_repetitions times.
+         *
+         * CLI key: 'ci'
+         */
+        uint32_t target_ci_half_width_us = 0;
         /**
          * Number of milliseconds between the moment when the app starts running and the start
          *  of the measurements.
@@ -76,23 +89,43 @@ namespace wvb
         uint32_t duration_end_margin_ms = 4000;
     };
 
+    enum class MeasurementExportFormat : uint8_t
+    {
+        /** One CSV file per run, with a table after the other. */
+        CSV = 0,
+        /** One binary columnar file per run (see ColumnarFileWriter), much faster to write and to load. */
+        BINARY = 1,
+    };
+
     struct BenchmarkSettings
     {
         /** List of all configurations to measure, in order. */
         std::vector<BenchmarkPass> passes;
         /** Number of milliseconds between the end of a run and the start of the next one. */
         uint32_t duration_inter_run_interval_ms = 5000;
+        /**
+         * Format of the exported measurements.
+         *
+         * CLI key: '--format' (csv, binary)
+         */
+        MeasurementExportFormat export_format = MeasurementExportFormat::CSV;
     };
 
     struct NetworkSettings
     {
         /** Number of ping replies that the client waits until it ends the sync phase.
          * If packets are dropped and less replies are received, the client will stop
-         * after sending 2*ping_count pings.
+         * after sending 2*ping_count pings. Sent to the client when it connects.
          *
          * CLI key: 'pc'
          */
         uint8_t ping_count = 20;
+        /** Half-width in microseconds of the 95% confidence interval of the clock offset at which the client ends the sync phase
+         * early, before ping_count replies were received. 0 disables the early stop. Sent to the client when it connects.
+         *
+         * CLI key: 'sc'
+         */
+        uint16_t clock_sync_target_confidence_us = 200;
         /** Number of milliseconds between the reception of a ping reply (or timeout) and the sending of the next ping.
          *
          * CLI key: 'pi'
@@ -105,15 +138,44 @@ namespace wvb
         uint16_t ping_timeout_ms = 500;
     };
 
+    enum class PosePredictionModel : uint8_t
+    {
+        /** The latest received pose is used as-is. */
+        NONE = 0,
+        /** The pose is extrapolated from the latest ones, assuming constant linear and angular velocities. */
+        CONSTANT_VELOCITY = 1,
+    };
+
+    struct PosePredictionSettings
+    {
+        /** Model used by the driver to predict the pose at the time the frame will be displayed.
+         *
+         * CLI key: 'model' (none, velocity)
+         */
+        PosePredictionModel model = PosePredictionModel::CONSTANT_VELOCITY;
+        /** Number of microseconds between the driver vsync and the moment the frame is displayed by the client
+         * (encoding, network, decoding...). It is added to the prediction horizon.
+         *
+         * CLI key: 'h'
+         */
+        uint32_t horizon_us = 0;
+        /** Maximum number of microseconds that the pose can be extrapolated past the latest received one.
+         *
+         * CLI key: 'max'
+         */
+        uint32_t max_extrapolation_us = 100000;
+    };
+
     struct AppSettings
     {
         AppMode app_mode = AppMode::NORMAL;
         /** Codec that is used when in normal mode.
          * In benchmark mode, the value defined in the pass is used instead. */
-        std::string       preferred_codec = "h265";
-        std::string       steamvr_path = WVB_DEFAULT_STEAMVR_PATH;
-        NetworkSettings   network_settings {};
-        BenchmarkSettings benchmark_settings {};
+        std::string            preferred_codec = "h265";
+        std::string            steamvr_path = WVB_DEFAULT_STEAMVR_PATH;
+        NetworkSettings        network_settings {};
+        BenchmarkSettings      benchmark_settings {};
+        PosePredictionSettings pose_prediction_settings {};
     };
 
     constexpr std::string to_string(AppMode mode)
@@ -125,4 +187,24 @@ namespace wvb
             default: return "INVALID";
         }
     }
+
+    constexpr std::string to_string(PosePredictionModel model)
+    {
+        switch (model)
+        {
+            case PosePredictionModel::NONE: return "NONE";
+            case PosePredictionModel::CONSTANT_VELOCITY: return "CONSTANT_VELOCITY";
+            default: return "INVALID";
+        }
+    }
+
+    constexpr std::string to_string(MeasurementExportFormat format)
+    {
+        switch (format)
+        {
+            case MeasurementExportFormat::CSV: return "CSV";
+            case MeasurementExportFormat::BINARY: return "BINARY";
+            default: return "INVALID";
+        }
+    }
 } // namespace wvb
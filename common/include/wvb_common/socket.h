@@ -10,6 +10,14 @@
 
 namespace wvb
 {
+    /** OS handle of a socket, to wait for it with the system polling functions. */
+#ifdef _WIN32
+    typedef uintptr_t NativeSocketHandle;
+#else
+    typedef int32_t NativeSocketHandle;
+#endif
+#define INVALID_NATIVE_SOCKET_HANDLE (static_cast<NativeSocketHandle>(-1))
+
     enum class TCPSocketState : int8_t
     {
         NOT_STARTED = 0,
@@ -44,6 +52,9 @@ namespace wvb
 
         // Transmission
         void               send(const uint8_t *data, size_t size, uint32_t timeout_us = 100000) const;
+        /** Send as many bytes as the socket accepts without blocking. The number of bytes actually sent is written to sent_size.
+         * Returns false if nothing could be sent, either because the socket buffer is full or because the connection was closed. */
+        [[nodiscard]] bool try_send(const uint8_t *data, size_t size, size_t *sent_size) const;
         [[nodiscard]] bool receive(uint8_t *data, size_t size, size_t *actual_size) const;
 
         // Getters
@@ -52,6 +63,8 @@ namespace wvb
         [[nodiscard]] inline bool       is_connected() const { return state() == TCPSocketState::CONNECTED; };
         [[nodiscard]] const SocketAddr &local_addr() const;
         [[nodiscard]] const SocketAddr &peer_addr() const;
+        /** Changes when a connection is accepted, since the listening socket is replaced by the connected one. */
+        [[nodiscard]] NativeSocketHandle native_handle() const;
     };
 
     /** Non-blocking UDP socket. */
@@ -76,8 +89,9 @@ namespace wvb
         [[nodiscard]] bool receive_from(uint8_t *data, size_t size, size_t *actual_size, SocketAddr *addr) const;
 
         // Getters
-        [[nodiscard]] bool              is_open() const;
-        [[nodiscard]] const SocketAddr &local_addr() const;
+        [[nodiscard]] bool               is_open() const;
+        [[nodiscard]] const SocketAddr  &local_addr() const;
+        [[nodiscard]] NativeSocketHandle native_handle() const;
     };
 
     std::vector<InetAddr> get_broadcast_addresses();
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "macros.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#endif
+
+// Duration of the first calibration of the TSC, which busy waits
+#define WVB_TSC_INITIAL_CALIBRATION_MS 10
+// Interval between two recalibrations. They are done by the thread that reads the time when it expires.
+#define WVB_TSC_RECALIBRATION_INTERVAL_MS 1000
+// Maximum rate correction applied to catch up with CLOCK_MONOTONIC, in parts per million
+#define WVB_TSC_MAX_STEERING_PPM 1000
+// If the TSC is late by more than this, it jumps forward instead of being steered
+#define WVB_TSC_MAX_STEERED_ERROR_US 10000
+
+namespace wvb::rtp
+{
+    /** Returns the high 64 bits of the product. */
+    [[nodiscard]] inline uint64_t mul_high(uint64_t a, uint64_t b) noexcept
+    {
+#if defined(__SIZEOF_INT128__)
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        return __umulh(a, b);
+#else
+        const uint64_t a_low  = a & 0xFFFFFFFF;
+        const uint64_t a_high = a >> 32;
+        const uint64_t b_low  = b & 0xFFFFFFFF;
+        const uint64_t b_high = b >> 32;
+
+        const uint64_t low_low   = a_low * b_low;
+        const uint64_t low_high  = a_low * b_high;
+        const uint64_t high_low  = a_high * b_low;
+        const uint64_t high_high = a_high * b_high;
+
+        const uint64_t middle = (low_low >> 32) + (low_high & 0xFFFFFFFF) + (high_low & 0xFFFFFFFF);
+        return high_high + (low_high >> 32) + (high_low >> 32) + (middle >> 32);
+#endif
+    }
+
+    /** Returns (a * b) >> 32, without overflowing as long as the result fits in 64 bits. */
+    [[nodiscard]] inline uint64_t mul_shift_32(uint64_t a, uint64_t b) noexcept
+    {
+        // Low bits of the product wrap around
+        return (mul_high(a, b) << 32) | ((a * b) >> 32);
+    }
+
+    enum class TimestampSourceType : uint8_t
+    {
+        /** CLOCK_MONOTONIC through std::chrono::steady_clock. On Linux, it is read from the vDSO without a system call. */
+        MONOTONIC = 0,
+        /** Invariant TSC of x86 CPUs, calibrated against the system clocks. */
+        TSC = 1,
+    };
+
+    std::string to_string(TimestampSourceType type);
+
+    /**
+     * Source of the current time for the RTP clocks.
+     *
+     * Times are in the time base of std::chrono::steady_clock, so that they can be mixed with the time points of the rest of the app.
+     * All sources are thread-safe, and monotonic for each thread.
+     */
+    class TimestampSource
+    {
+      public:
+        virtual ~TimestampSource() = default;
+
+        [[nodiscard]] virtual std::chrono::steady_clock::time_point now() const noexcept = 0;
+
+        [[nodiscard]] virtual TimestampSourceType type() const noexcept = 0;
+
+        /** Shared CLOCK_MONOTONIC source. */
+        static std::shared_ptr<TimestampSource> monotonic();
+
+        /** Shared TSC source, or nullptr if the CPU doesn't have an invariant TSC. It is calibrated on the first call. */
+        static std::shared_ptr<TimestampSource> tsc();
+
+        /** Cheapest source available: the TSC if it is supported, CLOCK_MONOTONIC otherwise. */
+        static std::shared_ptr<TimestampSource> best();
+    };
+
+    class MonotonicTimestampSource final : public TimestampSource
+    {
+      public:
+        [[nodiscard]] inline std::chrono::steady_clock::time_point now() const noexcept override
+        {
+            return std::chrono::steady_clock::now();
+        }
+
+        [[nodiscard]] inline TimestampSourceType type() const noexcept override { return TimestampSourceType::MONOTONIC; }
+    };
+
+    /**
+     * Reads the time from the invariant TSC, and converts it to nanoseconds with a fixed-point multiplication.
+     *
+     * The TSC frequency is measured against CLOCK_MONOTONIC_RAW, which isn't adjusted by NTP, since the first calibration, so that
+     * the estimation gets more precise over time. The offset to CLOCK_MONOTONIC is then corrected at each recalibration by steering
+     * the conversion rate, instead of making the time jump. Each calibration starts where the previous one ended, and the rate is
+     * always positive, so the time never goes back.
+     *
+     * Only supported on x86 Linux, where CLOCK_MONOTONIC_RAW is available. Construction throws if the TSC isn't invariant.
+     */
+    class TSCTimestampSource final : public TimestampSource
+    {
+        PIMPL_CLASS(TSCTimestampSource);
+
+      public:
+        /** Busy waits for WVB_TSC_INITIAL_CALIBRATION_MS to measure the TSC frequency. */
+        TSCTimestampSource();
+
+        [[nodiscard]] static bool is_supported();
+
+        [[nodiscard]] std::chrono::steady_clock::time_point now() const noexcept override;
+
+        [[nodiscard]] inline TimestampSourceType type() const noexcept override { return TimestampSourceType::TSC; }
+
+        /** Recalibrates now instead of waiting for the interval to expire. */
+        void recalibrate() const;
+
+        /** Estimated TSC frequency, in ticks per second of CLOCK_MONOTONIC_RAW. */
+        [[nodiscard]] double frequency_hz() const;
+    };
+} // namespace wvb::rtp
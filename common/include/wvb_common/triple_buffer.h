@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace wvb
+{
+    /**
+     * Wait-free handoff of the latest value from one writer thread to one reader thread.
+     *
+     * The writer and the reader each own one of the three buffers, and the third one holds the latest published value. Publishing
+     * and reading only swap buffer indices atomically, so neither side can be delayed by the other, whatever their timings.
+     * Intermediate values are skipped if the writer is faster than the reader.
+     */
+    template<typename T>
+    class TripleBuffer
+    {
+      private:
+        /** Set in the shared index when it holds a value that the reader hasn't taken yet. */
+        static constexpr uint8_t NEW_VALUE_FLAG = 0b100;
+
+        std::array<T, 3> m_buffers {};
+        /** Index of the buffer holding the latest published value, and the new value flag. */
+        std::atomic<uint8_t> m_shared_index {1};
+        /** Only used by the writer. */
+        uint8_t m_write_index = 0;
+        /** Only used by the reader. */
+        uint8_t m_read_index = 2;
+
+      public:
+        TripleBuffer() = default;
+        explicit TripleBuffer(const T &initial_value) : m_buffers {initial_value, initial_value, initial_value} {}
+
+        /** Publishes a new value. Only one thread may write. */
+        void write(const T &value)
+        {
+            m_buffers[m_write_index] = value;
+
+            // Give the buffer to the reader, and take the one it didn't read
+            const uint8_t previous = m_shared_index.exchange(m_write_index | NEW_VALUE_FLAG, std::memory_order_acq_rel);
+            m_write_index          = previous & ~NEW_VALUE_FLAG;
+        }
+
+        /** Returns the latest published value. Only one thread may read. The reference stays valid until the next read. */
+        const T &read()
+        {
+            if ((m_shared_index.load(std::memory_order_relaxed) & NEW_VALUE_FLAG) != 0)
+            {
+                // Take the new value, and give back the buffer that was read
+                const uint8_t previous = m_shared_index.exchange(m_read_index, std::memory_order_acq_rel);
+                m_read_index           = previous & ~NEW_VALUE_FLAG;
+            }
+            return m_buffers[m_read_index];
+        }
+
+        /** Returns true if a value was published since the last read. Can be called from any thread. */
+        [[nodiscard]] inline bool has_new_value() const
+        {
+            return (m_shared_index.load(std::memory_order_relaxed) & NEW_VALUE_FLAG) != 0;
+        }
+    };
+} // namespace wvb
@@ -51,6 +51,7 @@ namespace wvb
                             bool *__restrict out_end_of_stream,
                             uint32_t *__restrict out_rtp_timestamp,
                             uint32_t *__restrict out_rtp_pose_timestamp,
+                            Pose *__restrict out_rendered_pose,
                             std::chrono::steady_clock::time_point *out_last_packet_received_timestamp,
                             bool *__restrict out_save_frame);
 
@@ -114,13 +115,16 @@ namespace wvb
                          bool           end_of_stream,
                          uint32_t       rtp_timestamp,
                          uint32_t       rtp_pose_timestamp,
+                         const Pose    &rendered_pose,
                          bool           save_frame = false,
                          bool           last       = true,
                          uint32_t       timeout_us = 100000);
 
         [[nodiscard]] inline const SocketAddr &local_addr() const { return m_socket.local_addr(); }
         [[nodiscard]] inline const SocketAddr &peer_addr() const { return m_peer_addr; }
-        [[nodiscard]] inline bool              is_connected() const
+        /** Used to wait for the client connection in a reactor. */
+        [[nodiscard]] inline NativeSocketHandle native_handle() const { return m_socket.native_handle(); }
+        [[nodiscard]] inline bool               is_connected() const
         {
 #ifdef WVB_VIDEO_SOCKET_USE_UDP
             return m_socket.is_valid();
@@ -6,6 +6,9 @@
 #define EYE_LEFT  0
 #define EYE_RIGHT 1
 
+// Number of previous poses repeated in each tracking update, so that the ones of lost packets can be recovered
+#define WVB_TRACKING_PAST_POSES_CAPACITY 3
+
 namespace wvb
 {
 
@@ -98,6 +101,14 @@ namespace wvb
         float right = 0;
         float up    = 0;
         float down  = 0;
+
+        constexpr bool operator==(const Fov &other) const = default;
+    };
+
+    struct PastPose
+    {
+        uint32_t pose_timestamp = 0;
+        Pose     pose;
     };
 
     struct TrackingState
@@ -107,6 +118,9 @@ namespace wvb
         Pose     pose;
         Fov      fov_left;
         Fov      fov_right;
+        /** Poses sent in the previous updates, newest first. They may be less precise than the latest one. */
+        uint32_t nb_past_poses = 0;
+        PastPose past_poses[WVB_TRACKING_PAST_POSES_CAPACITY];
     };
 
 } // namespace wvb
\ No newline at end of file
@@ -16,11 +16,17 @@ namespace wvb::vrcp
     // =                       Data types                          =
     // =============================================================
 
-#define VRCP_VERSION                    1
+#define VRCP_VERSION                    2
 #define VRCP_MAGIC                      0x4D
 #define VRCP_DEFAULT_ADVERTISEMENT_PORT 7672
+#define VRCP_DEFAULT_DISCOVERY_PORT     7673
 #define VRCP_ROW_SIZE                   4
 
+// Quantization of the compact tracking data
+#define VRCP_POSITION_UNITS_PER_METER      1000000 // Micrometers
+#define VRCP_PAST_POSITION_UNITS_PER_METER 10000   // Tenths of millimeters, +-3.2m from the latest pose
+#define VRCP_PAST_ROTATION_RANGE           0.125f  // Max vector part of the rotation from the latest pose (~14 degrees)
+
     /** Field type for the VR Control Protocol */
     enum class VRCPFieldType : uint8_t
     {
@@ -36,12 +42,19 @@ namespace wvb::vrcp
         // Input, no value
         INPUT_DATA    = 0b00000100,
         TRACKING_DATA = 0x05,
+        // Quantized tracking with redundant past poses, FOV sent separately when it changes
+        COMPACT_TRACKING_DATA = 0x06,
+        FOV_DATA              = 0x07,
+        // Refresh timing of the client's display, to lock the driver's vsync on it
+        DISPLAY_TIMING = 0x08,
 
         // TLV subfields for CONN_REQ
         MANUFACTURER_NAME_TLV      = 0x09,
         SYSTEM_NAME_TLV            = 0x0A,
         SUPPORTED_VIDEO_CODECS_TLV = 0x0B,
         CHOSEN_VIDEO_CODEC_TLV     = 0x0C,
+        // TLV subfield for CONN_ACCEPT, with a VRCPClockSyncSettings value
+        CLOCK_SYNC_SETTINGS_TLV = 0x0D,
 
         // Synchronization
         PING          = 0x10,
@@ -58,9 +71,12 @@ namespace wvb::vrcp
         SOCKET_MEASUREMENT            = 0x26,
         NEXT_PASS                     = 0x27,
         FRAME_CAPTURE_FRAGMENT        = 0x28,
+        SEND_QUEUE_MEASUREMENT        = 0x29,
 
         // Server advertisement broadcasted when no one is connected
         SERVER_ADVERTISEMENT = 0x70,
+        // Sent by clients to get an advertisement right away
+        DISCOVERY_PROBE = 0x71,
 
         // MSB set to 1: user TLV field, m_packet extracted then given to user
         USER_DATA = 0b10000000,
@@ -178,6 +194,15 @@ namespace wvb::vrcp
     };
     static_assert(sizeof(VRCPConnectionAccept) == VRCP_ROW_SIZE *VRCPConnectionAccept {}.n_rows, "Size must be 4 * n_rows");
 
+    /** Value of the CLOCK_SYNC_SETTINGS_TLV field of the CONN_ACCEPT: how the client runs the sync phase that follows. */
+    struct VRCPClockSyncSettings
+    {
+        uint8_t                  ping_count           = 0;
+        [[maybe_unused]] uint8_t _reserved            = 0;
+        uint16_t                 target_confidence_us = 0;
+    };
+    static_assert(sizeof(VRCPClockSyncSettings) == 4, "Size must be 4");
+
     /** Sent by the server if it is unable to start a connection.
      * Contains the reason of this reject, as well as an optional additional info. */
     struct VRCPConnectionReject
@@ -225,6 +250,17 @@ namespace wvb::vrcp
     };
     static_assert(sizeof(VRCPServerAdvertisement) == VRCP_ROW_SIZE *VRCPServerAdvertisement {}.n_rows, "Size must be 4 * n_rows");
 
+    /** Broadcast by a client to the discovery port. Servers waiting for a client answer with an advertisement sent directly to
+     * the sender, so that it doesn't have to wait for the next periodic one. */
+    struct VRCPDiscoveryProbe
+    {
+        VRCPFieldType ftype   = VRCPFieldType::DISCOVERY_PROBE;
+        uint8_t       n_rows  = 1;
+        uint8_t       magic   = VRCP_MAGIC;
+        uint8_t       version = VRCP_VERSION;
+    };
+    static_assert(sizeof(VRCPDiscoveryProbe) == VRCP_ROW_SIZE *VRCPDiscoveryProbe {}.n_rows, "Size must be 4 * n_rows");
+
     /** If the user wants to tunnel data in a VRCP m_packet, this header is added on top of the message.
      * The user can give anything as type field between 0x80 and 0xFF.
      *
@@ -272,24 +308,106 @@ namespace wvb::vrcp
     };
     static_assert(sizeof(VRCPTrackingData) == VRCP_ROW_SIZE *VRCPTrackingData {}.n_rows, "Size must be 4 * n_rows");
 
+    /** Past pose relative to the latest one, in a VRCPCompactTrackingData. */
+    struct VRCPPastPose
+    {
+        /** Ticks between this pose and the latest one. 0 if this past pose is invalid. */
+        uint16_t timestamp_delta = 0;
+        /** Position relative to the latest one, in VRCP_PAST_POSITION_UNITS_PER_METER. */
+        int16_t position_delta[3] = {0, 0, 0};
+        /** Vector part of the rotation from the latest orientation, 10 bits per component. */
+        uint32_t rotation_delta = 0;
+    };
+
+    /**
+     * Smaller alternative to VRCPTrackingData. The latest pose is quantized, and the previous ones are repeated as deltas so that
+     * the server can recover the poses of lost packets without retransmission.
+     *
+     * The FOV isn't included, it is sent with a VRCPFovData when it changes.
+     */
+    struct VRCPCompactTrackingData
+    {
+        VRCPFieldType            ftype         = VRCPFieldType::COMPACT_TRACKING_DATA;
+        uint8_t                  n_rows        = 17;
+        uint8_t                  nb_past_poses = 0;
+        [[maybe_unused]] uint8_t _reserved     = 0;
+
+        uint32_t sample_timestamp = 0;
+        uint32_t pose_timestamp   = 0;
+
+        /** Smallest three encoding: index of the largest component on 2 bits, then the 3 others on 20 bits each. */
+        uint32_t orientation[2] = {0, 0};
+        /** In VRCP_POSITION_UNITS_PER_METER. */
+        int32_t position[3] = {0, 0, 0};
+
+        VRCPPastPose past_poses[WVB_TRACKING_PAST_POSES_CAPACITY] = {};
+
+        // Helpers
+        VRCPCompactTrackingData() = default;
+        VRCPCompactTrackingData(const TrackingState &state);
+
+        /** The FOV of the state is left untouched. */
+        void to_tracking_state(TrackingState &state) const;
+    };
+    static_assert(sizeof(VRCPCompactTrackingData) == VRCP_ROW_SIZE *VRCPCompactTrackingData {}.n_rows, "Size must be 4 * n_rows");
+    static_assert(sizeof(VRCPCompactTrackingData) < sizeof(VRCPTrackingData), "Compact tracking data must be smaller");
+
+    struct VRCPFovData
+    {
+        VRCPFieldType            ftype        = VRCPFieldType::FOV_DATA;
+        uint8_t                  n_rows       = 9;
+        [[maybe_unused]] uint8_t _reserved[2] = {0, 0};
+
+        uint32_t left_eye_fov_left   = 0;
+        uint32_t left_eye_fov_right  = 0;
+        uint32_t left_eye_fov_up     = 0;
+        uint32_t left_eye_fov_down   = 0;
+        uint32_t right_eye_fov_left  = 0;
+        uint32_t right_eye_fov_right = 0;
+        uint32_t right_eye_fov_up    = 0;
+        uint32_t right_eye_fov_down  = 0;
+
+        // Helpers
+        VRCPFovData() = default;
+        VRCPFovData(const Fov &fov_left, const Fov &fov_right);
+
+        void to_tracking_state(TrackingState &state) const;
+    };
+    static_assert(sizeof(VRCPFovData) == VRCP_ROW_SIZE *VRCPFovData {}.n_rows, "Size must be 4 * n_rows");
+
+    /** Sent regularly by the client, so that the driver can keep its vsync at a constant phase from the display refreshes. */
+    struct VRCPDisplayTiming
+    {
+        VRCPFieldType            ftype        = VRCPFieldType::DISPLAY_TIMING;
+        uint8_t                  n_rows       = 3;
+        [[maybe_unused]] uint8_t _reserved[2] = {0, 0};
+
+        /** RTP timestamp at which the latest frame will be displayed, in network byte order. */
+        uint32_t display_timestamp = 0;
+        /** Time between two refreshes of the display in nanoseconds, in network byte order. */
+        uint32_t display_period_ns = 0;
+    };
+    static_assert(sizeof(VRCPDisplayTiming) == VRCP_ROW_SIZE *VRCPDisplayTiming {}.n_rows, "Size must be 4 * n_rows");
+
+    /** Times are on the nanosecond timeline of the RTP clock, in network byte order. */
     struct VRCPFrameTimeMeasurement
     {
-        VRCPFieldType            ftype                          = VRCPFieldType::FRAME_TIME_MEASUREMENT;
-        uint8_t                  n_rows                         = 14;
-        [[maybe_unused]] uint8_t _reserved[2]                   = {0, 0};
-        uint32_t                 frame_index                    = 0;
-        uint32_t                 frame_id                       = 0;
-        uint32_t                 frame_delay                    = 0;
-        uint32_t                 tracking_timestamp             = 0;
-        uint32_t                 last_packet_received_timestamp = 0;
-        uint32_t                 pushed_to_decoder_timestamp    = 0;
-        uint32_t                 begin_wait_frame_timestamp     = 0;
-        uint32_t                 begin_frame_timestamp          = 0;
-        uint32_t                 after_wait_swapchain_timestamp = 0;
-        uint32_t                 after_render_timestamp         = 0;
-        uint32_t                 end_frame_timestamp            = 0;
-        uint32_t                 predicted_present_timestamp    = 0;
-        uint32_t                 pose_timestamp                 = 0;
+        VRCPFieldType            ftype                   = VRCPFieldType::FRAME_TIME_MEASUREMENT;
+        uint8_t                  n_rows                  = 23;
+        [[maybe_unused]] uint8_t _reserved[2]            = {0, 0};
+        uint32_t                 frame_index             = 0;
+        uint32_t                 frame_id                = 0;
+        uint32_t                 frame_delay             = 0;
+        uint32_t                 pose_timestamp          = 0;
+        uint64_t                 tracking_ns             = 0;
+        uint64_t                 last_packet_received_ns = 0;
+        uint64_t                 pushed_to_decoder_ns    = 0;
+        uint64_t                 begin_wait_frame_ns     = 0;
+        uint64_t                 begin_frame_ns          = 0;
+        uint64_t                 after_wait_swapchain_ns = 0;
+        uint64_t                 after_render_ns         = 0;
+        uint64_t                 end_frame_ns            = 0;
+        uint64_t                 predicted_present_ns    = 0;
 
         // Helpers
         VRCPFrameTimeMeasurement() = default;
@@ -318,14 +436,15 @@ namespace wvb::vrcp
     static_assert(sizeof(VRCPImageQualityMeasurement) == VRCP_ROW_SIZE *VRCPImageQualityMeasurement {}.n_rows,
                   "Size must be 4 * n_rows");
 
+    /** Times are on the nanosecond timeline of the RTP clock, in network byte order. */
     struct VRCPTrackingTimeMeasurement
     {
-        VRCPFieldType            ftype                        = VRCPFieldType::TRACKING_TIME_MEASUREMENT;
-        uint8_t                  n_rows                       = 4;
-        [[maybe_unused]] uint8_t _reserved[2]                 = {0, 0};
-        uint32_t                 pose_timestamp               = 0;
-        uint32_t                 tracking_received_timestamp  = 0;
-        uint32_t                 tracking_processed_timestamp = 0;
+        VRCPFieldType            ftype                 = VRCPFieldType::TRACKING_TIME_MEASUREMENT;
+        uint8_t                  n_rows                = 6;
+        [[maybe_unused]] uint8_t _reserved[2]          = {0, 0};
+        uint32_t                 pose_timestamp        = 0;
+        uint64_t                 tracking_received_ns  = 0;
+        uint64_t                 tracking_processed_ns = 0;
 
         // Helpers
         VRCPTrackingTimeMeasurement() = default;
@@ -339,10 +458,12 @@ namespace wvb::vrcp
     struct VRCPNetworkMeasurement
     {
         VRCPFieldType            ftype        = VRCPFieldType::NETWORK_MEASUREMENT;
-        uint8_t                  n_rows       = 3;
+        uint8_t                  n_rows       = 5;
         [[maybe_unused]] uint8_t _reserved[2] = {0, 0};
         uint32_t                 rtt          = 0;
         uint32_t                 clock_error  = 0;
+        uint32_t                 drift_ppm    = 0;
+        uint32_t                 residual     = 0;
 
         // Helpers
         VRCPNetworkMeasurement() = default;
@@ -371,6 +492,25 @@ namespace wvb::vrcp
     };
     static_assert(sizeof(VRCPSocketMeasurement) == VRCP_ROW_SIZE *VRCPSocketMeasurement {}.n_rows, "Size must be 4 * n_rows");
 
+    struct VRCPSendQueueMeasurement
+    {
+        VRCPFieldType            ftype          = VRCPFieldType::SEND_QUEUE_MEASUREMENT;
+        uint8_t                  n_rows         = 6;
+        uint8_t                  priority       = 0;
+        [[maybe_unused]] uint8_t _reserved      = 0;
+        uint32_t                 packets_sent   = 0;
+        uint32_t                 bytes_sent     = 0;
+        uint64_t                 total_delay_us = 0;
+        uint32_t                 max_delay_us   = 0;
+
+        // Helpers
+        VRCPSendQueueMeasurement() = default;
+        VRCPSendQueueMeasurement(const SendQueueMeasurements &send_queue_measurement);
+
+        void to_send_queue_measurements(SendQueueMeasurements &send_queue_measurement) const;
+    };
+    static_assert(sizeof(VRCPSendQueueMeasurement) == VRCP_ROW_SIZE *VRCPSendQueueMeasurement {}.n_rows, "Size must be 4 * n_rows");
+
     /** Part of the clock synchronization algorithm.
      * Client regularly send this packet to the server.
      * A unique ping_id is used to identify the ping.
@@ -428,12 +568,14 @@ namespace wvb::vrcp
     struct VRCPMeasurementTransferFinished
     {
         VRCPFieldType ftype  = VRCPFieldType::MEASUREMENT_TRANSFER_FINISHED;
-        uint8_t       n_rows = 3;
+        uint8_t       n_rows = 5;
         // Other standalone misc measurements
         uint8_t                  decoder_frame_delay  = 0;
         [[maybe_unused]] uint8_t _reserved            = 0;
         uint32_t                 nb_dropped_frames    = 0;
         uint32_t                 nb_catched_up_frames = 0;
+        uint32_t                 sync_duration        = 0;
+        uint32_t                 sync_error_bound     = 0;
     };
     static_assert(sizeof(VRCPMeasurementTransferFinished) == VRCP_ROW_SIZE *VRCPMeasurementTransferFinished {}.n_rows,
                   "Size must be 4 * n_rows");
@@ -1,13 +1,21 @@
 #pragma once
 
 #include "macros.h"
+#include "settings.h"
+#include "socket.h"
 #include "socket_addr.h"
 #include "vrcp.h"
 #include <wvb_common/vr_structs.h>
 
+#include <chrono>
 #include <cstdint>
 #include <vector>
 
+// Maximum number of bulk bytes handed to the TCP socket during a single flush of the send queues.
+// The rest of the bulk data stays in the queue until the next flush, so that a flush never spends its time on a large transfer.
+// It doesn't bound what the kernel socket buffer holds: bulk bytes sent by previous flushes may still be waiting there.
+#define VRCP_DEFAULT_BULK_BUDGET_BYTES (64 * 1024)
+
 namespace wvb
 {
 
@@ -35,6 +43,9 @@ namespace wvb
     {
         uint16_t                 video_port;
         std::vector<std::string> supported_video_codecs;
+        /** Sent to the client in the CONN_ACCEPT, since it runs the sync phase. */
+        uint8_t                  clock_sync_ping_count           = NetworkSettings {}.ping_count;
+        uint16_t                 clock_sync_target_confidence_us = NetworkSettings {}.clock_sync_target_confidence_us;
     };
 
     struct VRCPConnectResp
@@ -42,6 +53,9 @@ namespace wvb
         uint16_t    peer_video_port;
         std::string chosen_video_codec;
         uint64_t    ntp_timestamp;
+        /** Clock sync settings chosen by the server. Defaults if the server didn't send them. */
+        uint8_t     clock_sync_ping_count           = NetworkSettings {}.ping_count;
+        uint16_t    clock_sync_target_confidence_us = NetworkSettings {}.clock_sync_target_confidence_us;
     };
 
     /**
@@ -51,7 +65,8 @@ namespace wvb
      *
      * Lifetime:
      * 1. A server socket will repeatedly advertise itself over a well-known UDP port, 7672 by default.
-     *    This will allow clients to discover the server.
+     *    This will allow clients to discover the server. Clients can also broadcast a probe to another well-known port, 7673 by
+     *    default, to get an advertisement right away.
      * 2. To start a session, a client will establish a TCP session to the server using the port specified in the advertisement.
      *    It also sends its device specification to the server.
      * 3. The server can then either accept or reject the connection. If it accepts, it also sends additional parameters for the
@@ -61,6 +76,9 @@ namespace wvb
      *
      * The socket also includes a buffer for TCP messages. This way, the "receive" function returns
      * one full message at a time, similarly to what we would expect from a UDP socket.
+     *
+     * Reliable messages are not written directly to the TCP socket: they are queued by priority class and
+     * interleaved at packet granularity, so that a large transfer cannot delay a control message.
      */
     class VRCPSocket
     {
@@ -86,6 +104,8 @@ namespace wvb
         /**
          * Creates a basic socket as a server. It doesn't do anything yet.
          * @param tcp_port TCP Port that will be used for session establishment and reliable transfer
+         * @param local_advert_port UDP port from which advertisements are sent, and on which discovery probes are received. Pass
+         * VRCP_DEFAULT_DISCOVERY_PORT to answer the probes of the clients.
          * @param advert_udp_port UDP port used for server advertisements. By default, the 7672 port is used.
          */
         static VRCPSocket create_server(uint8_t                                  advertisement_interval_sec = 3,
@@ -112,6 +132,10 @@ namespace wvb
         /** Returns the list of servers that sent valid advertisements. */
         [[nodiscard]] const std::vector<VRCPServerCandidate> &available_servers() const;
 
+        /** Broadcast a discovery probe. Servers waiting for a client answer immediately, and the answers are then returned by
+         * available_servers(). */
+        void discover(const std::vector<InetAddr> &bcast_addrs, uint16_t discovery_port = VRCP_DEFAULT_DISCOVERY_PORT) const;
+
         /** Connect to TCP socket and send CONN_REQ */
         [[nodiscard]] bool connect(const SocketAddr &addr, const VRCPClientParams &params, VRCPConnectResp *resp) const;
 
@@ -141,8 +165,19 @@ namespace wvb
         [[nodiscard]] bool reliable_receive(const vrcp::VRCPBaseHeader **dest_packet, size_t *dest_size) const;
         /** Receive VRCP message from UDP socket */
         [[nodiscard]] bool unreliable_receive(const vrcp::VRCPBaseHeader **dest_packet, size_t *dest_size) const;
-        /** Send VRCP message via TCP socket */
-        void reliable_send(vrcp::VRCPBaseHeader *packet, size_t size, uint32_t timeout_us = 100000) const;
+        /** Queue VRCP message(s) to be sent via TCP socket, then try to flush the queues.
+         *
+         * The buffer can contain several packets, which will be queued individually. Packets of a higher priority class are
+         * always sent before packets of a lower one, but a packet is never interrupted once it started being sent.
+         */
+        void reliable_send(const vrcp::VRCPBaseHeader *packet, size_t size, SendPriority priority = SendPriority::CONTROL) const;
+        /** Send as many queued reliable packets as the TCP socket accepts without blocking.
+         * Should be called regularly, for example in the polling loop. Returns true if all queues are empty. */
+        bool flush_send_queues() const;
+        /** Set the maximum number of bulk bytes sent per flush. */
+        void set_bulk_budget(size_t bulk_budget_bytes) const;
+        /** Returns the number of bytes waiting in the queue of the given class. */
+        [[nodiscard]] size_t queued_bytes(SendPriority priority) const;
         /** Send VRCP message via UDP socket */
         bool unreliable_send(vrcp::VRCPBaseHeader *packet, size_t size) const;
 
@@ -153,5 +188,13 @@ namespace wvb
         [[nodiscard]] bool is_connected() const;
 
         [[nodiscard]] InetAddr peer_inet_addr() const;
+
+        /** Time it took to establish the session, from the first discover() or connect() call for a client, and from the TCP
+         * connection for a server. Zero if the socket is not connected. */
+        [[nodiscard]] std::chrono::nanoseconds time_to_connected() const;
+
+        /** Handles of the sockets read in the current state, to wait for them in a reactor. The TCP socket comes first. The
+         * handles change when the state changes, e.g. when a connection is accepted. */
+        [[nodiscard]] std::vector<NativeSocketHandle> native_handles() const;
     };
 } // namespace wvb
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+namespace wvb
+{
+    struct VsyncPhaseLockSettings
+    {
+        /** Part of the phase error corrected on the next vsync interval. */
+        double kp = 0.1;
+        /** Part of the phase error accumulated in the period correction, which compensates for the drift between the clocks. */
+        double ki = 0.002;
+        /** Maximum change of a vsync interval, relative to the period, so that the frame rate stays stable while locking. */
+        double max_interval_change = 0.05;
+    };
+
+    /**
+     * Phase-locked loop keeping the driver's virtual vsync at a fixed offset before the client's display refreshes.
+     *
+     * The client's display defines a grid of refresh times, known from a reported display time and its period. At each vsync,
+     * the phase error is the distance to the nearest point of that grid, shifted by the phase offset. The next vsync interval is
+     * the period corrected by a proportional term, to catch up with the phase, and by an integral term, to follow the clock drift
+     * between the two devices.
+     *
+     * All timestamps are in microseconds, from the synchronized RTP clock.
+     */
+    class VsyncPhaseLock
+    {
+      private:
+        VsyncPhaseLockSettings m_settings {};
+        double                 m_nominal_period_us = 0;
+
+        bool m_has_reference = false;
+        /** A time at which the vsync should happen, i.e. a display time minus the phase offset. */
+        int64_t m_reference_us        = 0;
+        double  m_reference_period_us = 0;
+
+        double m_period_correction_us = 0;
+        double m_phase_error_us       = 0;
+        double m_next_interval_us     = 0;
+
+      public:
+        VsyncPhaseLock() = default;
+        explicit VsyncPhaseLock(double nominal_period_us, const VsyncPhaseLockSettings &settings = {});
+
+        /**
+         * Updates the client display timing: a frame is displayed at display_timestamp_us, and the next ones every
+         * display_period_us. The vsync should happen phase_offset_us before each display.
+         */
+        void set_reference(int64_t display_timestamp_us, double display_period_us, int64_t phase_offset_us);
+
+        /** Called at each vsync. Returns the interval until the next one. Without reference, the nominal period is kept. */
+        double on_vsync(int64_t vsync_timestamp_us);
+
+        [[nodiscard]] inline bool has_reference() const { return m_has_reference; }
+
+        /** Signed distance between the latest vsync and its target. Positive if it was late. */
+        [[nodiscard]] inline double phase_error_us() const { return m_phase_error_us; }
+
+        /** Integral correction of the period, which compensates for the clock drift. */
+        [[nodiscard]] inline double period_correction_us() const { return m_period_correction_us; }
+
+        [[nodiscard]] inline double next_interval_us() const { return m_next_interval_us; }
+
+        void reset();
+    };
+} // namespace wvb
@@ -2,12 +2,12 @@
 
 #include <wvb_common/macros.h>
 #include <wvb_common/rtp.h>
+
+#include <unordered_map>
 namespace wvb
 {
-    int64_t to_us(const rtp::RTPClock &clock, uint32_t timestamp)
-    {
-        return std::chrono::duration_cast<std::chrono::microseconds>(clock.from_rtp_timestamp(timestamp).time_since_epoch()).count();
-    }
+    /** Pose timestamps are exported on the nanosecond timeline, like the other times. */
+    int64_t to_ns(const rtp::RTPClock &clock, uint32_t timestamp) { return clock.ns_from_rtp_timestamp(timestamp); }
 
     std::string to_string(SocketId socket_id)
     {
@@ -31,6 +31,18 @@ namespace wvb
         }
     }
 
+    std::string to_string(SendPriority priority)
+    {
+        switch (priority)
+        {
+            case SendPriority::CONTROL: return "CONTROL";
+            case SendPriority::TRACKING: return "TRACKING";
+            case SendPriority::MEASUREMENTS: return "MEASUREMENTS";
+            case SendPriority::BULK: return "BULK";
+            default: return "INVALID";
+        }
+    }
+
     uint32_t SocketMeasurementBucket::register_socket(SocketId socket_id, SocketType socket_type)
     {
         m_socket_measurements.push_back(SocketMeasurements {
@@ -46,22 +58,24 @@ namespace wvb
         max_rtt = 0;
         avg_rtt = 0;
         med_rtt = 0; // median
-        if (m_network_measurements.empty())
+
+        const std::vector<NetworkMeasurements> network_measurements = m_network_measurements.merged();
+        if (network_measurements.empty())
         {
             return;
         }
-        min_rtt = m_network_measurements[0].rtt_us;
-        max_rtt = m_network_measurements[0].rtt_us;
-        for (auto &measurement : m_network_measurements)
+        min_rtt = network_measurements[0].rtt_us;
+        max_rtt = network_measurements[0].rtt_us;
+        for (auto &measurement : network_measurements)
         {
             min_rtt = std::min(min_rtt, measurement.rtt_us);
             max_rtt = std::max(max_rtt, measurement.rtt_us);
             avg_rtt += measurement.rtt_us;
         }
-        avg_rtt /= m_network_measurements.size();
+        avg_rtt /= network_measurements.size();
 
         // Get median rtt
-        med_rtt = compute_median(&m_network_measurements[0].rtt_us, m_network_measurements.size(), sizeof(NetworkMeasurements));
+        med_rtt = compute_median(&network_measurements[0].rtt_us, network_measurements.size(), sizeof(NetworkMeasurements));
     }
 
     void ClientMeasurementBucket::get_clock_error_stats(uint32_t &min_clock_error,
@@ -71,14 +85,16 @@ namespace wvb
         min_clock_error = 0;
         max_clock_error = 0;
         med_clock_error = 0; // median
-        if (m_network_measurements.empty())
+
+        const std::vector<NetworkMeasurements> network_measurements = m_network_measurements.merged();
+        if (network_measurements.empty())
         {
             return;
         }
         // Get min absolute clock error
-        min_clock_error = static_cast<uint32_t>(std::abs(m_network_measurements[0].clock_error_us));
-        max_clock_error = static_cast<uint32_t>(std::abs(m_network_measurements[0].clock_error_us));
-        for (auto &measurement : m_network_measurements)
+        min_clock_error = static_cast<uint32_t>(std::abs(network_measurements[0].clock_error_us));
+        max_clock_error = static_cast<uint32_t>(std::abs(network_measurements[0].clock_error_us));
+        for (auto &measurement : network_measurements)
         {
             min_clock_error = std::min(min_clock_error, static_cast<uint32_t>(std::abs(measurement.clock_error_us)));
             max_clock_error = std::max(max_clock_error, static_cast<uint32_t>(std::abs(measurement.clock_error_us)));
@@ -86,8 +102,8 @@ namespace wvb
 
         // Get median clock error
         std::vector<uint32_t> abs_errors;
-        abs_errors.reserve(m_network_measurements.size());
-        for (auto &measurement : m_network_measurements)
+        abs_errors.reserve(network_measurements.size());
+        for (auto &measurement : network_measurements)
         {
             abs_errors.push_back(static_cast<uint32_t>(std::abs(measurement.clock_error_us)));
         }
@@ -95,29 +111,15 @@ namespace wvb
     }
 
     DriverMeasurementBucket::DriverMeasurementBucket(const DriverMeasurementBucket &other)
+        : m_frame_measurements(other.m_frame_measurements),
+          m_tracking_measurements(other.m_tracking_measurements),
+          m_pose_accesses_measurements(other.m_pose_accesses_measurements),
+          m_pose_prediction_measurements(other.m_pose_prediction_measurements)
     {
-        // Deep copy measurements
-        m_frame_measurements.reserve(other.m_frame_measurements.size());
-        for (auto &measurement : other.m_frame_measurements)
-        {
-            m_frame_measurements.push_back(measurement);
-        }
-
-        m_tracking_measurements.reserve(other.m_tracking_measurements.size());
-        for (auto &measurement : other.m_tracking_measurements)
-        {
-            m_tracking_measurements.push_back(measurement);
-        }
-
-        m_pose_accesses_measurements.reserve(other.m_pose_accesses_measurements.size());
-        for (auto &measurement : other.m_pose_accesses_measurements)
-        {
-            m_pose_accesses_measurements.push_back(measurement);
-        }
-
         m_rtp_clock = other.m_rtp_clock;
         m_window    = other.m_window;
         m_mode      = other.m_mode;
+        update_phase();
     }
 
     DriverMeasurementBucket &DriverMeasurementBucket::operator=(const DriverMeasurementBucket &other)
@@ -127,34 +129,16 @@ namespace wvb
             return *this;
         }
 
-        // this->reset();
-        m_frame_measurements.clear();
-        m_tracking_measurements.clear();
-        m_pose_accesses_measurements.clear();
-        m_tracking_measurements.clear();
-
         // Deep copy measurements
-        m_frame_measurements.reserve(other.m_frame_measurements.size());
-        for (auto &measurement : other.m_frame_measurements)
-        {
-            m_frame_measurements.push_back(measurement);
-        }
-
-        m_tracking_measurements.reserve(other.m_tracking_measurements.size());
-        for (auto &measurement : other.m_tracking_measurements)
-        {
-            m_tracking_measurements.push_back(measurement);
-        }
-
-        m_pose_accesses_measurements.reserve(other.m_pose_accesses_measurements.size());
-        for (auto &measurement : other.m_pose_accesses_measurements)
-        {
-            m_pose_accesses_measurements.push_back(measurement);
-        }
+        m_frame_measurements           = other.m_frame_measurements;
+        m_tracking_measurements        = other.m_tracking_measurements;
+        m_pose_accesses_measurements   = other.m_pose_accesses_measurements;
+        m_pose_prediction_measurements = other.m_pose_prediction_measurements;
 
         // m_rtp_clock = other.m_rtp_clock;
         // m_window    = other.m_window;
         m_mode = other.m_mode;
+        update_phase();
 
         return *this;
     }
@@ -191,9 +175,7 @@ namespace wvb
         }
     }
 
-    void DriverFrameTimeMeasurements::export_csv(std::ofstream                                  &file,
-                                                 const rtp::RTPClock                            &clock,
-                                                 const std::vector<DriverFrameTimeMeasurements> &measurements)
+    void SendQueueMeasurements::export_csv_header(std::ofstream &file)
     {
         if (!file.is_open())
         {
@@ -202,16 +184,46 @@ namespace wvb
         }
 
         // Write header
-        file << "frame_id,present_called,vsync,frame_sent,wait_for_present_called,server_finished,pose_updated_event\n";
+        file << "component,priority,packets_sent,bytes_sent,avg_delay,max_delay\n";
+    }
+
+    void SendQueueMeasurements::export_csv_body(std::ofstream                                                    &file,
+                                                const std::array<SendQueueMeasurements, WVB_SEND_PRIORITY_COUNT> &measurements,
+                                                const char                                                       *component)
+    {
+        if (!file.is_open())
+        {
+            LOGE("File not open\n");
+            return;
+        }
+
+        for (const auto &measurement : measurements)
+        {
+            const uint64_t avg_delay = measurement.packets_sent == 0 ? 0 : measurement.total_delay_us / measurement.packets_sent;
+            file << component << ',' << wvb::to_string(measurement.priority) << ',' << measurement.packets_sent << ','
+                 << measurement.bytes_sent << ',' << avg_delay << ',' << measurement.max_delay_us << '\n';
+        }
+    }
+
+    void DriverFrameTimeMeasurements::export_csv(std::ofstream &file, const std::vector<DriverFrameTimeMeasurements> &measurements)
+    {
+        if (!file.is_open())
+        {
+            LOGE("File not open\n");
+            return;
+        }
+
+        // Write header
+        file << "frame_id,present_called,vsync,frame_sent,wait_for_present_called,server_finished,pose_updated_event,"
+                "present_deadline_error\n";
 
         // Write body
         for (const auto &measurement : measurements)
         {
-            file << measurement.frame_id << ',' << to_us(clock, measurement.present_called_timestamp) << ','
-                 << to_us(clock, measurement.vsync_timestamp) << ',' << to_us(clock, measurement.frame_sent_timestamp) << ','
-                 << to_us(clock, measurement.wait_for_present_called_timestamp) << ','
-                 << to_us(clock, measurement.server_finished_timestamp) << ','
-                 << to_us(clock, measurement.pose_updated_event_timestamp) << '\n';
+            file << measurement.frame_id << ',' << measurement.present_called_ns << ',' << measurement.vsync_ns << ','
+                 << measurement.frame_sent_ns << ',' << measurement.wait_for_present_called_ns << ','
+                 << measurement.server_finished_ns << ',' << measurement.pose_updated_event_ns << ','
+                 << measurement.present_deadline_error_us << '\n';
         }
     }
 
@@ -231,8 +243,8 @@ namespace wvb
         // Write body
         for (const auto &measurement : measurements)
         {
-            file << to_us(clock, measurement.pose_timestamp) << ',' << to_us(clock, measurement.tracking_received_timestamp) << ','
-                 << to_us(clock, measurement.tracking_processed_timestamp) << '\n';
+            file << to_ns(clock, measurement.pose_timestamp) << ',' << measurement.tracking_received_ns << ','
+                 << measurement.tracking_processed_ns << '\n';
         }
     }
 
@@ -252,13 +264,32 @@ namespace wvb
         // Write body
         for (const auto &measurement : measurements)
         {
-            file << to_us(clock, measurement.pose_timestamp) << ',' << to_us(clock, measurement.pose_accessed_timestamp) << '\n';
+            file << to_ns(clock, measurement.pose_timestamp) << ',' << measurement.pose_accessed_ns << '\n';
         }
     }
 
-    void ServerFrameTimeMeasurements::export_csv(std::ofstream                                  &file,
-                                                 const rtp::RTPClock                            &clock,
-                                                 const std::vector<ServerFrameTimeMeasurements> &measurements)
+    void PosePredictionMeasurements::export_csv(std::ofstream                                 &file,
+                                                const rtp::RTPClock                           &clock,
+                                                const std::vector<PosePredictionMeasurements> &measurements)
+    {
+        if (!file.is_open())
+        {
+            LOGE("File not open\n");
+            return;
+        }
+
+        // Write header
+        file << "pose_timestamp,target_timestamp,orientation_error,position_error\n";
+
+        // Write body
+        for (const auto &measurement : measurements)
+        {
+            file << to_ns(clock, measurement.pose_timestamp) << ',' << measurement.target_ns << ',' << measurement.orientation_error
+                 << ',' << measurement.position_error << '\n';
+        }
+    }
+
+    void ServerFrameTimeMeasurements::export_csv(std::ofstream &file, const std::vector<ServerFrameTimeMeasurements> &measurements)
     {
         if (!file.is_open())
         {
@@ -274,19 +305,13 @@ namespace wvb
         // Write body
         for (const auto &measurement : measurements)
         {
-            file << measurement.frame_id << ',' << measurement.dropped << ','
-                 << to_us(clock, measurement.frame_event_received_timestamp) << ','
-                 << to_us(clock, measurement.present_info_received_timestamp) << ','
-                 << to_us(clock, measurement.shared_texture_opened_timestamp) << ','
-                 << to_us(clock, measurement.shared_texture_acquired_timestamp) << ','
-                 << to_us(clock, measurement.staging_texture_mapped_timestamp) << ','
-                 << to_us(clock, measurement.frame_pushed_timestamp) << ','
-                 << to_us(clock, measurement.frame_pulled_timestamp) << ','
-                 << to_us(clock, measurement.before_last_get_next_packet_timestamp) << ','
-                 << to_us(clock, measurement.after_last_get_next_packet_timestamp) << ','
-                 << to_us(clock, measurement.before_last_send_packet_timestamp) << ','
-                 << to_us(clock, measurement.after_last_send_packet_timestamp) << ','
-                 << to_us(clock, measurement.finished_signal_sent_timestamp) << '\n';
+            file << measurement.frame_id << ',' << measurement.dropped << ',' << measurement.frame_event_received_ns << ','
+                 << measurement.present_info_received_ns << ',' << measurement.shared_texture_opened_ns << ','
+                 << measurement.shared_texture_acquired_ns << ',' << measurement.staging_texture_mapped_ns << ','
+                 << measurement.frame_pushed_ns << ',' << measurement.frame_pulled_ns << ','
+                 << measurement.before_last_get_next_packet_ns << ',' << measurement.after_last_get_next_packet_ns << ','
+                 << measurement.before_last_send_packet_ns << ',' << measurement.after_last_send_packet_ns << ','
+                 << measurement.finished_signal_sent_ns << '\n';
         }
     }
 
@@ -299,13 +324,13 @@ namespace wvb
         }
 
         // Write header
-        file << "frame_id,codestream_size,raw_size,psnr\n";
+        file << "frame_id,codestream_size,raw_size,psnr,ssim,ms_ssim\n";
 
         // Write body
         for (const auto &measurement : measurements)
         {
             file << measurement.frame_id << ',' << measurement.codestream_size << ',' << measurement.raw_size << ','
-                 << measurement.psnr << '\n';
+                 << measurement.psnr << ',' << measurement.ssim << ',' << measurement.ms_ssim << '\n';
         }
     }
 
@@ -327,12 +352,10 @@ namespace wvb
         for (const auto &measurement : measurements)
         {
             file << measurement.frame_index << ',' << measurement.frame_id << ',' << measurement.frame_delay << ','
-                 << to_us(clock, measurement.tracking_timestamp) << ',' << to_us(clock, measurement.last_packet_received_timestamp)
-                 << ',' << to_us(clock, measurement.pushed_to_decoder_timestamp) << ','
-                 << to_us(clock, measurement.begin_wait_frame_timestamp) << ',' << to_us(clock, measurement.begin_frame_timestamp)
-                 << ',' << to_us(clock, measurement.after_wait_swapchain_timestamp) << ','
-                 << to_us(clock, measurement.after_render_timestamp) << ',' << to_us(clock, measurement.end_frame_timestamp) << ','
-                 << to_us(clock, measurement.predicted_present_timestamp) << ',' << to_us(clock, measurement.pose_timestamp) << '\n';
+                 << measurement.tracking_ns << ',' << measurement.last_packet_received_ns << ',' << measurement.pushed_to_decoder_ns
+                 << ',' << measurement.begin_wait_frame_ns << ',' << measurement.begin_frame_ns << ','
+                 << measurement.after_wait_swapchain_ns << ',' << measurement.after_render_ns << ',' << measurement.end_frame_ns
+                 << ',' << measurement.predicted_present_ns << ',' << to_ns(clock, measurement.pose_timestamp) << '\n';
         }
     }
 
@@ -345,12 +368,13 @@ namespace wvb
         }
 
         // Write header
-        file << "rtt,clock_error\n";
+        file << "rtt,clock_error,drift,residual\n";
 
         // Write body
         for (const auto &measurement : measurements)
         {
-            file << measurement.rtt_us << ',' << measurement.clock_error_us << '\n';
+            file << measurement.rtt_us << ',' << measurement.clock_error_us << ',' << measurement.drift_ppm << ','
+                 << measurement.residual_us << '\n';
         }
     }
 
@@ -359,7 +383,9 @@ namespace wvb
                                       uint32_t       nb_dropped_frames_client,
                                       uint32_t       nb_catched_up_frames_client,
                                       uint32_t       encoder_delay,
-                                      uint32_t       decoder_delay)
+                                      uint32_t       decoder_delay,
+                                      uint32_t       sync_duration_us,
+                                      uint32_t       sync_error_bound_us)
     {
         if (!file.is_open())
         {
@@ -368,11 +394,401 @@ namespace wvb
         }
 
         // Write header
-        file << "nb_dropped_frames_server,nb_dropped_frames_client,nb_catched_up_frames_client,encoder_delay,decoder_delay\n";
+        file << "nb_dropped_frames_server,nb_dropped_frames_client,nb_catched_up_frames_client,encoder_delay,decoder_delay,"
+                "sync_duration,sync_error_bound\n";
 
         // Write body
         file << nb_dropped_frames_server << ',' << nb_dropped_frames_client << ',' << nb_catched_up_frames_client << ','
-             << encoder_delay << ',' << decoder_delay << '\n';
+             << encoder_delay << ',' << decoder_delay << ',' << sync_duration_us << ',' << sync_error_bound_us << '\n';
+    }
+
+    std::string to_string(LatencyStage stage)
+    {
+        switch (stage)
+        {
+            case LatencyStage::ENCODE: return "ENCODE";
+            case LatencyStage::SEND: return "SEND";
+            case LatencyStage::NETWORK: return "NETWORK";
+            case LatencyStage::DECODE: return "DECODE";
+            case LatencyStage::RENDER: return "RENDER";
+            case LatencyStage::MOTION_TO_PHOTON: return "MOTION_TO_PHOTON";
+            default: return "UNKNOWN";
+        }
+    }
+
+    /** Writes the percentiles of each stage. Histograms and sketches share the same table, so that they are loaded the same way. */
+    template<typename Distribution>
+    void export_stage_latencies_csv(std::ofstream &file, const std::array<Distribution, WVB_LATENCY_STAGE_COUNT> &stages)
+    {
+        if (!file.is_open())
+        {
+            LOGE("File not open\n");
+            return;
+        }
+
+        // Write header
+        file << "stage,count,min,mean,p50,p90,p99,p999,max\n";
+
+        // Write body, in integer nanoseconds like the other times
+        for (size_t i = 0; i < stages.size(); i++)
+        {
+            const auto &stage    = stages[i];
+            const auto  quantile = [&stage](double q) { return static_cast<int64_t>(stage.value_at_quantile(q)); };
+            file << to_string(static_cast<LatencyStage>(i)) << ',' << stage.count() << ',' << static_cast<int64_t>(stage.min()) << ','
+                 << static_cast<int64_t>(stage.mean()) << ',' << quantile(0.5) << ',' << quantile(0.9) << ',' << quantile(0.99) << ','
+                 << quantile(0.999) << ',' << static_cast<int64_t>(stage.max()) << '\n';
+        }
+    }
+
+    void StageLatencyHistograms::record_server_frame(const ServerFrameTimeMeasurements &server_frame)
+    {
+        if (server_frame.dropped)
+        {
+            return;
+        }
+
+        // The texture is only acquired when it has to be copied
+        const int64_t acquired_ns = server_frame.shared_texture_acquired_ns != 0 ? server_frame.shared_texture_acquired_ns
+                                                                                  : server_frame.frame_pushed_ns;
+        record_between(LatencyStage::ENCODE, acquired_ns, server_frame.after_last_get_next_packet_ns);
+        record_between(LatencyStage::SEND, server_frame.after_last_get_next_packet_ns, server_frame.after_last_send_packet_ns);
+    }
+
+    void StageLatencyHistograms::record_client_frame(const ClientFrameTimeMeasurements &client_frame,
+                                                     const ServerFrameTimeMeasurements *server_frame)
+    {
+        if (server_frame != nullptr)
+        {
+            record_between(LatencyStage::NETWORK, server_frame->after_last_send_packet_ns, client_frame.last_packet_received_ns);
+        }
+        record_between(LatencyStage::DECODE, client_frame.pushed_to_decoder_ns, client_frame.after_render_ns);
+        record_between(LatencyStage::RENDER, client_frame.after_render_ns, client_frame.end_frame_ns);
+        record_between(LatencyStage::MOTION_TO_PHOTON, client_frame.tracking_ns, client_frame.predicted_present_ns);
+    }
+
+    void StageLatencyHistograms::record_frames(const std::vector<ServerFrameTimeMeasurements> &server_measurements,
+                                               const std::vector<ClientFrameTimeMeasurements> &client_measurements)
+    {
+        std::unordered_map<uint32_t, const ServerFrameTimeMeasurements *> server_frames;
+        server_frames.reserve(server_measurements.size());
+        for (const auto &server_frame : server_measurements)
+        {
+            if (!server_frame.dropped)
+            {
+                server_frames[server_frame.frame_id] = &server_frame;
+            }
+            record_server_frame(server_frame);
+        }
+
+        for (const auto &client_frame : client_measurements)
+        {
+            const auto server_frame = server_frames.find(client_frame.frame_id);
+            record_client_frame(client_frame, server_frame != server_frames.end() ? server_frame->second : nullptr);
+        }
+    }
+
+    void StageLatencyHistograms::merge(const StageLatencyHistograms &other)
+    {
+        for (size_t i = 0; i < stages.size(); i++)
+        {
+            stages[i].merge(other.stages[i]);
+        }
+    }
+
+    void StageLatencyHistograms::reset()
+    {
+        for (auto &stage : stages)
+        {
+            stage.reset();
+        }
+    }
+
+    void StageLatencyHistograms::export_csv(std::ofstream &file, const StageLatencyHistograms &latencies)
+    {
+        export_stage_latencies_csv(file, latencies.stages);
+    }
+
+    void StageLatencySketches::add(const StageLatencyHistograms &histograms)
+    {
+        for (size_t i = 0; i < stages.size(); i++)
+        {
+            stages[i].add(histograms.stages[i]);
+        }
+    }
+
+    void StageLatencySketches::merge(const StageLatencySketches &other)
+    {
+        for (size_t i = 0; i < stages.size(); i++)
+        {
+            stages[i].merge(other.stages[i]);
+        }
+    }
+
+    void StageLatencySketches::reset()
+    {
+        for (auto &stage : stages)
+        {
+            stage.reset();
+        }
+    }
+
+    void StageLatencySketches::export_csv(std::ofstream &file, const StageLatencySketches &latencies)
+    {
+        export_stage_latencies_csv(file, latencies.stages);
+    }
+
+    // --- Columnar export ---
+    // Tables and columns have the same names as in the CSV export.
+
+    /** Pose timestamps of the measurements, on the nanosecond timeline. */
+    template<typename T>
+    std::vector<int64_t> pose_timestamps_ns(const rtp::RTPClock &clock, const std::vector<T> &measurements)
+    {
+        std::vector<int64_t> timestamps(measurements.size());
+        for (size_t i = 0; i < measurements.size(); i++)
+        {
+            timestamps[i] = to_ns(clock, measurements[i].pose_timestamp);
+        }
+        return timestamps;
+    }
+
+    void SocketMeasurements::export_columns(ColumnarFileWriter                    &file,
+                                            const std::string                     &table_name,
+                                            const std::vector<SocketMeasurements> &server_measurements,
+                                            const std::vector<SocketMeasurements> &client_measurements)
+    {
+        std::vector<SocketMeasurements> measurements = server_measurements;
+        measurements.insert(measurements.end(), client_measurements.begin(), client_measurements.end());
+
+        std::vector<std::string> components(measurements.size(), EXPORT_FILE_CLIENT_ID);
+        std::fill_n(components.begin(), server_measurements.size(), EXPORT_FILE_SERVER_ID);
+        std::vector<std::string> socket_ids;
+        std::vector<std::string> socket_types;
+        for (const auto &measurement : measurements)
+        {
+            socket_ids.push_back(wvb::to_string(measurement.socket_id));
+            socket_types.push_back(wvb::to_string(measurement.socket_type));
+        }
+
+        file.begin_table(table_name, 7, measurements.size());
+        file.write_column("component", components);
+        file.write_column("socket_id", socket_ids);
+        file.write_column("socket_type", socket_types);
+        file.write_column("bytes_sent", measurements, &SocketMeasurements::bytes_sent);
+        file.write_column("bytes_received", measurements, &SocketMeasurements::bytes_received);
+        file.write_column("packets_sent", measurements, &SocketMeasurements::packets_sent);
+        file.write_column("packets_received", measurements, &SocketMeasurements::packets_received);
+    }
+
+    void SendQueueMeasurements::export_columns(ColumnarFileWriter                                               &file,
+                                               const std::string                                                &table_name,
+                                               const std::array<SendQueueMeasurements, WVB_SEND_PRIORITY_COUNT> &server_measurements,
+                                               const std::array<SendQueueMeasurements, WVB_SEND_PRIORITY_COUNT> &client_measurements)
+    {
+        std::vector<SendQueueMeasurements> measurements(server_measurements.begin(), server_measurements.end());
+        measurements.insert(measurements.end(), client_measurements.begin(), client_measurements.end());
+
+        std::vector<std::string> components(measurements.size(), EXPORT_FILE_CLIENT_ID);
+        std::fill_n(components.begin(), server_measurements.size(), EXPORT_FILE_SERVER_ID);
+        std::vector<std::string> priorities;
+        std::vector<int64_t>     avg_delays;
+        for (const auto &measurement : measurements)
+        {
+            priorities.push_back(wvb::to_string(measurement.priority));
+            avg_delays.push_back(
+                measurement.packets_sent == 0 ? 0 : static_cast<int64_t>(measurement.total_delay_us / measurement.packets_sent));
+        }
+
+        file.begin_table(table_name, 6, measurements.size());
+        file.write_column("component", components);
+        file.write_column("priority", priorities);
+        file.write_column("packets_sent", measurements, &SendQueueMeasurements::packets_sent);
+        file.write_column("bytes_sent", measurements, &SendQueueMeasurements::bytes_sent);
+        file.write_column("avg_delay", avg_delays);
+        file.write_column("max_delay", measurements, &SendQueueMeasurements::max_delay_us);
+    }
+
+    void DriverFrameTimeMeasurements::export_columns(ColumnarFileWriter                             &file,
+                                                     const std::string                              &table_name,
+                                                     const std::vector<DriverFrameTimeMeasurements> &measurements)
+    {
+        file.begin_table(table_name, 8, measurements.size());
+        file.write_column("frame_id", measurements, &DriverFrameTimeMeasurements::frame_id);
+        file.write_column("present_called", measurements, &DriverFrameTimeMeasurements::present_called_ns);
+        file.write_column("vsync", measurements, &DriverFrameTimeMeasurements::vsync_ns);
+        file.write_column("frame_sent", measurements, &DriverFrameTimeMeasurements::frame_sent_ns);
+        file.write_column("wait_for_present_called", measurements, &DriverFrameTimeMeasurements::wait_for_present_called_ns);
+        file.write_column("server_finished", measurements, &DriverFrameTimeMeasurements::server_finished_ns);
+        file.write_column("pose_updated_event", measurements, &DriverFrameTimeMeasurements::pose_updated_event_ns);
+        file.write_column("present_deadline_error", measurements, &DriverFrameTimeMeasurements::present_deadline_error_us);
+    }
+
+    void TrackingTimeMeasurements::export_columns(ColumnarFileWriter                          &file,
+                                                  const std::string                           &table_name,
+                                                  const rtp::RTPClock                         &clock,
+                                                  const std::vector<TrackingTimeMeasurements> &measurements)
+    {
+        file.begin_table(table_name, 3, measurements.size());
+        file.write_column("pose_timestamp", pose_timestamps_ns(clock, measurements));
+        file.write_column("tracking_received", measurements, &TrackingTimeMeasurements::tracking_received_ns);
+        file.write_column("tracking_processed", measurements, &TrackingTimeMeasurements::tracking_processed_ns);
+    }
+
+    void PoseAccessTimeMeasurements::export_columns(ColumnarFileWriter                            &file,
+                                                    const std::string                             &table_name,
+                                                    const rtp::RTPClock                           &clock,
+                                                    const std::vector<PoseAccessTimeMeasurements> &measurements)
+    {
+        file.begin_table(table_name, 2, measurements.size());
+        file.write_column("pose_timestamp", pose_timestamps_ns(clock, measurements));
+        file.write_column("pose_accessed", measurements, &PoseAccessTimeMeasurements::pose_accessed_ns);
+    }
+
+    void PosePredictionMeasurements::export_columns(ColumnarFileWriter                            &file,
+                                                    const std::string                             &table_name,
+                                                    const rtp::RTPClock                           &clock,
+                                                    const std::vector<PosePredictionMeasurements> &measurements)
+    {
+        file.begin_table(table_name, 4, measurements.size());
+        file.write_column("pose_timestamp", pose_timestamps_ns(clock, measurements));
+        file.write_column("target_timestamp", measurements, &PosePredictionMeasurements::target_ns);
+        file.write_column("orientation_error", measurements, &PosePredictionMeasurements::orientation_error);
+        file.write_column("position_error", measurements, &PosePredictionMeasurements::position_error);
+    }
+
+    void ServerFrameTimeMeasurements::export_columns(ColumnarFileWriter                             &file,
+                                                     const std::string                              &table_name,
+                                                     const std::vector<ServerFrameTimeMeasurements> &measurements)
+    {
+        using M = ServerFrameTimeMeasurements;
+
+        file.begin_table(table_name, 14, measurements.size());
+        file.write_column("frame_id", measurements, &M::frame_id);
+        file.write_column("dropped", measurements, &M::dropped);
+        file.write_column("frame_event_received", measurements, &M::frame_event_received_ns);
+        file.write_column("present_info_received", measurements, &M::present_info_received_ns);
+        file.write_column("shared_texture_opened", measurements, &M::shared_texture_opened_ns);
+        file.write_column("shared_texture_acquired", measurements, &M::shared_texture_acquired_ns);
+        file.write_column("staging_texture_mapped", measurements, &M::staging_texture_mapped_ns);
+        file.write_column("encoder_frame_pushed", measurements, &M::frame_pushed_ns);
+        file.write_column("encoder_frame_pulled", measurements, &M::frame_pulled_ns);
+        file.write_column("before_last_get_next_packet", measurements, &M::before_last_get_next_packet_ns);
+        file.write_column("after_last_get_next_packet", measurements, &M::after_last_get_next_packet_ns);
+        file.write_column("before_last_send_packet", measurements, &M::before_last_send_packet_ns);
+        file.write_column("after_last_send_packet", measurements, &M::after_last_send_packet_ns);
+        file.write_column("finished_signal_sent", measurements, &M::finished_signal_sent_ns);
+    }
+
+    void ImageQualityMeasurements::export_columns(ColumnarFileWriter                          &file,
+                                                  const std::string                           &table_name,
+                                                  const std::vector<ImageQualityMeasurements> &measurements)
+    {
+        file.begin_table(table_name, 6, measurements.size());
+        file.write_column("frame_id", measurements, &ImageQualityMeasurements::frame_id);
+        file.write_column("codestream_size", measurements, &ImageQualityMeasurements::codestream_size);
+        file.write_column("raw_size", measurements, &ImageQualityMeasurements::raw_size);
+        file.write_column("psnr", measurements, &ImageQualityMeasurements::psnr);
+        file.write_column("ssim", measurements, &ImageQualityMeasurements::ssim);
+        file.write_column("ms_ssim", measurements, &ImageQualityMeasurements::ms_ssim);
+    }
+
+    void ClientFrameTimeMeasurements::export_columns(ColumnarFileWriter                             &file,
+                                                     const std::string                              &table_name,
+                                                     const rtp::RTPClock                            &clock,
+                                                     const std::vector<ClientFrameTimeMeasurements> &measurements)
+    {
+        using M = ClientFrameTimeMeasurements;
+
+        file.begin_table(table_name, 13, measurements.size());
+        file.write_column("frame_index", measurements, &M::frame_index);
+        file.write_column("frame_id", measurements, &M::frame_id);
+        file.write_column("frame_delay", measurements, &M::frame_delay);
+        file.write_column("tracking_sampled", measurements, &M::tracking_ns);
+        file.write_column("last_packet_received", measurements, &M::last_packet_received_ns);
+        file.write_column("pushed_to_decoder", measurements, &M::pushed_to_decoder_ns);
+        file.write_column("begin_wait_frame", measurements, &M::begin_wait_frame_ns);
+        file.write_column("begin_frame", measurements, &M::begin_frame_ns);
+        file.write_column("after_wait_swapchain", measurements, &M::after_wait_swapchain_ns);
+        file.write_column("after_render", measurements, &M::after_render_ns);
+        file.write_column("end_frame", measurements, &M::end_frame_ns);
+        file.write_column("predicted_present_time", measurements, &M::predicted_present_ns);
+        file.write_column("pose_timestamp", pose_timestamps_ns(clock, measurements));
+    }
+
+    void NetworkMeasurements::export_columns(ColumnarFileWriter                     &file,
+                                             const std::string                      &table_name,
+                                             const std::vector<NetworkMeasurements> &measurements)
+    {
+        file.begin_table(table_name, 4, measurements.size());
+        file.write_column("rtt", measurements, &NetworkMeasurements::rtt_us);
+        file.write_column("clock_error", measurements, &NetworkMeasurements::clock_error_us);
+        file.write_column("drift", measurements, &NetworkMeasurements::drift_ppm);
+        file.write_column("residual", measurements, &NetworkMeasurements::residual_us);
+    }
+
+    void export_misc_measurements_columns(ColumnarFileWriter &file,
+                                          const std::string  &table_name,
+                                          uint32_t            nb_dropped_frames_server,
+                                          uint32_t            nb_dropped_frames_client,
+                                          uint32_t            nb_catched_up_frames_client,
+                                          uint32_t            encoder_delay,
+                                          uint32_t            decoder_delay,
+                                          uint32_t            sync_duration_us,
+                                          uint32_t            sync_error_bound_us)
+    {
+        file.begin_table(table_name, 7, 1);
+        file.write_column("nb_dropped_frames_server", std::vector<uint32_t> {nb_dropped_frames_server});
+        file.write_column("nb_dropped_frames_client", std::vector<uint32_t> {nb_dropped_frames_client});
+        file.write_column("nb_catched_up_frames_client", std::vector<uint32_t> {nb_catched_up_frames_client});
+        file.write_column("encoder_delay", std::vector<uint32_t> {encoder_delay});
+        file.write_column("decoder_delay", std::vector<uint32_t> {decoder_delay});
+        file.write_column("sync_duration", std::vector<uint32_t> {sync_duration_us});
+        file.write_column("sync_error_bound", std::vector<uint32_t> {sync_error_bound_us});
+    }
+
+    template<typename Distribution>
+    void export_stage_latencies_columns(ColumnarFileWriter                                      &file,
+                                        const std::string                                       &table_name,
+                                        const std::array<Distribution, WVB_LATENCY_STAGE_COUNT> &stages)
+    {
+        std::vector<std::string> names;
+        // Same statistics as in the CSV export, in integer nanoseconds
+        std::array<std::vector<int64_t>, 8> statistics;
+        for (size_t i = 0; i < stages.size(); i++)
+        {
+            const auto &stage = stages[i];
+            names.push_back(to_string(static_cast<LatencyStage>(i)));
+            statistics[0].push_back(static_cast<int64_t>(stage.count()));
+            statistics[1].push_back(static_cast<int64_t>(stage.min()));
+            statistics[2].push_back(static_cast<int64_t>(stage.mean()));
+            statistics[3].push_back(static_cast<int64_t>(stage.value_at_quantile(0.5)));
+            statistics[4].push_back(static_cast<int64_t>(stage.value_at_quantile(0.9)));
+            statistics[5].push_back(static_cast<int64_t>(stage.value_at_quantile(0.99)));
+            statistics[6].push_back(static_cast<int64_t>(stage.value_at_quantile(0.999)));
+            statistics[7].push_back(static_cast<int64_t>(stage.max()));
+        }
+
+        static const char *statistic_names[] = {"count", "min", "mean", "p50", "p90", "p99", "p999", "max"};
+        file.begin_table(table_name, 1 + statistics.size(), stages.size());
+        file.write_column("stage", names);
+        for (size_t i = 0; i < statistics.size(); i++)
+        {
+            file.write_column(statistic_names[i], statistics[i]);
+        }
+    }
+
+    void StageLatencyHistograms::export_columns(ColumnarFileWriter           &file,
+                                                const std::string            &table_name,
+                                                const StageLatencyHistograms &latencies)
+    {
+        export_stage_latencies_columns(file, table_name, latencies.stages);
+    }
+
+    void StageLatencySketches::export_columns(ColumnarFileWriter         &file,
+                                              const std::string          &table_name,
+                                              const StageLatencySketches &latencies)
+    {
+        export_stage_latencies_columns(file, table_name, latencies.stages);
     }
 
     // void BenchmarkContext::print_stats(const rtp::RTPClock &clock) const
@@ -0,0 +1,193 @@
+#include "wvb_common/clock_sync.h"
+
+#include <wvb_common/repetition_scheduler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                  ClockSyncEstimator                                 =
+    // =======================================================================================
+
+    ClockSyncEstimator::ClockSyncEstimator(size_t filter_size, size_t regression_size)
+        : m_filter_size(filter_size > 0 ? filter_size : 1),
+          m_regression_size(regression_size > 0 ? regression_size : 1)
+    {
+    }
+
+    bool ClockSyncEstimator::add_sample(const ClockSyncSample &sample)
+    {
+        if (sample.rtt_us() < 0)
+        {
+            // Invalid sample
+            return false;
+        }
+
+        m_recent_samples.push_back(sample);
+        if (m_recent_samples.size() > m_filter_size)
+        {
+            m_recent_samples.pop_front();
+        }
+
+        // Find the recent sample with the lowest RTT
+        const ClockSyncSample *best = &m_recent_samples.front();
+        for (const auto &recent_sample : m_recent_samples)
+        {
+            if (recent_sample.rtt_us() <= best->rtt_us())
+            {
+                best = &recent_sample;
+            }
+        }
+
+        // Only use it if it is newer than the last used one. Otherwise, the best sample was already used,
+        // and the new ones are less reliable.
+        if (!m_filtered_samples.empty() && best->local_receive_us <= m_filtered_samples.back().local_receive_us)
+        {
+            return false;
+        }
+
+        m_filtered_samples.push_back(*best);
+        if (m_filtered_samples.size() > m_regression_size)
+        {
+            m_filtered_samples.pop_front();
+        }
+
+        fit();
+        return true;
+    }
+
+    void ClockSyncEstimator::reset()
+    {
+        m_recent_samples.clear();
+        m_filtered_samples.clear();
+        m_reference_us = 0;
+        m_offset_us    = 0;
+        m_drift        = 0;
+        m_residual_us  = 0;
+    }
+
+    double ClockSyncEstimator::offset_at(int64_t local_us) const
+    {
+        return m_offset_us + m_drift * static_cast<double>(local_us - m_reference_us);
+    }
+
+    void ClockSyncEstimator::fit()
+    {
+        const auto n = static_cast<double>(m_filtered_samples.size());
+
+        // Use the latest sample as reference to keep the values small
+        m_reference_us = m_filtered_samples.back().local_mid_us();
+
+        double mean_x = 0;
+        double mean_y = 0;
+        for (const auto &sample : m_filtered_samples)
+        {
+            mean_x += static_cast<double>(sample.local_mid_us() - m_reference_us);
+            mean_y += static_cast<double>(sample.offset_us());
+        }
+        mean_x /= n;
+        mean_y /= n;
+
+        double sxx = 0;
+        double sxy = 0;
+        for (const auto &sample : m_filtered_samples)
+        {
+            const double dx = static_cast<double>(sample.local_mid_us() - m_reference_us) - mean_x;
+            const double dy = static_cast<double>(sample.offset_us()) - mean_y;
+            sxx += dx * dx;
+            sxy += dx * dy;
+        }
+
+        const auto span_us = m_filtered_samples.back().local_mid_us() - m_filtered_samples.front().local_mid_us();
+        if (span_us >= WVB_CLOCK_SYNC_MIN_DRIFT_SPAN_US && sxx > 0)
+        {
+            // Least squares line
+            m_drift     = sxy / sxx;
+            m_offset_us = mean_y - m_drift * mean_x;
+        }
+        else
+        {
+            // Not enough history to see the drift: use the mean offset
+            m_drift     = 0;
+            m_offset_us = mean_y;
+        }
+
+        // Residual error
+        double sum_squares = 0;
+        for (const auto &sample : m_filtered_samples)
+        {
+            const double error = static_cast<double>(sample.offset_us()) - offset_at(sample.local_mid_us());
+            sum_squares += error * error;
+        }
+        m_residual_us = n > 1 ? std::sqrt(sum_squares / (n - 1)) : 0;
+    }
+
+    // =======================================================================================
+    // =                                 ClockSyncBurstFilter                                =
+    // =======================================================================================
+
+    ClockSyncBurstFilter::ClockSyncBurstFilter(size_t nb_kept_samples) : m_nb_kept_samples(nb_kept_samples > 0 ? nb_kept_samples : 1)
+    {
+    }
+
+    void ClockSyncBurstFilter::add_sample(const ClockSyncSample &sample)
+    {
+        if (sample.rtt_us() < 0)
+        {
+            // Invalid sample
+            return;
+        }
+        m_nb_samples++;
+
+        // Insert it at its place, and drop the worst one if there are too many
+        const auto by_rtt   = [](const ClockSyncSample &a, const ClockSyncSample &b) { return a.rtt_us() < b.rtt_us(); };
+        const auto position = std::upper_bound(m_best_samples.begin(), m_best_samples.end(), sample, by_rtt);
+        m_best_samples.insert(position, sample);
+        if (m_best_samples.size() > m_nb_kept_samples)
+        {
+            m_best_samples.pop_back();
+        }
+
+        update_estimate();
+    }
+
+    void ClockSyncBurstFilter::reset()
+    {
+        m_nb_samples = 0;
+        m_best_samples.clear();
+        m_offset_us     = 0;
+        m_confidence_us = std::numeric_limits<double>::infinity();
+    }
+
+    void ClockSyncBurstFilter::update_estimate()
+    {
+        const auto n = m_best_samples.size();
+
+        double mean = 0;
+        for (const auto &sample : m_best_samples)
+        {
+            mean += static_cast<double>(sample.offset_us());
+        }
+        mean /= static_cast<double>(n);
+        m_offset_us = mean;
+
+        if (n < WVB_CLOCK_SYNC_BURST_MIN_SAMPLES)
+        {
+            m_confidence_us = std::numeric_limits<double>::infinity();
+            return;
+        }
+
+        double sum_squares = 0;
+        for (const auto &sample : m_best_samples)
+        {
+            const double diff = static_cast<double>(sample.offset_us()) - mean;
+            sum_squares += diff * diff;
+        }
+        const double std_dev = std::sqrt(sum_squares / static_cast<double>(n - 1));
+
+        m_confidence_us = student_t_95(static_cast<uint32_t>(n - 1)) * std_dev / std::sqrt(static_cast<double>(n));
+    }
+} // namespace wvb
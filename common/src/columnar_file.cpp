@@ -0,0 +1,228 @@
+#include "wvb_common/columnar_file.h"
+
+#include <wvb_common/macros.h>
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                 ColumnarFileWriter                                  =
+    // =======================================================================================
+
+    ColumnarFileWriter::ColumnarFileWriter(const std::string &path) : m_file(path, std::ios::out | std::ios::trunc | std::ios::binary)
+    {
+        if (!m_file.is_open())
+        {
+            LOGE("Failed to open output file %s\n", path.c_str());
+            return;
+        }
+
+        m_file.write(WVB_COLUMNAR_FILE_MAGIC, 4);
+        write_value<uint32_t>(WVB_COLUMNAR_FILE_VERSION);
+    }
+
+    bool ColumnarFileWriter::close()
+    {
+        m_file.close();
+        return !m_file.fail();
+    }
+
+    void ColumnarFileWriter::write_string(const std::string &value)
+    {
+        write_value(static_cast<uint32_t>(value.size()));
+        m_file.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+    void ColumnarFileWriter::begin_table(const std::string &name, uint32_t nb_columns, uint32_t nb_rows)
+    {
+        if (m_nb_remaining_columns != 0)
+        {
+            throw std::logic_error("ColumnarFileWriter: table \"" + name + "\" started before the previous one was complete");
+        }
+
+        write_string(name);
+        write_value(nb_columns);
+        write_value(nb_rows);
+        m_nb_rows              = nb_rows;
+        m_nb_remaining_columns = nb_columns;
+    }
+
+    void ColumnarFileWriter::begin_column(const std::string &name, ColumnType type, uint64_t size)
+    {
+        if (m_nb_remaining_columns == 0)
+        {
+            throw std::logic_error("ColumnarFileWriter: column \"" + name + "\" doesn't fit in its table");
+        }
+        m_nb_remaining_columns--;
+
+        write_string(name);
+        write_value(type);
+        write_value(size);
+    }
+
+    void ColumnarFileWriter::write_column(const std::string &name, const std::vector<uint8_t> &values, ColumnType type)
+    {
+        if (values.size() != m_nb_rows)
+        {
+            throw std::invalid_argument("ColumnarFileWriter: column \"" + name + "\" doesn't have the row count of its table");
+        }
+
+        begin_column(name, type, values.size());
+        m_file.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size()));
+    }
+
+    void ColumnarFileWriter::write_column(const std::string &name, const std::vector<std::string> &values)
+    {
+        if (values.size() != m_nb_rows)
+        {
+            throw std::invalid_argument("ColumnarFileWriter: column \"" + name + "\" doesn't have the row count of its table");
+        }
+
+        // Serialize the column first, so that it is written at once
+        std::vector<char> data;
+        for (const auto &value : values)
+        {
+            const auto size = static_cast<uint32_t>(value.size());
+            data.insert(data.end(), reinterpret_cast<const char *>(&size), reinterpret_cast<const char *>(&size) + sizeof(size));
+            data.insert(data.end(), value.begin(), value.end());
+        }
+
+        begin_column(name, ColumnType::STRING, data.size());
+        m_file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    // =======================================================================================
+    // =                                       Reading                                       =
+    // =======================================================================================
+
+    std::vector<std::string> ColumnarColumn::strings() const
+    {
+        if (type != ColumnType::STRING)
+        {
+            throw std::runtime_error("ColumnarColumn: column \"" + name + "\" doesn't hold strings");
+        }
+
+        std::vector<std::string> values;
+        size_t                   offset = 0;
+        while (offset + sizeof(uint32_t) <= data.size())
+        {
+            uint32_t size = 0;
+            std::memcpy(&size, data.data() + offset, sizeof(size));
+            offset += sizeof(size);
+            if (offset + size > data.size())
+            {
+                throw std::runtime_error("ColumnarColumn: truncated string in column \"" + name + "\"");
+            }
+            values.emplace_back(reinterpret_cast<const char *>(data.data() + offset), size);
+            offset += size;
+        }
+        return values;
+    }
+
+    std::vector<int64_t> ColumnarColumn::int64_values() const
+    {
+        const auto converted = [](const auto &values) { return std::vector<int64_t>(values.begin(), values.end()); };
+        switch (type)
+        {
+            case ColumnType::BOOL: return converted(values<bool>());
+            case ColumnType::INT32: return converted(values<int32_t>());
+            case ColumnType::UINT32: return converted(values<uint32_t>());
+            case ColumnType::INT64: return values<int64_t>();
+            case ColumnType::FLOAT32: return converted(values<float>());
+            default: throw std::runtime_error("ColumnarColumn: column \"" + name + "\" isn't numerical");
+        }
+    }
+
+    const ColumnarColumn *ColumnarTable::column(const std::string &column_name) const
+    {
+        for (const auto &column : columns)
+        {
+            if (column.name == column_name)
+            {
+                return &column;
+            }
+        }
+        return nullptr;
+    }
+
+    /** Reads a value, or throws if the end of the file is reached. */
+    template<typename T>
+    static T read_value(std::ifstream &file)
+    {
+        T value {};
+        if (!file.read(reinterpret_cast<char *>(&value), sizeof(T)))
+        {
+            throw std::runtime_error("read_columnar_file: unexpected end of file");
+        }
+        return value;
+    }
+
+    /** Reads the size of the data that follows, or throws if that data would go past the end of the file. */
+    template<typename T>
+    static T read_size(std::ifstream &file, std::streamoff file_size)
+    {
+        const T size = read_value<T>(file);
+        if (size > static_cast<uint64_t>(file_size - file.tellg()))
+        {
+            throw std::runtime_error("read_columnar_file: size past the end of the file");
+        }
+        return size;
+    }
+
+    static std::string read_string(std::ifstream &file, std::streamoff file_size)
+    {
+        std::string value(read_size<uint32_t>(file, file_size), '\0');
+        if (!file.read(value.data(), static_cast<std::streamsize>(value.size())))
+        {
+            throw std::runtime_error("read_columnar_file: unexpected end of file");
+        }
+        return value;
+    }
+
+    std::vector<ColumnarTable> read_columnar_file(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("read_columnar_file: failed to open " + path);
+        }
+        // Sizes are checked against the file size, so that a corrupted one doesn't allocate a huge buffer
+        const std::streamoff file_size = file.tellg();
+        file.seekg(0);
+
+        char magic[4] = {};
+        file.read(magic, sizeof(magic));
+        if (!file || std::memcmp(magic, WVB_COLUMNAR_FILE_MAGIC, sizeof(magic)) != 0)
+        {
+            throw std::runtime_error("read_columnar_file: " + path + " isn't a columnar measurement file");
+        }
+        if (read_value<uint32_t>(file) != WVB_COLUMNAR_FILE_VERSION)
+        {
+            throw std::runtime_error("read_columnar_file: unsupported version of " + path);
+        }
+
+        std::vector<ColumnarTable> tables;
+        // Tables follow each other until the end of the file
+        while (file.peek() != std::ifstream::traits_type::eof())
+        {
+            ColumnarTable table;
+            table.name                = read_string(file, file_size);
+            const uint32_t nb_columns = read_value<uint32_t>(file);
+            table.nb_rows             = read_value<uint32_t>(file);
+
+            for (uint32_t i = 0; i < nb_columns; i++)
+            {
+                ColumnarColumn column;
+                column.name = read_string(file, file_size);
+                column.type = read_value<ColumnType>(file);
+                column.data.resize(read_size<uint64_t>(file, file_size));
+                if (!file.read(reinterpret_cast<char *>(column.data.data()), static_cast<std::streamsize>(column.data.size())))
+                {
+                    throw std::runtime_error("read_columnar_file: unexpected end of file");
+                }
+                table.columns.push_back(std::move(column));
+            }
+            tables.push_back(std::move(table));
+        }
+        return tables;
+    }
+} // namespace wvb
@@ -0,0 +1,212 @@
+#include "wvb_common/export_worker.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                       Structs                                       =
+    // =======================================================================================
+
+    struct ExportJob
+    {
+        std::string                 path;
+        ExportWorker::WriteFunction write;
+    };
+
+    struct ExportWorker::Data
+    {
+        ResultCallback on_result;
+        size_t         queue_capacity;
+
+        mutable std::mutex      mutex;
+        std::condition_variable queue_not_empty;
+        std::condition_variable queue_not_full;
+        std::condition_variable idle;
+        std::deque<ExportJob>   queue;
+        /** Queued exports, and those of the batch being processed. */
+        size_t      nb_pending  = 0;
+        uint32_t    nb_failed   = 0;
+        bool        should_stop = false;
+        std::thread thread;
+
+        void worker_thread_main();
+    };
+
+    // =======================================================================================
+    // =                                   Implementation                                    =
+    // =======================================================================================
+
+    void ExportWorker::Data::worker_thread_main()
+    {
+        while (true)
+        {
+            // Take all the waiting exports at once, so that they are synced together
+            std::deque<ExportJob> batch;
+            {
+                std::unique_lock lock(mutex);
+                queue_not_empty.wait(lock, [this] { return should_stop || !queue.empty(); });
+                if (queue.empty())
+                {
+                    // Only stop once the queue is drained
+                    return;
+                }
+                batch.swap(queue);
+            }
+            queue_not_full.notify_all();
+
+            std::vector<ExportResult> results;
+            results.reserve(batch.size());
+            for (auto &job : batch)
+            {
+                ExportResult result {.path = std::move(job.path)};
+                try
+                {
+                    result.success = job.write(result.path);
+                }
+                catch (const std::exception &e)
+                {
+                    LOGE("Failed to export %s: %s\n", result.path.c_str(), e.what());
+                }
+                // Release the snapshot as soon as it is written
+                job.write = nullptr;
+                results.push_back(std::move(result));
+            }
+
+            for (auto &result : results)
+            {
+                if (result.success)
+                {
+                    result.success = sync_file(result.path);
+                }
+                if (on_result != nullptr)
+                {
+                    on_result(result);
+                }
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                for (const auto &result : results)
+                {
+                    nb_failed += result.success ? 0 : 1;
+                }
+                nb_pending -= results.size();
+            }
+            idle.notify_all();
+        }
+    }
+
+    bool sync_file(const std::string &path)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(),
+                                  GENERIC_WRITE,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL,
+                                  nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        const bool success = FlushFileBuffers(file) != 0;
+        CloseHandle(file);
+        return success;
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        const bool success = fsync(fd) == 0;
+        close(fd);
+        return success;
+#endif
+    }
+
+    // =======================================================================================
+    // =                                         API                                         =
+    // =======================================================================================
+
+    ExportWorker::ExportWorker(ResultCallback on_result, size_t queue_capacity)
+        : m_data(new Data {
+            .on_result      = std::move(on_result),
+            .queue_capacity = queue_capacity,
+        })
+    {
+        if (queue_capacity == 0)
+        {
+            delete m_data;
+            m_data = nullptr;
+            throw std::invalid_argument("Export queue capacity cannot be 0");
+        }
+
+        m_data->thread = std::thread(&ExportWorker::Data::worker_thread_main, m_data);
+    }
+
+    ExportWorker::~ExportWorker()
+    {
+        if (m_data != nullptr)
+        {
+            {
+                std::lock_guard lock(m_data->mutex);
+                m_data->should_stop = true;
+            }
+            m_data->queue_not_empty.notify_all();
+            if (m_data->thread.joinable())
+            {
+                m_data->thread.join();
+            }
+
+            delete m_data;
+            m_data = nullptr;
+        }
+    }
+
+    void ExportWorker::submit(std::string path, WriteFunction write)
+    {
+        {
+            std::unique_lock lock(m_data->mutex);
+            m_data->queue_not_full.wait(lock, [this] { return m_data->queue.size() < m_data->queue_capacity; });
+            m_data->queue.push_back({.path = std::move(path), .write = std::move(write)});
+            m_data->nb_pending++;
+        }
+        m_data->queue_not_empty.notify_one();
+    }
+
+    void ExportWorker::wait_idle()
+    {
+        std::unique_lock lock(m_data->mutex);
+        m_data->idle.wait(lock, [this] { return m_data->nb_pending == 0; });
+    }
+
+    size_t ExportWorker::nb_pending() const
+    {
+        std::lock_guard lock(m_data->mutex);
+        return m_data->nb_pending;
+    }
+
+    uint32_t ExportWorker::nb_failed() const
+    {
+        std::lock_guard lock(m_data->mutex);
+        return m_data->nb_failed;
+    }
+} // namespace wvb
@@ -111,6 +111,18 @@ namespace wvb
             m_current_rtp_timestamp      = ntohl(data->timestamp);
             m_current_rtp_pose_timestamp = ntohl(data->pose_timestamp_ext);
             m_current_frame_id           = ntohl(data->frame_id_ext);
+
+            m_current_rendered_pose.orientation = {
+                ntohf(data->rendered_orientation_ext[0]),
+                ntohf(data->rendered_orientation_ext[1]),
+                ntohf(data->rendered_orientation_ext[2]),
+                ntohf(data->rendered_orientation_ext[3]),
+            };
+            m_current_rendered_pose.position = {
+                ntohf(data->rendered_position_ext[0]),
+                ntohf(data->rendered_position_ext[1]),
+                ntohf(data->rendered_position_ext[2]),
+            };
         }
 
         // If the payload is a fragmented NAL
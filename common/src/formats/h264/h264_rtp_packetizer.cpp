@@ -36,6 +36,7 @@ namespace wvb
                             bool           end_of_stream,
                             uint32_t       rtp_timestamp,
                             uint32_t       rtp_pose_timestamp,
+                            const Pose    &rendered_pose,
                             bool           last,
                             bool           save_frame) override;
         bool create_next_packet(const uint8_t **__restrict out_packet_data, size_t *__restrict out_size) override;
@@ -75,6 +76,7 @@ namespace wvb
                                            bool           end_of_stream,
                                            uint32_t       rtp_timestamp,
                                            uint32_t       rtp_pose_timestamp,
+                                           const Pose    &rendered_pose,
                                            bool           last,
                                            bool           save_frame)
     {
@@ -83,9 +85,16 @@ namespace wvb
         m_current_nalu_header = 0;
         m_last                = last;
 
-        packet()->timestamp          = htonl(rtp_timestamp);
-        packet()->pose_timestamp_ext = htonl(rtp_pose_timestamp);
-        packet()->frame_id_ext       = htonl(frame_id);
+        packet()->timestamp                   = htonl(rtp_timestamp);
+        packet()->pose_timestamp_ext          = htonl(rtp_pose_timestamp);
+        packet()->frame_id_ext                = htonl(frame_id);
+        packet()->rendered_orientation_ext[0] = htonf(rendered_pose.orientation.x);
+        packet()->rendered_orientation_ext[1] = htonf(rendered_pose.orientation.y);
+        packet()->rendered_orientation_ext[2] = htonf(rendered_pose.orientation.z);
+        packet()->rendered_orientation_ext[3] = htonf(rendered_pose.orientation.w);
+        packet()->rendered_position_ext[0]    = htonf(rendered_pose.position.x);
+        packet()->rendered_position_ext[1]    = htonf(rendered_pose.position.y);
+        packet()->rendered_position_ext[2]    = htonf(rendered_pose.position.z);
     }
 
     bool H264RtpPacketizer::create_next_packet(const uint8_t **__restrict out_packet_data, size_t *__restrict out_size)
@@ -183,6 +183,7 @@ namespace wvb
                                               bool *__restrict out_eos,
                                               uint32_t *__restrict out_rtp_timestamp,
                                               uint32_t *__restrict out_rtp_pose_timestamp,
+                                              Pose *__restrict out_rendered_pose,
                                               std::chrono::steady_clock::time_point *out_last_packet_received_time,
                                               bool *__restrict out_save_frame)
     {
@@ -195,6 +196,7 @@ namespace wvb
         *out_frame_size                = m_frame_data.size();
         *out_rtp_timestamp             = m_current_rtp_timestamp;
         *out_rtp_pose_timestamp        = m_current_rtp_pose_timestamp;
+        *out_rendered_pose             = m_current_rendered_pose;
         *out_last_packet_received_time = m_last_packet_received_time;
 
         return true;
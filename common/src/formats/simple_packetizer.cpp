@@ -56,9 +56,12 @@ namespace wvb
             /** Timestamp of the sampling time of the frame. */
             uint32_t rtp_sample_timestamp = 0;
             /** Timestamp of the pose that was used to generate the frame. */
-            uint32_t          rtp_pose_timestamp = 0;
-            uint32_t          frame_id           = 0;
-            SimpleHeaderFlags flags              = SimpleHeaderFlags::NONE;
+            uint32_t rtp_pose_timestamp = 0;
+            /** Pose the frame was rendered with, as floats in network order. */
+            uint32_t          rendered_orientation[4] = {0};
+            uint32_t          rendered_position[3]    = {0};
+            uint32_t          frame_id                = 0;
+            SimpleHeaderFlags flags                   = SimpleHeaderFlags::NONE;
         };
 
         const uint8_t *m_data        = nullptr;
@@ -76,6 +79,7 @@ namespace wvb
                             bool           end_of_stream,
                             uint32_t       rtp_sampling_timestamp,
                             uint32_t       rtp_pose_timestamp,
+                            const Pose    &rendered_pose,
                             bool           save_frame,
                             bool           last_of_frame) override;
 
@@ -117,6 +121,7 @@ namespace wvb
                                 bool *__restrict out_end_of_stream,
                                 uint32_t *__restrict out_rtp_timestamp,
                                 uint32_t *__restrict out_rtp_pose_timestamp,
+                                Pose *__restrict out_rendered_pose,
                                 std::chrono::steady_clock::time_point *out_last_packet_received_time,
                                 bool *__restrict out_save_frame) override;
         void release_frame_data() override;
@@ -130,15 +135,23 @@ namespace wvb
                                           bool           end_of_stream,
                                           uint32_t       rtp_sampling_timestamp,
                                           uint32_t       rtp_pose_timestamp,
+                                          const Pose    &rendered_pose,
                                           bool           save_frame,
                                           bool           last_of_frame)
     {
         // No processing to do, simply store the parameters
-        m_data                        = data;
-        m_header.size                 = htonl(sizeof(SimpleHeader) + size);
-        m_header.rtp_sample_timestamp = htonl(rtp_sampling_timestamp);
-        m_header.rtp_pose_timestamp   = htonl(rtp_pose_timestamp);
-        m_header.frame_id             = htonl(frame_id);
+        m_data                           = data;
+        m_header.size                    = htonl(sizeof(SimpleHeader) + size);
+        m_header.rtp_sample_timestamp    = htonl(rtp_sampling_timestamp);
+        m_header.rtp_pose_timestamp      = htonl(rtp_pose_timestamp);
+        m_header.rendered_orientation[0] = htonf(rendered_pose.orientation.x);
+        m_header.rendered_orientation[1] = htonf(rendered_pose.orientation.y);
+        m_header.rendered_orientation[2] = htonf(rendered_pose.orientation.z);
+        m_header.rendered_orientation[3] = htonf(rendered_pose.orientation.w);
+        m_header.rendered_position[0]    = htonf(rendered_pose.position.x);
+        m_header.rendered_position[1]    = htonf(rendered_pose.position.y);
+        m_header.rendered_position[2]    = htonf(rendered_pose.position.z);
+        m_header.frame_id                = htonl(frame_id);
         if (last_of_frame)
         {
             m_header.flags = m_header.flags | SimpleHeaderFlags::END_OF_FRAME;
@@ -270,6 +283,7 @@ namespace wvb
                                                 bool *__restrict out_end_of_stream,
                                                 uint32_t *__restrict out_rtp_timestamp,
                                                 uint32_t *__restrict out_rtp_pose_timestamp,
+                                                Pose *__restrict out_rendered_pose,
                                                 std::chrono::steady_clock::time_point *out_last_packet_received_time,
                                                 bool *__restrict out_save_frame)
     {
@@ -346,6 +360,18 @@ namespace wvb
             *out_end_of_stream = (header->flags & wvb::SimplePacketizer::SimpleHeaderFlags::END_OF_STREAM)
                                  == wvb::SimplePacketizer::SimpleHeaderFlags::END_OF_STREAM;
 
+            out_rendered_pose->orientation = {
+                ntohf(header->rendered_orientation[0]),
+                ntohf(header->rendered_orientation[1]),
+                ntohf(header->rendered_orientation[2]),
+                ntohf(header->rendered_orientation[3]),
+            };
+            out_rendered_pose->position = {
+                ntohf(header->rendered_position[0]),
+                ntohf(header->rendered_position[1]),
+                ntohf(header->rendered_position[2]),
+            };
+
             // Don't free the lock yet until we are done with the data
             return true;
         }
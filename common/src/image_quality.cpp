@@ -0,0 +1,551 @@
+#include "wvb_common/image_quality.h"
+
+#include <wvb_common/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WVB_IMAGE_QUALITY_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define WVB_IMAGE_QUALITY_NEON
+#include <arm_neon.h>
+#endif
+
+// Number of samples in a SSIM window
+#define SSIM_WINDOW_AREA (WVB_SSIM_WINDOW_SIZE * WVB_SSIM_WINDOW_SIZE)
+// Stabilization constants of the SSIM, for 8-bit samples
+#define SSIM_C1 ((0.01 * 255) * (0.01 * 255))
+#define SSIM_C2 ((0.03 * 255) * (0.03 * 255))
+// Vectors accumulated before the 32-bit sums of squared errors could overflow
+#define SQUARED_ERROR_BLOCK_SIZE 4096
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                       Structs                                       =
+    // =======================================================================================
+
+    static constexpr double MS_SSIM_WEIGHTS[WVB_MS_SSIM_NB_SCALES] = {0.0448, 0.2856, 0.3001, 0.2363, 0.1333};
+
+    /** Samples of one channel of an image. */
+    struct Channel
+    {
+        const uint8_t *data      = nullptr;
+        uint32_t       width     = 0;
+        uint32_t       height    = 0;
+        size_t         row_pitch = 0;
+        /** Bytes between two samples of a row. */
+        uint32_t step = 1;
+
+        [[nodiscard]] inline const uint8_t *row(uint32_t y) const { return data + y * row_pitch; }
+    };
+
+    /** Rows of bytes compared for the PSNR. */
+    struct Plane
+    {
+        const uint8_t *data       = nullptr;
+        uint32_t       row_size   = 0;
+        uint32_t       height     = 0;
+        size_t         row_pitch  = 0;
+        bool           skip_alpha = false;
+    };
+
+    /** Sums over the SSIM windows of a tile. */
+    struct SSIMSums
+    {
+        double ssim = 0;
+        /** Contrast-structure term, used by MS-SSIM. */
+        double   cs         = 0;
+        uint64_t nb_windows = 0;
+
+        inline SSIMSums &operator+=(const SSIMSums &other)
+        {
+            ssim += other.ssim;
+            cs += other.cs;
+            nb_windows += other.nb_windows;
+            return *this;
+        }
+    };
+
+    /** Window sums of a row of SSIM windows. */
+    struct WindowSums
+    {
+        std::vector<int32_t> x;
+        std::vector<int32_t> y;
+        std::vector<int32_t> xx;
+        std::vector<int32_t> yy;
+        std::vector<int32_t> xy;
+
+        explicit WindowSums(size_t size) : x(size, 0), y(size, 0), xx(size, 0), yy(size, 0), xy(size, 0) {}
+    };
+
+    // =======================================================================================
+    // =                                       Kernels                                       =
+    // =======================================================================================
+
+    /** Sum of the squared differences of the bytes. If skip_alpha is set, the bytes are RGBA or BGRA pixels and alpha is skipped. */
+    static uint64_t squared_error(const uint8_t *a, const uint8_t *b, size_t size, bool skip_alpha)
+    {
+        uint64_t sum = 0;
+        size_t   i   = 0;
+#if defined(WVB_IMAGE_QUALITY_SSE2)
+        const __m128i mask = _mm_set1_epi32(skip_alpha ? 0x00FFFFFF : -1);
+        const __m128i zero = _mm_setzero_si128();
+        while (i + 16 <= size)
+        {
+            __m128i acc = zero;
+            for (size_t j = 0; j < SQUARED_ERROR_BLOCK_SIZE && i + 16 <= size; j++, i += 16)
+            {
+                const __m128i va = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)), mask);
+                const __m128i vb = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)), mask);
+                const __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+                const __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+                acc              = _mm_add_epi32(acc, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+            }
+            alignas(16) uint32_t lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+            sum += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+        }
+#elif defined(WVB_IMAGE_QUALITY_NEON)
+        const uint8x16_t mask = vreinterpretq_u8_u32(vdupq_n_u32(skip_alpha ? 0x00FFFFFF : 0xFFFFFFFF));
+        while (i + 16 <= size)
+        {
+            uint32x4_t acc = vdupq_n_u32(0);
+            for (size_t j = 0; j < SQUARED_ERROR_BLOCK_SIZE && i + 16 <= size; j++, i += 16)
+            {
+                const uint8x16_t diff = vabdq_u8(vandq_u8(vld1q_u8(a + i), mask), vandq_u8(vld1q_u8(b + i), mask));
+                acc                   = vpadalq_u16(acc, vmull_u8(vget_low_u8(diff), vget_low_u8(diff)));
+                acc                   = vpadalq_u16(acc, vmull_high_u8(diff, diff));
+            }
+            sum += vaddlvq_u32(acc);
+        }
+#endif
+        for (; i < size; i++)
+        {
+            if (skip_alpha && i % 4 == 3)
+            {
+                continue;
+            }
+            const int32_t diff = static_cast<int32_t>(a[i]) - static_cast<int32_t>(b[i]);
+            sum += static_cast<uint64_t>(diff * diff);
+        }
+        return sum;
+    }
+
+    /**
+     * Adds the SSIM and contrast-structure terms of a row of windows, from the sums of their samples.
+     *
+     * Multiplying the terms of the SSIM by the square of the window area N keeps them in integers until the divisions:
+     * N^2 * mean_x * mean_y = sum_x * sum_y, and N^2 * var_x = k * (N * sum_xx - sum_x^2), with k = N / (N - 1) for the sample
+     * variance. These products fit in 32-bit integers for 8-bit samples.
+     */
+    static void add_ssim_row(const WindowSums &sums, size_t size, SSIMSums &result)
+    {
+        constexpr int32_t N  = SSIM_WINDOW_AREA;
+        constexpr double  k  = static_cast<double>(N) / (N - 1);
+        constexpr double  c1 = SSIM_C1 * N * N;
+        constexpr double  c2 = SSIM_C2 * N * N;
+
+        size_t i = 0;
+#if defined(WVB_IMAGE_QUALITY_SSE2)
+        const __m128 c1_v  = _mm_set1_ps(static_cast<float>(c1));
+        const __m128 c2_v  = _mm_set1_ps(static_cast<float>(c2));
+        const __m128 k_v   = _mm_set1_ps(static_cast<float>(k));
+        const __m128 two_k = _mm_set1_ps(static_cast<float>(2 * k));
+        const __m128 two   = _mm_set1_ps(2.0f);
+        __m128d      ssim_acc[2] = {_mm_setzero_pd(), _mm_setzero_pd()};
+        __m128d      cs_acc[2]   = {_mm_setzero_pd(), _mm_setzero_pd()};
+        for (; i + 4 <= size; i += 4)
+        {
+            const __m128i sx  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sums.x.data() + i));
+            const __m128i sy  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sums.y.data() + i));
+            const __m128i sxx = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sums.xx.data() + i));
+            const __m128i syy = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sums.yy.data() + i));
+            const __m128i sxy = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sums.xy.data() + i));
+
+            // Sums of samples are below 2^15, so their high 16 bits are 0 and madd multiplies them exactly
+            const __m128i x_y = _mm_madd_epi16(sx, sy);
+            const __m128i x_x = _mm_madd_epi16(sx, sx);
+            const __m128i y_y = _mm_madd_epi16(sy, sy);
+            // N * sum, with N = 49 = 32 + 16 + 1
+            const auto times_n = [](__m128i v) { return _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(v, 5), _mm_slli_epi32(v, 4)), v); };
+            const __m128i cov  = _mm_sub_epi32(times_n(sxy), x_y);
+            const __m128i vars = _mm_sub_epi32(_mm_add_epi32(times_n(sxx), times_n(syy)), _mm_add_epi32(x_x, y_y));
+
+            const __m128 a1 = _mm_add_ps(_mm_mul_ps(two, _mm_cvtepi32_ps(x_y)), c1_v);
+            const __m128 b1 = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(x_x, y_y)), c1_v);
+            const __m128 a2 = _mm_add_ps(_mm_mul_ps(two_k, _mm_cvtepi32_ps(cov)), c2_v);
+            const __m128 b2 = _mm_add_ps(_mm_mul_ps(k_v, _mm_cvtepi32_ps(vars)), c2_v);
+            const __m128 cs = _mm_div_ps(a2, b2);
+            const __m128 s  = _mm_div_ps(_mm_mul_ps(a1, cs), b1);
+
+            ssim_acc[0] = _mm_add_pd(ssim_acc[0], _mm_cvtps_pd(s));
+            ssim_acc[1] = _mm_add_pd(ssim_acc[1], _mm_cvtps_pd(_mm_movehl_ps(s, s)));
+            cs_acc[0]   = _mm_add_pd(cs_acc[0], _mm_cvtps_pd(cs));
+            cs_acc[1]   = _mm_add_pd(cs_acc[1], _mm_cvtps_pd(_mm_movehl_ps(cs, cs)));
+        }
+        alignas(16) double lanes[2];
+        _mm_store_pd(lanes, _mm_add_pd(ssim_acc[0], ssim_acc[1]));
+        result.ssim += lanes[0] + lanes[1];
+        _mm_store_pd(lanes, _mm_add_pd(cs_acc[0], cs_acc[1]));
+        result.cs += lanes[0] + lanes[1];
+#elif defined(WVB_IMAGE_QUALITY_NEON)
+        const float32x4_t c1_v        = vdupq_n_f32(static_cast<float>(c1));
+        const float32x4_t c2_v        = vdupq_n_f32(static_cast<float>(c2));
+        float64x2_t       ssim_acc[2] = {vdupq_n_f64(0), vdupq_n_f64(0)};
+        float64x2_t       cs_acc[2]   = {vdupq_n_f64(0), vdupq_n_f64(0)};
+        for (; i + 4 <= size; i += 4)
+        {
+            const int32x4_t sx  = vld1q_s32(sums.x.data() + i);
+            const int32x4_t sy  = vld1q_s32(sums.y.data() + i);
+            const int32x4_t sxx = vld1q_s32(sums.xx.data() + i);
+            const int32x4_t syy = vld1q_s32(sums.yy.data() + i);
+            const int32x4_t sxy = vld1q_s32(sums.xy.data() + i);
+
+            const int32x4_t x_y  = vmulq_s32(sx, sy);
+            const int32x4_t x_x  = vmulq_s32(sx, sx);
+            const int32x4_t y_y  = vmulq_s32(sy, sy);
+            const int32x4_t cov  = vsubq_s32(vmulq_n_s32(sxy, N), x_y);
+            const int32x4_t vars = vsubq_s32(vmulq_n_s32(vaddq_s32(sxx, syy), N), vaddq_s32(x_x, y_y));
+
+            const float32x4_t a1 = vmlaq_n_f32(c1_v, vcvtq_f32_s32(x_y), 2.0f);
+            const float32x4_t b1 = vaddq_f32(vcvtq_f32_s32(vaddq_s32(x_x, y_y)), c1_v);
+            const float32x4_t a2 = vmlaq_n_f32(c2_v, vcvtq_f32_s32(cov), static_cast<float>(2 * k));
+            const float32x4_t b2 = vmlaq_n_f32(c2_v, vcvtq_f32_s32(vars), static_cast<float>(k));
+            const float32x4_t cs = vdivq_f32(a2, b2);
+            const float32x4_t s  = vdivq_f32(vmulq_f32(a1, cs), b1);
+
+            ssim_acc[0] = vaddq_f64(ssim_acc[0], vcvt_f64_f32(vget_low_f32(s)));
+            ssim_acc[1] = vaddq_f64(ssim_acc[1], vcvt_high_f64_f32(s));
+            cs_acc[0]   = vaddq_f64(cs_acc[0], vcvt_f64_f32(vget_low_f32(cs)));
+            cs_acc[1]   = vaddq_f64(cs_acc[1], vcvt_high_f64_f32(cs));
+        }
+        result.ssim += vaddvq_f64(vaddq_f64(ssim_acc[0], ssim_acc[1]));
+        result.cs += vaddvq_f64(vaddq_f64(cs_acc[0], cs_acc[1]));
+#endif
+        for (; i < size; i++)
+        {
+            const auto   x_y  = static_cast<int64_t>(sums.x[i]) * sums.y[i];
+            const auto   x_x  = static_cast<int64_t>(sums.x[i]) * sums.x[i];
+            const auto   y_y  = static_cast<int64_t>(sums.y[i]) * sums.y[i];
+            const auto   cov  = static_cast<int64_t>(N) * sums.xy[i] - x_y;
+            const auto   vars = static_cast<int64_t>(N) * (sums.xx[i] + sums.yy[i]) - x_x - y_y;
+            const double cs   = (2 * k * static_cast<double>(cov) + c2) / (k * static_cast<double>(vars) + c2);
+            result.ssim += (2 * static_cast<double>(x_y) + c1) * cs / (static_cast<double>(x_x + y_y) + c1);
+            result.cs += cs;
+        }
+        result.nb_windows += size;
+    }
+
+    /** Adds or removes a row of samples from the column sums. */
+    static void update_columns(const Channel &x, const Channel &y, uint32_t row, int32_t sign, WindowSums &columns)
+    {
+        const uint8_t *x_row = x.row(row);
+        const uint8_t *y_row = y.row(row);
+        for (uint32_t i = 0; i < x.width; i++)
+        {
+            const int32_t a = x_row[i * x.step];
+            const int32_t b = y_row[i * y.step];
+            columns.x[i] += sign * a;
+            columns.y[i] += sign * b;
+            columns.xx[i] += sign * a * a;
+            columns.yy[i] += sign * b * b;
+            columns.xy[i] += sign * a * b;
+        }
+    }
+
+    /** Sums the columns over each window of the row. */
+    static void sum_windows(const std::vector<int32_t> &columns, std::vector<int32_t> &windows)
+    {
+        int32_t sum = 0;
+        for (size_t i = 0; i < WVB_SSIM_WINDOW_SIZE; i++)
+        {
+            sum += columns[i];
+        }
+        windows[0] = sum;
+        for (size_t i = 1; i < windows.size(); i++)
+        {
+            sum += columns[i + WVB_SSIM_WINDOW_SIZE - 1] - columns[i - 1];
+            windows[i] = sum;
+        }
+    }
+
+    /** SSIM terms of the windows whose top rows are in [first_row, end_row). The sums of each column of the window are kept up to
+     * date as the window slides down, and summed horizontally for each row. */
+    static SSIMSums ssim_tile(const Channel &x, const Channel &y, uint32_t first_row, uint32_t end_row)
+    {
+        const uint32_t out_width = x.width - WVB_SSIM_WINDOW_SIZE + 1;
+        WindowSums     columns(x.width);
+        WindowSums     windows(out_width);
+        SSIMSums       result;
+
+        for (uint32_t row = first_row; row < first_row + WVB_SSIM_WINDOW_SIZE - 1; row++)
+        {
+            update_columns(x, y, row, 1, columns);
+        }
+        for (uint32_t row = first_row; row < end_row; row++)
+        {
+            update_columns(x, y, row + WVB_SSIM_WINDOW_SIZE - 1, 1, columns);
+            sum_windows(columns.x, windows.x);
+            sum_windows(columns.y, windows.y);
+            sum_windows(columns.xx, windows.xx);
+            sum_windows(columns.yy, windows.yy);
+            sum_windows(columns.xy, windows.xy);
+            add_ssim_row(windows, out_width, result);
+            update_columns(x, y, row, -1, columns);
+        }
+        return result;
+    }
+
+    /** Halves the size of the channel by averaging 2x2 blocks. */
+    static Channel downsample(const Channel &channel, std::vector<uint8_t> &storage)
+    {
+        const uint32_t width  = channel.width / 2;
+        const uint32_t height = channel.height / 2;
+        storage.resize(static_cast<size_t>(width) * height);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            const uint8_t *top    = channel.row(2 * y);
+            const uint8_t *bottom = channel.row(2 * y + 1);
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const uint32_t left  = 2 * x * channel.step;
+                const uint32_t right = left + channel.step;
+                storage[y * width + x] =
+                    static_cast<uint8_t>((top[left] + top[right] + bottom[left] + bottom[right] + 2) / 4);
+            }
+        }
+        return {.data = storage.data(), .width = width, .height = height, .row_pitch = width, .step = 1};
+    }
+
+    // =======================================================================================
+    // =                                   Implementation                                    =
+    // =======================================================================================
+
+    static std::vector<Channel> channels_of(const RawFrame &frame)
+    {
+        switch (frame.format)
+        {
+            case ImageFormat::R8G8B8A8_UNORM:
+            case ImageFormat::B8G8R8A8_UNORM:
+            {
+                // Interleaved RGB(A), alpha is ignored
+                std::vector<Channel> channels;
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    channels.push_back({frame.data[0] + i, frame.width, frame.height, frame.pitch[0], 4});
+                }
+                return channels;
+            }
+            case ImageFormat::NV12:
+                // Luma plane, then interleaved U and V at half resolution
+                return {
+                    {frame.data[0], frame.width, frame.height, frame.pitch[0], 1},
+                    {frame.data[1], frame.width / 2, frame.height / 2, frame.pitch[1], 2},
+                    {frame.data[1] + 1, frame.width / 2, frame.height / 2, frame.pitch[1], 2},
+                };
+            default: throw std::invalid_argument("Unsupported image format for quality measurements");
+        }
+    }
+
+    static std::vector<Plane> planes_of(const RawFrame &frame)
+    {
+        if (frame.format == ImageFormat::NV12)
+        {
+            return {
+                {.data = frame.data[0], .row_size = frame.width, .height = frame.height, .row_pitch = frame.pitch[0]},
+                {.data = frame.data[1], .row_size = frame.width / 2 * 2, .height = frame.height / 2, .row_pitch = frame.pitch[1]},
+            };
+        }
+        return {{.data       = frame.data[0],
+                 .row_size   = frame.width * 4,
+                 .height     = frame.height,
+                 .row_pitch  = frame.pitch[0],
+                 .skip_alpha = true}};
+    }
+
+    static double compute_psnr(const RawFrame &reference, const RawFrame &distorted, uint32_t nb_threads)
+    {
+        struct Tile
+        {
+            size_t   plane     = 0;
+            uint32_t first_row = 0;
+            uint32_t end_row   = 0;
+        };
+
+        const auto        reference_planes = planes_of(reference);
+        const auto        distorted_planes = planes_of(distorted);
+        std::vector<Tile> tiles;
+        uint64_t          nb_samples = 0;
+        for (size_t i = 0; i < reference_planes.size(); i++)
+        {
+            for (uint32_t row = 0; row < reference_planes[i].height; row += WVB_IMAGE_QUALITY_TILE_ROWS)
+            {
+                tiles.push_back({i, row, std::min(row + WVB_IMAGE_QUALITY_TILE_ROWS, reference_planes[i].height)});
+            }
+            const uint32_t samples_per_row = reference_planes[i].skip_alpha ? reference_planes[i].row_size / 4 * 3
+                                                                            : reference_planes[i].row_size;
+            nb_samples += static_cast<uint64_t>(samples_per_row) * reference_planes[i].height;
+        }
+
+        std::vector<uint64_t> errors(tiles.size(), 0);
+        parallel_for(tiles.size(),
+                     nb_threads,
+                     [&](size_t i)
+                     {
+                         const Plane &x = reference_planes[tiles[i].plane];
+                         const Plane &y = distorted_planes[tiles[i].plane];
+                         for (uint32_t row = tiles[i].first_row; row < tiles[i].end_row; row++)
+                         {
+                             const uint8_t *x_row = x.data + row * x.row_pitch;
+                             const uint8_t *y_row = y.data + row * y.row_pitch;
+                             errors[i] += squared_error(x_row, y_row, x.row_size, x.skip_alpha);
+                         }
+                     });
+
+        uint64_t error = 0;
+        for (const auto tile_error : errors)
+        {
+            error += tile_error;
+        }
+        if (error == 0)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+        const double mse = static_cast<double>(error) / static_cast<double>(nb_samples);
+        return 10 * std::log10(255.0 * 255.0 / mse);
+    }
+
+    /** Sums of the SSIM terms of each channel. */
+    static std::vector<SSIMSums> compute_ssim_sums(const std::vector<Channel> &x, const std::vector<Channel> &y, uint32_t nb_threads)
+    {
+        struct Tile
+        {
+            size_t   channel   = 0;
+            uint32_t first_row = 0;
+            uint32_t end_row   = 0;
+        };
+
+        std::vector<Tile> tiles;
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            const uint32_t nb_rows = x[i].height - WVB_SSIM_WINDOW_SIZE + 1;
+            for (uint32_t row = 0; row < nb_rows; row += WVB_IMAGE_QUALITY_TILE_ROWS)
+            {
+                tiles.push_back({i, row, std::min(row + WVB_IMAGE_QUALITY_TILE_ROWS, nb_rows)});
+            }
+        }
+
+        std::vector<SSIMSums> tile_sums(tiles.size());
+        parallel_for(tiles.size(),
+                     nb_threads,
+                     [&](size_t i)
+                     {
+                         const auto &tile = tiles[i];
+                         tile_sums[i]     = ssim_tile(x[tile.channel], y[tile.channel], tile.first_row, tile.end_row);
+                     });
+
+        // Sum in order, so that the result doesn't depend on the threads
+        std::vector<SSIMSums> sums(x.size());
+        for (size_t i = 0; i < tiles.size(); i++)
+        {
+            sums[tiles[i].channel] += tile_sums[i];
+        }
+        return sums;
+    }
+
+    ImageQualityMetrics compute_image_quality(const RawFrame &reference, const RawFrame &distorted, uint32_t nb_threads)
+    {
+        if (reference.format != distorted.format || reference.width != distorted.width || reference.height != distorted.height)
+        {
+            throw std::invalid_argument("Compared images must have the same format and size");
+        }
+        if (reference.data[0] == nullptr || distorted.data[0] == nullptr
+            || (reference.format == ImageFormat::NV12 && (reference.data[1] == nullptr || distorted.data[1] == nullptr)))
+        {
+            throw std::invalid_argument("Compared images must have data");
+        }
+
+        std::vector<Channel> x = channels_of(reference);
+        std::vector<Channel> y = channels_of(distorted);
+        uint32_t             min_size = std::numeric_limits<uint32_t>::max();
+        for (const auto &channel : x)
+        {
+            min_size = std::min({min_size, channel.width, channel.height});
+        }
+        if (min_size < WVB_SSIM_WINDOW_SIZE)
+        {
+            throw std::invalid_argument("Compared images are smaller than the SSIM window");
+        }
+        if (nb_threads == 0)
+        {
+            nb_threads = default_nb_threads();
+        }
+
+        // Channels are weighted by their number of samples
+        std::vector<double> weights;
+        double              total_weight = 0;
+        for (const auto &channel : x)
+        {
+            weights.push_back(static_cast<double>(channel.width) * channel.height);
+            total_weight += weights.back();
+        }
+
+        // Use as many scales as the smallest channel allows
+        uint32_t nb_scales = 1;
+        while (nb_scales < WVB_MS_SSIM_NB_SCALES && (min_size >> nb_scales) >= WVB_SSIM_WINDOW_SIZE)
+        {
+            nb_scales++;
+        }
+        double total_scale_weight = 0;
+        for (uint32_t i = 0; i < nb_scales; i++)
+        {
+            total_scale_weight += MS_SSIM_WEIGHTS[i];
+        }
+
+        ImageQualityMetrics metrics;
+        metrics.psnr = compute_psnr(reference, distorted, nb_threads);
+
+        std::vector<double>               ms_ssim(x.size(), 1.0);
+        std::vector<std::vector<uint8_t>> storage(2 * x.size());
+        for (uint32_t scale = 0; scale < nb_scales; scale++)
+        {
+            const auto sums = compute_ssim_sums(x, y, nb_threads);
+            for (size_t i = 0; i < x.size(); i++)
+            {
+                const double nb_windows = static_cast<double>(sums[i].nb_windows);
+                if (scale == 0)
+                {
+                    metrics.ssim += weights[i] * sums[i].ssim / nb_windows;
+                }
+
+                // The last scale contributes its SSIM, the others only their contrast-structure term
+                const double term = scale + 1 == nb_scales ? sums[i].ssim / nb_windows : sums[i].cs / nb_windows;
+                ms_ssim[i] *= std::pow(std::max(term, 0.0), MS_SSIM_WEIGHTS[scale] / total_scale_weight);
+            }
+
+            if (scale + 1 < nb_scales)
+            {
+                parallel_for(2 * x.size(),
+                             nb_threads,
+                             [&](size_t i)
+                             {
+                                 auto &channel = i < x.size() ? x[i] : y[i - x.size()];
+                                 channel       = downsample(channel, storage[i]);
+                             });
+            }
+        }
+
+        metrics.ssim /= total_weight;
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            metrics.ms_ssim += weights[i] * ms_ssim[i] / total_weight;
+        }
+        return metrics;
+    }
+} // namespace wvb
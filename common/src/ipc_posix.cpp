@@ -4,10 +4,18 @@
 
 #include "wvb_common/ipc.h"
 
+#include <cerrno>
+#include <chrono>
+#include <climits>
 #include <fcntl.h>
 #include <iostream>
+#include <linux/futex.h>
 #include <semaphore.h>
+#include <string>
+#include <sys/mman.h>
 #include <sys/shm.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 namespace wvb
 {
@@ -30,12 +38,31 @@ namespace wvb
         void       *data             = nullptr;
     };
 
+    /** State of a futex-based event, placed in a small shared memory. Zeros is a valid, non-signaled state. */
+    struct FutexEventState
+    {
+        /** 1 if signaled, 0 otherwise. Waiters sleep on this word. */
+        std::atomic<uint32_t> signaled;
+        /** Number of waiters that may be sleeping, so that signal() can skip the wake up syscall when there are none. */
+        std::atomic<uint32_t> nb_waiters;
+    };
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+                  "Futex words must be plain 32 bit integers");
+
     struct InterProcessEvent::Data
     {
-        // Implement using semaphores
+        EventResetMode reset_mode = EventResetMode::AUTO;
+        EventBackend   backend    = EventBackend::DEFAULT;
+        bool           is_sender  = false;
+
+        // Semaphore backend
         sem_t      *semaphore      = SEM_FAILED;
-        bool        is_sender      = false;
         const char *semaphore_name = nullptr;
+
+        // Futex backend
+        int32_t          shared_memory_fd   = INVALID_HANDLE_VALUE;
+        std::string      shared_memory_name = {};
+        FutexEventState *state              = nullptr;
     };
 
     // =======================================================================================
@@ -46,13 +73,101 @@ namespace wvb
 
     bool sem_timed_wait(sem_t *sem, uint32_t timeout_ms)
     {
+        // Use a monotonic clock when possible, so that wall clock adjustments don't change the timeout
+#if __GLIBC_PREREQ(2, 30)
+        const clockid_t clock = CLOCK_MONOTONIC;
+#else
+        const clockid_t clock = CLOCK_REALTIME;
+#endif
         timespec timeout {};
-        clock_gettime(CLOCK_REALTIME, &timeout);
+        clock_gettime(clock, &timeout);
         timeout.tv_sec += timeout_ms / 1000;
         timeout.tv_nsec += (timeout_ms % 1000) * 1000000;
+        if (timeout.tv_nsec >= 1000000000)
+        {
+            timeout.tv_sec++;
+            timeout.tv_nsec -= 1000000000;
+        }
 
         // Wait
-        return sem_timedwait(sem, &timeout) == 0;
+        int32_t result = 0;
+        do
+        {
+#if __GLIBC_PREREQ(2, 30)
+            result = sem_clockwait(sem, clock, &timeout);
+#else
+            result = sem_timedwait(sem, &timeout);
+#endif
+            // Try again if it is interrupted
+        } while (result != 0 && errno == EINTR);
+
+        return result == 0;
+    }
+
+    long futex_wait(std::atomic<uint32_t> *word, uint32_t expected_value, const timespec *timeout)
+    {
+        // The timeout is relative and measured against CLOCK_MONOTONIC
+        return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT, expected_value, timeout, nullptr, 0);
+    }
+
+    void futex_wake(std::atomic<uint32_t> *word, int32_t nb_waiters)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, nb_waiters, nullptr, nullptr, 0);
+    }
+
+    /** Returns true if the event is signaled. In auto reset mode, it is reset at the same time. */
+    bool futex_event_try_consume(FutexEventState *state, EventResetMode reset_mode)
+    {
+        if (reset_mode == EventResetMode::MANUAL)
+        {
+            return state->signaled.load(std::memory_order_acquire) != 0;
+        }
+
+        uint32_t expected = 1;
+        return state->signaled.compare_exchange_strong(expected, 0, std::memory_order_acq_rel);
+    }
+
+    bool futex_event_wait(FutexEventState *state, EventResetMode reset_mode, uint32_t timeout_ms)
+    {
+        if (futex_event_try_consume(state, reset_mode))
+        {
+            return true;
+        }
+        if (timeout_ms == 0)
+        {
+            return false;
+        }
+
+        // steady_clock is CLOCK_MONOTONIC, like the futex timeout
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (true)
+        {
+            timespec  remaining {};
+            timespec *timeout = nullptr;
+            if (timeout_ms != NO_TIMEOUT)
+            {
+                const auto remaining_ns =
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now()).count();
+                if (remaining_ns <= 0)
+                {
+                    return futex_event_try_consume(state, reset_mode);
+                }
+                remaining.tv_sec  = static_cast<time_t>(remaining_ns / 1000000000);
+                remaining.tv_nsec = static_cast<long>(remaining_ns % 1000000000);
+                timeout           = &remaining;
+            }
+
+            // The kernel only puts the thread to sleep if the event is still not signaled, so a signal can't be missed
+            state->nb_waiters.fetch_add(1, std::memory_order_seq_cst);
+            futex_wait(&state->signaled, 0, timeout);
+            state->nb_waiters.fetch_sub(1, std::memory_order_seq_cst);
+
+            // Woken up, interrupted or timed out: check again. Another waiter may have consumed the signal first.
+            if (futex_event_try_consume(state, reset_mode))
+            {
+                return true;
+            }
+        }
     }
 
     _impl::SharedMemoryImpl::SharedMemoryImpl(size_t size, const char *mutex_name, const char *memory_name) : m_data(new Data)
@@ -185,11 +300,54 @@ namespace wvb
         sem_post(m_data->semaphore);
     }
 
+    void *_impl::SharedMemoryImpl::unsafe_data() const
+    {
+        if (m_data == nullptr)
+        {
+            return nullptr;
+        }
+
+        return m_data->data;
+    }
+
     // Inter Process Event
 
-    InterProcessEvent::InterProcessEvent(const char *name, bool is_sender) : m_data(new Data)
+    InterProcessEvent::InterProcessEvent(const char *name, bool is_sender, EventResetMode reset_mode, EventBackend backend)
+        : m_data(new Data)
     {
-        m_data->is_sender      = is_sender;
+        m_data->is_sender  = is_sender;
+        m_data->reset_mode = reset_mode;
+        m_data->backend    = backend;
+
+        if (backend == EventBackend::DEFAULT)
+        {
+            // Futex word in a small shared memory. POSIX shared memory names must start with a slash.
+            m_data->shared_memory_name = name[0] == '/' ? name : std::string("/") + name;
+            m_data->shared_memory_fd   = shm_open(m_data->shared_memory_name.c_str(), O_CREAT | O_RDWR, 0666);
+            if (m_data->shared_memory_fd == INVALID_HANDLE_VALUE
+                || ftruncate(m_data->shared_memory_fd, sizeof(FutexEventState)) != 0)
+            {
+                this->~InterProcessEvent();
+                return;
+            }
+
+            // New memory is filled with zeros, which is a non-signaled state
+            void *data = mmap(nullptr, sizeof(FutexEventState), PROT_READ | PROT_WRITE, MAP_SHARED, m_data->shared_memory_fd, 0);
+            if (data == MAP_FAILED)
+            {
+                this->~InterProcessEvent();
+                return;
+            }
+            m_data->state = static_cast<FutexEventState *>(data);
+
+            // Like with semaphores, the sender makes sure that the event starts in a non-signaled state
+            if (is_sender)
+            {
+                m_data->state->signaled.store(0, std::memory_order_release);
+            }
+            return;
+        }
+
         m_data->semaphore_name = name;
 
         // Create semaphore
@@ -229,6 +387,23 @@ namespace wvb
     {
         if (m_data != nullptr)
         {
+            if (m_data->state != nullptr)
+            {
+                munmap(m_data->state, sizeof(FutexEventState));
+                m_data->state = nullptr;
+            }
+
+            if (m_data->shared_memory_fd != INVALID_HANDLE_VALUE)
+            {
+                close(m_data->shared_memory_fd);
+                // Since events are unidirectional, only the sender should delete the shared memory
+                if (m_data->is_sender)
+                {
+                    shm_unlink(m_data->shared_memory_name.c_str());
+                }
+                m_data->shared_memory_fd = INVALID_HANDLE_VALUE;
+            }
+
             if (m_data->semaphore != SEM_FAILED)
             {
                 sem_close(m_data->semaphore);
@@ -252,6 +427,13 @@ namespace wvb
             return false;
         }
 
+        if (m_data->backend == EventBackend::DEFAULT)
+        {
+            return futex_event_wait(m_data->state, m_data->reset_mode, timeout_ms);
+        }
+
+        bool received = false;
+
         // Unlimited wait
         if (timeout_ms == NO_TIMEOUT)
         {
@@ -261,15 +443,22 @@ namespace wvb
                 result = sem_wait(m_data->semaphore);
 
                 // Try again if it is interrupted
-            } while (result == EINTR);
+            } while (result != 0 && errno == EINTR);
 
-            return result == 0;
+            received = result == 0;
         }
         // Timed wait
         else
         {
-            return sem_timed_wait(m_data->semaphore, timeout_ms);
+            received = sem_timed_wait(m_data->semaphore, timeout_ms);
+        }
+
+        // Waiting always consumes the semaphore, give it back to stay signaled
+        if (received && m_data->reset_mode == EventResetMode::MANUAL)
+        {
+            sem_post(m_data->semaphore);
         }
+        return received;
     }
 
     void InterProcessEvent::signal() const
@@ -279,6 +468,17 @@ namespace wvb
             return;
         }
 
+        if (m_data->backend == EventBackend::DEFAULT)
+        {
+            // Only wake up the waiters on the transition to signaled, and only if there are some
+            const uint32_t previous = m_data->state->signaled.exchange(1, std::memory_order_seq_cst);
+            if (previous == 0 && m_data->state->nb_waiters.load(std::memory_order_seq_cst) > 0)
+            {
+                futex_wake(&m_data->state->signaled, m_data->reset_mode == EventResetMode::AUTO ? 1 : INT_MAX);
+            }
+            return;
+        }
+
         sem_post(m_data->semaphore);
     }
 
@@ -289,6 +489,11 @@ namespace wvb
             return false;
         }
 
+        if (m_data->backend == EventBackend::DEFAULT)
+        {
+            return m_data->state->signaled.load(std::memory_order_acquire) != 0;
+        }
+
         int32_t value = 0;
         sem_getvalue(m_data->semaphore, &value);
         return value > 0;
@@ -296,6 +501,17 @@ namespace wvb
 
     void InterProcessEvent::reset() const
     {
+        if (m_data == nullptr)
+        {
+            return;
+        }
+
+        if (m_data->backend == EventBackend::DEFAULT)
+        {
+            m_data->state->signaled.store(0, std::memory_order_release);
+            return;
+        }
+
         if (is_signaled())
         {
             sem_wait(m_data->semaphore);
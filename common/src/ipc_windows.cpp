@@ -21,8 +21,9 @@ namespace wvb
 
     struct InterProcessEvent::Data
     {
-        HANDLE event     = nullptr;
-        bool   is_sender = false;
+        HANDLE         event      = nullptr;
+        bool           is_sender  = false;
+        EventResetMode reset_mode = EventResetMode::AUTO;
     };
 
     // =======================================================================================
@@ -105,13 +106,25 @@ namespace wvb
         ReleaseMutex(m_data->mutex);
     }
 
+    void *_impl::SharedMemoryImpl::unsafe_data() const
+    {
+        if (!is_valid())
+        {
+            return nullptr;
+        }
+
+        return m_data->data;
+    }
+
     // Inter Process Event
 
-    InterProcessEvent::InterProcessEvent(const char *event_name, bool is_sender) : m_data(new Data)
+    InterProcessEvent::InterProcessEvent(const char *event_name, bool is_sender, EventResetMode reset_mode, EventBackend /*backend*/)
+        : m_data(new Data)
     {
-        m_data->is_sender = is_sender;
+        m_data->is_sender  = is_sender;
+        m_data->reset_mode = reset_mode;
 
-        // Create the event
+        // Create the event. It is always a manual reset event, otherwise is_signaled() would consume the signal.
         m_data->event = CreateEventA(nullptr, TRUE, FALSE, event_name);
 
         // If it failed, clean up and return
@@ -149,8 +162,8 @@ namespace wvb
         // Return true if the event was triggered
         auto triggered = res == WAIT_OBJECT_0;
 
-        // If we are the sender, reset the event
-        if (triggered)
+        // In auto reset mode, consume the signal
+        if (triggered && m_data->reset_mode == EventResetMode::AUTO)
         {
             ResetEvent(m_data->event);
         }
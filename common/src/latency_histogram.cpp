@@ -0,0 +1,217 @@
+#include "wvb_common/latency_histogram.h"
+
+#include <cmath>
+#include <cstddef>
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                  LatencyHistogram                                   =
+    // =======================================================================================
+
+    void LatencyHistogram::merge(const LatencyHistogram &other)
+    {
+        if (other.empty())
+        {
+            return;
+        }
+
+        for (size_t i = 0; i < m_counts.size(); i++)
+        {
+            m_counts[i] += other.m_counts[i];
+        }
+        m_count += other.m_count;
+        m_nb_out_of_range += other.m_nb_out_of_range;
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+        m_sum += other.m_sum;
+    }
+
+    void LatencyHistogram::reset()
+    {
+        std::fill(m_counts.begin(), m_counts.end(), 0);
+        m_count           = 0;
+        m_nb_out_of_range = 0;
+        m_min             = MAX_VALUE;
+        m_max             = 0;
+        m_sum             = 0;
+    }
+
+    int64_t LatencyHistogram::value_at_quantile(double quantile) const
+    {
+        if (empty())
+        {
+            return 0;
+        }
+
+        // Rank of the value, starting at 1
+        const auto rank = std::max(static_cast<uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(m_count))),
+                                   static_cast<uint64_t>(1));
+        uint64_t   nb_below = 0;
+        for (size_t i = 0; i < m_counts.size(); i++)
+        {
+            nb_below += m_counts[i];
+            if (nb_below >= rank)
+            {
+                return std::min(bucket_highest_value(i), m_max);
+            }
+        }
+        return m_max;
+    }
+
+    // =======================================================================================
+    // =                                   QuantileSketch                                    =
+    // =======================================================================================
+
+    /** Bucket key k holds the values in ]gamma^(k-1), gamma^k]. */
+    static const double GAMMA     = (1 + WVB_QUANTILE_SKETCH_RELATIVE_ACCURACY) / (1 - WVB_QUANTILE_SKETCH_RELATIVE_ACCURACY);
+    static const double LOG_GAMMA = std::log(GAMMA);
+
+    static inline int32_t key_of(double value) { return static_cast<int32_t>(std::ceil(std::log(value) / LOG_GAMMA)); }
+
+    /** Value of a bucket that is within the relative accuracy of all of its values. */
+    static inline double value_of(int32_t key) { return 2 * std::pow(GAMMA, key) / (GAMMA + 1); }
+
+    void QuantileSketch::add_to_bucket(int32_t key, uint64_t count)
+    {
+        if (m_counts.empty())
+        {
+            m_min_key = key;
+            m_counts.assign(1, 0);
+        }
+        else if (key < m_min_key)
+        {
+            m_counts.insert(m_counts.begin(), m_min_key - key, 0);
+            m_min_key = key;
+        }
+        else if (key - m_min_key >= static_cast<int32_t>(m_counts.size()))
+        {
+            m_counts.resize(key - m_min_key + 1, 0);
+        }
+        m_counts[key - m_min_key] += count;
+
+        if (m_counts.size() > WVB_QUANTILE_SKETCH_MAX_BUCKETS)
+        {
+            // Merge the lowest buckets into the lowest one that is kept
+            const size_t nb_merged = m_counts.size() - WVB_QUANTILE_SKETCH_MAX_BUCKETS;
+            uint64_t     merged    = 0;
+            for (size_t i = 0; i <= nb_merged; i++)
+            {
+                merged += m_counts[i];
+            }
+            m_counts.erase(m_counts.begin(), m_counts.begin() + static_cast<std::ptrdiff_t>(nb_merged));
+            m_counts[0] = merged;
+            m_min_key += static_cast<int32_t>(nb_merged);
+        }
+    }
+
+    void QuantileSketch::add(double value, uint64_t count)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        if (value < 1)
+        {
+            m_zero_count += count;
+        }
+        else
+        {
+            add_to_bucket(key_of(value), count);
+        }
+
+        m_min = empty() ? value : std::min(m_min, value);
+        m_max = empty() ? value : std::max(m_max, value);
+        m_count += count;
+        m_sum += value * static_cast<double>(count);
+    }
+
+    void QuantileSketch::add(const LatencyHistogram &histogram)
+    {
+        if (histogram.empty())
+        {
+            return;
+        }
+
+        histogram.for_each_bucket(
+            [this](int64_t lowest_value, int64_t highest_value, uint64_t count)
+            {
+                const double value = static_cast<double>(lowest_value + highest_value) / 2;
+                if (value < 1)
+                {
+                    m_zero_count += count;
+                }
+                else
+                {
+                    add_to_bucket(key_of(value), count);
+                }
+            });
+
+        const auto min = static_cast<double>(histogram.min());
+        const auto max = static_cast<double>(histogram.max());
+        m_min          = empty() ? min : std::min(m_min, min);
+        m_max          = empty() ? max : std::max(m_max, max);
+        m_count += histogram.count();
+        m_sum += histogram.mean() * static_cast<double>(histogram.count());
+    }
+
+    void QuantileSketch::merge(const QuantileSketch &other)
+    {
+        if (other.empty())
+        {
+            return;
+        }
+
+        for (size_t i = 0; i < other.m_counts.size(); i++)
+        {
+            if (other.m_counts[i] != 0)
+            {
+                add_to_bucket(other.m_min_key + static_cast<int32_t>(i), other.m_counts[i]);
+            }
+        }
+        m_zero_count += other.m_zero_count;
+
+        m_min = empty() ? other.m_min : std::min(m_min, other.m_min);
+        m_max = empty() ? other.m_max : std::max(m_max, other.m_max);
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+    }
+
+    void QuantileSketch::reset()
+    {
+        m_counts.clear();
+        m_min_key    = 0;
+        m_zero_count = 0;
+        m_count      = 0;
+        m_min        = 0;
+        m_max        = 0;
+        m_sum        = 0;
+    }
+
+    double QuantileSketch::value_at_quantile(double quantile) const
+    {
+        if (empty())
+        {
+            return 0;
+        }
+
+        // Rank of the value, starting at 1
+        const auto rank = std::max(static_cast<uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(m_count))),
+                                   static_cast<uint64_t>(1));
+        uint64_t   nb_below = m_zero_count;
+        if (nb_below >= rank)
+        {
+            return std::clamp(0.0, m_min, m_max);
+        }
+        for (size_t i = 0; i < m_counts.size(); i++)
+        {
+            nb_below += m_counts[i];
+            if (nb_below >= rank)
+            {
+                return std::clamp(value_of(m_min_key + static_cast<int32_t>(i)), m_min, m_max);
+            }
+        }
+        return m_max;
+    }
+} // namespace wvb
@@ -0,0 +1,633 @@
+#include "wvb_common/measurement_analysis.h"
+
+#include <wvb_common/macros.h>
+#include <wvb_common/parallel_for.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#define CSV_TABLE_DIVIDER "---"
+#define NS_PER_S          1e9
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                       Loading                                       =
+    // =======================================================================================
+
+    template<typename T>
+    static std::vector<uint8_t> to_bytes(const std::vector<T> &values)
+    {
+        std::vector<uint8_t> bytes(values.size() * sizeof(T));
+        std::memcpy(bytes.data(), values.data(), bytes.size());
+        return bytes;
+    }
+
+    static bool parse_integer(const std::string &value, int64_t &out)
+    {
+        const auto result = std::from_chars(value.data(), value.data() + value.size(), out);
+        return result.ec == std::errc() && result.ptr == value.data() + value.size();
+    }
+
+    static bool parse_number(const std::string &value, double &out)
+    {
+        if (value.empty())
+        {
+            return false;
+        }
+        char *end = nullptr;
+        out       = std::strtod(value.c_str(), &end);
+        return end == value.c_str() + value.size();
+    }
+
+    /** Stores the values of a CSV column with the narrowest type that holds them all. */
+    static ColumnarColumn make_column(std::string name, const std::vector<std::string> &values)
+    {
+        std::vector<int64_t> integers(values.size());
+        std::vector<float>   numbers(values.size());
+        bool                 all_integers = true;
+        bool                 all_numbers  = true;
+        for (size_t i = 0; i < values.size() && all_numbers; i++)
+        {
+            double number = 0;
+            all_integers  = all_integers && parse_integer(values[i], integers[i]);
+            all_numbers   = parse_number(values[i], number);
+            numbers[i]    = static_cast<float>(number);
+        }
+
+        ColumnarColumn column {.name = std::move(name)};
+        if (all_integers)
+        {
+            column.type = ColumnType::INT64;
+            column.data = to_bytes(integers);
+        }
+        else if (all_numbers)
+        {
+            column.type = ColumnType::FLOAT32;
+            column.data = to_bytes(numbers);
+        }
+        else
+        {
+            column.type = ColumnType::STRING;
+            for (const auto &value : values)
+            {
+                const auto     size       = static_cast<uint32_t>(value.size());
+                const uint8_t *size_bytes = reinterpret_cast<const uint8_t *>(&size);
+                column.data.insert(column.data.end(), size_bytes, size_bytes + sizeof(size));
+                column.data.insert(column.data.end(), value.begin(), value.end());
+            }
+        }
+        return column;
+    }
+
+    static std::vector<std::string> split(const std::string &line)
+    {
+        std::vector<std::string> values;
+        size_t                   start = 0;
+        while (true)
+        {
+            const size_t end = line.find(',', start);
+            values.push_back(line.substr(start, end - start));
+            if (end == std::string::npos)
+            {
+                return values;
+            }
+            start = end + 1;
+        }
+    }
+
+    /** Reads the format written by the export_csv() functions: the name of each table, its header and its rows, then a divider. */
+    static std::vector<ColumnarTable> read_csv_measurement_file(std::ifstream &file, const std::string &path)
+    {
+        std::vector<ColumnarTable>            tables;
+        std::vector<std::string>              column_names;
+        std::vector<std::vector<std::string>> values;
+
+        const auto finish_table = [&]
+        {
+            for (size_t i = 0; i < column_names.size(); i++)
+            {
+                tables.back().columns.push_back(make_column(std::move(column_names[i]), values[i]));
+            }
+            column_names.clear();
+            values.clear();
+        };
+
+        enum class State
+        {
+            EXPECTING_TABLE_NAME,
+            EXPECTING_COLUMN_NAMES,
+            EXPECTING_VALUES,
+        };
+
+        State       state = State::EXPECTING_TABLE_NAME;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            // Trim the line, which can end with "\r" on Windows
+            line.erase(line.find_last_not_of(" \r\t") + 1);
+            line.erase(0, line.find_first_not_of(" \t"));
+            if (line.empty())
+            {
+                continue;
+            }
+
+            switch (state)
+            {
+                case State::EXPECTING_TABLE_NAME:
+                    if (line != CSV_TABLE_DIVIDER)
+                    {
+                        tables.push_back({.name = line});
+                        state = State::EXPECTING_COLUMN_NAMES;
+                    }
+                    break;
+                case State::EXPECTING_COLUMN_NAMES:
+                    column_names = split(line);
+                    values.resize(column_names.size());
+                    state = State::EXPECTING_VALUES;
+                    break;
+                case State::EXPECTING_VALUES:
+                {
+                    if (line == CSV_TABLE_DIVIDER)
+                    {
+                        finish_table();
+                        state = State::EXPECTING_TABLE_NAME;
+                        break;
+                    }
+
+                    // Only keep the values that have a column
+                    auto row = split(line);
+                    if (row.size() < column_names.size())
+                    {
+                        throw std::runtime_error("read_measurement_file: missing values in table " + tables.back().name + " of "
+                                                 + path);
+                    }
+                    for (size_t i = 0; i < column_names.size(); i++)
+                    {
+                        values[i].push_back(std::move(row[i]));
+                    }
+                    tables.back().nb_rows++;
+                    break;
+                }
+            }
+        }
+
+        if (state == State::EXPECTING_COLUMN_NAMES)
+        {
+            throw std::runtime_error("read_measurement_file: missing header of table " + tables.back().name + " in " + path);
+        }
+        if (state == State::EXPECTING_VALUES)
+        {
+            finish_table();
+        }
+        return tables;
+    }
+
+    std::vector<ColumnarTable> read_measurement_file(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("read_measurement_file: failed to open " + path);
+        }
+
+        char magic[4] = {};
+        file.read(magic, sizeof(magic));
+        if (file && std::memcmp(magic, WVB_COLUMNAR_FILE_MAGIC, sizeof(magic)) == 0)
+        {
+            return read_columnar_file(path);
+        }
+        file.clear();
+        file.seekg(0, std::ios::beg);
+        return read_csv_measurement_file(file, path);
+    }
+
+    static const ColumnarTable &table_of(const std::vector<ColumnarTable> &tables, const std::string &name, const std::string &path)
+    {
+        for (const auto &table : tables)
+        {
+            if (table.name == name)
+            {
+                return table;
+            }
+        }
+        throw std::runtime_error("Missing table " + name + " in " + path);
+    }
+
+    static std::vector<int64_t> column_of(const ColumnarTable &table, const std::string &name)
+    {
+        const auto *column = table.column(name);
+        if (column == nullptr)
+        {
+            throw std::runtime_error("Missing column " + name + " in table " + table.name);
+        }
+        return column->int64_values();
+    }
+
+    /** Reads a column into a field of each row. */
+    template<typename Row, typename T>
+    static void read_column(const ColumnarTable &table, const std::string &name, std::vector<Row> &rows, T Row::*field)
+    {
+        const auto values = column_of(table, name);
+        rows.resize(values.size());
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            rows[i].*field = static_cast<T>(values[i]);
+        }
+    }
+
+    // =======================================================================================
+    // =                                        Joins                                        =
+    // =======================================================================================
+
+    /** Returns the indices of the values, sorted by value. */
+    static std::vector<size_t> sorted_indices(const std::vector<int64_t> &values)
+    {
+        std::vector<size_t> indices(values.size());
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            indices[i] = i;
+        }
+        std::stable_sort(indices.begin(), indices.end(), [&values](size_t a, size_t b) { return values[a] < values[b]; });
+        return indices;
+    }
+
+    /**
+     * Finds the minimum time between the sampling of a pose by the client and its reception by the server, over the frames of a run.
+     *
+     * Like in wvb_combine_all_times(), the pose of a frame is matched on its timestamp to the tracking times of the server and of the
+     * driver, and to the last access of the driver to the pose before the frame was presented. The tracking tables are sorted on the
+     * pose timestamp once, then searched for each frame.
+     */
+    static void find_clock_error(RunFrameTimes                              &run,
+                                 const std::vector<int64_t>                 &client_pose_timestamps,
+                                 const std::vector<ColumnarTable>           &tables,
+                                 const std::string                          &path,
+                                 const std::unordered_map<uint32_t, size_t> &frames)
+    {
+        const auto &server_tracking          = table_of(tables, "server_tracking_measurements", path);
+        const auto  server_pose_timestamps   = column_of(server_tracking, "pose_timestamp");
+        const auto  server_tracking_received = column_of(server_tracking, "tracking_received");
+        const auto  server_order             = sorted_indices(server_pose_timestamps);
+
+        auto driver_pose_timestamps = column_of(table_of(tables, "driver_tracking_measurements", path), "pose_timestamp");
+        std::sort(driver_pose_timestamps.begin(), driver_pose_timestamps.end());
+
+        // Accesses sorted by pose, then by time, so that the last access before a time is found with a single search
+        const auto &access_table           = table_of(tables, "driver_pose_access_measurements", path);
+        const auto  access_pose_timestamps = column_of(access_table, "pose_timestamp");
+        const auto  access_times           = column_of(access_table, "pose_accessed");
+
+        std::vector<std::pair<int64_t, int64_t>> accesses;
+        for (size_t i = 0; i < access_pose_timestamps.size(); i++)
+        {
+            accesses.emplace_back(access_pose_timestamps[i], access_times[i]);
+        }
+        std::sort(accesses.begin(), accesses.end());
+
+        uint32_t best_frame_id = 0;
+        for (size_t i = 0; i < run.client_frames.size(); i++)
+        {
+            const auto &client_frame = run.client_frames[i];
+            const auto  frame        = frames.find(client_frame.frame_id);
+            if (client_frame.tracking_ns == 0 || frame == frames.end())
+            {
+                continue;
+            }
+            const int64_t pose_timestamp = client_pose_timestamps[i];
+            const int64_t present_called = run.driver_frames[frame->second].present_called_ns;
+
+            const auto access = std::lower_bound(accesses.begin(), accesses.end(), std::make_pair(pose_timestamp, present_called));
+            if (access == accesses.begin() || std::prev(access)->first != pose_timestamp
+                || !std::binary_search(driver_pose_timestamps.begin(), driver_pose_timestamps.end(), pose_timestamp))
+            {
+                continue;
+            }
+            const auto server = std::lower_bound(server_order.begin(),
+                                                 server_order.end(),
+                                                 pose_timestamp,
+                                                 [&](size_t index, int64_t value) { return server_pose_timestamps[index] < value; });
+            if (server == server_order.end() || server_pose_timestamps[*server] != pose_timestamp)
+            {
+                continue;
+            }
+
+            // Keep the first frame with the minimum error
+            const int64_t error = server_tracking_received[*server] - client_frame.tracking_ns;
+            if (!run.has_clock_error || error < run.clock_error_ns
+                || (error == run.clock_error_ns && client_frame.frame_id < best_frame_id))
+            {
+                run.has_clock_error     = true;
+                run.clock_error_ns      = error;
+                run.clock_error_time_ns = present_called;
+                best_frame_id           = client_frame.frame_id;
+            }
+        }
+    }
+
+    RunFrameTimes RunFrameTimes::load(const std::string &path, uint32_t pass_id, uint32_t run_id)
+    {
+        using D = DriverFrameTimeMeasurements;
+        using S = ServerFrameTimeMeasurements;
+        using C = ClientFrameTimeMeasurements;
+
+        const auto tables = read_measurement_file(path);
+
+        const auto                              &driver_table = table_of(tables, "driver_frame_time_measurements", path);
+        std::vector<DriverFrameTimeMeasurements> driver_frames;
+        read_column(driver_table, "frame_id", driver_frames, &D::frame_id);
+        read_column(driver_table, "present_called", driver_frames, &D::present_called_ns);
+        read_column(driver_table, "vsync", driver_frames, &D::vsync_ns);
+        read_column(driver_table, "frame_sent", driver_frames, &D::frame_sent_ns);
+        read_column(driver_table, "wait_for_present_called", driver_frames, &D::wait_for_present_called_ns);
+        read_column(driver_table, "server_finished", driver_frames, &D::server_finished_ns);
+        read_column(driver_table, "pose_updated_event", driver_frames, &D::pose_updated_event_ns);
+        read_column(driver_table, "present_deadline_error", driver_frames, &D::present_deadline_error_us);
+
+        const auto                              &server_table = table_of(tables, "server_frame_time_measurements", path);
+        std::vector<ServerFrameTimeMeasurements> server_frames;
+        read_column(server_table, "frame_id", server_frames, &S::frame_id);
+        read_column(server_table, "dropped", server_frames, &S::dropped);
+        read_column(server_table, "frame_event_received", server_frames, &S::frame_event_received_ns);
+        read_column(server_table, "present_info_received", server_frames, &S::present_info_received_ns);
+        read_column(server_table, "shared_texture_opened", server_frames, &S::shared_texture_opened_ns);
+        read_column(server_table, "shared_texture_acquired", server_frames, &S::shared_texture_acquired_ns);
+        read_column(server_table, "staging_texture_mapped", server_frames, &S::staging_texture_mapped_ns);
+        read_column(server_table, "encoder_frame_pushed", server_frames, &S::frame_pushed_ns);
+        read_column(server_table, "encoder_frame_pulled", server_frames, &S::frame_pulled_ns);
+        read_column(server_table, "before_last_get_next_packet", server_frames, &S::before_last_get_next_packet_ns);
+        read_column(server_table, "after_last_get_next_packet", server_frames, &S::after_last_get_next_packet_ns);
+        read_column(server_table, "before_last_send_packet", server_frames, &S::before_last_send_packet_ns);
+        read_column(server_table, "after_last_send_packet", server_frames, &S::after_last_send_packet_ns);
+        read_column(server_table, "finished_signal_sent", server_frames, &S::finished_signal_sent_ns);
+
+        RunFrameTimes run {.pass_id = pass_id, .run_id = run_id};
+        const auto   &client_table = table_of(tables, "client_frame_time_measurements", path);
+        read_column(client_table, "frame_index", run.client_frames, &C::frame_index);
+        read_column(client_table, "frame_id", run.client_frames, &C::frame_id);
+        read_column(client_table, "frame_delay", run.client_frames, &C::frame_delay);
+        read_column(client_table, "tracking_sampled", run.client_frames, &C::tracking_ns);
+        read_column(client_table, "last_packet_received", run.client_frames, &C::last_packet_received_ns);
+        read_column(client_table, "pushed_to_decoder", run.client_frames, &C::pushed_to_decoder_ns);
+        read_column(client_table, "begin_wait_frame", run.client_frames, &C::begin_wait_frame_ns);
+        read_column(client_table, "begin_frame", run.client_frames, &C::begin_frame_ns);
+        read_column(client_table, "after_wait_swapchain", run.client_frames, &C::after_wait_swapchain_ns);
+        read_column(client_table, "after_render", run.client_frames, &C::after_render_ns);
+        read_column(client_table, "end_frame", run.client_frames, &C::end_frame_ns);
+        read_column(client_table, "predicted_present_time", run.client_frames, &C::predicted_present_ns);
+        // Exported on the nanosecond timeline, which doesn't fit the RTP timestamp of the struct
+        const auto client_pose_timestamps = column_of(client_table, "pose_timestamp");
+
+        // Frames measured by both the driver and the server, with the first measurement of each frame id
+        std::unordered_map<uint32_t, size_t> driver_index;
+        driver_index.reserve(driver_frames.size());
+        for (size_t i = 0; i < driver_frames.size(); i++)
+        {
+            driver_index.emplace(driver_frames[i].frame_id, i);
+        }
+        std::unordered_map<uint32_t, size_t> frames;
+        frames.reserve(server_frames.size());
+        for (const auto &server_frame : server_frames)
+        {
+            const auto driver_frame = driver_index.find(server_frame.frame_id);
+            if (driver_frame != driver_index.end() && frames.emplace(server_frame.frame_id, run.server_frames.size()).second)
+            {
+                run.driver_frames.push_back(driver_frames[driver_frame->second]);
+                run.server_frames.push_back(server_frame);
+            }
+        }
+
+        find_clock_error(run, client_pose_timestamps, tables, path, frames);
+        return run;
+    }
+
+    // =======================================================================================
+    // =                                      Analysis                                       =
+    // =======================================================================================
+
+    ClientClockErrorFit ClientClockErrorFit::fit(const std::vector<RunFrameTimes> &runs)
+    {
+        // Samples are the offsets to remove from the client times, with the first sample of each time
+        std::vector<std::pair<double, double>> samples;
+        std::set<int64_t>                      times;
+        for (const auto &run : runs)
+        {
+            if (run.has_clock_error && times.insert(run.clock_error_time_ns).second)
+            {
+                samples.emplace_back(static_cast<double>(run.clock_error_time_ns), -static_cast<double>(run.clock_error_ns));
+            }
+        }
+
+        ClientClockErrorFit fit {.nb_samples = static_cast<uint32_t>(samples.size())};
+        if (samples.empty())
+        {
+            return fit;
+        }
+
+        // Least squares, centered on the mean time to keep the precision of the nanosecond times
+        double mean_time   = 0;
+        double mean_offset = 0;
+        for (const auto &[time, offset] : samples)
+        {
+            mean_time += time / static_cast<double>(samples.size());
+            mean_offset += offset / static_cast<double>(samples.size());
+        }
+        double covariance = 0;
+        double variance   = 0;
+        for (const auto &[time, offset] : samples)
+        {
+            covariance += (time - mean_time) * (offset - mean_offset);
+            variance += (time - mean_time) * (time - mean_time);
+        }
+        fit.slope        = variance > 0 ? covariance / variance : 0;
+        fit.intercept_ns = mean_offset - fit.slope * mean_time;
+        return fit;
+    }
+
+    void ClientClockErrorFit::correct(std::vector<ClientFrameTimeMeasurements> &client_frames) const
+    {
+        if (nb_samples == 0)
+        {
+            return;
+        }
+
+        using C = ClientFrameTimeMeasurements;
+        static constexpr int64_t C::*times[] = {
+            &C::tracking_ns,
+            &C::last_packet_received_ns,
+            &C::pushed_to_decoder_ns,
+            &C::begin_wait_frame_ns,
+            &C::begin_frame_ns,
+            &C::after_wait_swapchain_ns,
+            &C::after_render_ns,
+            &C::end_frame_ns,
+            &C::predicted_present_ns,
+        };
+
+        for (auto &client_frame : client_frames)
+        {
+            // The error is evaluated at the sampling time of the frame, for all its times
+            const int64_t error = std::llround(slope * static_cast<double>(client_frame.tracking_ns) + intercept_ns);
+            for (const auto time : times)
+            {
+                if (client_frame.*time != 0)
+                {
+                    client_frame.*time -= error;
+                }
+            }
+        }
+    }
+
+    void ClientClockErrorFit::export_csv(std::ofstream &file, const ClientClockErrorFit &fit)
+    {
+        if (!file.is_open())
+        {
+            LOGE("File not open\n");
+            return;
+        }
+
+        file << "slope,intercept,nb_samples\n";
+        file << fit.slope << ',' << std::llround(fit.intercept_ns) << ',' << fit.nb_samples << '\n';
+    }
+
+    void ClientClockErrorFit::export_columns(ColumnarFileWriter &file, const std::string &table_name, const ClientClockErrorFit &fit)
+    {
+        file.begin_table(table_name, 3, 1);
+        file.write_column("slope", std::vector<float> {static_cast<float>(fit.slope)});
+        file.write_column("intercept", std::vector<int64_t> {std::llround(fit.intercept_ns)});
+        file.write_column("nb_samples", std::vector<uint32_t> {fit.nb_samples});
+    }
+
+    void PassAnalysis::export_csv(std::ofstream &file, const PassAnalysis &analysis)
+    {
+        if (!file.is_open())
+        {
+            LOGE("File not open\n");
+            return;
+        }
+
+        file << "nb_runs,nb_frames,driver_fps,client_fps\n";
+        file << analysis.nb_runs << ',' << analysis.nb_frames << ',' << analysis.driver_fps << ',' << analysis.client_fps << '\n';
+    }
+
+    void PassAnalysis::export_columns(ColumnarFileWriter &file, const std::string &table_name, const PassAnalysis &analysis)
+    {
+        file.begin_table(table_name, 4, 1);
+        file.write_column("nb_runs", std::vector<uint32_t> {analysis.nb_runs});
+        file.write_column("nb_frames", std::vector<int64_t> {static_cast<int64_t>(analysis.nb_frames)});
+        file.write_column("driver_fps", std::vector<float> {static_cast<float>(analysis.driver_fps)});
+        file.write_column("client_fps", std::vector<float> {static_cast<float>(analysis.client_fps)});
+    }
+
+    /** Average rate of the events, from the span of their times. Events that weren't measured are ignored. */
+    template<typename Row>
+    static double frame_rate(const std::vector<Row> &frames, int64_t Row::*time)
+    {
+        int64_t  first    = 0;
+        int64_t  last     = 0;
+        uint64_t nb_times = 0;
+        for (const auto &frame : frames)
+        {
+            const int64_t value = frame.*time;
+            if (value != 0)
+            {
+                first = nb_times == 0 ? value : std::min(first, value);
+                last  = nb_times == 0 ? value : std::max(last, value);
+                nb_times++;
+            }
+        }
+        return nb_times < 2 || last == first ? 0 : static_cast<double>(nb_times - 1) * NS_PER_S / static_cast<double>(last - first);
+    }
+
+    MeasurementAnalysis analyze_measurements(const std::string &directory, bool correct_client_clock, uint32_t nb_threads)
+    {
+        if (nb_threads == 0)
+        {
+            nb_threads = default_nb_threads();
+        }
+
+        // Measurement files, by pass and run
+        std::map<std::pair<uint32_t, uint32_t>, std::string> files;
+        for (const auto &entry : std::filesystem::directory_iterator(directory))
+        {
+            const std::string name = entry.path().filename().string();
+            uint32_t          pass = 0;
+            uint32_t          run  = 0;
+            if (!entry.is_regular_file() || name.rfind(WVB_MEASUREMENT_FILE_PREFIX, 0) != 0
+                || std::sscanf(name.c_str() + std::strlen(WVB_MEASUREMENT_FILE_PREFIX), "%u_run_%u", &pass, &run) != 2)
+            {
+                continue;
+            }
+
+            const std::string stem = WVB_MEASUREMENT_FILE_PREFIX + std::to_string(pass) + "_run_" + std::to_string(run);
+            if (name == stem + ".wvbm" || (name == stem + ".csv" && !files.contains({pass, run})))
+            {
+                files[{pass, run}] = entry.path().string();
+            }
+        }
+
+        std::vector<RunFrameTimes> runs(files.size());
+        std::vector<const std::pair<const std::pair<uint32_t, uint32_t>, std::string> *> run_files;
+        for (const auto &file : files)
+        {
+            run_files.push_back(&file);
+        }
+        parallel_for(runs.size(),
+                     nb_threads,
+                     [&](size_t i)
+                     {
+                         const auto &[ids, path] = *run_files[i];
+                         runs[i]                 = RunFrameTimes::load(path, ids.first, ids.second);
+                     });
+
+        MeasurementAnalysis analysis;
+        analysis.client_clock_error = ClientClockErrorFit::fit(runs);
+
+        // Summarize each run, then reduce them in order
+        std::vector<StageLatencyHistograms>   latencies(runs.size());
+        std::vector<std::pair<double, double>> frame_rates(runs.size());
+        parallel_for(runs.size(),
+                     nb_threads,
+                     [&](size_t i)
+                     {
+                         auto &run = runs[i];
+                         if (correct_client_clock)
+                         {
+                             analysis.client_clock_error.correct(run.client_frames);
+                         }
+                         latencies[i].record_frames(run.server_frames, run.client_frames);
+                         frame_rates[i] = {frame_rate(run.driver_frames, &DriverFrameTimeMeasurements::present_called_ns),
+                                           frame_rate(run.client_frames, &ClientFrameTimeMeasurements::end_frame_ns)};
+                     });
+
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            if (analysis.passes.empty() || analysis.passes.back().pass_id != runs[i].pass_id)
+            {
+                analysis.passes.push_back({.pass_id = runs[i].pass_id});
+            }
+            auto &pass = analysis.passes.back();
+            pass.nb_runs++;
+            pass.nb_frames += runs[i].client_frames.size();
+            pass.driver_fps += frame_rates[i].first;
+            pass.client_fps += frame_rates[i].second;
+            pass.latencies.merge(latencies[i]);
+        }
+        for (auto &pass : analysis.passes)
+        {
+            pass.driver_fps /= pass.nb_runs;
+            pass.client_fps /= pass.nb_runs;
+        }
+        return analysis;
+    }
+} // namespace wvb
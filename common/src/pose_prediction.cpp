@@ -0,0 +1,320 @@
+#include "wvb_common/pose_prediction.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                   Quaternion math                                   =
+    // =======================================================================================
+
+    Quaternion quaternion_multiply(const Quaternion &a, const Quaternion &b)
+    {
+        return {
+            a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+            a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+        };
+    }
+
+    Quaternion quaternion_normalize(const Quaternion &q)
+    {
+        const float norm = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        if (norm <= 0.0f)
+        {
+            return {};
+        }
+        return {q.x / norm, q.y / norm, q.z / norm, q.w / norm};
+    }
+
+    Quaternion quaternion_slerp(const Quaternion &a, const Quaternion &b, double t)
+    {
+        // Rotation from a to b
+        Quaternion delta = quaternion_normalize(quaternion_multiply(b, quaternion_conjugate(a)));
+        if (delta.w < 0)
+        {
+            // Take the shortest path
+            delta = {-delta.x, -delta.y, -delta.z, -delta.w};
+        }
+
+        // Convert to axis-angle
+        const double half_angle     = std::acos(std::clamp(static_cast<double>(delta.w), -1.0, 1.0));
+        const double sin_half_angle = std::sin(half_angle);
+        if (sin_half_angle < 1e-6)
+        {
+            // No rotation
+            return quaternion_normalize(a);
+        }
+
+        // Scale the angle, and apply the resulting rotation to a
+        const double scaled_half_angle = half_angle * t;
+        const double scale             = std::sin(scaled_half_angle) / sin_half_angle;
+        const auto   scaled_delta      = Quaternion {
+            static_cast<float>(delta.x * scale),
+            static_cast<float>(delta.y * scale),
+            static_cast<float>(delta.z * scale),
+            static_cast<float>(std::cos(scaled_half_angle)),
+        };
+        return quaternion_normalize(quaternion_multiply(scaled_delta, a));
+    }
+
+    float quaternion_angle(const Quaternion &a, const Quaternion &b)
+    {
+        const auto   delta = quaternion_normalize(quaternion_multiply(b, quaternion_conjugate(a)));
+        const double w     = std::min(std::abs(static_cast<double>(delta.w)), 1.0);
+        return static_cast<float>(2.0 * std::acos(w));
+    }
+
+    Vector3<float> quaternion_rotate(const Quaternion &q, const Vector3<float> &v)
+    {
+        // q * v * conj(q), with v as a pure quaternion
+        const auto rotated = quaternion_multiply(quaternion_multiply(q, {v.x, v.y, v.z, 0}), quaternion_conjugate(q));
+        return {rotated.x, rotated.y, rotated.z};
+    }
+
+    Pose pose_apply_motion(const Pose &pose, const Pose &from, const Pose &to)
+    {
+        const auto rotation = quaternion_normalize(quaternion_multiply(to.orientation, quaternion_conjugate(from.orientation)));
+        const auto offset   = quaternion_rotate(rotation,
+                                              {
+                                                  pose.position.x - from.position.x,
+                                                  pose.position.y - from.position.y,
+                                                  pose.position.z - from.position.z,
+                                              });
+        return {
+            .orientation = quaternion_normalize(quaternion_multiply(rotation, pose.orientation)),
+            .position    = to.position + offset,
+        };
+    }
+
+    // =======================================================================================
+    // =                                    Pose history                                     =
+    // =======================================================================================
+
+    bool PoseHistory::add(const TimedPose &pose)
+    {
+        if (m_count > 0 && pose.timestamp_us <= latest().timestamp_us)
+        {
+            return false;
+        }
+
+        m_poses[m_next] = pose;
+        m_next          = (m_next + 1) % WVB_POSE_HISTORY_CAPACITY;
+        m_count         = std::min(m_count + 1, static_cast<size_t>(WVB_POSE_HISTORY_CAPACITY));
+        return true;
+    }
+
+    void PoseHistory::clear()
+    {
+        m_next  = 0;
+        m_count = 0;
+    }
+
+    const TimedPose &PoseHistory::get(size_t age) const
+    {
+        return m_poses[(m_next + WVB_POSE_HISTORY_CAPACITY - 1 - age) % WVB_POSE_HISTORY_CAPACITY];
+    }
+
+    bool PoseHistory::interpolate(int64_t timestamp_us, Pose &pose) const
+    {
+        if (m_count == 0 || timestamp_us > latest().timestamp_us || timestamp_us < get(m_count - 1).timestamp_us)
+        {
+            return false;
+        }
+
+        // Find the two poses around the timestamp, starting from the most recent ones
+        for (size_t age = 0; age < m_count; age++)
+        {
+            const auto &before = get(age);
+            if (before.timestamp_us > timestamp_us)
+            {
+                continue;
+            }
+
+            if (age == 0 || before.timestamp_us == timestamp_us)
+            {
+                pose = before.pose;
+                return true;
+            }
+
+            const auto  &after = get(age - 1);
+            const double t     = static_cast<double>(timestamp_us - before.timestamp_us)
+                             / static_cast<double>(after.timestamp_us - before.timestamp_us);
+            pose.orientation = quaternion_slerp(before.pose.orientation, after.pose.orientation, t);
+            pose.position    = {
+                static_cast<float>(before.pose.position.x + (after.pose.position.x - before.pose.position.x) * t),
+                static_cast<float>(before.pose.position.y + (after.pose.position.y - before.pose.position.y) * t),
+                static_cast<float>(before.pose.position.z + (after.pose.position.z - before.pose.position.z) * t),
+            };
+            return true;
+        }
+        return false;
+    }
+
+    // =======================================================================================
+    // =                                   Pose prediction                                   =
+    // =======================================================================================
+
+    bool PosePredictor::add_pose(const TimedPose &pose)
+    {
+        if (!m_history.add(pose))
+        {
+            return false;
+        }
+
+        evaluate_pending_predictions();
+        return true;
+    }
+
+    Pose PoseExtrapolation::predict(int64_t target_timestamp_us) const
+    {
+        const auto span_us = latest.timestamp_us - reference.timestamp_us;
+        if (span_us <= 0)
+        {
+            return latest.pose;
+        }
+
+        // Extrapolate with constant velocities
+        const auto   horizon_us = std::min(target_timestamp_us - latest.timestamp_us,
+                                         static_cast<int64_t>(settings.max_extrapolation_us));
+        const double t          = static_cast<double>(span_us + horizon_us) / static_cast<double>(span_us);
+
+        return {
+            .orientation = quaternion_slerp(reference.pose.orientation, latest.pose.orientation, t),
+            .position =
+                {
+                    static_cast<float>(reference.pose.position.x + (latest.pose.position.x - reference.pose.position.x) * t),
+                    static_cast<float>(reference.pose.position.y + (latest.pose.position.y - reference.pose.position.y) * t),
+                    static_cast<float>(reference.pose.position.z + (latest.pose.position.z - reference.pose.position.z) * t),
+                },
+        };
+    }
+
+    bool PosePredictor::predict(int64_t target_timestamp_us, Pose &pose)
+    {
+        if (m_history.empty())
+        {
+            return false;
+        }
+
+        const auto &latest = m_history.latest();
+        if (m_settings.model != PosePredictionModel::NONE && target_timestamp_us <= latest.timestamp_us
+            && m_history.interpolate(target_timestamp_us, pose))
+        {
+            // Already received, no need to predict
+        }
+        else
+        {
+            pose = extrapolation().predict(target_timestamp_us);
+        }
+
+        add_prediction({
+            .pose_timestamp_us   = latest.timestamp_us,
+            .target_timestamp_us = target_timestamp_us,
+            .predicted_pose      = pose,
+        });
+        return true;
+    }
+
+    PoseExtrapolation PosePredictor::extrapolation() const
+    {
+        if (m_history.empty())
+        {
+            return {.settings = m_settings};
+        }
+
+        const auto &latest = m_history.latest();
+        if (m_settings.model == PosePredictionModel::NONE || m_history.size() < 2)
+        {
+            return {.settings = m_settings, .latest = latest, .reference = latest, .is_valid = true};
+        }
+
+        // Find a previous pose far enough in the past to get a stable velocity
+        size_t age = 1;
+        while (age < m_history.size() - 1 && latest.timestamp_us - m_history.get(age).timestamp_us < WVB_POSE_VELOCITY_MIN_SPAN_US)
+        {
+            age++;
+        }
+        return {.settings = m_settings, .latest = latest, .reference = m_history.get(age), .is_valid = true};
+    }
+
+    void PosePredictor::add_prediction(const PosePrediction &prediction)
+    {
+        // Only keep the predictions of the future, the other ones are already known. If there are too many, drop the oldest one.
+        if (prediction.target_timestamp_us <= prediction.pose_timestamp_us)
+        {
+            return;
+        }
+
+        if (m_pending_count == WVB_POSE_PREDICTION_PENDING_CAPACITY)
+        {
+            m_pending_start = (m_pending_start + 1) % WVB_POSE_PREDICTION_PENDING_CAPACITY;
+            m_pending_count--;
+        }
+        m_pending[(m_pending_start + m_pending_count) % WVB_POSE_PREDICTION_PENDING_CAPACITY] = prediction;
+        m_pending_count++;
+    }
+
+    void PosePredictor::evaluate_pending_predictions()
+    {
+        // Predictions are sorted by target in practice, but not necessarily: stop at the first one that can't be evaluated yet
+        while (m_pending_count > 0)
+        {
+            const auto &pending = m_pending[m_pending_start];
+
+            Pose real_pose;
+            if (pending.target_timestamp_us > m_history.latest().timestamp_us)
+            {
+                break;
+            }
+            if (m_history.interpolate(pending.target_timestamp_us, real_pose))
+            {
+                if (m_errors_count == WVB_POSE_PREDICTION_PENDING_CAPACITY)
+                {
+                    m_errors_start = (m_errors_start + 1) % WVB_POSE_PREDICTION_PENDING_CAPACITY;
+                    m_errors_count--;
+                }
+
+                const float dx = real_pose.position.x - pending.predicted_pose.position.x;
+                const float dy = real_pose.position.y - pending.predicted_pose.position.y;
+                const float dz = real_pose.position.z - pending.predicted_pose.position.z;
+
+                m_errors[(m_errors_start + m_errors_count) % WVB_POSE_PREDICTION_PENDING_CAPACITY] = {
+                    .pose_timestamp_us   = pending.pose_timestamp_us,
+                    .target_timestamp_us = pending.target_timestamp_us,
+                    .orientation_error   = quaternion_angle(pending.predicted_pose.orientation, real_pose.orientation),
+                    .position_error      = std::sqrt(dx * dx + dy * dy + dz * dz),
+                };
+                m_errors_count++;
+            }
+            // Otherwise, the real pose is already out of the history and can't be evaluated
+
+            m_pending_start = (m_pending_start + 1) % WVB_POSE_PREDICTION_PENDING_CAPACITY;
+            m_pending_count--;
+        }
+    }
+
+    bool PosePredictor::pop_error(PosePredictionError &error)
+    {
+        if (m_errors_count == 0)
+        {
+            return false;
+        }
+
+        error          = m_errors[m_errors_start];
+        m_errors_start = (m_errors_start + 1) % WVB_POSE_PREDICTION_PENDING_CAPACITY;
+        m_errors_count--;
+        return true;
+    }
+
+    void PosePredictor::reset()
+    {
+        m_history.clear();
+        m_pending_start = 0;
+        m_pending_count = 0;
+        m_errors_start  = 0;
+        m_errors_count  = 0;
+    }
+} // namespace wvb
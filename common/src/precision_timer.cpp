@@ -0,0 +1,135 @@
+#include "wvb_common/precision_timer.h"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+// std::min and std::max are used below
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <time.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+// Not defined by older SDKs
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace wvb
+{
+    /** Tells the CPU that we are spinning, to save power and let the other hyper-thread run. */
+    inline void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    PrecisionTimer::PrecisionTimer()
+    {
+#ifdef _WIN32
+        // High resolution timers are available since Windows 10 1803. Otherwise, use a regular one with the default resolution.
+        m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        if (m_timer == nullptr)
+        {
+            m_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+        }
+#endif
+    }
+
+    PrecisionTimer::~PrecisionTimer()
+    {
+#ifdef _WIN32
+        if (m_timer != nullptr)
+        {
+            CloseHandle(m_timer);
+            m_timer = nullptr;
+        }
+#endif
+    }
+
+    void PrecisionTimer::sleep_until(clock::time_point time)
+    {
+#ifdef _WIN32
+        // Relative due time, in 100 ns units
+        const auto    duration = std::chrono::duration_cast<std::chrono::nanoseconds>(time - clock::now()).count() / 100;
+        LARGE_INTEGER due_time {};
+        due_time.QuadPart = -std::max(duration, static_cast<int64_t>(1));
+        if (m_timer == nullptr || !SetWaitableTimer(m_timer, &due_time, 0, nullptr, nullptr, FALSE))
+        {
+            std::this_thread::sleep_until(time);
+            return;
+        }
+        WaitForSingleObject(m_timer, INFINITE);
+#elif defined(__linux__)
+        // steady_clock uses CLOCK_MONOTONIC. The absolute time avoids drifting if the sleep is interrupted and restarted.
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        timespec   ts {};
+        ts.tv_sec  = static_cast<time_t>(ns / 1000000000);
+        ts.tv_nsec = static_cast<long>(ns % 1000000000);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+        {
+        }
+#else
+        std::this_thread::sleep_until(time);
+#endif
+    }
+
+    void PrecisionTimer::add_wakeup_error(std::chrono::microseconds error)
+    {
+        m_wakeup_errors_us[m_next_wakeup_error] = std::max(error.count(), static_cast<int64_t>(0));
+        m_next_wakeup_error                     = (m_next_wakeup_error + 1) % WVB_PRECISION_TIMER_HISTORY_SIZE;
+        if (m_nb_wakeup_errors < WVB_PRECISION_TIMER_HISTORY_SIZE)
+        {
+            m_nb_wakeup_errors++;
+        }
+
+        // Keep the initial margin until there are enough errors to estimate a high percentile
+        if (m_nb_wakeup_errors < WVB_PRECISION_TIMER_HISTORY_SIZE / 4)
+        {
+            return;
+        }
+
+        std::array<int64_t, WVB_PRECISION_TIMER_HISTORY_SIZE> sorted_errors_us = m_wakeup_errors_us;
+        const auto end = sorted_errors_us.begin() + static_cast<ptrdiff_t>(m_nb_wakeup_errors);
+        const auto p99 = sorted_errors_us.begin() + static_cast<ptrdiff_t>(m_nb_wakeup_errors * 99 / 100);
+        std::nth_element(sorted_errors_us.begin(), p99, end);
+
+        m_spin_margin = std::chrono::microseconds(std::clamp(*p99 + WVB_PRECISION_TIMER_MARGIN_SAFETY_US,
+                                                             static_cast<int64_t>(WVB_PRECISION_TIMER_MIN_MARGIN_US),
+                                                             static_cast<int64_t>(WVB_PRECISION_TIMER_MAX_MARGIN_US)));
+    }
+
+    PrecisionTimer::clock::time_point PrecisionTimer::wait_until(clock::time_point deadline)
+    {
+        // Sleep for the major part of the wait to save resources
+        const auto sleep_end = deadline - m_spin_margin;
+        auto       now       = clock::now();
+        if (now < sleep_end)
+        {
+            sleep_until(sleep_end);
+            now = clock::now();
+            add_wakeup_error(std::chrono::duration_cast<std::chrono::microseconds>(now - sleep_end));
+        }
+
+        // Spin for the remaining time to end on the exact deadline
+        while (now < deadline)
+        {
+            cpu_relax();
+            now = clock::now();
+        }
+        return now;
+    }
+} // namespace wvb
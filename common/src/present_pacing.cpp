@@ -0,0 +1,119 @@
+#include "wvb_common/present_pacing.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                 Duration estimation                                 =
+    // =======================================================================================
+
+    void DurationEstimator::add(int64_t duration_us)
+    {
+        const auto duration = static_cast<double>(duration_us);
+
+        // Start with a conservative deviation, like TCP's round trip time estimation
+        if (!m_has_sample)
+        {
+            m_mean_us      = duration;
+            m_deviation_us = duration / 2;
+            m_has_sample   = true;
+            return;
+        }
+
+        m_deviation_us += m_alpha * (std::abs(duration - m_mean_us) - m_deviation_us);
+        m_mean_us += m_alpha * (duration - m_mean_us);
+    }
+
+    void DurationEstimator::reset()
+    {
+        m_mean_us      = 0;
+        m_deviation_us = 0;
+        m_has_sample   = false;
+    }
+
+    int64_t DurationEstimator::estimate_us() const
+    {
+        if (!m_has_sample)
+        {
+            return 0;
+        }
+        return static_cast<int64_t>(m_mean_us + m_deviation_factor * m_deviation_us);
+    }
+
+    // =======================================================================================
+    // =                                   Present pacing                                    =
+    // =======================================================================================
+
+    PresentPacer::PresentPacer(uint32_t frame_interval_us, const PresentPacingSettings &settings)
+        : m_settings(settings),
+          m_frame_interval_us(frame_interval_us),
+          m_render_time(settings.estimate_alpha, settings.deviation_factor),
+          m_encode_time(settings.estimate_alpha, settings.deviation_factor)
+    {
+    }
+
+    void PresentPacer::set_frame_interval_us(uint32_t frame_interval_us)
+    {
+        m_frame_interval_us = frame_interval_us;
+        update_wait_margin();
+    }
+
+    void PresentPacer::on_frame_started(int64_t timestamp_us)
+    {
+        m_frame_started_timestamp_us = timestamp_us;
+        m_is_frame_started           = true;
+    }
+
+    int64_t PresentPacer::on_frame_presented(int64_t present_timestamp_us, int64_t vsync_timestamp_us)
+    {
+        // The first present has no known start
+        if (m_is_frame_started)
+        {
+            m_render_time.add(present_timestamp_us - m_frame_started_timestamp_us);
+            m_is_frame_started = false;
+        }
+
+        const int64_t target_us = vsync_timestamp_us - m_settings.target_lead_us;
+        m_deadline_error_us     = present_timestamp_us - target_us;
+
+        // A missed vsync gives a very large error: limit its impact so that the correction doesn't overshoot
+        const auto max_error_us = static_cast<double>(m_frame_interval_us) / 2;
+        const auto error_us     = std::clamp(static_cast<double>(m_deadline_error_us), -max_error_us, max_error_us);
+
+        // Late frames need a larger margin. The integral term is bounded to prevent wind-up while the margin is saturated.
+        m_integral_us   = std::clamp(m_integral_us + m_settings.ki * error_us, -max_error_us, max_error_us);
+        m_correction_us = static_cast<int64_t>(m_settings.kp * error_us + m_integral_us);
+
+        update_wait_margin();
+        return m_deadline_error_us;
+    }
+
+    void PresentPacer::on_frame_encoded(int64_t vsync_timestamp_us, int64_t finished_timestamp_us)
+    {
+        m_encode_time.add(finished_timestamp_us - vsync_timestamp_us);
+        update_wait_margin();
+    }
+
+    void PresentPacer::update_wait_margin()
+    {
+        const int64_t margin_us = m_render_time.estimate_us() + m_settings.target_lead_us + m_correction_us;
+
+        // The app can only be released after the server finished encoding the previous frame, which started at the previous vsync
+        const int64_t max_margin_us =
+            std::max(static_cast<int64_t>(m_frame_interval_us) - m_encode_time.mean_us(), static_cast<int64_t>(0));
+        m_wait_margin_us = std::clamp(margin_us, static_cast<int64_t>(0), max_margin_us);
+    }
+
+    void PresentPacer::reset()
+    {
+        m_render_time.reset();
+        m_encode_time.reset();
+        m_is_frame_started  = false;
+        m_integral_us       = 0;
+        m_correction_us     = 0;
+        m_deadline_error_us = 0;
+        update_wait_margin();
+    }
+} // namespace wvb
@@ -0,0 +1,396 @@
+// Implementation is platform-dependant since each OS has its own polling functions.
+
+#ifdef __linux__
+
+#include "wvb_common/reactor.h"
+
+#include <atomic>
+#include <cerrno>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+// Maximum number of ready handlers returned by a single wait
+#define WVB_REACTOR_MAX_EVENTS 64
+// Maximum time for an event thread to see that its handler was removed
+#define WVB_REACTOR_EVENT_STOP_CHECK_MS 10
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                 Structs and classes                                 =
+    // =======================================================================================
+
+#define INVALID_FD (-1)
+
+    enum class ReactorHandlerType
+    {
+        SOCKET,
+        TIMER,
+        EVENT,
+    };
+
+    struct ReactorHandler
+    {
+        ReactorHandlerType type = ReactorHandlerType::SOCKET;
+        /** Socket, or timerfd of a timer. */
+        int32_t fd = INVALID_FD;
+        /** Shared so that a callback can remove its own handler while it runs. */
+        std::shared_ptr<Reactor::Callback> on_ready         = nullptr;
+        std::shared_ptr<Reactor::Callback> on_writable      = nullptr;
+        bool                               writable_enabled = false;
+        bool                               one_shot         = false;
+
+        // Event
+        const InterProcessEvent           *event         = nullptr;
+        std::shared_ptr<std::atomic<bool>> event_running = nullptr;
+        std::thread                        event_thread;
+    };
+
+    struct Reactor::Data
+    {
+        int32_t epoll_fd = INVALID_FD;
+        /** eventfd used to wake up the loop from other threads. Registered with the invalid handler id. */
+        int32_t wake_fd = INVALID_FD;
+
+        ReactorHandlerId                                                      next_id = 1;
+        std::unordered_map<ReactorHandlerId, std::unique_ptr<ReactorHandler>> handlers;
+
+        mutable std::mutex            posted_mutex;
+        mutable std::vector<Callback> posted_callbacks;
+        mutable std::atomic<bool>     should_stop = false;
+    };
+
+    // =======================================================================================
+    // =                                   Implementation                                    =
+    // =======================================================================================
+
+    void wake_up(int32_t wake_fd)
+    {
+        const uint64_t value = 1;
+        // Can only fail if the counter overflows, in which case the loop is already awake
+        [[maybe_unused]] const auto result = write(wake_fd, &value, sizeof(value));
+    }
+
+    Reactor::Reactor() : m_data(new Data)
+    {
+        m_data->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        m_data->wake_fd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_data->epoll_fd == INVALID_FD || m_data->wake_fd == INVALID_FD)
+        {
+            this->~Reactor();
+            throw std::runtime_error("Failed to create reactor");
+        }
+
+        epoll_event event {.events = EPOLLIN, .data = {.u64 = INVALID_REACTOR_HANDLER_ID}};
+        if (epoll_ctl(m_data->epoll_fd, EPOLL_CTL_ADD, m_data->wake_fd, &event) != 0)
+        {
+            this->~Reactor();
+            throw std::runtime_error("Failed to register reactor wake up event");
+        }
+    }
+
+    Reactor::~Reactor()
+    {
+        if (m_data != nullptr)
+        {
+            // Stop the event threads
+            std::vector<ReactorHandlerId> ids;
+            for (const auto &[id, handler] : m_data->handlers)
+            {
+                ids.push_back(id);
+            }
+            for (const auto id : ids)
+            {
+                remove(id);
+            }
+
+            if (m_data->wake_fd != INVALID_FD)
+            {
+                close(m_data->wake_fd);
+            }
+            if (m_data->epoll_fd != INVALID_FD)
+            {
+                close(m_data->epoll_fd);
+            }
+
+            delete m_data;
+            m_data = nullptr;
+        }
+    }
+
+    ReactorHandlerId Reactor::add_socket(NativeSocketHandle socket, Callback on_ready, Callback on_writable)
+    {
+        if (socket == INVALID_NATIVE_SOCKET_HANDLE || on_ready == nullptr)
+        {
+            throw std::invalid_argument("Invalid socket handler");
+        }
+
+        const ReactorHandlerId id = m_data->next_id++;
+        epoll_event            event {.events = EPOLLIN | EPOLLRDHUP, .data = {.u64 = id}};
+        if (epoll_ctl(m_data->epoll_fd, EPOLL_CTL_ADD, socket, &event) != 0)
+        {
+            throw std::runtime_error("Failed to register socket in reactor");
+        }
+
+        auto handler         = std::make_unique<ReactorHandler>();
+        handler->type        = ReactorHandlerType::SOCKET;
+        handler->fd          = socket;
+        handler->on_ready    = std::make_shared<Callback>(std::move(on_ready));
+        handler->on_writable = on_writable != nullptr ? std::make_shared<Callback>(std::move(on_writable)) : nullptr;
+        m_data->handlers.emplace(id, std::move(handler));
+        return id;
+    }
+
+    void Reactor::set_writable_notifications(ReactorHandlerId id, bool enabled) const
+    {
+        const auto it = m_data->handlers.find(id);
+        if (it == m_data->handlers.end() || it->second->type != ReactorHandlerType::SOCKET || it->second->on_writable == nullptr
+            || it->second->writable_enabled == enabled)
+        {
+            return;
+        }
+
+        it->second->writable_enabled = enabled;
+        epoll_event event {.events = EPOLLIN | EPOLLRDHUP | (enabled ? EPOLLOUT : 0u), .data = {.u64 = id}};
+        epoll_ctl(m_data->epoll_fd, EPOLL_CTL_MOD, it->second->fd, &event);
+    }
+
+    ReactorHandlerId Reactor::add_timer(std::chrono::microseconds delay, Callback on_timer, std::chrono::microseconds interval)
+    {
+        if (on_timer == nullptr)
+        {
+            throw std::invalid_argument("Invalid timer handler");
+        }
+
+        const int32_t timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd == INVALID_FD)
+        {
+            throw std::runtime_error("Failed to create timer");
+        }
+
+        // A zero value would disarm the timer
+        const auto first_delay = std::max(delay, std::chrono::microseconds(1));
+        itimerspec spec {};
+        spec.it_value.tv_sec     = static_cast<time_t>(first_delay.count() / 1000000);
+        spec.it_value.tv_nsec    = static_cast<long>(first_delay.count() % 1000000) * 1000;
+        spec.it_interval.tv_sec  = static_cast<time_t>(interval.count() / 1000000);
+        spec.it_interval.tv_nsec = static_cast<long>(interval.count() % 1000000) * 1000;
+
+        const ReactorHandlerId id = m_data->next_id++;
+        epoll_event            event {.events = EPOLLIN, .data = {.u64 = id}};
+        if (timerfd_settime(timer_fd, 0, &spec, nullptr) != 0 || epoll_ctl(m_data->epoll_fd, EPOLL_CTL_ADD, timer_fd, &event) != 0)
+        {
+            close(timer_fd);
+            throw std::runtime_error("Failed to register timer in reactor");
+        }
+
+        auto handler      = std::make_unique<ReactorHandler>();
+        handler->type     = ReactorHandlerType::TIMER;
+        handler->fd       = timer_fd;
+        handler->on_ready = std::make_shared<Callback>(std::move(on_timer));
+        handler->one_shot = interval == std::chrono::microseconds::zero();
+        m_data->handlers.emplace(id, std::move(handler));
+        return id;
+    }
+
+    ReactorHandlerId Reactor::add_event(const InterProcessEvent &event, Callback on_event)
+    {
+#ifdef __ANDROID__
+        throw std::runtime_error("Inter-process events are not supported on Android");
+#else
+        if (!event.is_valid() || on_event == nullptr)
+        {
+            throw std::invalid_argument("Invalid event handler");
+        }
+
+        const ReactorHandlerId id = m_data->next_id++;
+
+        auto handler           = std::make_unique<ReactorHandler>();
+        handler->type          = ReactorHandlerType::EVENT;
+        handler->on_ready      = std::make_shared<Callback>(std::move(on_event));
+        handler->event         = &event;
+        handler->event_running = std::make_shared<std::atomic<bool>>(true);
+
+        // The thread only forwards the event to the loop, where the handler is looked up again in case it was removed since.
+        // It uses the data rather than the reactor, which can be moved.
+        handler->event_thread = std::thread(
+            [data = m_data, id, running = handler->event_running, event_ptr = &event]
+            {
+                while (running->load())
+                {
+                    // Bounded wait, so that the thread can be stopped without signaling the user's event
+                    if (!event_ptr->wait(WVB_REACTOR_EVENT_STOP_CHECK_MS) || !running->load())
+                    {
+                        continue;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(data->posted_mutex);
+                        data->posted_callbacks.emplace_back(
+                            [data, id]
+                            {
+                                const auto it = data->handlers.find(id);
+                                if (it != data->handlers.end())
+                                {
+                                    const auto callback = it->second->on_ready;
+                                    (*callback)();
+                                }
+                            });
+                    }
+                    wake_up(data->wake_fd);
+                }
+            });
+
+        m_data->handlers.emplace(id, std::move(handler));
+        return id;
+#endif
+    }
+
+    void Reactor::remove(ReactorHandlerId id)
+    {
+        const auto it = m_data->handlers.find(id);
+        if (it == m_data->handlers.end())
+        {
+            return;
+        }
+
+        // Take the handler out first, in case it is removed again while its thread is joined
+        std::unique_ptr<ReactorHandler> handler = std::move(it->second);
+        m_data->handlers.erase(it);
+
+        switch (handler->type)
+        {
+            case ReactorHandlerType::SOCKET:
+                // Fails if the socket was already closed, which also unregistered it
+                epoll_ctl(m_data->epoll_fd, EPOLL_CTL_DEL, handler->fd, nullptr);
+                break;
+            case ReactorHandlerType::TIMER:
+                // Closing the timer unregisters it
+                close(handler->fd);
+                break;
+            case ReactorHandlerType::EVENT:
+#ifndef __ANDROID__
+                // The thread sees it at its next wait timeout. The event itself isn't signaled: another receiver could get it.
+                handler->event_running->store(false);
+                handler->event_thread.join();
+#endif
+                break;
+        }
+    }
+
+    void Reactor::post(Callback callback) const
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_data->posted_mutex);
+            m_data->posted_callbacks.push_back(std::move(callback));
+        }
+        wake_up(m_data->wake_fd);
+    }
+
+    uint32_t Reactor::run_once(uint32_t timeout_ms)
+    {
+        epoll_event events[WVB_REACTOR_MAX_EVENTS];
+        const int   timeout  = timeout_ms == NO_TIMEOUT ? -1 : static_cast<int>(timeout_ms);
+        const int   nb_ready = epoll_wait(m_data->epoll_fd, events, WVB_REACTOR_MAX_EVENTS, timeout);
+        if (nb_ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                return 0;
+            }
+            throw std::runtime_error("Failed to wait for reactor events");
+        }
+
+        uint32_t nb_called = 0;
+        for (int i = 0; i < nb_ready; i++)
+        {
+            const auto id = static_cast<ReactorHandlerId>(events[i].data.u64);
+
+            // Callbacks posted by other threads
+            if (id == INVALID_REACTOR_HANDLER_ID)
+            {
+                uint64_t value = 0;
+                [[maybe_unused]] const auto result = read(m_data->wake_fd, &value, sizeof(value));
+
+                std::vector<Callback> callbacks;
+                {
+                    std::lock_guard<std::mutex> lock(m_data->posted_mutex);
+                    callbacks.swap(m_data->posted_callbacks);
+                }
+                for (const auto &callback : callbacks)
+                {
+                    callback();
+                    nb_called++;
+                }
+                continue;
+            }
+
+            // The handler may have been removed by a previous callback
+            auto it = m_data->handlers.find(id);
+            if (it == m_data->handlers.end())
+            {
+                continue;
+            }
+
+            if (it->second->type == ReactorHandlerType::TIMER)
+            {
+                uint64_t nb_expirations = 0;
+                [[maybe_unused]] const auto result = read(it->second->fd, &nb_expirations, sizeof(nb_expirations));
+
+                const auto callback = it->second->on_ready;
+                if (it->second->one_shot)
+                {
+                    remove(id);
+                }
+                (*callback)();
+                nb_called++;
+                continue;
+            }
+
+            if ((events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0)
+            {
+                const auto callback = it->second->on_ready;
+                (*callback)();
+                nb_called++;
+            }
+
+            if ((events[i].events & EPOLLOUT) != 0)
+            {
+                it = m_data->handlers.find(id);
+                if (it != m_data->handlers.end() && it->second->on_writable != nullptr)
+                {
+                    const auto callback = it->second->on_writable;
+                    (*callback)();
+                    nb_called++;
+                }
+            }
+        }
+        return nb_called;
+    }
+
+    void Reactor::run()
+    {
+        while (!m_data->should_stop)
+        {
+            run_once(NO_TIMEOUT);
+        }
+        // Can be run again
+        m_data->should_stop = false;
+    }
+
+    void Reactor::stop() const
+    {
+        m_data->should_stop = true;
+        wake_up(m_data->wake_fd);
+    }
+} // namespace wvb
+
+#endif
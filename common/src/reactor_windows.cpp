@@ -0,0 +1,365 @@
+// Implementation is platform-dependant since each OS has its own polling functions.
+
+#ifdef _WIN32
+
+#include "wvb_common/reactor.h"
+
+#include <winsock2.h>
+#undef ERROR
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Maximum time for an event thread to see that its handler was removed
+#define WVB_REACTOR_EVENT_STOP_CHECK_MS 10
+
+namespace wvb
+{
+    // =======================================================================================
+    // =                                 Structs and classes                                 =
+    // =======================================================================================
+
+    enum class ReactorHandlerType
+    {
+        SOCKET,
+        TIMER,
+        EVENT,
+    };
+
+    struct ReactorHandler
+    {
+        ReactorHandlerType type = ReactorHandlerType::SOCKET;
+        /** Shared so that a callback can remove its own handler while it runs. */
+        std::shared_ptr<Reactor::Callback> on_ready    = nullptr;
+        std::shared_ptr<Reactor::Callback> on_writable = nullptr;
+
+        // Socket
+        NativeSocketHandle socket           = INVALID_NATIVE_SOCKET_HANDLE;
+        bool               writable_enabled = false;
+
+        // Timer
+        std::chrono::steady_clock::time_point deadline {};
+        std::chrono::microseconds             interval {};
+
+        // Event
+        const InterProcessEvent           *event         = nullptr;
+        std::shared_ptr<std::atomic<bool>> event_running = nullptr;
+        std::thread                        event_thread;
+    };
+
+    struct Reactor::Data
+    {
+        /** Loopback socket used to wake up the loop from other threads, since WSAPoll only waits on sockets. */
+        UDPSocket  wake_socket;
+        SocketAddr wake_addr {};
+
+        ReactorHandlerId                                                      next_id = 1;
+        std::unordered_map<ReactorHandlerId, std::unique_ptr<ReactorHandler>> handlers;
+
+        mutable std::mutex            posted_mutex;
+        mutable std::vector<Callback> posted_callbacks;
+        mutable std::atomic<bool>     should_stop = false;
+    };
+
+    // =======================================================================================
+    // =                                   Implementation                                    =
+    // =======================================================================================
+
+    void wake_up(const UDPSocket &wake_socket, const SocketAddr &wake_addr)
+    {
+        // If the socket buffer is full, the loop is already awake
+        const uint8_t value = 1;
+        (void) wake_socket.send_to(wake_addr, &value, sizeof(value));
+    }
+
+    Reactor::Reactor() : m_data(new Data)
+    {
+        m_data->wake_socket = UDPSocket(PORT_AUTO, false);
+        m_data->wake_addr   = {INET_ADDR_LOOPBACK, m_data->wake_socket.local_addr().port};
+    }
+
+    Reactor::~Reactor()
+    {
+        if (m_data != nullptr)
+        {
+            // Stop the event threads
+            std::vector<ReactorHandlerId> ids;
+            for (const auto &[id, handler] : m_data->handlers)
+            {
+                ids.push_back(id);
+            }
+            for (const auto id : ids)
+            {
+                remove(id);
+            }
+
+            delete m_data;
+            m_data = nullptr;
+        }
+    }
+
+    ReactorHandlerId Reactor::add_socket(NativeSocketHandle socket, Callback on_ready, Callback on_writable)
+    {
+        if (socket == INVALID_NATIVE_SOCKET_HANDLE || on_ready == nullptr)
+        {
+            throw std::invalid_argument("Invalid socket handler");
+        }
+
+        const ReactorHandlerId id = m_data->next_id++;
+
+        auto handler         = std::make_unique<ReactorHandler>();
+        handler->type        = ReactorHandlerType::SOCKET;
+        handler->socket      = socket;
+        handler->on_ready    = std::make_shared<Callback>(std::move(on_ready));
+        handler->on_writable = on_writable != nullptr ? std::make_shared<Callback>(std::move(on_writable)) : nullptr;
+        m_data->handlers.emplace(id, std::move(handler));
+        return id;
+    }
+
+    void Reactor::set_writable_notifications(ReactorHandlerId id, bool enabled) const
+    {
+        const auto it = m_data->handlers.find(id);
+        if (it == m_data->handlers.end() || it->second->type != ReactorHandlerType::SOCKET || it->second->on_writable == nullptr)
+        {
+            return;
+        }
+
+        it->second->writable_enabled = enabled;
+    }
+
+    ReactorHandlerId Reactor::add_timer(std::chrono::microseconds delay, Callback on_timer, std::chrono::microseconds interval)
+    {
+        if (on_timer == nullptr)
+        {
+            throw std::invalid_argument("Invalid timer handler");
+        }
+
+        const ReactorHandlerId id = m_data->next_id++;
+
+        auto handler      = std::make_unique<ReactorHandler>();
+        handler->type     = ReactorHandlerType::TIMER;
+        handler->on_ready = std::make_shared<Callback>(std::move(on_timer));
+        handler->deadline = std::chrono::steady_clock::now() + delay;
+        handler->interval = interval;
+        m_data->handlers.emplace(id, std::move(handler));
+        return id;
+    }
+
+    ReactorHandlerId Reactor::add_event(const InterProcessEvent &event, Callback on_event)
+    {
+        if (!event.is_valid() || on_event == nullptr)
+        {
+            throw std::invalid_argument("Invalid event handler");
+        }
+
+        const ReactorHandlerId id = m_data->next_id++;
+
+        auto handler           = std::make_unique<ReactorHandler>();
+        handler->type          = ReactorHandlerType::EVENT;
+        handler->on_ready      = std::make_shared<Callback>(std::move(on_event));
+        handler->event         = &event;
+        handler->event_running = std::make_shared<std::atomic<bool>>(true);
+
+        // The thread only forwards the event to the loop, where the handler is looked up again in case it was removed since.
+        // It uses the data rather than the reactor, which can be moved.
+        handler->event_thread = std::thread(
+            [data = m_data, id, running = handler->event_running, event_ptr = &event]
+            {
+                while (running->load())
+                {
+                    // Bounded wait, so that the thread can be stopped without signaling the user's event
+                    if (!event_ptr->wait(WVB_REACTOR_EVENT_STOP_CHECK_MS) || !running->load())
+                    {
+                        continue;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(data->posted_mutex);
+                        data->posted_callbacks.emplace_back(
+                            [data, id]
+                            {
+                                const auto it = data->handlers.find(id);
+                                if (it != data->handlers.end())
+                                {
+                                    const auto callback = it->second->on_ready;
+                                    (*callback)();
+                                }
+                            });
+                    }
+                    wake_up(data->wake_socket, data->wake_addr);
+                }
+            });
+
+        m_data->handlers.emplace(id, std::move(handler));
+        return id;
+    }
+
+    void Reactor::remove(ReactorHandlerId id)
+    {
+        const auto it = m_data->handlers.find(id);
+        if (it == m_data->handlers.end())
+        {
+            return;
+        }
+
+        // Take the handler out first, in case it is removed again while its thread is joined
+        std::unique_ptr<ReactorHandler> handler = std::move(it->second);
+        m_data->handlers.erase(it);
+
+        if (handler->type == ReactorHandlerType::EVENT)
+        {
+            // The thread sees it at its next wait timeout. The event itself isn't signaled: another receiver could get it.
+            handler->event_running->store(false);
+            handler->event_thread.join();
+        }
+    }
+
+    void Reactor::post(Callback callback) const
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_data->posted_mutex);
+            m_data->posted_callbacks.push_back(std::move(callback));
+        }
+        wake_up(m_data->wake_socket, m_data->wake_addr);
+    }
+
+    uint32_t Reactor::run_once(uint32_t timeout_ms)
+    {
+        // Wait until the next timer at most
+        const auto now     = std::chrono::steady_clock::now();
+        int        timeout = timeout_ms == NO_TIMEOUT ? -1 : static_cast<int>(timeout_ms);
+
+        std::vector<WSAPOLLFD>        fds {{.fd = m_data->wake_socket.native_handle(), .events = POLLRDNORM}};
+        std::vector<ReactorHandlerId> fd_ids {INVALID_REACTOR_HANDLER_ID};
+        for (const auto &[id, handler] : m_data->handlers)
+        {
+            if (handler->type == ReactorHandlerType::SOCKET)
+            {
+                fds.push_back({
+                    .fd     = handler->socket,
+                    .events = static_cast<SHORT>(POLLRDNORM | (handler->writable_enabled ? POLLWRNORM : 0)),
+                });
+                fd_ids.push_back(id);
+            }
+            else if (handler->type == ReactorHandlerType::TIMER)
+            {
+                // Round up, to avoid waking up just before the deadline
+                const auto until_deadline =
+                    std::chrono::ceil<std::chrono::milliseconds>(std::max(handler->deadline - now, std::chrono::nanoseconds::zero()));
+                const int timer_timeout = static_cast<int>(until_deadline.count());
+                timeout                 = timeout < 0 ? timer_timeout : std::min(timeout, timer_timeout);
+            }
+        }
+
+        const int nb_ready = WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), timeout);
+        if (nb_ready == SOCKET_ERROR)
+        {
+            throw std::runtime_error("Failed to wait for reactor events");
+        }
+
+        uint32_t nb_called = 0;
+        for (size_t i = 0; i < fds.size() && nb_ready > 0; i++)
+        {
+            if (fds[i].revents == 0)
+            {
+                continue;
+            }
+
+            // Callbacks posted by other threads
+            if (fd_ids[i] == INVALID_REACTOR_HANDLER_ID)
+            {
+                uint8_t buffer[64];
+                size_t  size = 0;
+                while (m_data->wake_socket.receive_from(buffer, sizeof(buffer), &size, nullptr))
+                {
+                }
+
+                std::vector<Callback> callbacks;
+                {
+                    std::lock_guard<std::mutex> lock(m_data->posted_mutex);
+                    callbacks.swap(m_data->posted_callbacks);
+                }
+                for (const auto &callback : callbacks)
+                {
+                    callback();
+                    nb_called++;
+                }
+                continue;
+            }
+
+            // The handler may have been removed by a previous callback
+            auto it = m_data->handlers.find(fd_ids[i]);
+            if (it != m_data->handlers.end() && (fds[i].revents & (POLLRDNORM | POLLHUP | POLLERR)) != 0)
+            {
+                const auto callback = it->second->on_ready;
+                (*callback)();
+                nb_called++;
+            }
+
+            it = m_data->handlers.find(fd_ids[i]);
+            if (it != m_data->handlers.end() && (fds[i].revents & POLLWRNORM) != 0 && it->second->on_writable != nullptr)
+            {
+                const auto callback = it->second->on_writable;
+                (*callback)();
+                nb_called++;
+            }
+        }
+
+        // Expired timers
+        std::vector<ReactorHandlerId> expired_ids;
+        const auto                    after_wait = std::chrono::steady_clock::now();
+        for (const auto &[id, handler] : m_data->handlers)
+        {
+            if (handler->type == ReactorHandlerType::TIMER && handler->deadline <= after_wait)
+            {
+                expired_ids.push_back(id);
+            }
+        }
+        for (const auto id : expired_ids)
+        {
+            const auto it = m_data->handlers.find(id);
+            if (it == m_data->handlers.end())
+            {
+                continue;
+            }
+
+            const auto callback = it->second->on_ready;
+            if (it->second->interval == std::chrono::microseconds::zero())
+            {
+                remove(id);
+            }
+            else
+            {
+                // Skip the missed expirations, like timerfd
+                it->second->deadline = std::max(it->second->deadline + it->second->interval, after_wait);
+            }
+            (*callback)();
+            nb_called++;
+        }
+        return nb_called;
+    }
+
+    void Reactor::run()
+    {
+        while (!m_data->should_stop)
+        {
+            run_once(NO_TIMEOUT);
+        }
+        // Can be run again
+        m_data->should_stop = false;
+    }
+
+    void Reactor::stop() const
+    {
+        m_data->should_stop = true;
+        wake_up(m_data->wake_socket, m_data->wake_addr);
+    }
+} // namespace wvb
+
+#endif
@@ -0,0 +1,180 @@
+#include "wvb_common/repetition_scheduler.h"
+
+#include <wvb_common/macros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Two-sided 95% quantile of the standard normal distribution
+#define NORMAL_QUANTILE_95 1.959963984540054
+
+namespace wvb
+{
+    // Two-sided 95% quantiles of the Student t distribution, by degrees of freedom
+    static constexpr double STUDENT_T_95[] = {
+        12.706205, 4.302653, 3.182446, 2.776445, 2.570582, 2.446912, 2.364624, 2.306004, 2.262157, 2.228139,
+        2.200985,  2.178813, 2.160369, 2.144787, 2.131450, 2.119905, 2.109816, 2.100922, 2.093024, 2.085963,
+        2.079614,  2.073873, 2.068658, 2.063899, 2.059539, 2.055529, 2.051831, 2.048407, 2.045230, 2.042272,
+    };
+
+    void RunningStatistics::add(double value)
+    {
+        count++;
+        const double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+    }
+
+    double RunningStatistics::variance() const { return count < 2 ? 0 : m2 / (count - 1); }
+
+    double RunningStatistics::confidence_half_width() const
+    {
+        if (count < 2)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+        return student_t_95(count - 1) * std::sqrt(variance() / count);
+    }
+
+    double student_t_95(uint32_t degrees_of_freedom)
+    {
+        constexpr uint32_t nb_tabulated = sizeof(STUDENT_T_95) / sizeof(STUDENT_T_95[0]);
+        if (degrees_of_freedom <= nb_tabulated)
+        {
+            return STUDENT_T_95[std::max(degrees_of_freedom, 1u) - 1];
+        }
+
+        // Cornish-Fisher expansion around the normal quantile, accurate to 1e-4 past the table
+        const double z  = NORMAL_QUANTILE_95;
+        const double z3 = z * z * z;
+        const double z5 = z3 * z * z;
+        const double v  = degrees_of_freedom;
+        return z + (z3 + z) / (4 * v) + (5 * z5 + 16 * z3 + 3 * z) / (96 * v * v);
+    }
+
+    std::string to_string(RepetitionStopReason reason)
+    {
+        switch (reason)
+        {
+            case RepetitionStopReason::NONE: return "NONE";
+            case RepetitionStopReason::PRECISION_REACHED: return "PRECISION_REACHED";
+            case RepetitionStopReason::MAX_REPETITIONS: return "MAX_REPETITIONS";
+            default: return "UNKNOWN";
+        }
+    }
+
+    RepetitionScheduler::RepetitionScheduler(uint32_t min_repetitions, uint32_t max_repetitions, double target_half_width_ns)
+        : m_min_repetitions(std::clamp(min_repetitions, 1u, std::max(max_repetitions, 1u))),
+          m_max_repetitions(std::max(max_repetitions, 1u)),
+          m_target_half_width(target_half_width_ns)
+    {
+    }
+
+    RepetitionScheduler::RepetitionScheduler(const BenchmarkPass &pass)
+        : RepetitionScheduler(pass.min_repetitions,
+                              pass.num_repetitions,
+                              static_cast<double>(pass.target_ci_half_width_us) * 1000)
+    {
+    }
+
+    RepetitionStopReason RepetitionScheduler::add_run(const std::array<double, WVB_LATENCY_STAGE_COUNT> &stage_means_ns)
+    {
+        m_nb_runs++;
+        for (size_t i = 0; i < m_stages.size(); i++)
+        {
+            if (!std::isnan(stage_means_ns[i]))
+            {
+                m_stages[i].add(stage_means_ns[i]);
+            }
+        }
+
+        if (m_target_half_width > 0 && m_nb_runs >= m_min_repetitions && max_half_width() <= m_target_half_width)
+        {
+            m_stop_reason = RepetitionStopReason::PRECISION_REACHED;
+        }
+        else if (m_nb_runs >= m_max_repetitions)
+        {
+            m_stop_reason = RepetitionStopReason::MAX_REPETITIONS;
+        }
+        return m_stop_reason;
+    }
+
+    RepetitionStopReason RepetitionScheduler::add_run(const StageLatencyHistograms &latencies)
+    {
+        std::array<double, WVB_LATENCY_STAGE_COUNT> stage_means_ns {};
+        for (size_t i = 0; i < stage_means_ns.size(); i++)
+        {
+            const auto &stage = latencies.stages[i];
+            stage_means_ns[i] = stage.empty() ? std::numeric_limits<double>::quiet_NaN() : stage.mean();
+        }
+        return add_run(stage_means_ns);
+    }
+
+    double RepetitionScheduler::max_half_width() const
+    {
+        double max_half_width = -1;
+        for (const auto &stage : m_stages)
+        {
+            if (stage.count != 0)
+            {
+                max_half_width = std::max(max_half_width, stage.confidence_half_width());
+            }
+        }
+        return max_half_width < 0 ? std::numeric_limits<double>::infinity() : max_half_width;
+    }
+
+    void RepetitionScheduler::export_csv(std::ofstream &file, const RepetitionScheduler &scheduler)
+    {
+        if (!file.is_open())
+        {
+            LOGE("File not open\n");
+            return;
+        }
+
+        file << "stage,nb_runs,mean,stddev,ci_half_width,target_ci_half_width,stop_reason\n";
+        for (size_t i = 0; i < scheduler.m_stages.size(); i++)
+        {
+            const auto &stage = scheduler.m_stages[i];
+            // Infinite widths are written as -1, so that the column stays numerical
+            const double half_width = stage.count < 2 ? -1 : stage.confidence_half_width();
+            file << to_string(static_cast<LatencyStage>(i)) << ',' << stage.count << ',' << std::llround(stage.mean) << ','
+                 << std::llround(std::sqrt(stage.variance())) << ',' << std::llround(half_width) << ','
+                 << std::llround(scheduler.m_target_half_width) << ',' << to_string(scheduler.m_stop_reason) << '\n';
+        }
+    }
+
+    void RepetitionScheduler::export_columns(ColumnarFileWriter        &file,
+                                             const std::string         &table_name,
+                                             const RepetitionScheduler &scheduler)
+    {
+        std::vector<std::string> stages;
+        std::vector<uint32_t>    nb_runs;
+        std::vector<int64_t>     means;
+        std::vector<int64_t>     stddevs;
+        std::vector<int64_t>     half_widths;
+        std::vector<int64_t>     targets;
+        std::vector<std::string> stop_reasons;
+        for (size_t i = 0; i < scheduler.m_stages.size(); i++)
+        {
+            const auto &stage = scheduler.m_stages[i];
+            stages.push_back(to_string(static_cast<LatencyStage>(i)));
+            nb_runs.push_back(stage.count);
+            means.push_back(std::llround(stage.mean));
+            stddevs.push_back(std::llround(std::sqrt(stage.variance())));
+            half_widths.push_back(stage.count < 2 ? -1 : std::llround(stage.confidence_half_width()));
+            targets.push_back(std::llround(scheduler.m_target_half_width));
+            stop_reasons.push_back(to_string(scheduler.m_stop_reason));
+        }
+
+        file.begin_table(table_name, 7, static_cast<uint32_t>(stages.size()));
+        file.write_column("stage", stages);
+        file.write_column("nb_runs", nb_runs);
+        file.write_column("mean", means);
+        file.write_column("stddev", stddevs);
+        file.write_column("ci_half_width", half_widths);
+        file.write_column("target_ci_half_width", targets);
+        file.write_column("stop_reason", stop_reasons);
+    }
+} // namespace wvb
@@ -6,7 +6,9 @@
 #include <chrono>
 #include <deque>
 #include <fcntl.h>
+#include <ifaddrs.h>
 #include <iostream>
+#include <net/if.h>
 #include <netinet/in.h>
 #include <stdexcept>
 #include <sys/socket.h>
@@ -363,6 +365,37 @@ namespace wvb
         std::cerr << "Failed to send message: timeout\n";
     }
 
+    bool TCPSocket::try_send(const uint8_t *data, size_t size, size_t *sent_size) const
+    {
+        *sent_size = 0;
+
+        // Socket must be connected
+        if (m_data->state != TCPSocketState::CONNECTED)
+        {
+            return false;
+        }
+
+        auto res = ::send(m_data->socket, reinterpret_cast<const char *>(data), static_cast<int>(size), 0);
+        if (res == SOCKET_ERROR)
+        {
+            const auto err = errno;
+            if (err != EWOULDBLOCK && err != EAGAIN)
+            {
+                // Connection closed
+                close();
+            }
+            return false;
+        }
+
+        *sent_size = static_cast<size_t>(res);
+        if (m_data->measurements_bucket && res > 0)
+        {
+            m_data->measurements_bucket->add_bytes_sent(m_data->measurement_storage_id, res);
+            m_data->measurements_bucket->add_packets_sent(m_data->measurement_storage_id, 1);
+        }
+        return res > 0;
+    }
+
     bool TCPSocket::receive(uint8_t *data, size_t size, size_t *actual_size) const
     {
         // Socket must be connected
@@ -419,6 +452,15 @@ namespace wvb
         return m_data->peer_addr;
     }
 
+    NativeSocketHandle TCPSocket::native_handle() const
+    {
+        if (m_data == nullptr)
+        {
+            return INVALID_NATIVE_SOCKET_HANDLE;
+        }
+        return static_cast<NativeSocketHandle>(m_data->socket);
+    }
+
     // ========================================================================================
     // =                               UDP Socket implementation                              =
     // ========================================================================================
@@ -616,6 +658,49 @@ namespace wvb
         return m_data->local_addr;
     }
 
+    NativeSocketHandle UDPSocket::native_handle() const
+    {
+        if (m_data == nullptr)
+        {
+            return INVALID_NATIVE_SOCKET_HANDLE;
+        }
+        return static_cast<NativeSocketHandle>(m_data->socket);
+    }
+
+    // ========================================================================================
+    // =                                 Other helpers                                        =
+    // ========================================================================================
+
+    std::vector<InetAddr> get_broadcast_addresses()
+    {
+        ifaddrs *interfaces = nullptr;
+        if (getifaddrs(&interfaces) != 0)
+        {
+            throw std::runtime_error("Failed to get network interfaces");
+        }
+
+        std::vector<InetAddr> broadcast_addrs;
+        for (const ifaddrs *interface = interfaces; interface != nullptr; interface = interface->ifa_next)
+        {
+            if (interface->ifa_addr == nullptr || interface->ifa_addr->sa_family != AF_INET || (interface->ifa_flags & IFF_UP) == 0)
+            {
+                continue;
+            }
+
+            if ((interface->ifa_flags & IFF_LOOPBACK) != 0)
+            {
+                // Use loopback address for loopback (don't use .255)
+                broadcast_addrs.emplace_back(ntohl(reinterpret_cast<const sockaddr_in *>(interface->ifa_addr)->sin_addr.s_addr));
+            }
+            else if ((interface->ifa_flags & IFF_BROADCAST) != 0 && interface->ifa_broadaddr != nullptr)
+            {
+                broadcast_addrs.emplace_back(ntohl(reinterpret_cast<const sockaddr_in *>(interface->ifa_broadaddr)->sin_addr.s_addr));
+            }
+        }
+
+        freeifaddrs(interfaces);
+        return broadcast_addrs;
+    }
 } // namespace wvb
 
 #endif
\ No newline at end of file
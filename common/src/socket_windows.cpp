@@ -384,6 +384,41 @@ namespace wvb
         std::cerr << "Failed to send message: timeout\n";
     }
 
+    bool TCPSocket::try_send(const uint8_t *data, size_t size, size_t *sent_size) const
+    {
+        *sent_size = 0;
+
+        // Socket must be connected
+        if (m_data->state != TCPSocketState::CONNECTED)
+        {
+            return false;
+        }
+
+        auto res = ::send(m_data->socket, reinterpret_cast<const char *>(data), static_cast<int>(size), 0);
+        if (res == 0)
+        {
+            close();
+            return false;
+        }
+        if (res == SOCKET_ERROR)
+        {
+            // If socket closed
+            if (WSAGetLastError() != WSAEWOULDBLOCK)
+            {
+                close();
+            }
+            return false;
+        }
+
+        *sent_size = static_cast<size_t>(res);
+        if (m_data->measurements_bucket)
+        {
+            m_data->measurements_bucket->add_bytes_sent(m_data->measurement_storage_id, res);
+            m_data->measurements_bucket->add_packets_sent(m_data->measurement_storage_id, 1);
+        }
+        return true;
+    }
+
     bool TCPSocket::receive(uint8_t *data, size_t size, size_t *actual_size) const
     {
         // Socket must be connected
@@ -449,6 +484,15 @@ namespace wvb
         return m_data->peer_addr;
     }
 
+    NativeSocketHandle TCPSocket::native_handle() const
+    {
+        if (m_data == nullptr)
+        {
+            return INVALID_NATIVE_SOCKET_HANDLE;
+        }
+        return static_cast<NativeSocketHandle>(m_data->socket);
+    }
+
     // ========================================================================================
     // =                               UDP Socket implementation                              =
     // ========================================================================================
@@ -645,6 +689,15 @@ namespace wvb
         return m_data->local_addr;
     }
 
+    NativeSocketHandle UDPSocket::native_handle() const
+    {
+        if (m_data == nullptr)
+        {
+            return INVALID_NATIVE_SOCKET_HANDLE;
+        }
+        return static_cast<NativeSocketHandle>(m_data->socket);
+    }
+
     // ========================================================================================
     // =                                 Other helpers                                        =
     // ========================================================================================
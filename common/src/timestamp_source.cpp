@@ -0,0 +1,297 @@
+#include "wvb_common/timestamp_source.h"
+
+#include "wvb_common/ipc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__))
+#define WVB_TSC_SUPPORTED
+#include <cpuid.h>
+#include <time.h>
+#include <x86intrin.h>
+#endif
+
+// Number of times the clocks are read around the TSC in a calibration sample. The fastest read is kept.
+#define TSC_SAMPLE_ATTEMPTS 5
+// Bit of CPUID 0x80000007 EDX telling that the TSC runs at a constant rate in all power states
+#define CPUID_INVARIANT_TSC_BIT (1u << 8)
+
+namespace wvb::rtp
+{
+    std::string to_string(TimestampSourceType type)
+    {
+        switch (type)
+        {
+            case TimestampSourceType::MONOTONIC: return "MONOTONIC";
+            case TimestampSourceType::TSC: return "TSC";
+            default: return "INVALID";
+        }
+    }
+
+    // =======================================================================================
+    // =                                   TimestampSource                                   =
+    // =======================================================================================
+
+    std::shared_ptr<TimestampSource> TimestampSource::monotonic()
+    {
+        static const auto source = std::make_shared<MonotonicTimestampSource>();
+        return source;
+    }
+
+    std::shared_ptr<TimestampSource> TimestampSource::tsc()
+    {
+        static const auto source = TSCTimestampSource::is_supported() ? std::make_shared<TSCTimestampSource>() : nullptr;
+        return source;
+    }
+
+    std::shared_ptr<TimestampSource> TimestampSource::best()
+    {
+        auto source = tsc();
+        return source != nullptr ? source : monotonic();
+    }
+
+    // =======================================================================================
+    // =                                 TSCTimestampSource                                  =
+    // =======================================================================================
+
+    /** Conversion of the TSC to CLOCK_MONOTONIC nanoseconds: ns = base_ns + (tsc - base_tsc) * mult >> 32. */
+    struct TSCCalibration
+    {
+        uint64_t base_tsc = 0;
+        int64_t  base_ns  = 0;
+        /** Nanoseconds per TSC tick, in 32.32 fixed point. */
+        uint64_t mult = 0;
+        /** The calibration is renewed by the first reader that gets past this TSC value. */
+        uint64_t deadline_tsc = 0;
+
+        [[nodiscard]] inline int64_t to_ns(uint64_t tsc) const
+        {
+            // The TSC may have been read just before a recalibration
+            if (tsc >= base_tsc)
+            {
+                return base_ns + static_cast<int64_t>(mul_shift_32(tsc - base_tsc, mult));
+            }
+            return base_ns - static_cast<int64_t>(mul_shift_32(base_tsc - tsc, mult));
+        }
+    };
+
+    /** Readings of the clocks at the same time. */
+    struct TSCSample
+    {
+        uint64_t raw_tsc = 0;
+        int64_t  raw_ns  = 0;
+        uint64_t tsc     = 0;
+        int64_t  ns      = 0;
+    };
+
+    struct TSCTimestampSource::Data
+    {
+        SeqLock<TSCCalibration> calibration;
+        uint64_t                interval_tsc = 0;
+
+        /** Set while a thread is recalibrating. The state below is only used by that thread. */
+        std::atomic_flag recalibrating;
+        TSCSample        first_sample;
+        TSCSample        last_sample;
+        /** Rate of CLOCK_MONOTONIC relative to CLOCK_MONOTONIC_RAW, currently set by NTP. */
+        double ntp_rate = 1;
+        /** Nanoseconds of CLOCK_MONOTONIC_RAW per TSC tick. */
+        std::atomic<double> raw_ns_per_tick {0};
+
+        /** Per-thread last returned time, so that the time never goes back for a thread while a recalibration is published. */
+        struct LastTime
+        {
+            const Data *source = nullptr;
+            int64_t     ns     = 0;
+        };
+
+        static inline uint64_t read_tsc()
+        {
+#ifdef WVB_TSC_SUPPORTED
+            return __rdtsc();
+#else
+            return 0;
+#endif
+        }
+
+        static inline int64_t read_clock_ns([[maybe_unused]] int clock_id)
+        {
+#ifdef WVB_TSC_SUPPORTED
+            timespec ts {};
+            clock_gettime(clock_id, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+            return 0;
+#endif
+        }
+
+        /** Reads CLOCK_MONOTONIC_RAW and CLOCK_MONOTONIC between TSC reads. The TSC value of each clock is the middle of its reads. */
+        static TSCSample sample()
+        {
+#ifdef WVB_TSC_SUPPORTED
+            TSCSample best;
+            uint64_t  best_duration = UINT64_MAX;
+            for (uint32_t attempt = 0; attempt < TSC_SAMPLE_ATTEMPTS; attempt++)
+            {
+                const uint64_t tsc_0  = read_tsc();
+                const int64_t  raw_ns = read_clock_ns(CLOCK_MONOTONIC_RAW);
+                const uint64_t tsc_1  = read_tsc();
+                const int64_t  ns     = read_clock_ns(CLOCK_MONOTONIC);
+                const uint64_t tsc_2  = read_tsc();
+
+                if (tsc_2 - tsc_0 < best_duration)
+                {
+                    best_duration = tsc_2 - tsc_0;
+                    best          = {
+                                 .raw_tsc = tsc_0 + (tsc_1 - tsc_0) / 2,
+                                 .raw_ns  = raw_ns,
+                                 .tsc     = tsc_1 + (tsc_2 - tsc_1) / 2,
+                                 .ns      = ns,
+                    };
+                }
+            }
+            return best;
+#else
+            return {};
+#endif
+        }
+
+        void recalibrate(const TSCSample &current)
+        {
+            TSCCalibration previous;
+            calibration.load(previous);
+
+            // Frequency of the TSC, measured over the longest possible time for precision. Neither clock is adjusted.
+            const double raw_ns_per_tick = static_cast<double>(current.raw_ns - first_sample.raw_ns)
+                                         / static_cast<double>(current.raw_tsc - first_sample.raw_tsc);
+            // The NTP rate is only measured over full intervals, since the clocks are read with a jitter that is too large
+            // over the short ones of forced recalibrations
+            const int64_t raw_elapsed_ns = current.raw_ns - last_sample.raw_ns;
+            if (raw_elapsed_ns >= WVB_TSC_RECALIBRATION_INTERVAL_MS * 1000000LL / 2)
+            {
+                ntp_rate    = static_cast<double>(current.ns - last_sample.ns) / static_cast<double>(raw_elapsed_ns);
+                last_sample = current;
+            }
+
+            // Start where the previous calibration ends. Past its deadline, times were only returned while this recalibration
+            // was running, so the rate correction that kept going since the deadline can be dropped.
+            const int64_t mapped_ns   = previous.to_ns(current.tsc);
+            const int64_t deadline_ns = previous.to_ns(std::min(current.tsc, previous.deadline_tsc));
+            int64_t       base_ns     = std::max(deadline_ns, std::min(mapped_ns, current.ns));
+            if (current.ns - base_ns > WVB_TSC_MAX_STEERED_ERROR_US * 1000)
+            {
+                // Too late to catch up progressively. Jumping forward keeps the time monotonic.
+                base_ns = current.ns;
+            }
+
+            // Absorb the remaining error over the next interval
+            const double interval_ns = raw_ns_per_tick * ntp_rate * static_cast<double>(interval_tsc);
+            const double steering    = std::clamp(static_cast<double>(current.ns - base_ns) / interval_ns,
+                                                  -WVB_TSC_MAX_STEERING_PPM * 1e-6,
+                                                  WVB_TSC_MAX_STEERING_PPM * 1e-6);
+            const double ns_per_tick = raw_ns_per_tick * ntp_rate * (1 + steering);
+
+            calibration.store({
+                .base_tsc     = current.tsc,
+                .base_ns      = base_ns,
+                .mult         = static_cast<uint64_t>(std::llround(ns_per_tick * 4294967296.0)),
+                .deadline_tsc = current.tsc + interval_tsc,
+            });
+            this->raw_ns_per_tick.store(raw_ns_per_tick, std::memory_order_relaxed);
+        }
+
+        /** Recalibrates, unless another thread is already doing it. */
+        void try_recalibrate()
+        {
+            if (recalibrating.test_and_set(std::memory_order_acquire))
+            {
+                return;
+            }
+            recalibrate(sample());
+            recalibrating.clear(std::memory_order_release);
+        }
+    };
+
+    TSCTimestampSource::TSCTimestampSource()
+    {
+        if (!is_supported())
+        {
+            throw std::runtime_error("TSCTimestampSource: the CPU doesn't have an invariant TSC");
+        }
+        m_data = new Data;
+
+        // Measure the frequency over a short period, to have a first estimation
+        const TSCSample first    = Data::sample();
+        const auto      deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(WVB_TSC_INITIAL_CALIBRATION_MS);
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+        }
+        const TSCSample second = Data::sample();
+
+        const double raw_ns_per_tick =
+            static_cast<double>(second.raw_ns - first.raw_ns) / static_cast<double>(second.raw_tsc - first.raw_tsc);
+        m_data->interval_tsc = static_cast<uint64_t>(WVB_TSC_RECALIBRATION_INTERVAL_MS * 1e6 / raw_ns_per_tick);
+        m_data->first_sample = first;
+        m_data->last_sample  = second;
+        m_data->raw_ns_per_tick.store(raw_ns_per_tick, std::memory_order_relaxed);
+        m_data->calibration.store({
+            .base_tsc     = second.tsc,
+            .base_ns      = second.ns,
+            .mult         = static_cast<uint64_t>(std::llround(raw_ns_per_tick * 4294967296.0)),
+            .deadline_tsc = second.tsc + m_data->interval_tsc,
+        });
+    }
+
+    DEFAULT_PIMPL_DESTRUCTOR(TSCTimestampSource);
+
+    bool TSCTimestampSource::is_supported()
+    {
+#ifdef WVB_TSC_SUPPORTED
+        unsigned int eax = 0;
+        unsigned int ebx = 0;
+        unsigned int ecx = 0;
+        unsigned int edx = 0;
+        if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0)
+        {
+            return false;
+        }
+        return (edx & CPUID_INVARIANT_TSC_BIT) != 0;
+#else
+        return false;
+#endif
+    }
+
+    std::chrono::steady_clock::time_point TSCTimestampSource::now() const noexcept
+    {
+        const uint64_t tsc = Data::read_tsc();
+
+        TSCCalibration calibration;
+        if (!m_data->calibration.load(calibration))
+        {
+            return std::chrono::steady_clock::now();
+        }
+        if (tsc >= calibration.deadline_tsc)
+        {
+            m_data->try_recalibrate();
+            m_data->calibration.load(calibration);
+        }
+
+        int64_t                            ns = calibration.to_ns(tsc);
+        static thread_local Data::LastTime last_time;
+        if (last_time.source == m_data)
+        {
+            ns = std::max(ns, last_time.ns);
+        }
+        last_time = {.source = m_data, .ns = ns};
+
+        return std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns)));
+    }
+
+    void TSCTimestampSource::recalibrate() const { m_data->try_recalibrate(); }
+
+    double TSCTimestampSource::frequency_hz() const { return 1e9 / m_data->raw_ns_per_tick.load(std::memory_order_relaxed); }
+} // namespace wvb::rtp
@@ -137,11 +137,20 @@ namespace wvb
                                         bool           end_of_stream,
                                         uint32_t       rtp_timestamp,
                                         uint32_t       rtp_pose_timestamp,
+                                        const Pose    &rendered_pose,
                                         bool           save_frame,
                                         bool           last,
                                         uint32_t       timeout_us)
     {
-        m_packetizer->add_frame_data(data, size, frame_index, end_of_stream, rtp_timestamp, rtp_pose_timestamp, save_frame, last);
+        m_packetizer->add_frame_data(data,
+                                     size,
+                                     frame_index,
+                                     end_of_stream,
+                                     rtp_timestamp,
+                                     rtp_pose_timestamp,
+                                     rendered_pose,
+                                     save_frame,
+                                     last);
 
         send_all_generated_packets(timeout_us);
     }
@@ -179,6 +188,7 @@ namespace wvb
                                            bool *__restrict out_end_of_stream,
                                            uint32_t *__restrict out_rtp_timestamp,
                                            uint32_t *__restrict out_rtp_pose_timestamp,
+                                           Pose *__restrict out_rendered_pose,
                                            std::chrono::steady_clock::time_point *out_last_packet_received_timestamp,
                                            bool *__restrict out_save_frame)
     {
@@ -194,6 +204,7 @@ namespace wvb
                                                   out_end_of_stream,
                                                   out_rtp_timestamp,
                                                   out_rtp_pose_timestamp,
+                                                  out_rendered_pose,
                                                   out_last_packet_received_timestamp,
                                                   out_save_frame);
     }
@@ -1,6 +1,18 @@
 #include "wvb_common/vrcp.h"
 
 #include <wvb_common/network_utils.h>
+#include <wvb_common/pose_prediction.h>
+
+#include <algorithm>
+#include <cmath>
+
+#define SMALLEST_THREE_BITS  20
+#define SMALLEST_THREE_MAX   ((1 << (SMALLEST_THREE_BITS - 1)) - 1)
+#define ROTATION_DELTA_BITS  10
+#define ROTATION_DELTA_MAX   ((1 << (ROTATION_DELTA_BITS - 1)) - 1)
+#define ROTATION_DELTA_MASK  ((1u << ROTATION_DELTA_BITS) - 1)
+#define ROTATION_DELTA_VALID (1u << 31)
+#define INV_SQRT_2           0.70710678118654752440
 
 namespace wvb::vrcp
 {
@@ -44,40 +56,283 @@ namespace wvb::vrcp
         state.fov_right.right    = ntohf(right_eye_fov_right);
         state.fov_right.up       = ntohf(right_eye_fov_up);
         state.fov_right.down     = ntohf(right_eye_fov_down);
+        state.nb_past_poses      = 0;
+    }
+
+    // --- Quantization ---
+
+    /** Maps a value in [-range, range] to an unsigned integer of the given number of bits, where 0 is exactly representable. */
+    uint32_t quantize_signed(double value, double range, int32_t max)
+    {
+        const auto scaled = static_cast<int32_t>(std::lround(std::clamp(value / range, -1.0, 1.0) * max));
+        return static_cast<uint32_t>(scaled + max + 1);
+    }
+
+    double dequantize_signed(uint32_t value, double range, int32_t max)
+    {
+        return static_cast<double>(static_cast<int32_t>(value) - max - 1) / max * range;
+    }
+
+    int32_t encode_position(float position)
+    {
+        return static_cast<int32_t>(htonl(static_cast<uint32_t>(std::lround(position * VRCP_POSITION_UNITS_PER_METER))));
+    }
+
+    float decode_position(int32_t encoded)
+    {
+        return static_cast<float>(static_cast<int32_t>(ntohl(static_cast<uint32_t>(encoded)))) / VRCP_POSITION_UNITS_PER_METER;
+    }
+
+    uint64_t encode_smallest_three(const Quaternion &q)
+    {
+        const float components[4] = {q.x, q.y, q.z, q.w};
+
+        // Drop the largest component, it can be recomputed from the others since the quaternion is normalized
+        uint32_t largest = 0;
+        for (uint32_t i = 1; i < 4; i++)
+        {
+            if (std::abs(components[i]) > std::abs(components[largest]))
+            {
+                largest = i;
+            }
+        }
+        // q and -q are the same orientation: make the largest one positive so that its sign doesn't need to be sent
+        const double sign = components[largest] < 0 ? -1.0 : 1.0;
+
+        uint64_t encoded = static_cast<uint64_t>(largest) << (3 * SMALLEST_THREE_BITS);
+        uint32_t shift   = 2 * SMALLEST_THREE_BITS;
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            if (i != largest)
+            {
+                const auto value = quantize_signed(sign * components[i], INV_SQRT_2, SMALLEST_THREE_MAX);
+                encoded |= static_cast<uint64_t>(value) << shift;
+                shift -= SMALLEST_THREE_BITS;
+            }
+        }
+        return encoded;
+    }
+
+    Quaternion decode_smallest_three(uint64_t encoded)
+    {
+        const auto largest = static_cast<uint32_t>(encoded >> (3 * SMALLEST_THREE_BITS)) & 0b11;
+
+        double   components[4] = {0, 0, 0, 0};
+        double   sum_squares   = 0;
+        uint32_t shift         = 2 * SMALLEST_THREE_BITS;
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            if (i != largest)
+            {
+                const auto value = static_cast<uint32_t>(encoded >> shift) & ((1u << SMALLEST_THREE_BITS) - 1);
+                components[i]    = dequantize_signed(value, INV_SQRT_2, SMALLEST_THREE_MAX);
+                sum_squares += components[i] * components[i];
+                shift -= SMALLEST_THREE_BITS;
+            }
+        }
+        components[largest] = std::sqrt(std::max(0.0, 1.0 - sum_squares));
+
+        return quaternion_normalize({
+            static_cast<float>(components[0]),
+            static_cast<float>(components[1]),
+            static_cast<float>(components[2]),
+            static_cast<float>(components[3]),
+        });
+    }
+
+    float decode_past_position_delta(int16_t encoded)
+    {
+        return static_cast<float>(static_cast<int16_t>(ntohs(static_cast<uint16_t>(encoded)))) / VRCP_PAST_POSITION_UNITS_PER_METER;
+    }
+
+    uint32_t encode_rotation_component(float value, uint32_t shift)
+    {
+        return quantize_signed(value, VRCP_PAST_ROTATION_RANGE, ROTATION_DELTA_MAX) << shift;
+    }
+
+    double decode_rotation_component(uint32_t rotation_delta, uint32_t shift)
+    {
+        return dequantize_signed((rotation_delta >> shift) & ROTATION_DELTA_MASK, VRCP_PAST_ROTATION_RANGE, ROTATION_DELTA_MAX);
+    }
+
+    /** Encodes the past pose relative to the latest one. If it is too far from it, it is marked as invalid. */
+    VRCPPastPose encode_past_pose(const TrackingState &state, const PastPose &past_pose)
+    {
+        const uint32_t timestamp_delta = state.pose_timestamp - past_pose.pose_timestamp;
+        if (timestamp_delta == 0 || timestamp_delta > UINT16_MAX)
+        {
+            return {};
+        }
+
+        VRCPPastPose encoded {.timestamp_delta = htons(static_cast<uint16_t>(timestamp_delta))};
+
+        const float position_delta[3] = {
+            past_pose.pose.position.x - state.pose.position.x,
+            past_pose.pose.position.y - state.pose.position.y,
+            past_pose.pose.position.z - state.pose.position.z,
+        };
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            const auto value = std::lround(position_delta[i] * VRCP_PAST_POSITION_UNITS_PER_METER);
+            if (value < INT16_MIN || value > INT16_MAX)
+            {
+                return {};
+            }
+            encoded.position_delta[i] = static_cast<int16_t>(htons(static_cast<uint16_t>(value)));
+        }
+
+        // Rotation such that past = delta * latest. It is small, so w is the largest component: only the vector part is sent.
+        const auto inverse_latest = quaternion_conjugate(state.pose.orientation);
+        auto       delta          = quaternion_normalize(quaternion_multiply(past_pose.pose.orientation, inverse_latest));
+        if (delta.w < 0)
+        {
+            delta = {-delta.x, -delta.y, -delta.z, -delta.w};
+        }
+        if (std::abs(delta.x) > VRCP_PAST_ROTATION_RANGE || std::abs(delta.y) > VRCP_PAST_ROTATION_RANGE
+            || std::abs(delta.z) > VRCP_PAST_ROTATION_RANGE)
+        {
+            return {};
+        }
+
+        const uint32_t rotation_delta = ROTATION_DELTA_VALID | encode_rotation_component(delta.x, 2 * ROTATION_DELTA_BITS)
+                                        | encode_rotation_component(delta.y, ROTATION_DELTA_BITS)
+                                        | encode_rotation_component(delta.z, 0);
+        encoded.rotation_delta = htonl(rotation_delta);
+
+        return encoded;
+    }
+
+    /** Decodes the past pose. Returns false if it is invalid. */
+    bool decode_past_pose(const TrackingState &state, const VRCPPastPose &encoded, PastPose &past_pose)
+    {
+        const auto timestamp_delta = ntohs(encoded.timestamp_delta);
+        const auto rotation_delta  = ntohl(encoded.rotation_delta);
+        if (timestamp_delta == 0 || (rotation_delta & ROTATION_DELTA_VALID) == 0)
+        {
+            return false;
+        }
+
+        past_pose.pose_timestamp = state.pose_timestamp - timestamp_delta;
+
+        past_pose.pose.position = {
+            state.pose.position.x + decode_past_position_delta(encoded.position_delta[0]),
+            state.pose.position.y + decode_past_position_delta(encoded.position_delta[1]),
+            state.pose.position.z + decode_past_position_delta(encoded.position_delta[2]),
+        };
+
+        const double x = decode_rotation_component(rotation_delta, 2 * ROTATION_DELTA_BITS);
+        const double y = decode_rotation_component(rotation_delta, ROTATION_DELTA_BITS);
+        const double z = decode_rotation_component(rotation_delta, 0);
+
+        const Quaternion delta {
+            static_cast<float>(x),
+            static_cast<float>(y),
+            static_cast<float>(z),
+            static_cast<float>(std::sqrt(std::max(0.0, 1.0 - x * x - y * y - z * z))),
+        };
+        past_pose.pose.orientation = quaternion_normalize(quaternion_multiply(delta, state.pose.orientation));
+
+        return true;
+    }
+
+    // --- Compact tracking ---
+
+    VRCPCompactTrackingData::VRCPCompactTrackingData(const TrackingState &state)
+        : sample_timestamp(htonl(state.sample_timestamp)),
+          pose_timestamp(htonl(state.pose_timestamp))
+    {
+        const auto encoded_orientation = encode_smallest_three(state.pose.orientation);
+        orientation[0]                 = htonl(static_cast<uint32_t>(encoded_orientation >> 32));
+        orientation[1]                 = htonl(static_cast<uint32_t>(encoded_orientation));
+
+        position[0] = encode_position(state.pose.position.x);
+        position[1] = encode_position(state.pose.position.y);
+        position[2] = encode_position(state.pose.position.z);
+
+        nb_past_poses = static_cast<uint8_t>(std::min(state.nb_past_poses, static_cast<uint32_t>(WVB_TRACKING_PAST_POSES_CAPACITY)));
+        for (uint32_t i = 0; i < nb_past_poses; i++)
+        {
+            past_poses[i] = encode_past_pose(state, state.past_poses[i]);
+        }
+    }
+
+    void VRCPCompactTrackingData::to_tracking_state(TrackingState &state) const
+    {
+        state.sample_timestamp = ntohl(sample_timestamp);
+        state.pose_timestamp   = ntohl(pose_timestamp);
+
+        const uint64_t encoded_orientation = static_cast<uint64_t>(ntohl(orientation[0])) << 32 | ntohl(orientation[1]);
+        state.pose.orientation             = decode_smallest_three(encoded_orientation);
+
+        state.pose.position = {decode_position(position[0]), decode_position(position[1]), decode_position(position[2])};
+
+        // Invalid past poses are skipped
+        state.nb_past_poses = 0;
+        for (uint32_t i = 0; i < std::min(nb_past_poses, static_cast<uint8_t>(WVB_TRACKING_PAST_POSES_CAPACITY)); i++)
+        {
+            if (decode_past_pose(state, past_poses[i], state.past_poses[state.nb_past_poses]))
+            {
+                state.nb_past_poses++;
+            }
+        }
+    }
+
+    VRCPFovData::VRCPFovData(const Fov &fov_left, const Fov &fov_right)
+        : left_eye_fov_left(htonf(fov_left.left)),
+          left_eye_fov_right(htonf(fov_left.right)),
+          left_eye_fov_up(htonf(fov_left.up)),
+          left_eye_fov_down(htonf(fov_left.down)),
+          right_eye_fov_left(htonf(fov_right.left)),
+          right_eye_fov_right(htonf(fov_right.right)),
+          right_eye_fov_up(htonf(fov_right.up)),
+          right_eye_fov_down(htonf(fov_right.down))
+    {
+    }
+
+    void VRCPFovData::to_tracking_state(TrackingState &state) const
+    {
+        state.fov_left.left   = ntohf(left_eye_fov_left);
+        state.fov_left.right  = ntohf(left_eye_fov_right);
+        state.fov_left.up     = ntohf(left_eye_fov_up);
+        state.fov_left.down   = ntohf(left_eye_fov_down);
+        state.fov_right.left  = ntohf(right_eye_fov_left);
+        state.fov_right.right = ntohf(right_eye_fov_right);
+        state.fov_right.up    = ntohf(right_eye_fov_up);
+        state.fov_right.down  = ntohf(right_eye_fov_down);
     }
 
     VRCPFrameTimeMeasurement::VRCPFrameTimeMeasurement(const ClientFrameTimeMeasurements &frame_time)
         : frame_index(htonl(frame_time.frame_index)),
           frame_id(htonl(frame_time.frame_id)),
           frame_delay(htonl(frame_time.frame_delay)),
-          tracking_timestamp(htonl(frame_time.tracking_timestamp)),
-          last_packet_received_timestamp(htonl(frame_time.last_packet_received_timestamp)),
-          pushed_to_decoder_timestamp(htonl(frame_time.pushed_to_decoder_timestamp)),
-          begin_wait_frame_timestamp(htonl(frame_time.begin_wait_frame_timestamp)),
-          begin_frame_timestamp(htonl(frame_time.begin_frame_timestamp)),
-          after_wait_swapchain_timestamp(htonl(frame_time.after_wait_swapchain_timestamp)),
-          after_render_timestamp(htonl(frame_time.after_render_timestamp)),
-          end_frame_timestamp(htonl(frame_time.end_frame_timestamp)),
-          predicted_present_timestamp(htonl(frame_time.predicted_present_timestamp)),
-          pose_timestamp(htonl(frame_time.pose_timestamp))
+          pose_timestamp(htonl(frame_time.pose_timestamp)),
+          tracking_ns(htonll(frame_time.tracking_ns)),
+          last_packet_received_ns(htonll(frame_time.last_packet_received_ns)),
+          pushed_to_decoder_ns(htonll(frame_time.pushed_to_decoder_ns)),
+          begin_wait_frame_ns(htonll(frame_time.begin_wait_frame_ns)),
+          begin_frame_ns(htonll(frame_time.begin_frame_ns)),
+          after_wait_swapchain_ns(htonll(frame_time.after_wait_swapchain_ns)),
+          after_render_ns(htonll(frame_time.after_render_ns)),
+          end_frame_ns(htonll(frame_time.end_frame_ns)),
+          predicted_present_ns(htonll(frame_time.predicted_present_ns))
     {
     }
 
     void VRCPFrameTimeMeasurement::to_frame_time_measurements(ClientFrameTimeMeasurements &frame_time) const
     {
-        frame_time.frame_index                    = ntohl(frame_index);
-        frame_time.frame_id                       = ntohl(frame_id);
-        frame_time.frame_delay                    = ntohl(frame_delay);
-        frame_time.tracking_timestamp             = ntohl(tracking_timestamp);
-        frame_time.last_packet_received_timestamp = ntohl(last_packet_received_timestamp);
-        frame_time.pushed_to_decoder_timestamp    = ntohl(pushed_to_decoder_timestamp);
-        frame_time.begin_wait_frame_timestamp     = ntohl(begin_wait_frame_timestamp);
-        frame_time.begin_frame_timestamp          = ntohl(begin_frame_timestamp);
-        frame_time.after_wait_swapchain_timestamp = ntohl(after_wait_swapchain_timestamp);
-        frame_time.after_render_timestamp         = ntohl(after_render_timestamp);
-        frame_time.end_frame_timestamp            = ntohl(end_frame_timestamp);
-        frame_time.predicted_present_timestamp    = ntohl(predicted_present_timestamp);
-        frame_time.pose_timestamp                 = ntohl(pose_timestamp);
+        frame_time.frame_index             = ntohl(frame_index);
+        frame_time.frame_id                = ntohl(frame_id);
+        frame_time.frame_delay             = ntohl(frame_delay);
+        frame_time.pose_timestamp          = ntohl(pose_timestamp);
+        frame_time.tracking_ns             = static_cast<int64_t>(ntohll(tracking_ns));
+        frame_time.last_packet_received_ns = static_cast<int64_t>(ntohll(last_packet_received_ns));
+        frame_time.pushed_to_decoder_ns    = static_cast<int64_t>(ntohll(pushed_to_decoder_ns));
+        frame_time.begin_wait_frame_ns     = static_cast<int64_t>(ntohll(begin_wait_frame_ns));
+        frame_time.begin_frame_ns          = static_cast<int64_t>(ntohll(begin_frame_ns));
+        frame_time.after_wait_swapchain_ns = static_cast<int64_t>(ntohll(after_wait_swapchain_ns));
+        frame_time.after_render_ns         = static_cast<int64_t>(ntohll(after_render_ns));
+        frame_time.end_frame_ns            = static_cast<int64_t>(ntohll(end_frame_ns));
+        frame_time.predicted_present_ns    = static_cast<int64_t>(ntohll(predicted_present_ns));
     }
 
     VRCPBenchmarkInfo::VRCPBenchmarkInfo(const MeasurementWindow &window, const rtp::RTPClock &clock)
@@ -116,21 +371,23 @@ namespace wvb::vrcp
 
     VRCPTrackingTimeMeasurement::VRCPTrackingTimeMeasurement(const TrackingTimeMeasurements &tracking_time)
         : pose_timestamp(htonl(tracking_time.pose_timestamp)),
-          tracking_received_timestamp(htonl(tracking_time.tracking_received_timestamp)),
-          tracking_processed_timestamp(htonl(tracking_time.tracking_processed_timestamp))
+          tracking_received_ns(htonll(tracking_time.tracking_received_ns)),
+          tracking_processed_ns(htonll(tracking_time.tracking_processed_ns))
     {
     }
 
     void VRCPTrackingTimeMeasurement::to_tracking_time_measurements(TrackingTimeMeasurements &tracking_time) const
     {
-        tracking_time.pose_timestamp               = ntohl(pose_timestamp);
-        tracking_time.tracking_received_timestamp  = ntohl(tracking_received_timestamp);
-        tracking_time.tracking_processed_timestamp = ntohl(tracking_processed_timestamp);
+        tracking_time.pose_timestamp        = ntohl(pose_timestamp);
+        tracking_time.tracking_received_ns  = static_cast<int64_t>(ntohll(tracking_received_ns));
+        tracking_time.tracking_processed_ns = static_cast<int64_t>(ntohll(tracking_processed_ns));
     }
 
     VRCPNetworkMeasurement::VRCPNetworkMeasurement(const NetworkMeasurements &network_measurements)
         : rtt(htonl(network_measurements.rtt_us)),
-          clock_error(htonl(*reinterpret_cast<const uint32_t *>(&network_measurements.clock_error_us)))
+          clock_error(htonl(*reinterpret_cast<const uint32_t *>(&network_measurements.clock_error_us))),
+          drift_ppm(htonf(network_measurements.drift_ppm)),
+          residual(htonl(network_measurements.residual_us))
     {
     }
 
@@ -140,6 +397,9 @@ namespace wvb::vrcp
 
         uint32_t err                        = ntohl(clock_error);
         network_measurements.clock_error_us = *reinterpret_cast<const int32_t *>(&err);
+
+        network_measurements.drift_ppm   = ntohf(drift_ppm);
+        network_measurements.residual_us = ntohl(residual);
     }
 
     VRCPSocketMeasurement::VRCPSocketMeasurement(const SocketMeasurements &socket_measurement)
@@ -161,4 +421,22 @@ namespace wvb::vrcp
         socket_measurement.packets_sent     = ntohl(packets_sent);
         socket_measurement.packets_received = ntohl(packets_received);
     }
+
+    VRCPSendQueueMeasurement::VRCPSendQueueMeasurement(const SendQueueMeasurements &send_queue_measurement)
+        : priority(static_cast<uint8_t>(send_queue_measurement.priority)),
+          packets_sent(htonl(send_queue_measurement.packets_sent)),
+          bytes_sent(htonl(send_queue_measurement.bytes_sent)),
+          total_delay_us(htonll(send_queue_measurement.total_delay_us)),
+          max_delay_us(htonl(send_queue_measurement.max_delay_us))
+    {
+    }
+
+    void VRCPSendQueueMeasurement::to_send_queue_measurements(SendQueueMeasurements &send_queue_measurement) const
+    {
+        send_queue_measurement.priority       = static_cast<SendPriority>(priority);
+        send_queue_measurement.packets_sent   = ntohl(packets_sent);
+        send_queue_measurement.bytes_sent     = ntohl(bytes_sent);
+        send_queue_measurement.total_delay_us = ntohll(total_delay_us);
+        send_queue_measurement.max_delay_us   = ntohl(max_delay_us);
+    }
 } // namespace wvb::vrcp
\ No newline at end of file
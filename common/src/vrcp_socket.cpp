@@ -4,6 +4,12 @@
 #include <wvb_common/rtp_clock.h>
 #include <wvb_common/socket.h>
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <optional>
+
 #ifdef __linux__
 #include <cstring>
 #endif
@@ -21,6 +27,52 @@ namespace wvb
 #define ADVERTISEMENT_TIMEOUT_MARGIN_SEC 10000
     // The size of the reception buffer must be large enough to accommodate the largest allowed packet
 #define DEFAULT_RECEPTION_BUFFER_SIZE (UINT8_MAX * VRCP_ROW_SIZE * 4)
+    // Sent bytes are only removed from the front of a send queue once they represent more than this size,
+    // to avoid moving the rest of the buffer after each packet
+#define SEND_QUEUE_COMPACTION_THRESHOLD (64 * 1024)
+#define NO_PACKET_IN_FLIGHT             (-1)
+
+    struct VRCPQueuedPacket
+    {
+        size_t                                size = 0;
+        std::chrono::steady_clock::time_point queued_time;
+    };
+
+    /** FIFO of packets of a given priority class. The bytes of all packets are stored contiguously in the buffer,
+     * starting at the head index. */
+    struct VRCPSendQueue
+    {
+        std::vector<uint8_t>         buffer;
+        size_t                       head = 0;
+        std::deque<VRCPQueuedPacket> packets;
+
+        [[nodiscard]] inline bool empty() const { return packets.empty(); }
+
+        void clear()
+        {
+            buffer.clear();
+            packets.clear();
+            head = 0;
+        }
+
+        /** Remove the first packet after it was fully sent. */
+        void pop_front()
+        {
+            head += packets.front().size;
+            packets.pop_front();
+
+            if (packets.empty())
+            {
+                buffer.clear();
+                head = 0;
+            }
+            else if (head > SEND_QUEUE_COMPACTION_THRESHOLD && head > buffer.size() / 2)
+            {
+                buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(head));
+                head = 0;
+            }
+        }
+    };
 
     struct VRCPSocket::Data
     {
@@ -45,6 +97,27 @@ namespace wvb
         uint32_t                         last_advertisement_time = 0;
         std::vector<VRCPServerCandidate> server_candidates;
 
+        // Session establishment time. Starts at the first discover() or connect() call for a client, and when the TCP connection
+        // is accepted for a server.
+        std::optional<std::chrono::steady_clock::time_point> connect_start_time = std::nullopt;
+        std::chrono::nanoseconds                             time_to_connected {0};
+
+        void start_connect_timer()
+        {
+            if (!connect_start_time.has_value())
+            {
+                connect_start_time = std::chrono::steady_clock::now();
+            }
+        }
+
+        void stop_connect_timer()
+        {
+            if (connect_start_time.has_value())
+            {
+                time_to_connected = std::chrono::steady_clock::now() - connect_start_time.value();
+            }
+        }
+
         // Benchmarking
         std::shared_ptr<SocketMeasurementBucket> measurements_bucket = nullptr;
 
@@ -63,6 +136,45 @@ namespace wvb
         uint8_t  udp_reception_buffer[DEFAULT_RECEPTION_BUFFER_SIZE] = {0};
         uint16_t udp_head                                            = 0;
         uint16_t udp_tail                                            = 0;
+
+        // Send scheduler
+        // Reliable packets are queued by priority class. Each flush sends the head of the most urgent non-empty queue, one
+        // packet at a time, so that a control message is never stuck behind a large transfer.
+        // Since TCP is a stream, a packet that was partially sent must be finished before anything else.
+        std::mutex    send_mutex;
+        VRCPSendQueue send_queues[WVB_SEND_PRIORITY_COUNT];
+        int8_t        in_flight_priority = NO_PACKET_IN_FLIGHT;
+        size_t        in_flight_sent     = 0;
+        size_t        bulk_budget        = VRCP_DEFAULT_BULK_BUDGET_BYTES;
+
+        void clear_send_queues()
+        {
+            std::lock_guard<std::mutex> lock(send_mutex);
+            for (auto &queue : send_queues)
+            {
+                queue.clear();
+            }
+            in_flight_priority = NO_PACKET_IN_FLIGHT;
+            in_flight_sent     = 0;
+        }
+
+        /** Returns the priority of the next packet to send, or NO_PACKET_IN_FLIGHT if there is none. */
+        [[nodiscard]] int8_t next_send_priority(size_t bulk_sent) const
+        {
+            for (int8_t priority = 0; priority < WVB_SEND_PRIORITY_COUNT; priority++)
+            {
+                if (!send_queues[priority].empty())
+                {
+                    if (static_cast<SendPriority>(priority) == SendPriority::BULK && bulk_sent >= bulk_budget)
+                    {
+                        // Bulk share exceeded for this flush
+                        return NO_PACKET_IN_FLIGHT;
+                    }
+                    return priority;
+                }
+            }
+            return NO_PACKET_IN_FLIGHT;
+        }
     };
 
     // =============================================================
@@ -160,6 +272,10 @@ namespace wvb
         {
             return "SERVER_ADVERTISEMENT";
         }
+        else if (ftype == vrcp::VRCPFieldType::DISCOVERY_PROBE)
+        {
+            return "DISCOVERY_PROBE";
+        }
         else if (ftype == vrcp::VRCPFieldType::USER_DATA)
         {
             return "USER_DATA";
@@ -216,8 +332,8 @@ namespace wvb
                                               true,
                                               true,
                                               measurements_bucket,
-                                              SocketId::VRCP_BCAST_SOCKET), // Servers don't need to listen on the advert port; so
-                                                                            // choose another one so that we can run local tests
+                                              SocketId::VRCP_BCAST_SOCKET), // Servers receive the discovery probes on this socket,
+                                                                            // so it must be another port than the clients' one
             .is_server                  = true,
             .advertisement_interval_sec = advertisement_interval_sec,
             .local_advert_port          = local_advert_port,
@@ -260,32 +376,45 @@ namespace wvb
 
     bool VRCPSocket::listen_for_tcp_connection(const std::vector<InetAddr> &bcast_addrs) const
     {
+        // Get unix timestamp in seconds
+        uint32_t now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        const vrcp::VRCPServerAdvertisement packet {
+            .tcp_port  = htons(m_data->tcp_socket.local_addr().port),
+            .interval  = m_data->advertisement_interval_sec,
+            .timestamp = htonl(now),
+        };
+
+        // Answer discovery probes right away, so that new clients don't have to wait for the next advertisement
+        uint8_t    buffer[64];
+        size_t     actual_size = 0;
+        SocketAddr probe_addr;
+        while (m_data->udp_broadcast_socket.receive_from(buffer, sizeof(buffer), &actual_size, &probe_addr))
+        {
+            const auto *probe = (const vrcp::VRCPDiscoveryProbe *) buffer;
+            if (actual_size == sizeof(vrcp::VRCPDiscoveryProbe) && probe->ftype == vrcp::VRCPFieldType::DISCOVERY_PROBE
+                && probe->magic == VRCP_MAGIC && probe->version == VRCP_VERSION)
+            {
+                (void) m_data->udp_broadcast_socket.send_to(probe_addr, (uint8_t *) &packet, sizeof(packet));
+            }
+        }
+
         // Listen for TCP connection.
         const bool connected = m_data->tcp_socket.listen();
         if (connected)
         {
             // We have a connection, but we need to wait the client CONN_REQ.
             m_data->state = VRCPSocketState::NEGOTIATING;
+            m_data->start_connect_timer();
 
             return true;
         }
 
         // Not connected: maybe we should send an advertisement
-
-        // Get unix timestamp in seconds
-        uint32_t now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-
         if (now - m_data->last_advertisement_time >= m_data->advertisement_interval_sec)
         {
             m_data->last_advertisement_time = now;
 
-            // Send advertisement
-            const vrcp::VRCPServerAdvertisement packet {
-                .tcp_port  = htons(m_data->tcp_socket.local_addr().port),
-                .interval  = m_data->advertisement_interval_sec,
-                .timestamp = htonl(now),
-            };
-
             for (const InetAddr &bcast_addr : bcast_addrs)
             {
                 const SocketAddr addr {bcast_addr, m_data->udp_advert_port};
@@ -482,9 +611,10 @@ namespace wvb
                             };
                         }
 
-                        // Create a CONN_ACCEPT with a TLV field containing the chosen codec
+                        // Create a CONN_ACCEPT with TLV fields containing the chosen codec and the clock sync settings
                         const size_t video_codec_size   = std::min(video_codec.length(), (size_t) 32) + 2;
-                        const size_t packet_size        = sizeof(vrcp::VRCPConnectionAccept) + video_codec_size;
+                        const size_t clock_sync_size    = sizeof(vrcp::VRCPClockSyncSettings) + 2;
+                        const size_t packet_size        = sizeof(vrcp::VRCPConnectionAccept) + video_codec_size + clock_sync_size;
                         const size_t padded_packet_size = (packet_size + 3) & ~3;
 
                         auto *packet      = new uint8_t[padded_packet_size];
@@ -499,6 +629,15 @@ namespace wvb
                         field->type   = vrcp::VRCPFieldType::CHOSEN_VIDEO_CODEC_TLV;
                         field->length = video_codec_size - 2;
                         memcpy(field->value, video_codec.c_str(), field->length);
+                        // The client runs the sync phase, but its settings are chosen on the server
+                        const vrcp::VRCPClockSyncSettings clock_sync {
+                            .ping_count           = server_params.clock_sync_ping_count,
+                            .target_confidence_us = htons(server_params.clock_sync_target_confidence_us),
+                        };
+                        field         = (vrcp::VRCPAdditionalField *) (field->value + field->length);
+                        field->type   = vrcp::VRCPFieldType::CLOCK_SYNC_SETTINGS_TLV;
+                        field->length = sizeof(clock_sync);
+                        memcpy(field->value, &clock_sync, sizeof(clock_sync));
                         // Pad with zeros
                         memset(packet + packet_size, 0, padded_packet_size - packet_size);
 
@@ -506,6 +645,7 @@ namespace wvb
 
                         // We are connected ! The server considers itself as connected to the client.
                         m_data->state = VRCPSocketState::CONNECTED;
+                        m_data->stop_connect_timer();
 
                         // We can now start sending actual packets. Because TCP is ordered, the client will receive them after the
                         // CONN_ACCEPT. However, the first UDP messages may experience some delay, as the receiver will not check the
@@ -649,6 +789,22 @@ namespace wvb
         return m_data->server_candidates;
     }
 
+    void VRCPSocket::discover(const std::vector<InetAddr> &bcast_addrs, uint16_t discovery_port) const
+    {
+        if (m_data->is_server || m_data->state != VRCPSocketState::AWAITING_CONNECTION)
+        {
+            throw std::runtime_error("Only clients awaiting a connection can discover servers");
+        }
+        m_data->start_connect_timer();
+
+        // The answers are received by available_servers(), like the periodic advertisements
+        const vrcp::VRCPDiscoveryProbe probe {};
+        for (const InetAddr &bcast_addr : bcast_addrs)
+        {
+            (void) m_data->udp_broadcast_socket.send_to({bcast_addr, discovery_port}, (uint8_t *) &probe, sizeof(probe));
+        }
+    }
+
     bool VRCPSocket::connect(const SocketAddr &addr, const VRCPClientParams &params, VRCPConnectResp *resp) const
     {
         if (params.specs.manufacturer_name.empty() || params.specs.system_name.empty() || params.supported_video_codecs.empty())
@@ -662,6 +818,7 @@ namespace wvb
 
         if (m_data->state == VRCPSocketState::AWAITING_CONNECTION)
         {
+            m_data->start_connect_timer();
             if (!m_data->tcp_socket.connect(addr))
             {
                 return false;
@@ -792,20 +949,27 @@ namespace wvb
                 resp->peer_video_port      = ntohs(conn_accept->video_port);
                 resp->ntp_timestamp        = params.ntp_timestamp;
 
-                // Load TLV name
+                // Load TLV fields
                 std::string chosen_codec;
                 size_t      remaining_size = size - sizeof(vrcp::VRCPConnectionAccept);
                 auto       *field          = (vrcp::VRCPAdditionalField *) (conn_accept + 1);
                 while (remaining_size >= 2)
                 {
-                    if (field->type == vrcp::VRCPFieldType::CHOSEN_VIDEO_CODEC_TLV && remaining_size >= field->length + 2)
+                    if (remaining_size < field->length + 2)
                     {
-                        chosen_codec = std::string((const char *) field->value, field->length);
                         break;
                     }
-                    if (remaining_size < field->length + 2)
+                    if (field->type == vrcp::VRCPFieldType::CHOSEN_VIDEO_CODEC_TLV)
                     {
-                        break;
+                        chosen_codec = std::string((const char *) field->value, field->length);
+                    }
+                    else if (field->type == vrcp::VRCPFieldType::CLOCK_SYNC_SETTINGS_TLV
+                             && field->length == sizeof(vrcp::VRCPClockSyncSettings))
+                    {
+                        vrcp::VRCPClockSyncSettings clock_sync;
+                        memcpy(&clock_sync, field->value, sizeof(clock_sync));
+                        resp->clock_sync_ping_count           = clock_sync.ping_count;
+                        resp->clock_sync_target_confidence_us = ntohs(clock_sync.target_confidence_us);
                     }
 
                     remaining_size -= field->length + 2;
@@ -819,6 +983,7 @@ namespace wvb
 
                 // We are connected
                 m_data->state = VRCPSocketState::CONNECTED;
+                m_data->stop_connect_timer();
 
                 // We don't need the broadcast socket anymore
                 m_data->udp_broadcast_socket = UDPSocket {};
@@ -861,13 +1026,14 @@ namespace wvb
         {
             m_data->udp_broadcast_socket.close();
         }
+        m_data->clear_send_queues();
         // Change state
         m_data->state = VRCPSocketState::CLOSED;
     }
 
     void VRCPSocket::reset_client() const
     {
-        if (m_data->state == VRCPSocketState::AWAITING_CONNECTION)
+        if (m_data->state == VRCPSocketState::AWAITING_CONNECTION && m_data->tcp_socket.state() == TCPSocketState::NOT_STARTED)
         {
             // We are already in the initial state
             return;
@@ -883,11 +1049,15 @@ namespace wvb
             m_data->tcp_head = 0;
             m_data->tcp_tail = 0;
         }
+        m_data->clear_send_queues();
 
         if (!(m_data->udp_broadcast_socket.is_valid() && m_data->udp_broadcast_socket.local_addr().port == m_data->udp_advert_port))
         {
-            // If the socket is not a valid UDP advert port, recreate it
-            m_data->udp_broadcast_socket.close();
+            // If the socket is not a valid UDP advert port, recreate it. It was released if the session was established.
+            if (m_data->udp_broadcast_socket.is_valid())
+            {
+                m_data->udp_broadcast_socket.close();
+            }
             m_data->udp_broadcast_socket =
                 UDPSocket(m_data->udp_advert_port, true, true, m_data->measurements_bucket, SocketId::VRCP_BCAST_SOCKET);
         }
@@ -897,7 +1067,9 @@ namespace wvb
         m_data->udp_tail = 0;
 
         // Reset state
-        m_data->state = VRCPSocketState::AWAITING_CONNECTION;
+        m_data->state              = VRCPSocketState::AWAITING_CONNECTION;
+        m_data->connect_start_time = std::nullopt;
+        m_data->time_to_connected  = std::chrono::nanoseconds::zero();
     }
 
     void VRCPSocket::reset_server() const
@@ -918,14 +1090,27 @@ namespace wvb
             m_data->tcp_head = 0;
             m_data->tcp_tail = 0;
         }
+        m_data->clear_send_queues();
 
         if (!(m_data->udp_broadcast_socket.is_valid() && m_data->udp_broadcast_socket.local_addr().port == m_data->local_advert_port))
         {
-            // If the socket is not a valid UDP advert port, recreate it
-            m_data->udp_broadcast_socket.close();
+            // If the socket is not a valid UDP advert port, recreate it. It was released if the session was established.
+            if (m_data->udp_broadcast_socket.is_valid())
+            {
+                m_data->udp_broadcast_socket.close();
+            }
             m_data->udp_broadcast_socket =
                 UDPSocket(m_data->local_advert_port, true, true, m_data->measurements_bucket, SocketId::VRCP_BCAST_SOCKET);
         }
+
+        // Reset reception socket
+        m_data->udp_head = 0;
+        m_data->udp_tail = 0;
+
+        // Reset state
+        m_data->state              = VRCPSocketState::AWAITING_CONNECTION;
+        m_data->connect_start_time = std::nullopt;
+        m_data->time_to_connected  = std::chrono::nanoseconds::zero();
     }
 
     // Transmission
@@ -1074,9 +1259,116 @@ namespace wvb
         return false;
     }
 
-    void VRCPSocket::reliable_send(vrcp::VRCPBaseHeader *packet, size_t size, uint32_t timeout_us) const
+    void VRCPSocket::reliable_send(const vrcp::VRCPBaseHeader *packet, size_t size, SendPriority priority) const
     {
-        m_data->tcp_socket.send((uint8_t *) packet, size, timeout_us);
+        {
+            std::lock_guard<std::mutex> lock(m_data->send_mutex);
+
+            auto          &queue       = m_data->send_queues[static_cast<uint8_t>(priority)];
+            const auto     queued_time = std::chrono::steady_clock::now();
+            const auto    *bytes       = reinterpret_cast<const uint8_t *>(packet);
+            size_t         offset      = 0;
+
+            // Split the buffer into individual packets, so that they can be interleaved with other classes
+            while (offset < size)
+            {
+                size_t packet_size = 0;
+                if (size - offset >= sizeof(vrcp::VRCPBaseHeader))
+                {
+                    packet_size = reinterpret_cast<const vrcp::VRCPBaseHeader *>(bytes + offset)->n_rows * VRCP_ROW_SIZE;
+                }
+                if (packet_size == 0 || packet_size > size - offset)
+                {
+                    // Malformed packet: keep the rest as a single block, the receiver will skip it
+                    packet_size = size - offset;
+                }
+
+                queue.packets.push_back({
+                    .size        = packet_size,
+                    .queued_time = queued_time,
+                });
+                offset += packet_size;
+            }
+            queue.buffer.insert(queue.buffer.end(), bytes, bytes + size);
+        }
+
+        flush_send_queues();
+    }
+
+    bool VRCPSocket::flush_send_queues() const
+    {
+        std::lock_guard<std::mutex> lock(m_data->send_mutex);
+
+        size_t bulk_sent = 0;
+        while (m_data->tcp_socket.is_connected())
+        {
+            // A packet that was partially sent must be finished first, since packets can't be interleaved inside the TCP stream
+            int8_t priority = m_data->in_flight_priority;
+            if (priority == NO_PACKET_IN_FLIGHT)
+            {
+                priority = m_data->next_send_priority(bulk_sent);
+                if (priority == NO_PACKET_IN_FLIGHT)
+                {
+                    break;
+                }
+            }
+
+            auto         &queue     = m_data->send_queues[priority];
+            const auto   &front     = queue.packets.front();
+            const size_t  remaining = front.size - m_data->in_flight_sent;
+            size_t        sent      = 0;
+            const bool    did_send  = m_data->tcp_socket.try_send(&queue.buffer[queue.head + m_data->in_flight_sent], remaining, &sent);
+
+            if (static_cast<SendPriority>(priority) == SendPriority::BULK)
+            {
+                bulk_sent += sent;
+            }
+            m_data->in_flight_sent += sent;
+
+            if (!did_send || sent < remaining)
+            {
+                // The socket buffer is full, try again during the next flush
+                m_data->in_flight_priority = m_data->in_flight_sent > 0 ? priority : NO_PACKET_IN_FLIGHT;
+                break;
+            }
+
+            // The packet was fully sent
+            if (m_data->measurements_bucket)
+            {
+                const auto delay = std::chrono::steady_clock::now() - front.queued_time;
+                m_data->measurements_bucket->add_send_queue_delay(
+                    static_cast<SendPriority>(priority),
+                    static_cast<uint32_t>(front.size),
+                    static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(delay).count()));
+            }
+            queue.pop_front();
+            m_data->in_flight_priority = NO_PACKET_IN_FLIGHT;
+            m_data->in_flight_sent     = 0;
+        }
+
+        for (const auto &queue : m_data->send_queues)
+        {
+            if (!queue.empty())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void VRCPSocket::set_bulk_budget(size_t bulk_budget_bytes) const
+    {
+        std::lock_guard<std::mutex> lock(m_data->send_mutex);
+        m_data->bulk_budget = bulk_budget_bytes;
+    }
+
+    size_t VRCPSocket::queued_bytes(SendPriority priority) const
+    {
+        std::lock_guard<std::mutex> lock(m_data->send_mutex);
+        const auto                 &queue = m_data->send_queues[static_cast<uint8_t>(priority)];
+        const size_t                in_flight_sent =
+            m_data->in_flight_priority == static_cast<int8_t>(priority) ? m_data->in_flight_sent : 0;
+        return queue.buffer.size() - queue.head - in_flight_sent;
     }
 
     bool VRCPSocket::unreliable_send(vrcp::VRCPBaseHeader *packet, size_t size) const
@@ -1108,4 +1400,27 @@ namespace wvb
         return m_data->tcp_socket.peer_addr().addr;
     }
 
+    std::chrono::nanoseconds VRCPSocket::time_to_connected() const
+    {
+        return m_data->state == VRCPSocketState::CONNECTED ? m_data->time_to_connected : std::chrono::nanoseconds::zero();
+    }
+
+    std::vector<NativeSocketHandle> VRCPSocket::native_handles() const
+    {
+        std::vector<NativeSocketHandle> handles {m_data->tcp_socket.native_handle()};
+        if (m_data->state == VRCPSocketState::CONNECTED)
+        {
+            handles.push_back(m_data->udp_socket.native_handle());
+        }
+        else
+        {
+            // Clients receive the advertisements on the broadcast socket, and servers the discovery probes
+            handles.push_back(m_data->udp_broadcast_socket.native_handle());
+        }
+
+        // Closed sockets can't be waited on
+        handles.erase(std::remove(handles.begin(), handles.end(), INVALID_NATIVE_SOCKET_HANDLE), handles.end());
+        return handles;
+    }
+
 } // namespace wvb
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "wvb_common/vsync_phase_lock.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wvb
+{
+    VsyncPhaseLock::VsyncPhaseLock(double nominal_period_us, const VsyncPhaseLockSettings &settings)
+        : m_settings(settings),
+          m_nominal_period_us(nominal_period_us),
+          m_next_interval_us(nominal_period_us)
+    {
+    }
+
+    void VsyncPhaseLock::set_reference(int64_t display_timestamp_us, double display_period_us, int64_t phase_offset_us)
+    {
+        if (display_period_us <= 0)
+        {
+            return;
+        }
+
+        m_reference_us        = display_timestamp_us - phase_offset_us;
+        m_reference_period_us = display_period_us;
+        m_has_reference       = true;
+    }
+
+    double VsyncPhaseLock::on_vsync(int64_t vsync_timestamp_us)
+    {
+        if (!m_has_reference)
+        {
+            m_phase_error_us   = 0;
+            m_next_interval_us = m_nominal_period_us;
+            return m_next_interval_us;
+        }
+
+        // Distance to the nearest target, in [-period / 2, period / 2[
+        const double period = m_reference_period_us;
+        double       phase  = std::fmod(static_cast<double>(vsync_timestamp_us - m_reference_us), period);
+        if (phase < -period / 2)
+        {
+            phase += period;
+        }
+        else if (phase >= period / 2)
+        {
+            phase -= period;
+        }
+        m_phase_error_us = phase;
+
+        // A late vsync needs a shorter interval. The integral term is bounded like the interval, to prevent wind-up.
+        const double max_change_us = m_settings.max_interval_change * period;
+        m_period_correction_us     = std::clamp(m_period_correction_us + m_settings.ki * phase, -max_change_us, max_change_us);
+        const double change_us     = std::clamp(m_settings.kp * phase + m_period_correction_us, -max_change_us, max_change_us);
+
+        m_next_interval_us = period - change_us;
+        return m_next_interval_us;
+    }
+
+    void VsyncPhaseLock::reset()
+    {
+        m_has_reference        = false;
+        m_period_correction_us = 0;
+        m_phase_error_us       = 0;
+        m_next_interval_us     = m_nominal_period_us;
+    }
+} // namespace wvb
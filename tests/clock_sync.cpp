@@ -0,0 +1,88 @@
+#include <wvb_common/clock_sync.h>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <test_framework.hpp>
+
+#define TRUE_OFFSET_US 123456789
+#define TRUE_DRIFT_PPM 50.0
+#define PING_PERIOD_US 1000000
+#define NB_PINGS       120
+#define BASE_DELAY_US  1500
+#define MAX_JITTER_US  8000
+
+TEST
+{
+    // Simulate a remote clock that is ahead of the local one and drifts away from it
+    const auto remote_time = [](int64_t local_us)
+    { return local_us + TRUE_OFFSET_US + static_cast<int64_t>(static_cast<double>(local_us) * TRUE_DRIFT_PPM / 1e6); };
+
+    // Random queueing delays on each direction, most of them small but some of them large
+    std::mt19937                           rng(42);
+    std::exponential_distribution<double>  small_jitter(1.0 / 300.0);
+    std::uniform_int_distribution<int64_t> large_jitter(0, MAX_JITTER_US);
+    std::bernoulli_distribution            is_large(0.3);
+
+    const auto one_way_delay = [&]()
+    { return BASE_DELAY_US + (is_large(rng) ? large_jitter(rng) : static_cast<int64_t>(small_jitter(rng))); };
+
+    wvb::ClockSyncEstimator estimator;
+    EXPECT_FALSE(estimator.has_estimate());
+
+    int64_t max_naive_error = 0;
+    for (int64_t i = 0; i < NB_PINGS; i++)
+    {
+        const int64_t send_us  = 1000000 + i * PING_PERIOD_US;
+        const int64_t forward  = one_way_delay();
+        const int64_t backward = one_way_delay();
+
+        wvb::ClockSyncSample sample {
+            .local_send_us    = send_us,
+            .local_receive_us = send_us + forward + backward,
+            .remote_us        = remote_time(send_us + forward),
+        };
+        const int64_t naive_error = std::abs(sample.offset_us() - (remote_time(sample.local_mid_us()) - sample.local_mid_us()));
+        max_naive_error           = std::max(max_naive_error, naive_error);
+
+        estimator.add_sample(sample);
+    }
+    ASSERT_TRUE(estimator.has_estimate());
+
+    // Individual samples are affected by the asymmetric delays
+    std::cout << "Max error of a single sample: " << max_naive_error << " us\n";
+    EXPECT_TRUE(max_naive_error > 1000);
+
+    // The drift should be found
+    std::cout << "Estimated drift: " << estimator.drift_ppm() << " ppm (expected " << TRUE_DRIFT_PPM << " ppm)\n";
+    EXPECT_TRUE(std::abs(estimator.drift_ppm() - TRUE_DRIFT_PPM) < 5.0);
+
+    // The offset should be accurate, even a bit in the future
+    const int64_t now_us          = 1000000 + NB_PINGS * PING_PERIOD_US;
+    const double  expected_offset = static_cast<double>(remote_time(now_us) - now_us);
+    std::cout << "Offset error: " << estimator.offset_at(now_us) - expected_offset << " us, residual: " << estimator.residual_us()
+              << " us\n";
+    EXPECT_TRUE(std::abs(estimator.offset_at(now_us) - expected_offset) < 200.0);
+    EXPECT_TRUE(std::abs(estimator.offset_at(now_us + 10 * PING_PERIOD_US)
+                         - static_cast<double>(remote_time(now_us + 10 * PING_PERIOD_US) - now_us - 10 * PING_PERIOD_US))
+                < 300.0);
+    EXPECT_TRUE(estimator.residual_us() < 500.0);
+
+    // With a short history, only the offset is estimated
+    estimator.reset();
+    EXPECT_FALSE(estimator.has_estimate());
+    for (int64_t i = 0; i < 4; i++)
+    {
+        const int64_t send_us = i * 100000;
+        estimator.add_sample({
+            .local_send_us    = send_us,
+            .local_receive_us = send_us + 2 * BASE_DELAY_US,
+            .remote_us        = remote_time(send_us + BASE_DELAY_US),
+        });
+    }
+    EXPECT_EQ(estimator.drift_ppm(), 0.0);
+    EXPECT_TRUE(std::abs(estimator.offset_at(300000) - static_cast<double>(remote_time(300000) - 300000)) < 50.0);
+
+    // Samples with a negative round trip are invalid
+    EXPECT_FALSE(estimator.add_sample({.local_send_us = 10, .local_receive_us = 5, .remote_us = 0}));
+}
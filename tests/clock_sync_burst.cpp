@@ -0,0 +1,77 @@
+#include <wvb_common/clock_sync.h>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <test_framework.hpp>
+
+#define TRUE_OFFSET_US       987654321
+#define BASE_DELAY_US        1500
+#define TARGET_CONFIDENCE_US 200
+#define MAX_SAMPLES          20
+
+/** Simulates a startup sync on a link with the given jitter, and returns the number of samples needed to reach the target. */
+size_t simulate_sync(wvb::ClockSyncBurstFilter &filter, std::mt19937 &rng, double mean_jitter_us)
+{
+    std::exponential_distribution<double> jitter(1.0 / mean_jitter_us);
+
+    int64_t now_us = 1000000;
+    while (filter.nb_samples() < MAX_SAMPLES && filter.confidence_us() > TARGET_CONFIDENCE_US)
+    {
+        const auto forward  = BASE_DELAY_US + static_cast<int64_t>(jitter(rng));
+        const auto backward = BASE_DELAY_US + static_cast<int64_t>(jitter(rng));
+        filter.add_sample({
+            .local_send_us    = now_us,
+            .local_receive_us = now_us + forward + backward,
+            .remote_us        = now_us + forward + TRUE_OFFSET_US,
+        });
+        now_us += forward + backward;
+    }
+    return filter.nb_samples();
+}
+
+TEST
+{
+    std::mt19937 rng(1234);
+
+    // Without samples, there is no estimation
+    wvb::ClockSyncBurstFilter filter;
+    EXPECT_FALSE(filter.has_estimate());
+    EXPECT_TRUE(std::isinf(filter.confidence_us()));
+
+    // Two samples aren't enough to know how precise they are, even if they are identical
+    filter.add_sample({.local_send_us = 0, .local_receive_us = 2 * BASE_DELAY_US, .remote_us = BASE_DELAY_US + TRUE_OFFSET_US});
+    filter.add_sample({.local_send_us = 0, .local_receive_us = 2 * BASE_DELAY_US, .remote_us = BASE_DELAY_US + TRUE_OFFSET_US});
+    EXPECT_TRUE(filter.has_estimate());
+    EXPECT_EQ(filter.offset_us(), static_cast<double>(TRUE_OFFSET_US));
+    EXPECT_TRUE(std::isinf(filter.confidence_us()));
+
+    // On a stable link, the sync should stop early
+    filter.reset();
+    const auto nb_samples_stable = simulate_sync(filter, rng, 20.0);
+    std::cout << "Stable link: " << nb_samples_stable << " samples, error bound " << filter.confidence_us() << " us, actual error "
+              << filter.offset_us() - TRUE_OFFSET_US << " us\n";
+    EXPECT_TRUE(nb_samples_stable < 5);
+    EXPECT_TRUE(filter.confidence_us() <= TARGET_CONFIDENCE_US);
+    EXPECT_TRUE(std::abs(filter.offset_us() - TRUE_OFFSET_US) <= TARGET_CONFIDENCE_US);
+
+    // On a noisy link, more samples are needed, but the result should still be accurate
+    filter.reset();
+    const auto nb_samples_noisy = simulate_sync(filter, rng, 2000.0);
+    std::cout << "Noisy link: " << nb_samples_noisy << " samples, error bound " << filter.confidence_us() << " us, actual error "
+              << filter.offset_us() - TRUE_OFFSET_US << " us\n";
+    EXPECT_TRUE(nb_samples_noisy > nb_samples_stable);
+    EXPECT_EQ(filter.nb_kept_samples(), (size_t) WVB_CLOCK_SYNC_BURST_KEPT_SAMPLES);
+    EXPECT_TRUE(std::abs(filter.offset_us() - TRUE_OFFSET_US) <= std::max(filter.confidence_us(), 500.0));
+
+    // The kept samples are the ones with the lowest RTT
+    filter.reset();
+    for (int64_t rtt = 10000; rtt > 0; rtt -= 1000)
+    {
+        filter.add_sample({.local_send_us = 0, .local_receive_us = rtt, .remote_us = rtt / 2 + TRUE_OFFSET_US});
+    }
+    EXPECT_EQ(filter.nb_samples(), (size_t) 10);
+    EXPECT_EQ(filter.nb_kept_samples(), (size_t) WVB_CLOCK_SYNC_BURST_KEPT_SAMPLES);
+    EXPECT_EQ(filter.offset_us(), static_cast<double>(TRUE_OFFSET_US));
+    EXPECT_EQ(filter.confidence_us(), 0.0);
+}
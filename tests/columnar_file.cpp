@@ -0,0 +1,177 @@
+#include <wvb_common/benchmark.h>
+#include <wvb_common/columnar_file.h>
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <test_framework.hpp>
+#include <vector>
+
+#define TEST_FILE_PATH      "columnar_file_test.wvbm"
+#define MALFORMED_FILE_PATH "columnar_file_malformed.wvbm"
+#define OVERSIZED_FILE_PATH "columnar_file_oversized.wvbm"
+// Loaded by tests/columnar_file.py after this test, to check wvb_load_binary_measurements() of wvb_measurements.py
+#define PYTHON_FILE_PATH "columnar_file_python.wvbm"
+#define NB_ROWS             1000
+#define NB_PYTHON_ROWS      10
+
+TEST
+{
+    // Values at the limits of their types, which a text format may not preserve
+    std::vector<wvb::ServerFrameTimeMeasurements> server_frames;
+    std::vector<wvb::ClientFrameTimeMeasurements> client_frames;
+    std::vector<wvb::PosePredictionMeasurements>  predictions;
+    for (uint32_t i = 0; i < NB_ROWS; i++)
+    {
+        server_frames.push_back({
+            .dropped                   = i % 3 == 0,
+            .frame_id                  = std::numeric_limits<uint32_t>::max() - i,
+            .frame_event_received_ns   = std::numeric_limits<int64_t>::max() - i,
+            .present_info_received_ns  = std::numeric_limits<int64_t>::min() + i,
+            .after_last_send_packet_ns = static_cast<int64_t>(i) * 1000000007,
+        });
+        client_frames.push_back({
+            .frame_index          = i,
+            .frame_id             = std::numeric_limits<uint32_t>::max() - i,
+            .tracking_ns          = -static_cast<int64_t>(i),
+            .predicted_present_ns = static_cast<int64_t>(i) << 32,
+        });
+        predictions.push_back({
+            .target_ns         = static_cast<int64_t>(i) * 11111111111,
+            .orientation_error = 0.1f * static_cast<float>(i) + std::numeric_limits<float>::denorm_min(),
+            .position_error    = i == 0 ? std::numeric_limits<float>::max() : 1.0f / static_cast<float>(i),
+        });
+    }
+    std::vector<wvb::SocketMeasurements> server_sockets = {
+        {.socket_id = wvb::SocketId::VIDEO_SOCKET, .socket_type = wvb::SocketType::SOCKET_TYPE_UDP, .bytes_sent = 123456789},
+    };
+    std::vector<wvb::SocketMeasurements> client_sockets = {
+        {.socket_id = wvb::SocketId::VRCP_TCP_SOCKET, .socket_type = wvb::SocketType::SOCKET_TYPE_TCP, .packets_received = 42},
+        {.socket_id = wvb::SocketId::VRCP_UDP_SOCKET, .socket_type = wvb::SocketType::SOCKET_TYPE_UDP},
+    };
+    const wvb::rtp::RTPClock clock;
+
+    {
+        wvb::ColumnarFileWriter file(TEST_FILE_PATH);
+        ASSERT_TRUE(file.is_open());
+        wvb::SocketMeasurements::export_columns(file, "socket_measurements", server_sockets, client_sockets);
+        wvb::ServerFrameTimeMeasurements::export_columns(file, "server_frame_time_measurements", server_frames);
+        wvb::ClientFrameTimeMeasurements::export_columns(file, "client_frame_time_measurements", clock, client_frames);
+        wvb::PosePredictionMeasurements::export_columns(file, "driver_pose_prediction_measurements", clock, predictions);
+        // Empty tables are valid
+        wvb::NetworkMeasurements::export_columns(file, "network_measurements", {});
+    }
+    {
+        // Columns must match their table
+        wvb::ColumnarFileWriter file(MALFORMED_FILE_PATH);
+        EXPECT_THROWS(file.write_column("extra", std::vector<int32_t> {}));
+        file.begin_table("mismatch", 1, 2);
+        EXPECT_THROWS(file.write_column("values", std::vector<int32_t> {1}));
+        EXPECT_THROWS(file.begin_table("next", 0, 0));
+    }
+
+    const auto tables = wvb::read_columnar_file(TEST_FILE_PATH);
+    std::remove(TEST_FILE_PATH);
+    ASSERT_EQ(tables.size(), (size_t) 5);
+
+    // Sockets of both components are in the same table
+    const auto &sockets = tables[0];
+    EXPECT_EQ(sockets.name, std::string("socket_measurements"));
+    EXPECT_EQ(sockets.nb_rows, (uint32_t) 3);
+    const auto components = sockets.column("component")->strings();
+    EXPECT_EQ(components[0], std::string(EXPORT_FILE_SERVER_ID));
+    EXPECT_EQ(components[2], std::string(EXPORT_FILE_CLIENT_ID));
+    EXPECT_EQ(sockets.column("socket_id")->strings()[1], std::string("VRCP_TCP"));
+    EXPECT_EQ(sockets.column("bytes_sent")->values<uint32_t>()[0], (uint32_t) 123456789);
+    EXPECT_EQ(sockets.column("packets_received")->values<uint32_t>()[1], (uint32_t) 42);
+
+    // Every value matches exactly
+    const auto &server_table = tables[1];
+    ASSERT_EQ(server_table.nb_rows, (uint32_t) NB_ROWS);
+    ASSERT_EQ(server_table.columns.size(), (size_t) 14);
+    ASSERT_TRUE(server_table.column("present_info_received") != nullptr);
+    const auto dropped               = server_table.column("dropped")->values<bool>();
+    const auto server_frame_ids      = server_table.column("frame_id")->values<uint32_t>();
+    const auto frame_event_received  = server_table.column("frame_event_received")->values<int64_t>();
+    const auto present_info_received = server_table.column("present_info_received")->values<int64_t>();
+    const auto after_last_send       = server_table.column("after_last_send_packet")->values<int64_t>();
+    EXPECT_THROWS((void) server_table.column("frame_id")->values<int64_t>());
+
+    const auto &client_table         = tables[2];
+    const auto  client_frame_ids     = client_table.column("frame_id")->values<uint32_t>();
+    const auto  tracking_sampled     = client_table.column("tracking_sampled")->values<int64_t>();
+    const auto  predicted_present    = client_table.column("predicted_present_time")->values<int64_t>();
+    const auto  client_pose_ts       = client_table.column("pose_timestamp")->values<int64_t>();
+    const auto &prediction_table     = tables[3];
+    const auto  target_timestamps    = prediction_table.column("target_timestamp")->values<int64_t>();
+    const auto  orientation_errors   = prediction_table.column("orientation_error")->values<float>();
+    const auto  position_errors      = prediction_table.column("position_error")->values<float>();
+    const auto  prediction_pose_ts   = prediction_table.column("pose_timestamp")->values<int64_t>();
+    uint32_t    nb_mismatches        = 0;
+    for (uint32_t i = 0; i < NB_ROWS; i++)
+    {
+        nb_mismatches += dropped[i] != server_frames[i].dropped;
+        nb_mismatches += server_frame_ids[i] != server_frames[i].frame_id;
+        nb_mismatches += frame_event_received[i] != server_frames[i].frame_event_received_ns;
+        nb_mismatches += present_info_received[i] != server_frames[i].present_info_received_ns;
+        nb_mismatches += after_last_send[i] != server_frames[i].after_last_send_packet_ns;
+        nb_mismatches += client_frame_ids[i] != client_frames[i].frame_id;
+        nb_mismatches += tracking_sampled[i] != client_frames[i].tracking_ns;
+        nb_mismatches += predicted_present[i] != client_frames[i].predicted_present_ns;
+        nb_mismatches += client_pose_ts[i] != clock.ns_from_rtp_timestamp(client_frames[i].pose_timestamp);
+        nb_mismatches += target_timestamps[i] != predictions[i].target_ns;
+        nb_mismatches += orientation_errors[i] != predictions[i].orientation_error;
+        nb_mismatches += position_errors[i] != predictions[i].position_error;
+        nb_mismatches += prediction_pose_ts[i] != clock.ns_from_rtp_timestamp(predictions[i].pose_timestamp);
+    }
+    EXPECT_EQ(nb_mismatches, (uint32_t) 0);
+
+    EXPECT_EQ(tables[4].name, std::string("network_measurements"));
+    EXPECT_EQ(tables[4].nb_rows, (uint32_t) 0);
+    EXPECT_EQ(tables[4].columns.size(), (size_t) 4);
+
+    // Incomplete and missing files are rejected
+    EXPECT_THROWS(wvb::read_columnar_file(MALFORMED_FILE_PATH));
+    std::remove(MALFORMED_FILE_PATH);
+    EXPECT_THROWS(wvb::read_columnar_file(MALFORMED_FILE_PATH));
+
+    // Sizes past the end of the file are rejected before the column is allocated
+    {
+        wvb::ColumnarFileWriter file(OVERSIZED_FILE_PATH);
+        file.begin_table("oversized", 1, 1);
+        file.write_column("values", std::vector<uint32_t> {1});
+        ASSERT_TRUE(file.close());
+    }
+    {
+        // The size of the last column is right before its value
+        std::fstream file(OVERSIZED_FILE_PATH, std::ios::in | std::ios::out | std::ios::binary);
+        const uint64_t oversized = uint64_t(1) << 40;
+        file.seekp(-static_cast<std::streamoff>(sizeof(uint64_t) + sizeof(uint32_t)), std::ios::end);
+        file.write(reinterpret_cast<const char *>(&oversized), sizeof(oversized));
+    }
+    EXPECT_THROWS(wvb::read_columnar_file(OVERSIZED_FILE_PATH));
+    std::remove(OVERSIZED_FILE_PATH);
+
+    // Values that tests/columnar_file.py computes the same way
+    std::vector<wvb::ServerFrameTimeMeasurements> python_server_frames;
+    std::vector<wvb::NetworkMeasurements>         python_network;
+    for (uint32_t i = 0; i < NB_PYTHON_ROWS; i++)
+    {
+        python_server_frames.push_back({
+            .dropped                   = i % 3 == 0,
+            .frame_id                  = std::numeric_limits<uint32_t>::max() - i,
+            .frame_event_received_ns   = static_cast<int64_t>(i) * 1000000007,
+            .after_last_send_packet_ns = (int64_t(1) << 52) + static_cast<int64_t>(i) * 1000,
+        });
+        python_network.push_back({
+            .rtt_us         = 100 * i,
+            .clock_error_us = -static_cast<int32_t>(i),
+            .drift_ppm      = 0.5f * static_cast<float>(i),
+        });
+    }
+    wvb::ColumnarFileWriter python_file(PYTHON_FILE_PATH);
+    wvb::SocketMeasurements::export_columns(python_file, "socket_measurements", server_sockets, client_sockets);
+    wvb::ServerFrameTimeMeasurements::export_columns(python_file, "server_frame_time_measurements", python_server_frames);
+    wvb::NetworkMeasurements::export_columns(python_file, "network_measurements", python_network);
+    EXPECT_TRUE(python_file.close());
+}
@@ -0,0 +1,58 @@
+"""Loads the binary measurement file written by tests/columnar_file.cpp with wvb_measurements.py, and checks its values."""
+
+import os
+import sys
+
+# Exit code that CTest reports as a skipped test
+SKIP_RETURN_CODE = 77
+FILE_PATH = "columnar_file_python.wvbm"
+NB_ROWS = 10
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools"))
+try:
+    from wvb_measurements import wvb_load_binary_measurements
+except ImportError as e:
+    print(f"Skipped, wvb_measurements.py can't be imported: {e}")
+    sys.exit(SKIP_RETURN_CODE)
+
+
+def check(condition, message):
+    if not condition:
+        raise AssertionError(message)
+
+
+def main():
+    measurements = wvb_load_binary_measurements(FILE_PATH)
+    os.remove(FILE_PATH)
+    check(list(measurements.keys()) == ["socket_measurements", "server_frame_time_measurements", "network_measurements"],
+          f"Unexpected tables {list(measurements.keys())}")
+
+    sockets = measurements["socket_measurements"]
+    check(list(sockets["component"]) == ["server", "client", "client"], "Unexpected socket components")
+    check(list(sockets["socket_id"]) == ["VIDEO", "VRCP_TCP", "VRCP_UDP"], "Unexpected socket ids")
+    check(sockets["bytes_sent"][0] == 123456789, "Unexpected bytes sent")
+    check(sockets["packets_received"][1] == 42, "Unexpected packets received")
+
+    # Times are loaded in microseconds
+    server_frames = measurements["server_frame_time_measurements"]
+    check(len(server_frames) == NB_ROWS, "Unexpected number of server frames")
+    for i in range(NB_ROWS):
+        check(server_frames["frame_id"][i] == 2**32 - 1 - i, f"Unexpected frame id of row {i}")
+        check(bool(server_frames["dropped"][i]) == (i % 3 == 0), f"Unexpected dropped flag of row {i}")
+        check(server_frames["frame_event_received"][i] == i * 1000000007 / 1000, f"Unexpected frame event time of row {i}")
+        check(server_frames["after_last_send_packet"][i] == (2**52 + i * 1000) / 1000, f"Unexpected send time of row {i}")
+        check(server_frames["present_info_received"][i] == 0, f"Unexpected present info time of row {i}")
+
+    network = measurements["network_measurements"]
+    check(len(network) == NB_ROWS, "Unexpected number of network measurements")
+    for i in range(NB_ROWS):
+        check(network["rtt"][i] == 100 * i, f"Unexpected RTT of row {i}")
+        check(network["clock_error"][i] == -i, f"Unexpected clock error of row {i}")
+        check(network["drift"][i] == 0.5 * i, f"Unexpected drift of row {i}")
+        check(network["residual"][i] == 0, f"Unexpected residual of row {i}")
+
+    print("PASSED")
+
+
+if __name__ == "__main__":
+    main()
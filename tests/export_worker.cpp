@@ -0,0 +1,147 @@
+#include <wvb_common/benchmark.h>
+#include <wvb_common/columnar_file.h>
+#include <wvb_common/export_worker.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <test_framework.hpp>
+#include <thread>
+#include <vector>
+
+#define NB_RUNS             12
+#define NB_FRAMES_PER_RUN   500
+#define QUEUE_CAPACITY      3
+#define SLOW_WRITE_DURATION std::chrono::milliseconds(20)
+
+/** Bucket filled like the one of a client at the end of a run. */
+std::unique_ptr<wvb::ClientMeasurementBucket> make_client_bucket(uint32_t run)
+{
+    auto bucket = std::make_unique<wvb::ClientMeasurementBucket>();
+    bucket->set_clock(std::make_shared<wvb::rtp::RTPClock>());
+    bucket->set_as_accept_all();
+    for (uint32_t i = 0; i < NB_FRAMES_PER_RUN; i++)
+    {
+        bucket->add_frame_time_measurement({
+            .frame_index = i,
+            .frame_id    = run * NB_FRAMES_PER_RUN + i,
+            .tracking_ns = static_cast<int64_t>(i) * 11111111,
+        });
+    }
+    bucket->set_as_finished();
+    return bucket;
+}
+
+std::string run_path(uint32_t run) { return "export_worker_test_run_" + std::to_string(run) + ".wvbm"; }
+
+TEST
+{
+    std::mutex                     results_mutex;
+    std::vector<wvb::ExportResult> results;
+    std::atomic<bool>              reported_from_caller = false;
+    const auto                     caller_id            = std::this_thread::get_id();
+    const wvb::rtp::RTPClock       clock;
+    size_t                         max_pending = 0;
+
+    {
+        wvb::ExportWorker worker(
+            [&](const wvb::ExportResult &result)
+            {
+                reported_from_caller = reported_from_caller || std::this_thread::get_id() == caller_id;
+                std::lock_guard lock(results_mutex);
+                results.push_back(result);
+            },
+            QUEUE_CAPACITY);
+
+        // The buckets are moved to the exports, and slow writes don't block the caller until the queue is full
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t run = 0; run < QUEUE_CAPACITY; run++)
+        {
+            std::shared_ptr<wvb::ClientMeasurementBucket> bucket = make_client_bucket(run);
+            worker.submit(run_path(run),
+                          [bucket, &clock](const std::string &path)
+                          {
+                              std::this_thread::sleep_for(SLOW_WRITE_DURATION);
+                              wvb::ColumnarFileWriter file(path);
+                              wvb::ClientFrameTimeMeasurements::export_columns(file,
+                                                                               "client_frame_time_measurements",
+                                                                               clock,
+                                                                               bucket->get_frame_time_measurements());
+                              return file.close();
+                          });
+        }
+        EXPECT_TRUE(std::chrono::steady_clock::now() - start < SLOW_WRITE_DURATION);
+
+        // Then, the queue is bounded
+        for (uint32_t run = QUEUE_CAPACITY; run < NB_RUNS; run++)
+        {
+            std::shared_ptr<wvb::ClientMeasurementBucket> bucket = make_client_bucket(run);
+            worker.submit(run_path(run),
+                          [bucket, &clock](const std::string &path)
+                          {
+                              wvb::ColumnarFileWriter file(path);
+                              wvb::ClientFrameTimeMeasurements::export_columns(file,
+                                                                               "client_frame_time_measurements",
+                                                                               clock,
+                                                                               bucket->get_frame_time_measurements());
+                              return file.close();
+                          });
+            max_pending = std::max(max_pending, worker.nb_pending());
+        }
+        // The queue, and the batch being written
+        EXPECT_TRUE(max_pending <= 2 * QUEUE_CAPACITY);
+
+        worker.wait_idle();
+        EXPECT_EQ(worker.nb_pending(), (size_t) 0);
+        EXPECT_EQ(worker.nb_failed(), (uint32_t) 0);
+
+        // Failures are reported, and don't stop the worker
+        worker.submit("export_worker_test_missing_dir/file.wvbm",
+                      [](const std::string &path)
+                      {
+                          wvb::ColumnarFileWriter file(path);
+                          return file.is_open() && file.close();
+                      });
+        worker.submit("export_worker_test_throws.wvbm",
+                      [](const std::string &) -> bool { throw std::runtime_error("Synthetic failure"); });
+        worker.submit("export_worker_test_last.csv",
+                      [](const std::string &path)
+                      {
+                          std::FILE *file = std::fopen(path.c_str(), "w");
+                          return file != nullptr && std::fclose(file) == 0;
+                      });
+        // Pending exports are completed when the worker is destroyed
+    }
+
+    EXPECT_FALSE(reported_from_caller);
+    ASSERT_EQ(results.size(), (size_t) NB_RUNS + 3);
+    EXPECT_FALSE(results[NB_RUNS].success);
+    EXPECT_FALSE(results[NB_RUNS + 1].success);
+    EXPECT_TRUE(results[NB_RUNS + 2].success);
+    std::remove("export_worker_test_last.csv");
+
+    // Exports are written in order, and hold the measurements of their bucket
+    uint32_t nb_mismatches = 0;
+    for (uint32_t run = 0; run < NB_RUNS; run++)
+    {
+        EXPECT_EQ(results[run].path, run_path(run));
+        EXPECT_TRUE(results[run].success);
+
+        const auto tables = wvb::read_columnar_file(run_path(run));
+        std::remove(run_path(run).c_str());
+        ASSERT_EQ(tables.size(), (size_t) 1);
+        const auto frame_ids = tables[0].column("frame_id")->values<uint32_t>();
+        ASSERT_EQ(frame_ids.size(), (size_t) NB_FRAMES_PER_RUN);
+        for (uint32_t i = 0; i < NB_FRAMES_PER_RUN; i++)
+        {
+            nb_mismatches += frame_ids[i] != run * NB_FRAMES_PER_RUN + i;
+        }
+    }
+    EXPECT_EQ(nb_mismatches, (uint32_t) 0);
+
+    EXPECT_THROWS(wvb::ExportWorker(nullptr, 0));
+}
@@ -0,0 +1,338 @@
+#include <wvb_common/image_quality.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stb_image.h>
+#include <test_framework.hpp>
+#include <vector>
+
+// Region of the test image compared with the reference implementation, with odd sizes to test the tails of the kernels
+#define CROP_X      1201
+#define CROP_Y      517
+#define CROP_WIDTH  389
+#define CROP_HEIGHT 263
+#define NOISE_RANGE 24
+#define OFFSET      5
+
+// Values of wvb_psnr and wvb_ssim from tools/wvb_measurements.py (scikit-image 0.26), for the test image and its distortion
+#define PYTHON_FULL_PSNR 27.9542490803
+#define PYTHON_FULL_SSIM 0.6159622552
+#define PYTHON_CROP_PSNR 33.2570333010
+#define PYTHON_CROP_SSIM 0.5433642492
+// The Python values are rounded to 10 decimals, and scikit-image filters the windows in floating point
+#define PYTHON_TOLERANCE 1e-7
+
+/** Straightforward implementation of the metrics, in double precision, following the definitions of scikit-image. */
+namespace reference
+{
+    struct Channel
+    {
+        std::vector<double> samples;
+        uint32_t            width  = 0;
+        uint32_t            height = 0;
+
+        [[nodiscard]] double at(uint32_t x, uint32_t y) const { return samples[y * width + x]; }
+    };
+
+    Channel extract(const uint8_t *data, uint32_t width, uint32_t height, size_t row_pitch, uint32_t step)
+    {
+        Channel channel {.width = width, .height = height};
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                channel.samples.push_back(data[y * row_pitch + x * step]);
+            }
+        }
+        return channel;
+    }
+
+    Channel downsample(const Channel &channel)
+    {
+        Channel result {.width = channel.width / 2, .height = channel.height / 2};
+        for (uint32_t y = 0; y < result.height; y++)
+        {
+            for (uint32_t x = 0; x < result.width; x++)
+            {
+                const double sum = channel.at(2 * x, 2 * y) + channel.at(2 * x + 1, 2 * y) + channel.at(2 * x, 2 * y + 1)
+                                 + channel.at(2 * x + 1, 2 * y + 1);
+                result.samples.push_back(std::floor((sum + 2) / 4));
+            }
+        }
+        return result;
+    }
+
+    /** Mean SSIM and contrast-structure terms. */
+    std::pair<double, double> ssim(const Channel &a, const Channel &b)
+    {
+        const double n  = WVB_SSIM_WINDOW_SIZE * WVB_SSIM_WINDOW_SIZE;
+        const double c1 = std::pow(0.01 * 255, 2);
+        const double c2 = std::pow(0.03 * 255, 2);
+
+        double   ssim_sum = 0;
+        double   cs_sum   = 0;
+        uint32_t count    = 0;
+        for (uint32_t y = 0; y + WVB_SSIM_WINDOW_SIZE <= a.height; y++)
+        {
+            for (uint32_t x = 0; x + WVB_SSIM_WINDOW_SIZE <= a.width; x++)
+            {
+                double mean_a = 0, mean_b = 0;
+                for (uint32_t j = 0; j < WVB_SSIM_WINDOW_SIZE; j++)
+                {
+                    for (uint32_t i = 0; i < WVB_SSIM_WINDOW_SIZE; i++)
+                    {
+                        mean_a += a.at(x + i, y + j) / n;
+                        mean_b += b.at(x + i, y + j) / n;
+                    }
+                }
+                double var_a = 0, var_b = 0, cov = 0;
+                for (uint32_t j = 0; j < WVB_SSIM_WINDOW_SIZE; j++)
+                {
+                    for (uint32_t i = 0; i < WVB_SSIM_WINDOW_SIZE; i++)
+                    {
+                        var_a += std::pow(a.at(x + i, y + j) - mean_a, 2) / (n - 1);
+                        var_b += std::pow(b.at(x + i, y + j) - mean_b, 2) / (n - 1);
+                        cov += (a.at(x + i, y + j) - mean_a) * (b.at(x + i, y + j) - mean_b) / (n - 1);
+                    }
+                }
+                const double cs = (2 * cov + c2) / (var_a + var_b + c2);
+                ssim_sum += (2 * mean_a * mean_b + c1) / (mean_a * mean_a + mean_b * mean_b + c1) * cs;
+                cs_sum += cs;
+                count++;
+            }
+        }
+        return {ssim_sum / count, cs_sum / count};
+    }
+
+    wvb::ImageQualityMetrics metrics(const std::vector<Channel> &a, const std::vector<Channel> &b)
+    {
+        const double weights[WVB_MS_SSIM_NB_SCALES] = {0.0448, 0.2856, 0.3001, 0.2363, 0.1333};
+
+        wvb::ImageQualityMetrics result;
+        double                   squared_error = 0;
+        double                   nb_samples    = 0;
+        for (size_t c = 0; c < a.size(); c++)
+        {
+            for (size_t i = 0; i < a[c].samples.size(); i++)
+            {
+                squared_error += std::pow(a[c].samples[i] - b[c].samples[i], 2);
+            }
+            nb_samples += static_cast<double>(a[c].samples.size());
+        }
+        result.psnr = 10 * std::log10(255.0 * 255.0 / (squared_error / nb_samples));
+
+        for (size_t c = 0; c < a.size(); c++)
+        {
+            const double weight = static_cast<double>(a[c].samples.size()) / nb_samples;
+            result.ssim += weight * ssim(a[c], b[c]).first;
+
+            // Scales that fit the smallest channel
+            uint32_t nb_scales = 0;
+            uint32_t min_size  = std::numeric_limits<uint32_t>::max();
+            for (const auto &channel : a)
+            {
+                min_size = std::min({min_size, channel.width, channel.height});
+            }
+            while (nb_scales < WVB_MS_SSIM_NB_SCALES && (min_size >> nb_scales) >= WVB_SSIM_WINDOW_SIZE)
+            {
+                nb_scales++;
+            }
+            double total_weight = 0;
+            for (uint32_t s = 0; s < nb_scales; s++)
+            {
+                total_weight += weights[s];
+            }
+
+            Channel x       = a[c];
+            Channel y       = b[c];
+            double  ms_ssim = 1;
+            for (uint32_t s = 0; s < nb_scales; s++)
+            {
+                const auto [scale_ssim, scale_cs] = ssim(x, y);
+                ms_ssim *= std::pow(std::max(s + 1 == nb_scales ? scale_ssim : scale_cs, 0.0), weights[s] / total_weight);
+                x = downsample(x);
+                y = downsample(y);
+            }
+            result.ms_ssim += weight * ms_ssim;
+        }
+        return result;
+    }
+
+    std::vector<Channel> rgb_channels(const std::vector<uint8_t> &rgba, uint32_t width, uint32_t height)
+    {
+        return {
+            extract(rgba.data(), width, height, width * 4, 4),
+            extract(rgba.data() + 1, width, height, width * 4, 4),
+            extract(rgba.data() + 2, width, height, width * 4, 4),
+        };
+    }
+
+    std::vector<Channel> nv12_channels(const std::vector<uint8_t> &nv12, uint32_t width, uint32_t height)
+    {
+        const uint8_t *uv = nv12.data() + width * height;
+        return {
+            extract(nv12.data(), width, height, width, 1),
+            extract(uv, width / 2, height / 2, width, 2),
+            extract(uv + 1, width / 2, height / 2, width, 2),
+        };
+    }
+} // namespace reference
+
+/** Deterministic noise in [-NOISE_RANGE / 2, NOISE_RANGE / 2), plus a darker band to vary the structure of the distortion. */
+std::vector<uint8_t> distort(const std::vector<uint8_t> &image, uint32_t width)
+{
+    std::vector<uint8_t> result(image.size());
+    uint32_t             state = 12345;
+    for (size_t i = 0; i < image.size(); i++)
+    {
+        state                = state * 1664525 + 1013904223;
+        const int32_t noise  = static_cast<int32_t>(state >> 24) % NOISE_RANGE - NOISE_RANGE / 2;
+        const int32_t shadow = (i / 4 % width) < width / 3 ? -30 : 0;
+        result[i]            = static_cast<uint8_t>(std::clamp(image[i] + noise + shadow, 0, 255));
+    }
+    return result;
+}
+
+/** BT.601 limited range conversion, with the chroma of the top-left pixel of each 2x2 block. */
+std::vector<uint8_t> to_nv12(const std::vector<uint8_t> &rgba, uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> nv12(width * height * 3 / 2);
+    uint8_t             *uv = nv12.data() + width * height;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const double r = rgba[(y * width + x) * 4];
+            const double g = rgba[(y * width + x) * 4 + 1];
+            const double b = rgba[(y * width + x) * 4 + 2];
+
+            nv12[y * width + x] = static_cast<uint8_t>(std::lround(16 + 0.257 * r + 0.504 * g + 0.098 * b));
+            if (x % 2 == 0 && y % 2 == 0)
+            {
+                uv[y / 2 * width + x]     = static_cast<uint8_t>(std::lround(128 - 0.148 * r - 0.291 * g + 0.439 * b));
+                uv[y / 2 * width + x + 1] = static_cast<uint8_t>(std::lround(128 + 0.439 * r - 0.368 * g - 0.071 * b));
+            }
+        }
+    }
+    return nv12;
+}
+
+wvb::RawFrame rgba_frame(std::vector<uint8_t> &image, uint32_t width, uint32_t height)
+{
+    wvb::RawFrame frame {.format = wvb::ImageFormat::R8G8B8A8_UNORM, .width = width, .height = height};
+    frame.data[0]  = image.data();
+    frame.pitch[0] = width * 4;
+    return frame;
+}
+
+wvb::RawFrame nv12_frame(std::vector<uint8_t> &image, uint32_t width, uint32_t height)
+{
+    wvb::RawFrame frame {.format = wvb::ImageFormat::NV12, .width = width, .height = height};
+    frame.data[0]  = image.data();
+    frame.data[1]  = image.data() + width * height;
+    frame.pitch[0] = width;
+    frame.pitch[1] = width;
+    return frame;
+}
+
+bool metrics_match(const wvb::ImageQualityMetrics &a, const wvb::ImageQualityMetrics &b)
+{
+    return std::abs(a.psnr - b.psnr) < 1e-9 && std::abs(a.ssim - b.ssim) < 1e-5 && std::abs(a.ms_ssim - b.ms_ssim) < 1e-5;
+}
+
+TEST
+{
+    int      width, height, n_channels;
+    uint8_t *loaded = stbi_load("resources/frame_1000_rgba.png", &width, &height, &n_channels, 4);
+    ASSERT_NOT_NULL(loaded);
+    std::vector<uint8_t> image(loaded, loaded + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(loaded);
+    std::vector<uint8_t> distorted = distort(image, width);
+
+    // Crop, matches the reference implementation
+    std::vector<uint8_t> crop;
+    for (uint32_t y = CROP_Y; y < CROP_Y + CROP_HEIGHT; y++)
+    {
+        const auto row = image.begin() + (static_cast<size_t>(y) * width + CROP_X) * 4;
+        crop.insert(crop.end(), row, row + CROP_WIDTH * 4);
+    }
+    std::vector<uint8_t> distorted_crop = distort(crop, CROP_WIDTH);
+
+    const auto crop_metrics = wvb::compute_image_quality(rgba_frame(crop, CROP_WIDTH, CROP_HEIGHT),
+                                                         rgba_frame(distorted_crop, CROP_WIDTH, CROP_HEIGHT),
+                                                         3);
+    const auto expected     = reference::metrics(reference::rgb_channels(crop, CROP_WIDTH, CROP_HEIGHT),
+                                             reference::rgb_channels(distorted_crop, CROP_WIDTH, CROP_HEIGHT));
+    EXPECT_TRUE(metrics_match(crop_metrics, expected));
+    EXPECT_TRUE(std::abs(crop_metrics.psnr - PYTHON_CROP_PSNR) < PYTHON_TOLERANCE);
+    EXPECT_TRUE(std::abs(crop_metrics.ssim - PYTHON_CROP_SSIM) < PYTHON_TOLERANCE);
+    EXPECT_TRUE(crop_metrics.ssim > 0.1 && crop_metrics.ssim < 0.99);
+    EXPECT_TRUE(crop_metrics.ms_ssim > crop_metrics.ssim);
+
+    // NV12, with a chroma plane of odd width
+    const uint32_t       nv12_width  = CROP_WIDTH - 1;
+    const uint32_t       nv12_height = CROP_HEIGHT - 1;
+    std::vector<uint8_t> even_crop;
+    for (uint32_t y = 0; y < nv12_height; y++)
+    {
+        even_crop.insert(even_crop.end(), crop.begin() + y * CROP_WIDTH * 4, crop.begin() + (y * CROP_WIDTH + nv12_width) * 4);
+    }
+    std::vector<uint8_t> nv12           = to_nv12(even_crop, nv12_width, nv12_height);
+    std::vector<uint8_t> distorted_nv12 = to_nv12(distort(even_crop, nv12_width), nv12_width, nv12_height);
+    const auto           nv12_metrics   = wvb::compute_image_quality(nv12_frame(nv12, nv12_width, nv12_height),
+                                                                 nv12_frame(distorted_nv12, nv12_width, nv12_height));
+    EXPECT_TRUE(metrics_match(nv12_metrics,
+                              reference::metrics(reference::nv12_channels(nv12, nv12_width, nv12_height),
+                                                 reference::nv12_channels(distorted_nv12, nv12_width, nv12_height))));
+
+    // The results don't depend on the number of threads
+    const auto full_frame           = rgba_frame(image, width, height);
+    const auto full_distorted_frame = rgba_frame(distorted, width, height);
+    const auto single_thread        = wvb::compute_image_quality(full_frame, full_distorted_frame, 1);
+    EXPECT_TRUE(std::abs(single_thread.psnr - PYTHON_FULL_PSNR) < PYTHON_TOLERANCE);
+    EXPECT_TRUE(std::abs(single_thread.ssim - PYTHON_FULL_SSIM) < PYTHON_TOLERANCE);
+    for (uint32_t nb_threads : {2u, 7u, 0u})
+    {
+        const auto metrics = wvb::compute_image_quality(full_frame, full_distorted_frame, nb_threads);
+        EXPECT_EQ(metrics.psnr, single_thread.psnr);
+        EXPECT_EQ(metrics.ssim, single_thread.ssim);
+        EXPECT_EQ(metrics.ms_ssim, single_thread.ms_ssim);
+    }
+
+    // Identical images, alpha is ignored
+    std::vector<uint8_t> transparent = image;
+    for (size_t i = 3; i < transparent.size(); i += 4)
+    {
+        transparent[i] = 0;
+    }
+    const auto identical = wvb::compute_image_quality(full_frame, rgba_frame(transparent, width, height));
+    EXPECT_TRUE(std::isinf(identical.psnr));
+    EXPECT_TRUE(std::abs(identical.ssim - 1) < 1e-6);
+    EXPECT_TRUE(std::abs(identical.ms_ssim - 1) < 1e-6);
+
+    // Constant offset
+    std::vector<uint8_t> dark(crop.size());
+    std::vector<uint8_t> offset(crop.size());
+    for (size_t i = 0; i < crop.size(); i++)
+    {
+        dark[i]   = std::min<uint8_t>(crop[i], 200);
+        offset[i] = dark[i] + OFFSET;
+    }
+    const auto offset_metrics =
+        wvb::compute_image_quality(rgba_frame(dark, CROP_WIDTH, CROP_HEIGHT), rgba_frame(offset, CROP_WIDTH, CROP_HEIGHT));
+    EXPECT_TRUE(std::abs(offset_metrics.psnr - 20 * std::log10(255.0 / OFFSET)) < 1e-9);
+
+    // Invalid inputs
+    wvb::RawFrame bgra_frame = full_frame;
+    bgra_frame.format        = wvb::ImageFormat::B8G8R8A8_UNORM;
+    EXPECT_THROWS(wvb::compute_image_quality(full_frame, bgra_frame));
+    EXPECT_THROWS(wvb::compute_image_quality(full_frame, rgba_frame(crop, CROP_WIDTH, CROP_HEIGHT)));
+    EXPECT_THROWS(wvb::compute_image_quality(rgba_frame(crop, WVB_SSIM_WINDOW_SIZE - 1, CROP_HEIGHT),
+                                             rgba_frame(crop, WVB_SSIM_WINDOW_SIZE - 1, CROP_HEIGHT)));
+    EXPECT_THROWS(wvb::compute_image_quality(nv12_frame(nv12, 12, 12), nv12_frame(nv12, 12, 12)));
+    wvb::RawFrame empty_frame = full_frame;
+    empty_frame.data[0]       = nullptr;
+    EXPECT_THROWS(wvb::compute_image_quality(full_frame, empty_frame));
+}
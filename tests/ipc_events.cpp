@@ -1,8 +1,11 @@
 #include <wvb_common/ipc.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <test_framework.hpp>
 #include <thread>
+#include <vector>
 
 struct SharedState
 {
@@ -12,6 +15,58 @@ struct SharedState
 #define MUTEX_NAME  "TEST_MUTEX"
 #define MEMORY_NAME "TEST_MEMORY"
 
+#define NB_ROUND_TRIPS 10000
+
+/** Measures the round trip latency between two threads signaling each other, and prints its percentiles. Returns the number of
+ * completed round trips. */
+size_t run_ping_pong(wvb::EventBackend backend, const char *name)
+{
+    wvb::InterProcessEvent ping_sender("TEST_PING", true, wvb::EventResetMode::AUTO, backend);
+    wvb::InterProcessEvent pong_receiver("TEST_PONG", false, wvb::EventResetMode::AUTO, backend);
+
+    std::thread other(
+        [&]
+        {
+            wvb::InterProcessEvent ping_receiver("TEST_PING", false, wvb::EventResetMode::AUTO, backend);
+            wvb::InterProcessEvent pong_sender("TEST_PONG", true, wvb::EventResetMode::AUTO, backend);
+            for (uint32_t i = 0; i < NB_ROUND_TRIPS; i++)
+            {
+                if (!ping_receiver.wait(1000))
+                {
+                    return;
+                }
+                pong_sender.signal();
+            }
+        });
+
+    // Give the other thread time to open the events
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::vector<int64_t> round_trips_ns;
+    round_trips_ns.reserve(NB_ROUND_TRIPS);
+    for (uint32_t i = 0; i < NB_ROUND_TRIPS; i++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        ping_sender.signal();
+        if (!pong_receiver.wait(1000))
+        {
+            break;
+        }
+        round_trips_ns.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+    other.join();
+
+    if (round_trips_ns.empty())
+    {
+        return 0;
+    }
+    std::sort(round_trips_ns.begin(), round_trips_ns.end());
+    std::cout << name << " round trip: p50 " << round_trips_ns[round_trips_ns.size() / 2] / 1000 << " us, p99 "
+              << round_trips_ns[round_trips_ns.size() * 99 / 100] / 1000 << " us, max " << round_trips_ns.back() / 1000 << " us\n";
+    return round_trips_ns.size();
+}
+
 TEST
 {
     std::thread t1(
@@ -118,4 +173,38 @@ TEST
     // Join threads
     t1.join();
     t2.join();
-}
\ No newline at end of file
+
+    // Reset modes and timeouts are identical for every backend
+    for (auto backend : {wvb::EventBackend::DEFAULT, wvb::EventBackend::SEMAPHORE})
+    {
+        wvb::InterProcessEvent sender("TEST_SEMANTICS_AUTO", true, wvb::EventResetMode::AUTO, backend);
+        wvb::InterProcessEvent receiver("TEST_SEMANTICS_AUTO", false, wvb::EventResetMode::AUTO, backend);
+        ASSERT_TRUE(sender.is_valid());
+        ASSERT_TRUE(receiver.is_valid());
+
+        // Timeout
+        const auto start = std::chrono::steady_clock::now();
+        EXPECT_FALSE(receiver.wait(20));
+        EXPECT_TRUE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+
+        // Auto reset: a wait consumes the signal
+        sender.signal();
+        EXPECT_TRUE(receiver.is_signaled());
+        EXPECT_TRUE(receiver.wait(0));
+        EXPECT_FALSE(receiver.is_signaled());
+        EXPECT_FALSE(receiver.wait(0));
+
+        // Manual reset: the event stays signaled until reset
+        wvb::InterProcessEvent manual_sender("TEST_SEMANTICS_MANUAL", true, wvb::EventResetMode::MANUAL, backend);
+        wvb::InterProcessEvent manual_receiver("TEST_SEMANTICS_MANUAL", false, wvb::EventResetMode::MANUAL, backend);
+        manual_sender.signal();
+        EXPECT_TRUE(manual_receiver.wait(10));
+        EXPECT_TRUE(manual_receiver.wait(10));
+        manual_receiver.reset();
+        EXPECT_FALSE(manual_receiver.wait(0));
+    }
+
+    // Latency of each implementation
+    EXPECT_EQ(run_ping_pong(wvb::EventBackend::DEFAULT, "Default"), (size_t) NB_ROUND_TRIPS);
+    EXPECT_EQ(run_ping_pong(wvb::EventBackend::SEMAPHORE, "Semaphore"), (size_t) NB_ROUND_TRIPS);
+}
@@ -0,0 +1,186 @@
+#include <wvb_common/ipc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <test_framework.hpp>
+#include <vector>
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define MUTEX_NAME "test_seqlock_mutex"
+// ftok needs an existing file: use the test executable so that the key doesn't collide with the other tests
+#define MEMORY_NAME "/proc/self/exe"
+#define NB_WRITES   200000
+// Same order of magnitude as a TrackingState
+#define PAYLOAD_NB_WORDS 24
+
+struct Payload
+{
+    uint64_t words[PAYLOAD_NB_WORDS];
+};
+
+struct Percentiles
+{
+    uint64_t p50  = 0;
+    uint64_t p99  = 0;
+    uint64_t p999 = 0;
+    uint64_t max  = 0;
+};
+
+struct StressState
+{
+    wvb::SeqLock<Payload> published;
+    Payload               locked;
+    std::atomic<bool>     writer_done;
+    Percentiles           write_latencies;
+};
+
+Percentiles compute_percentiles(std::vector<uint64_t> &latencies)
+{
+    if (latencies.empty())
+    {
+        return {};
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    return {
+        .p50  = latencies[latencies.size() / 2],
+        .p99  = latencies[latencies.size() * 99 / 100],
+        .p999 = latencies[latencies.size() * 999 / 1000],
+        .max  = latencies.back(),
+    };
+}
+
+void print_percentiles(const char *name, const Percentiles &percentiles)
+{
+    std::cout << "  " << name << ": p50 " << percentiles.p50 << " ns, p99 " << percentiles.p99 << " ns, p99.9 " << percentiles.p999
+              << " ns, max " << percentiles.max << " ns\n";
+}
+
+/** All words are written with the same value, so a torn read has different words. */
+bool is_torn(const Payload &payload)
+{
+    return std::any_of(std::begin(payload.words), std::end(payload.words), [&](uint64_t word) { return word != payload.words[0]; });
+}
+
+uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+TEST
+{
+#ifdef __linux__
+    wvb::SharedMemory<StressState> shared_memory(MUTEX_NAME, MEMORY_NAME);
+    ASSERT_TRUE(shared_memory.is_valid());
+    auto *state = shared_memory.unlocked();
+    ASSERT_TRUE(state != nullptr);
+
+    // An empty SeqLock is readable
+    Payload payload {};
+    EXPECT_TRUE(state->published.load(payload));
+    EXPECT_EQ(state->published.version(), (uint32_t) 0);
+
+    for (bool use_seqlock : {true, false})
+    {
+        state->writer_done = false;
+        state->published.store({});
+        {
+            auto lock    = shared_memory.lock();
+            lock->locked = {};
+        }
+        const uint32_t initial_version = state->published.version();
+
+        // The writer runs in another process, as the driver would
+        const pid_t pid = fork();
+        ASSERT_TRUE(pid >= 0);
+        if (pid == 0)
+        {
+            std::vector<uint64_t> latencies;
+            latencies.reserve(NB_WRITES);
+
+            Payload written {};
+            for (uint64_t i = 1; i <= NB_WRITES; i++)
+            {
+                std::fill(std::begin(written.words), std::end(written.words), i);
+
+                const auto start = std::chrono::steady_clock::now();
+                if (use_seqlock)
+                {
+                    state->published.store(written);
+                }
+                else
+                {
+                    auto lock    = shared_memory.lock();
+                    lock->locked = written;
+                }
+                latencies.push_back(elapsed_ns(start));
+            }
+
+            state->write_latencies = compute_percentiles(latencies);
+            state->writer_done     = true;
+
+            // Skip the destructors, the shared memory and the semaphore belong to the parent
+            _exit(0);
+        }
+
+        // Read continuously while the writer is running
+        std::vector<uint64_t> latencies;
+        latencies.reserve(4 * NB_WRITES);
+        uint32_t nb_torn_reads   = 0;
+        uint32_t nb_failed_reads = 0;
+        uint64_t last_value      = 0;
+        bool     is_monotonic    = true;
+        while (!state->writer_done)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            if (use_seqlock)
+            {
+                if (!state->published.load(payload))
+                {
+                    nb_failed_reads++;
+                    continue;
+                }
+            }
+            else
+            {
+                auto lock = shared_memory.lock();
+                payload   = lock->locked;
+            }
+            latencies.push_back(elapsed_ns(start));
+
+            if (is_torn(payload))
+            {
+                nb_torn_reads++;
+            }
+            is_monotonic = is_monotonic && payload.words[0] >= last_value;
+            last_value   = payload.words[0];
+        }
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        std::cout << (use_seqlock ? "SeqLock" : "Semaphore") << " (" << latencies.size() << " reads, " << NB_WRITES << " writes):\n";
+        print_percentiles("read", compute_percentiles(latencies));
+        print_percentiles("write", state->write_latencies);
+
+        EXPECT_EQ(nb_torn_reads, (uint32_t) 0);
+        // The writer never pauses here, which can starve the readers. This is much more than what the driver writes.
+        std::cout << "  failed reads: " << nb_failed_reads << "\n";
+        EXPECT_TRUE(nb_failed_reads < latencies.size() / 10);
+        EXPECT_TRUE(is_monotonic);
+
+        if (use_seqlock)
+        {
+            // Every write is counted, and the last one is visible
+            EXPECT_EQ(state->published.version(), initial_version + NB_WRITES);
+            EXPECT_TRUE(state->published.load(payload));
+            EXPECT_EQ(payload.words[0], (uint64_t) NB_WRITES);
+        }
+    }
+#endif
+}
@@ -0,0 +1,142 @@
+#include <wvb_common/ipc.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <test_framework.hpp>
+#include <thread>
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define MUTEX_NAME "test_shared_ring_mutex"
+// ftok needs an existing file: use the test executable so that the key doesn't collide with the other tests
+#define MEMORY_NAME   "/proc/self/exe"
+#define RING_CAPACITY 1024
+#define NB_ITEMS      2000000
+
+/** Same order of magnitude as a driver measurement. */
+struct Item
+{
+    uint64_t sequence;
+    uint64_t payload[3];
+};
+
+struct RingState
+{
+    wvb::SharedRing<Item, RING_CAPACITY> ring;
+    std::atomic<bool>                    producer_done;
+};
+
+Item make_item(uint64_t sequence)
+{
+    return {sequence, {sequence * 3, sequence * 5, sequence * 7}};
+}
+
+bool is_valid_item(const Item &item, uint64_t expected_sequence)
+{
+    const auto expected = make_item(expected_sequence);
+    return item.sequence == expected.sequence && item.payload[0] == expected.payload[0] && item.payload[1] == expected.payload[1]
+           && item.payload[2] == expected.payload[2];
+}
+
+TEST
+{
+    // Single process
+    auto small_ring = std::make_unique<wvb::SharedRing<Item, 4>>();
+    EXPECT_TRUE(small_ring->empty());
+    for (uint64_t i = 1; i <= 4; i++)
+    {
+        EXPECT_TRUE(small_ring->push(make_item(i)));
+    }
+    EXPECT_TRUE(small_ring->full());
+
+    // The producer never waits: when full, values are dropped and counted
+    EXPECT_FALSE(small_ring->push(make_item(5)));
+    EXPECT_EQ(small_ring->nb_dropped(), (uint64_t) 1);
+    EXPECT_EQ(small_ring->size(), (size_t) 4);
+
+    Item item {};
+    EXPECT_TRUE(small_ring->pop(item));
+    EXPECT_TRUE(is_valid_item(item, 1));
+
+    // Slots are reused after the end of the buffer
+    EXPECT_TRUE(small_ring->push(make_item(5)));
+    uint64_t expected_sequence = 2;
+    bool     is_in_order       = true;
+    EXPECT_EQ(small_ring->drain([&](const Item &value) { is_in_order = is_in_order && is_valid_item(value, expected_sequence++); }),
+              (size_t) 4);
+    EXPECT_TRUE(is_in_order);
+    EXPECT_FALSE(small_ring->pop(item));
+
+    small_ring->push(make_item(6));
+    small_ring->clear();
+    EXPECT_TRUE(small_ring->empty());
+    EXPECT_EQ(small_ring->nb_dropped(), (uint64_t) 0);
+
+#ifdef __linux__
+    // Two processes, like the driver and the server
+    wvb::SharedMemory<RingState> shared_memory(MUTEX_NAME, MEMORY_NAME);
+    ASSERT_TRUE(shared_memory.is_valid());
+    auto *state = shared_memory.unlocked();
+    ASSERT_TRUE(state != nullptr);
+    state->ring.clear();
+    state->producer_done = false;
+
+    const auto  start = std::chrono::steady_clock::now();
+    const pid_t pid   = fork();
+    ASSERT_TRUE(pid >= 0);
+    if (pid == 0)
+    {
+        for (uint64_t i = 1; i <= NB_ITEMS; i++)
+        {
+            // Wait for space instead of dropping, to measure the throughput
+            while (state->ring.full())
+            {
+                std::this_thread::yield();
+            }
+            state->ring.push(make_item(i));
+        }
+        state->producer_done = true;
+
+        // Skip the destructors, the shared memory and the semaphore belong to the parent
+        _exit(0);
+    }
+
+    // Drain continuously, like the server
+    expected_sequence         = 1;
+    uint64_t nb_invalid_items = 0;
+    uint64_t nb_drains        = 0;
+    while (!state->producer_done || !state->ring.empty())
+    {
+        const auto nb_drained = state->ring.drain(
+            [&](const Item &value)
+            {
+                if (!is_valid_item(value, expected_sequence))
+                {
+                    nb_invalid_items++;
+                }
+                expected_sequence = value.sequence + 1;
+            });
+        if (nb_drained == 0)
+        {
+            std::this_thread::yield();
+        }
+        nb_drains++;
+    }
+    const auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    std::cout << NB_ITEMS << " items of " << sizeof(Item) << " bytes in " << elapsed_us / 1000 << " ms: "
+              << static_cast<double>(NB_ITEMS) / static_cast<double>(elapsed_us) << " M items/s, "
+              << static_cast<double>(NB_ITEMS) / static_cast<double>(nb_drains) << " items per drain\n";
+
+    EXPECT_EQ(nb_invalid_items, (uint64_t) 0);
+    EXPECT_EQ(expected_sequence, (uint64_t) NB_ITEMS + 1);
+    EXPECT_EQ(state->ring.nb_dropped(), (uint64_t) 0);
+#endif
+}
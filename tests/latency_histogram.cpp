@@ -0,0 +1,177 @@
+#include <wvb_common/benchmark.h>
+#include <wvb_common/latency_histogram.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <test_framework.hpp>
+#include <vector>
+
+#define NB_SAMPLES 100000
+// Latencies around 5 ms, with a long tail
+#define MEDIAN_LATENCY_NS 5000000.0
+#define LATENCY_SIGMA     0.5
+
+static const double QUANTILES[] = {0.01, 0.1, 0.5, 0.9, 0.99, 0.999};
+
+/** Exact quantile of sorted values, with the same rank as the histograms. */
+int64_t exact_quantile(const std::vector<int64_t> &sorted_values, double quantile)
+{
+    const auto rank = std::max(static_cast<size_t>(std::ceil(quantile * static_cast<double>(sorted_values.size()))), (size_t) 1);
+    return sorted_values[rank - 1];
+}
+
+TEST
+{
+    // Bucket boundaries are contiguous, and values up to the precision have their own bucket
+    uint32_t nb_boundary_errors = 0;
+    for (size_t i = 0; i + 1 < wvb::LatencyHistogram::NB_BUCKETS; i++)
+    {
+        nb_boundary_errors += wvb::LatencyHistogram::bucket_highest_value(i) + 1 != wvb::LatencyHistogram::bucket_lowest_value(i + 1);
+        nb_boundary_errors += wvb::LatencyHistogram::bucket_index(wvb::LatencyHistogram::bucket_lowest_value(i)) != i;
+        nb_boundary_errors += wvb::LatencyHistogram::bucket_index(wvb::LatencyHistogram::bucket_highest_value(i)) != i;
+    }
+    EXPECT_EQ(nb_boundary_errors, (uint32_t) 0);
+    EXPECT_EQ(wvb::LatencyHistogram::bucket_index(200), (size_t) 200);
+    EXPECT_EQ(wvb::LatencyHistogram::bucket_index(wvb::LatencyHistogram::MAX_VALUE), wvb::LatencyHistogram::NB_BUCKETS - 1);
+
+    std::mt19937                     rng(42);
+    std::lognormal_distribution<>    distribution(std::log(MEDIAN_LATENCY_NS), LATENCY_SIGMA);
+    std::vector<int64_t>             values;
+    wvb::LatencyHistogram            histogram;
+    wvb::LatencyHistogram            first_half;
+    wvb::LatencyHistogram            second_half;
+    wvb::QuantileSketch              sketch;
+    std::vector<wvb::QuantileSketch> half_sketches(2);
+    values.reserve(NB_SAMPLES);
+    for (uint32_t i = 0; i < NB_SAMPLES; i++)
+    {
+        const auto value = static_cast<int64_t>(distribution(rng));
+        values.push_back(value);
+        histogram.record(value);
+        (i < NB_SAMPLES / 2 ? first_half : second_half).record(value);
+        sketch.add(static_cast<double>(value));
+        half_sketches[i % 2].add(static_cast<double>(value));
+    }
+
+    std::vector<int64_t> sorted_values = values;
+    std::sort(sorted_values.begin(), sorted_values.end());
+    EXPECT_EQ(histogram.count(), (uint64_t) NB_SAMPLES);
+    EXPECT_EQ(histogram.min(), sorted_values.front());
+    EXPECT_EQ(histogram.max(), sorted_values.back());
+
+    // The exact median is still available for small checks
+    std::vector<int64_t> median_values = values;
+    const int64_t        exact_median  = wvb::compute_median(median_values);
+    EXPECT_TRUE(std::abs(static_cast<double>(histogram.value_at_quantile(0.5) - exact_median)) <= exact_median / 128.0);
+
+    // Histogram quantiles are at most one bucket above the exact ones, and sketch quantiles within its relative accuracy
+    double max_histogram_error = 0;
+    double max_sketch_error    = 0;
+    for (double quantile : QUANTILES)
+    {
+        const auto exact           = static_cast<double>(exact_quantile(sorted_values, quantile));
+        const auto histogram_value = static_cast<double>(histogram.value_at_quantile(quantile));
+        EXPECT_TRUE(histogram_value >= exact);
+        max_histogram_error = std::max(max_histogram_error, (histogram_value - exact) / exact);
+        max_sketch_error    = std::max(max_sketch_error, std::abs(sketch.value_at_quantile(quantile) - exact) / exact);
+    }
+    std::cout << "Max relative error: histogram " << max_histogram_error << ", sketch " << max_sketch_error << "\n";
+    EXPECT_TRUE(max_histogram_error <= 1.0 / 128);
+    EXPECT_TRUE(max_sketch_error <= WVB_QUANTILE_SKETCH_RELATIVE_ACCURACY);
+
+    // Merging is exact
+    wvb::LatencyHistogram merged;
+    merged.merge(first_half);
+    merged.merge(second_half);
+    wvb::QuantileSketch merged_sketch;
+    merged_sketch.merge(half_sketches[0]);
+    merged_sketch.merge(half_sketches[1]);
+    EXPECT_EQ(merged.count(), histogram.count());
+    EXPECT_EQ(merged_sketch.count(), sketch.count());
+    for (double quantile : QUANTILES)
+    {
+        EXPECT_EQ(merged.value_at_quantile(quantile), histogram.value_at_quantile(quantile));
+        EXPECT_EQ(merged_sketch.value_at_quantile(quantile), sketch.value_at_quantile(quantile));
+    }
+
+    // A sketch summarizing histograms keeps both precisions
+    wvb::QuantileSketch summary;
+    summary.add(first_half);
+    summary.add(second_half);
+    EXPECT_EQ(summary.count(), histogram.count());
+    EXPECT_EQ(summary.min(), static_cast<double>(histogram.min()));
+    EXPECT_EQ(summary.max(), static_cast<double>(histogram.max()));
+    for (double quantile : QUANTILES)
+    {
+        const auto exact = static_cast<double>(exact_quantile(sorted_values, quantile));
+        EXPECT_TRUE(std::abs(summary.value_at_quantile(quantile) - exact) / exact
+                    <= WVB_QUANTILE_SKETCH_RELATIVE_ACCURACY + 1.0 / 128);
+    }
+
+    // Out of range values are clamped and counted
+    wvb::LatencyHistogram clamped;
+    clamped.record(-1000);
+    clamped.record(wvb::LatencyHistogram::MAX_VALUE + 1);
+    EXPECT_EQ(clamped.nb_out_of_range(), (uint64_t) 2);
+    EXPECT_EQ(clamped.value_at_quantile(0), (int64_t) 0);
+    EXPECT_EQ(clamped.value_at_quantile(1), wvb::LatencyHistogram::MAX_VALUE);
+    clamped.reset();
+    EXPECT_TRUE(clamped.empty());
+    EXPECT_EQ(clamped.value_at_quantile(0.5), (int64_t) 0);
+
+    // Sketches keep the high quantiles when they have too many buckets
+    wvb::QuantileSketch wide_sketch;
+    for (int32_t exponent = 0; exponent < 60; exponent++)
+    {
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            wide_sketch.add(std::pow(2.0, exponent) * (1 + i / 100.0));
+        }
+    }
+    const double top_value = std::pow(2.0, 59) * 1.99;
+    EXPECT_TRUE(std::abs(wide_sketch.value_at_quantile(1) - top_value) / top_value <= WVB_QUANTILE_SKETCH_RELATIVE_ACCURACY);
+
+    // Stages are computed from the frames measured by both sides
+    wvb::StageLatencyHistograms stages;
+    stages.record_frames(
+        {
+            {.frame_id                      = 1,
+             .shared_texture_acquired_ns    = 1000000,
+             .after_last_get_next_packet_ns = 4000000,
+             .after_last_send_packet_ns     = 4500000},
+            {.dropped = true, .frame_id = 2},
+        },
+        {
+            {.frame_id                = 1,
+             .tracking_ns             = 500000,
+             .last_packet_received_ns = 6500000,
+             .pushed_to_decoder_ns    = 6600000,
+             .after_render_ns         = 9600000,
+             .end_frame_ns            = 10000000,
+             .predicted_present_ns    = 30500000},
+            {.frame_id = 2, .pushed_to_decoder_ns = 1000, .after_render_ns = 2000},
+        });
+    EXPECT_EQ(stages.stages[static_cast<size_t>(wvb::LatencyStage::ENCODE)].value_at_quantile(0.5), (int64_t) 3000000);
+    EXPECT_EQ(stages.stages[static_cast<size_t>(wvb::LatencyStage::SEND)].max(), (int64_t) 500000);
+    EXPECT_EQ(stages.stages[static_cast<size_t>(wvb::LatencyStage::NETWORK)].count(), (uint64_t) 1);
+    EXPECT_EQ(stages.stages[static_cast<size_t>(wvb::LatencyStage::NETWORK)].max(), (int64_t) 2000000);
+    EXPECT_EQ(stages.stages[static_cast<size_t>(wvb::LatencyStage::DECODE)].count(), (uint64_t) 2);
+    EXPECT_EQ(stages.stages[static_cast<size_t>(wvb::LatencyStage::MOTION_TO_PHOTON)].max(), (int64_t) 30000000);
+
+    // The server bucket records its stages as the frames are measured
+    wvb::ServerMeasurementBucket bucket;
+    bucket.set_clock(std::make_shared<wvb::rtp::RTPClock>());
+    bucket.set_as_accept_all();
+    bucket.add_frame_time_measurement(
+        {.frame_id = 1, .frame_pushed_ns = 1000000, .after_last_get_next_packet_ns = 3000000, .after_last_send_packet_ns = 3200000});
+    bucket.add_frame_time_measurement({.dropped = true, .frame_id = 2, .frame_pushed_ns = 1000, .after_last_get_next_packet_ns = 2000});
+    const auto &live_stages = bucket.get_stage_latencies();
+    EXPECT_EQ(live_stages.stages[static_cast<size_t>(wvb::LatencyStage::ENCODE)].count(), (uint64_t) 1);
+    EXPECT_EQ(live_stages.stages[static_cast<size_t>(wvb::LatencyStage::ENCODE)].max(), (int64_t) 2000000);
+    EXPECT_EQ(live_stages.stages[static_cast<size_t>(wvb::LatencyStage::SEND)].max(), (int64_t) 200000);
+    bucket.reset();
+    EXPECT_TRUE(bucket.get_stage_latencies().stages[static_cast<size_t>(wvb::LatencyStage::ENCODE)].empty());
+}
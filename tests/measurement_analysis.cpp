@@ -0,0 +1,275 @@
+#include <wvb_common/benchmark.h>
+#include <wvb_common/columnar_file.h>
+#include <wvb_common/measurement_analysis.h>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <test_framework.hpp>
+#include <vector>
+
+#define TEST_DIRECTORY         "measurement_analysis_test"
+#define INVALID_TEST_DIRECTORY "measurement_analysis_invalid_test"
+// One pass of two runs, with its summary computed by wvb_summarize_pass() of wvb_measurements.py, in microseconds. The client times
+// are corrected with the function of wvb_get_client_clock_error_fn()
+#define SAMPLE_DIRECTORY    "resources/measurements"
+#define SAMPLE_SUMMARY_PATH SAMPLE_DIRECTORY "/python_summary_pass_1.csv"
+#define NS_PER_US           1000
+#define NB_FRAMES              100
+#define FRAME_PERIOD_NS        11111111
+#define NS_PER_MS              INT64_C(1000000)
+
+// The client clock is ahead by CLOCK_OFFSET_NS + CLOCK_DRIFT * t, and the tracking data takes at least TRACKING_DELAY_NS to reach
+// the server. Since the minimum delay is assumed to be 0 by the correction, the corrected client times are TRACKING_DELAY_NS late.
+#define CLOCK_OFFSET_NS   (50 * NS_PER_MS)
+#define CLOCK_DRIFT       1e-6
+#define TRACKING_DELAY_NS (2 * NS_PER_MS)
+
+// Durations of the stages, on a synchronized timeline
+#define ENCODE_NS           (3 * NS_PER_MS)
+#define SEND_NS             (NS_PER_MS / 2)
+#define NETWORK_NS          (3 * NS_PER_MS)
+#define DECODE_NS           (2 * NS_PER_MS)
+#define RENDER_NS           NS_PER_MS
+#define MOTION_TO_PHOTON_NS (40 * NS_PER_MS)
+
+struct RunTimes
+{
+    std::vector<wvb::DriverFrameTimeMeasurements> driver_frames;
+    std::vector<wvb::TrackingTimeMeasurements>    driver_tracking;
+    std::vector<wvb::PoseAccessTimeMeasurements>  pose_accesses;
+    std::vector<wvb::ServerFrameTimeMeasurements> server_frames;
+    std::vector<wvb::TrackingTimeMeasurements>    server_tracking;
+    std::vector<wvb::ClientFrameTimeMeasurements> client_frames;
+};
+
+int64_t clock_offset_ns(int64_t time_ns) { return CLOCK_OFFSET_NS + std::llround(CLOCK_DRIFT * static_cast<double>(time_ns)); }
+
+/** Frames of a run starting at start_ns. The clock of the client is offset by its value at the start of the run. */
+RunTimes generate_run(int64_t start_ns)
+{
+    RunTimes      times;
+    const int64_t client_offset_ns = clock_offset_ns(start_ns);
+    for (uint32_t i = 0; i < NB_FRAMES; i++)
+    {
+        const uint32_t frame_id       = i + 1;
+        const uint32_t pose_timestamp = 1000 + i * 100;
+        const int64_t  present_ns     = start_ns + static_cast<int64_t>(i) * FRAME_PERIOD_NS;
+        const int64_t  tracking_ns    = present_ns - 5 * NS_PER_MS;
+        const int64_t  sent_ns        = present_ns + NS_PER_MS + ENCODE_NS + SEND_NS;
+        const int64_t  received_ns    = sent_ns + NETWORK_NS;
+
+        times.driver_frames.push_back({.frame_id = frame_id, .present_called_ns = present_ns, .vsync_ns = present_ns + NS_PER_MS});
+        times.driver_tracking.push_back({.pose_timestamp = pose_timestamp, .tracking_received_ns = tracking_ns + NS_PER_MS});
+        times.pose_accesses.push_back({.pose_timestamp = pose_timestamp, .pose_accessed_ns = present_ns - NS_PER_MS});
+        times.server_frames.push_back({
+            .frame_id                      = frame_id,
+            .frame_pushed_ns               = present_ns + NS_PER_MS,
+            .after_last_get_next_packet_ns = present_ns + NS_PER_MS + ENCODE_NS,
+            .after_last_send_packet_ns     = sent_ns,
+        });
+        times.server_tracking.push_back({.pose_timestamp = pose_timestamp, .tracking_received_ns = tracking_ns + TRACKING_DELAY_NS});
+        times.client_frames.push_back({
+            .frame_index             = i,
+            .frame_id                = frame_id,
+            .tracking_ns             = tracking_ns + client_offset_ns,
+            .last_packet_received_ns = received_ns + client_offset_ns,
+            .pushed_to_decoder_ns    = received_ns + client_offset_ns,
+            .after_render_ns         = received_ns + DECODE_NS + client_offset_ns,
+            .end_frame_ns            = received_ns + DECODE_NS + RENDER_NS + client_offset_ns,
+            .predicted_present_ns    = tracking_ns + MOTION_TO_PHOTON_NS + client_offset_ns,
+            .pose_timestamp          = pose_timestamp,
+        });
+    }
+    return times;
+}
+
+void write_csv_run(const std::string &path, const wvb::rtp::RTPClock &clock, const RunTimes &times, bool with_client = true)
+{
+    std::ofstream file(path);
+    file << "driver_frame_time_measurements\n";
+    wvb::DriverFrameTimeMeasurements::export_csv(file, times.driver_frames);
+    file << "---\n";
+    file << "driver_tracking_measurements\n";
+    wvb::TrackingTimeMeasurements::export_csv(file, clock, times.driver_tracking);
+    file << "---\n";
+    file << "driver_pose_access_measurements\n";
+    wvb::PoseAccessTimeMeasurements::export_csv(file, clock, times.pose_accesses);
+    file << "---\n";
+    file << "server_frame_time_measurements\n";
+    wvb::ServerFrameTimeMeasurements::export_csv(file, times.server_frames);
+    file << "---\n";
+    file << "server_tracking_measurements\n";
+    wvb::TrackingTimeMeasurements::export_csv(file, clock, times.server_tracking);
+    file << "---\n";
+    if (with_client)
+    {
+        file << "client_frame_time_measurements\n";
+        wvb::ClientFrameTimeMeasurements::export_csv(file, clock, times.client_frames);
+        file << "---\n";
+    }
+}
+
+void write_binary_run(const std::string &path, const wvb::rtp::RTPClock &clock, const RunTimes &times)
+{
+    wvb::ColumnarFileWriter file(path);
+    wvb::DriverFrameTimeMeasurements::export_columns(file, "driver_frame_time_measurements", times.driver_frames);
+    wvb::TrackingTimeMeasurements::export_columns(file, "driver_tracking_measurements", clock, times.driver_tracking);
+    wvb::PoseAccessTimeMeasurements::export_columns(file, "driver_pose_access_measurements", clock, times.pose_accesses);
+    wvb::ServerFrameTimeMeasurements::export_columns(file, "server_frame_time_measurements", times.server_frames);
+    wvb::TrackingTimeMeasurements::export_columns(file, "server_tracking_measurements", clock, times.server_tracking);
+    wvb::ClientFrameTimeMeasurements::export_columns(file, "client_frame_time_measurements", clock, times.client_frames);
+    file.close();
+}
+
+bool near(double actual, double expected, double tolerance) { return std::abs(actual - expected) <= tolerance; }
+
+/** Reads the metric,value lines of a summary. */
+std::map<std::string, double> read_summary(const std::string &path)
+{
+    std::map<std::string, double> summary;
+    std::ifstream                 file(path);
+    std::string                   line;
+    std::getline(file, line);
+    while (std::getline(file, line))
+    {
+        const size_t split_pos = line.find(',');
+        if (split_pos != std::string::npos)
+        {
+            summary[line.substr(0, split_pos)] = std::stod(line.substr(split_pos + 1));
+        }
+    }
+    return summary;
+}
+
+TEST
+{
+    const wvb::rtp::RTPClock clock;
+    const int64_t            start_times_ns[] = {10000 * NS_PER_MS, 20000 * NS_PER_MS, 30000 * NS_PER_MS};
+
+    std::filesystem::remove_all(TEST_DIRECTORY);
+    std::filesystem::create_directory(TEST_DIRECTORY);
+    const std::string prefix = TEST_DIRECTORY "/" WVB_MEASUREMENT_FILE_PREFIX;
+    // Pass 1 is exported in both formats, pass 2 in binary. The CSV file of pass 2 is incomplete, so it mustn't be loaded.
+    write_csv_run(prefix + "1_run_1.csv", clock, generate_run(start_times_ns[0]));
+    write_binary_run(prefix + "1_run_2.wvbm", clock, generate_run(start_times_ns[1]));
+    write_binary_run(prefix + "2_run_1.wvbm", clock, generate_run(start_times_ns[2]));
+    write_csv_run(prefix + "2_run_1.csv", clock, generate_run(start_times_ns[2]), false);
+
+    // Loading
+    const auto run = wvb::RunFrameTimes::load(prefix + "1_run_1.csv", 1, 1);
+    ASSERT_EQ(run.driver_frames.size(), static_cast<size_t>(NB_FRAMES));
+    ASSERT_EQ(run.server_frames.size(), static_cast<size_t>(NB_FRAMES));
+    ASSERT_EQ(run.client_frames.size(), static_cast<size_t>(NB_FRAMES));
+    EXPECT_EQ(run.server_frames[10].frame_id, run.driver_frames[10].frame_id);
+    EXPECT_EQ(run.client_frames[10].end_frame_ns, generate_run(start_times_ns[0]).client_frames[10].end_frame_ns);
+    EXPECT_TRUE(run.has_clock_error);
+    // All frames have the same error, so the first one is kept
+    EXPECT_EQ(run.clock_error_time_ns, start_times_ns[0]);
+    EXPECT_EQ(run.clock_error_ns, TRACKING_DELAY_NS - clock_offset_ns(start_times_ns[0]));
+
+    const auto binary_run = wvb::RunFrameTimes::load(prefix + "1_run_2.wvbm", 1, 2);
+    EXPECT_EQ(binary_run.clock_error_ns, TRACKING_DELAY_NS - clock_offset_ns(start_times_ns[1]));
+
+    // Analysis
+    const auto analysis = wvb::analyze_measurements(TEST_DIRECTORY);
+    const auto &fit      = analysis.client_clock_error;
+    EXPECT_EQ(fit.nb_samples, 3u);
+    EXPECT_TRUE(near(fit.slope, CLOCK_DRIFT, 1e-12));
+    EXPECT_TRUE(near(fit.intercept_ns, CLOCK_OFFSET_NS - TRACKING_DELAY_NS, 1));
+
+    ASSERT_EQ(analysis.passes.size(), static_cast<size_t>(2));
+    const double expected_fps = 1e9 / FRAME_PERIOD_NS;
+    for (const auto &pass : analysis.passes)
+    {
+        const size_t nb_runs = pass.pass_id == 1 ? 2 : 1;
+        EXPECT_EQ(pass.nb_runs, static_cast<uint32_t>(nb_runs));
+        EXPECT_EQ(pass.nb_frames, static_cast<uint64_t>(nb_runs * NB_FRAMES));
+        EXPECT_TRUE(near(pass.driver_fps, expected_fps, 1e-6));
+        // The correction removes the drift of the client clock from the frame period
+        EXPECT_TRUE(near(pass.client_fps, expected_fps * (1 + CLOCK_DRIFT), 1e-6));
+
+        const auto stage = [&pass](wvb::LatencyStage stage) { return pass.latencies.stages[static_cast<size_t>(stage)]; };
+        EXPECT_EQ(stage(wvb::LatencyStage::ENCODE).count(), static_cast<uint64_t>(nb_runs * NB_FRAMES));
+        EXPECT_EQ(stage(wvb::LatencyStage::ENCODE).min(), ENCODE_NS);
+        EXPECT_EQ(stage(wvb::LatencyStage::SEND).max(), SEND_NS);
+        EXPECT_EQ(stage(wvb::LatencyStage::DECODE).mean(), static_cast<double>(DECODE_NS));
+        EXPECT_EQ(stage(wvb::LatencyStage::RENDER).mean(), static_cast<double>(RENDER_NS));
+        EXPECT_EQ(stage(wvb::LatencyStage::MOTION_TO_PHOTON).mean(), static_cast<double>(MOTION_TO_PHOTON_NS));
+        // The error is evaluated at the time of each frame, so it drifts by up to a few microseconds within a run
+        const auto &network = stage(wvb::LatencyStage::NETWORK);
+        EXPECT_TRUE(near(static_cast<double>(network.min()), NETWORK_NS + TRACKING_DELAY_NS, 2000));
+        EXPECT_TRUE(near(static_cast<double>(network.max()), NETWORK_NS + TRACKING_DELAY_NS, 2000));
+    }
+
+    // Without the correction, the offset of the client clock is in the network stage
+    const auto uncorrected = wvb::analyze_measurements(TEST_DIRECTORY, false, 1);
+    EXPECT_EQ(uncorrected.passes[1].latencies.stages[static_cast<size_t>(wvb::LatencyStage::NETWORK)].min(),
+              NETWORK_NS + clock_offset_ns(start_times_ns[2]));
+
+    // The results don't depend on the number of threads
+    const auto single_thread = wvb::analyze_measurements(TEST_DIRECTORY, true, 1);
+    EXPECT_EQ(single_thread.client_clock_error.slope, fit.slope);
+    EXPECT_EQ(single_thread.client_clock_error.intercept_ns, fit.intercept_ns);
+    for (size_t i = 0; i < analysis.passes.size(); i++)
+    {
+        EXPECT_EQ(single_thread.passes[i].client_fps, analysis.passes[i].client_fps);
+        for (size_t stage = 0; stage < WVB_LATENCY_STAGE_COUNT; stage++)
+        {
+            const auto &expected = analysis.passes[i].latencies.stages[stage];
+            const auto &actual   = single_thread.passes[i].latencies.stages[stage];
+            EXPECT_EQ(actual.count(), expected.count());
+            EXPECT_EQ(actual.mean(), expected.mean());
+            EXPECT_EQ(actual.value_at_quantile(0.99), expected.value_at_quantile(0.99));
+        }
+    }
+
+    // Sample measurements, compared to the Python tools. The times of the corrected client frames are rounded to the nanosecond,
+    // which moves the latencies that start on the server by up to 1 ns. Quantiles are the highest value of their histogram bucket,
+    // at most 1 / 2^WVB_LATENCY_HISTOGRAM_PRECISION_BITS above the exact value.
+    {
+        auto summary = read_summary(SAMPLE_SUMMARY_PATH);
+        ASSERT_EQ(summary.size(), static_cast<size_t>(6 + 7 * WVB_LATENCY_STAGE_COUNT));
+        const auto sample = wvb::analyze_measurements(SAMPLE_DIRECTORY);
+
+        EXPECT_EQ(sample.client_clock_error.nb_samples, 2u);
+        EXPECT_TRUE(near(sample.client_clock_error.slope, summary["client_clock_error_slope"], 1e-15));
+        EXPECT_TRUE(near(sample.client_clock_error.intercept_ns, summary["client_clock_error_intercept"] * NS_PER_US, 1));
+
+        ASSERT_EQ(sample.passes.size(), static_cast<size_t>(1));
+        const auto &pass = sample.passes[0];
+        EXPECT_EQ(pass.nb_runs, static_cast<uint32_t>(summary["nb_runs"]));
+        EXPECT_EQ(pass.nb_frames, static_cast<uint64_t>(summary["nb_frames"]));
+        EXPECT_TRUE(near(pass.driver_fps, summary["driver_fps"], 1e-6));
+        EXPECT_TRUE(near(pass.client_fps, summary["client_fps"], 1e-6));
+
+        for (size_t i = 0; i < WVB_LATENCY_STAGE_COUNT; i++)
+        {
+            const double bucket_ratio = 1.0 / (1 << WVB_LATENCY_HISTOGRAM_PRECISION_BITS);
+            const auto  &stage        = pass.latencies.stages[i];
+            const auto   name         = wvb::to_string(static_cast<wvb::LatencyStage>(i));
+            const auto   value        = [&](const std::string &metric) { return summary[name + "_" + metric] * NS_PER_US; };
+
+            EXPECT_EQ(stage.count(), static_cast<uint64_t>(summary[name + "_count"]));
+            EXPECT_TRUE(near(static_cast<double>(stage.min()), value("min"), 1));
+            EXPECT_TRUE(near(stage.mean(), value("mean"), 1));
+            EXPECT_TRUE(near(static_cast<double>(stage.max()), value("max"), 1));
+            for (const auto &[metric, quantile] : {std::pair {"p50", 0.5}, std::pair {"p90", 0.9}, std::pair {"p99", 0.99}})
+            {
+                const auto actual = static_cast<double>(stage.value_at_quantile(quantile));
+                EXPECT_TRUE(actual >= value(metric) - 1 && actual <= value(metric) * (1 + bucket_ratio) + 1);
+            }
+        }
+    }
+
+    // A missing table fails the analysis
+    std::filesystem::remove_all(INVALID_TEST_DIRECTORY);
+    std::filesystem::create_directory(INVALID_TEST_DIRECTORY);
+    write_csv_run(INVALID_TEST_DIRECTORY "/" WVB_MEASUREMENT_FILE_PREFIX "1_run_1.csv", clock, generate_run(start_times_ns[0]), false);
+    EXPECT_THROWS(wvb::analyze_measurements(INVALID_TEST_DIRECTORY));
+
+    std::filesystem::remove_all(TEST_DIRECTORY);
+    std::filesystem::remove_all(INVALID_TEST_DIRECTORY);
+}
@@ -0,0 +1,195 @@
+#include <wvb_common/benchmark.h>
+#include <wvb_common/measurement_log.h>
+
+#include <atomic>
+#include <iostream>
+#include <test_framework.hpp>
+#include <thread>
+#include <vector>
+
+#define NB_WRITERS            4
+#define NB_RECORDS_PER_WRITER 100000
+// Small chunks, so that writers allocate new ones while the log is being merged
+#define CHUNK_SIZE 64
+#define MAX_CHUNKS 2048
+
+struct Record
+{
+    uint32_t writer    = 0;
+    uint32_t sequence  = 0;
+    uint64_t timestamp = 0;
+    // Copy of the sequence, to detect torn records
+    uint32_t check = 0;
+};
+
+/** Checks that the merged records are complete and in order. Returns the number of errors. */
+uint32_t count_errors(const std::vector<Record> &records, bool sorted)
+{
+    uint32_t             nb_errors = 0;
+    std::vector<int64_t> last_sequences(NB_WRITERS, -1);
+    uint64_t             last_timestamp = 0;
+    for (const auto &record : records)
+    {
+        if (record.writer >= NB_WRITERS || record.check != record.sequence)
+        {
+            nb_errors++;
+            continue;
+        }
+        // Records of a writer are never reordered nor skipped
+        if (record.sequence != last_sequences[record.writer] + 1)
+        {
+            nb_errors++;
+        }
+        last_sequences[record.writer] = record.sequence;
+
+        if (sorted && record.timestamp < last_timestamp)
+        {
+            nb_errors++;
+        }
+        last_timestamp = record.timestamp;
+    }
+    return nb_errors;
+}
+
+TEST
+{
+    // Single thread
+    wvb::MeasurementLog<Record, CHUNK_SIZE, 2> small_log;
+    EXPECT_TRUE(small_log.empty());
+    for (uint32_t i = 0; i < 2 * CHUNK_SIZE; i++)
+    {
+        EXPECT_TRUE(small_log.append({.sequence = i, .timestamp = i, .check = i}));
+    }
+    EXPECT_FALSE(small_log.append({}));
+    EXPECT_EQ(small_log.size(), (size_t) 2 * CHUNK_SIZE);
+    EXPECT_EQ(small_log.nb_dropped(), (size_t) 1);
+    EXPECT_EQ(count_errors(small_log.merged(), true), (uint32_t) 0);
+    small_log.clear();
+    EXPECT_TRUE(small_log.empty());
+    EXPECT_EQ(small_log.nb_dropped(), (size_t) 0);
+
+    // Reserved chunks are taken by the threads that start recording, instead of allocating in the measurement phase
+    wvb::MeasurementLog<Record, CHUNK_SIZE, 2> reserved_log;
+    reserved_log.reserve(2);
+    EXPECT_EQ(reserved_log.nb_spare_chunks(), (size_t) 2);
+    std::thread([&reserved_log] { reserved_log.append({.sequence = 0, .timestamp = 0, .check = 0}); }).join();
+    EXPECT_EQ(reserved_log.nb_spare_chunks(), (size_t) 1);
+    EXPECT_EQ(reserved_log.size(), (size_t) 1);
+    // Topping up only allocates the chunk that was taken
+    reserved_log.reserve(2);
+    EXPECT_EQ(reserved_log.nb_spare_chunks(), (size_t) 2);
+    // This thread fills a chunk, then starts another one
+    for (uint32_t i = 0; i < CHUNK_SIZE + 1; i++)
+    {
+        EXPECT_TRUE(reserved_log.append({.sequence = i, .timestamp = i, .check = i}));
+    }
+    EXPECT_EQ(reserved_log.nb_spare_chunks(), (size_t) 0);
+    EXPECT_EQ(reserved_log.size(), (size_t) CHUNK_SIZE + 2);
+
+    // Several writers, like the video thread and the VRCP thread, while another thread exports the measurements
+    wvb::MeasurementLog<Record, CHUNK_SIZE, MAX_CHUNKS> log;
+    std::atomic<uint64_t>                               clock {0};
+    std::atomic<uint32_t>                               nb_running_writers {NB_WRITERS};
+    std::vector<std::thread>                            writers;
+    for (uint32_t writer = 0; writer < NB_WRITERS; writer++)
+    {
+        writers.emplace_back(
+            [&, writer]
+            {
+                for (uint32_t i = 0; i < NB_RECORDS_PER_WRITER; i++)
+                {
+                    log.append({
+                        .writer    = writer,
+                        .sequence  = i,
+                        .timestamp = clock.fetch_add(1, std::memory_order_relaxed),
+                        .check     = i,
+                    });
+                }
+                nb_running_writers--;
+            });
+    }
+
+    uint32_t nb_merges       = 0;
+    uint32_t nb_merge_errors = 0;
+    while (nb_running_writers > 0)
+    {
+        nb_merge_errors += count_errors(log.merged(), false);
+        nb_merges++;
+    }
+    for (auto &writer : writers)
+    {
+        writer.join();
+    }
+    std::cout << "Merged " << nb_merges << " times while recording\n";
+    EXPECT_EQ(nb_merge_errors, (uint32_t) 0);
+
+    const auto records = log.merged(&Record::timestamp);
+    EXPECT_EQ(records.size(), (size_t) NB_WRITERS * NB_RECORDS_PER_WRITER);
+    EXPECT_EQ(log.nb_dropped(), (size_t) 0);
+    EXPECT_EQ(count_errors(records, true), (uint32_t) 0);
+
+    // Copies hold the same records
+    const auto copy = log;
+    EXPECT_EQ(copy.size(), log.size());
+
+    // Buckets record from several threads as well
+    auto bucket = std::make_shared<wvb::DriverMeasurementBucket>();
+    bucket->set_clock(std::make_shared<wvb::rtp::RTPClock>());
+    bucket->set_as_accept_all();
+
+    std::vector<std::thread> bucket_writers;
+    for (uint32_t writer = 0; writer < NB_WRITERS; writer++)
+    {
+        bucket_writers.emplace_back(
+            [&, writer]
+            {
+                for (uint32_t i = 0; i < WVB_BENCHMARK_TIMING_PHASE_CAPACITY; i++)
+                {
+                    bucket->add_frame_time_measurement({.frame_id = i * NB_WRITERS + writer});
+                }
+            });
+    }
+    for (auto &writer : bucket_writers)
+    {
+        writer.join();
+    }
+
+    const auto frame_measurements = bucket->get_frame_time_measurements();
+    ASSERT_EQ(frame_measurements.size(), (size_t) NB_WRITERS * WVB_BENCHMARK_TIMING_PHASE_CAPACITY);
+    uint32_t nb_out_of_order = 0;
+    for (uint32_t i = 0; i < frame_measurements.size(); i++)
+    {
+        nb_out_of_order += frame_measurements[i].frame_id != i;
+    }
+    EXPECT_EQ(nb_out_of_order, (uint32_t) 0);
+
+    // Reset keeps the chunks
+    bucket->reset();
+    EXPECT_TRUE(bucket->get_frame_time_measurements().empty());
+
+    // Saved frames are added by the video thread while the main thread polls them
+    wvb::ServerMeasurementBucket server_bucket;
+    std::thread                  video_thread(
+        [&server_bucket]
+        {
+            for (uint32_t i = 0; i < WVB_BENCHMARK_NB_SAVED_FRAMES + 2; i++)
+            {
+                server_bucket.add_saved_frame(i * 3);
+            }
+        });
+    uint32_t nb_wrong_ids = 0;
+    while (!server_bucket.has_saved_frames())
+    {
+        const auto saved_frame_ids = server_bucket.get_saved_frame_ids();
+        for (uint32_t i = 0; i < saved_frame_ids.size(); i++)
+        {
+            nb_wrong_ids += saved_frame_ids[i] != i * 3;
+        }
+    }
+    video_thread.join();
+    EXPECT_EQ(nb_wrong_ids, (uint32_t) 0);
+    EXPECT_EQ(server_bucket.get_nb_saved_frames(), (uint32_t) WVB_BENCHMARK_NB_SAVED_FRAMES);
+    EXPECT_EQ(server_bucket.get_saved_frame_ids().back(), (uint32_t) (WVB_BENCHMARK_NB_SAVED_FRAMES - 1) * 3);
+    server_bucket.reset();
+    EXPECT_EQ(server_bucket.get_nb_saved_frames(), (uint32_t) 0);
+}
@@ -0,0 +1,56 @@
+#include <wvb_common/benchmark.h>
+
+#include <chrono>
+#include <test_framework.hpp>
+#include <thread>
+
+TEST
+{
+    auto rtp_clock = std::make_shared<wvb::rtp::RTPClock>();
+    auto bucket    = std::make_shared<wvb::SocketMeasurementBucket>();
+    bucket->set_clock(rtp_clock);
+
+    const uint32_t storage_id = bucket->register_socket(wvb::SocketId::VIDEO_SOCKET, wvb::SocketType::SOCKET_TYPE_UDP);
+
+    // No window yet
+    EXPECT_EQ((int) bucket->phase(), (int) wvb::MeasurementPhase::IDLE);
+    bucket->add_bytes_sent(storage_id, 10);
+    EXPECT_EQ(bucket->get_socket_measurements()[storage_id].bytes_sent, (uint32_t) 0);
+
+    // Setting the window updates the phase right away
+    const auto now = rtp_clock->now();
+    bucket->set_window({
+        .start_timing_phase        = now - std::chrono::milliseconds(10),
+        .start_image_quality_phase = now + std::chrono::milliseconds(50),
+        .end_measurements          = now + std::chrono::milliseconds(100),
+        .end                       = now + std::chrono::milliseconds(150),
+    });
+    EXPECT_EQ((int) bucket->phase(), (int) wvb::MeasurementPhase::TIMING);
+    EXPECT_TRUE(bucket->is_in_timing_phase());
+    EXPECT_FALSE(bucket->is_in_image_quality_phase());
+    bucket->add_bytes_sent(storage_id, 10);
+    EXPECT_EQ(bucket->get_socket_measurements()[storage_id].bytes_sent, (uint32_t) 10);
+
+    // The phase only changes when it is updated
+    std::this_thread::sleep_for(std::chrono::milliseconds(70));
+    EXPECT_TRUE(bucket->is_in_timing_phase());
+    bucket->update_phase();
+    EXPECT_EQ((int) bucket->phase(), (int) wvb::MeasurementPhase::IMAGE_QUALITY);
+    bucket->add_bytes_sent(storage_id, 10);
+    EXPECT_EQ(bucket->get_socket_measurements()[storage_id].bytes_sent, (uint32_t) 10);
+
+    // Polling for the end of the measurements updates it as well
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_TRUE(bucket->measurements_complete());
+    EXPECT_EQ((int) bucket->phase(), (int) wvb::MeasurementPhase::COMPLETE);
+
+    // Modes
+    bucket->set_as_accept_all();
+    EXPECT_TRUE(bucket->is_in_timing_phase());
+    EXPECT_TRUE(bucket->is_in_image_quality_phase());
+    bucket->set_as_finished();
+    EXPECT_FALSE(bucket->is_in_timing_phase());
+    EXPECT_TRUE(bucket->measurements_complete());
+    bucket->reset();
+    EXPECT_EQ((int) bucket->phase(), (int) wvb::MeasurementPhase::IDLE);
+}
@@ -0,0 +1,172 @@
+#include <wvb_common/pose_prediction.h>
+
+#include <cmath>
+#include <iostream>
+#include <test_framework.hpp>
+
+#define PI               3.14159265358979323846
+#define POSE_INTERVAL_US 11111
+#define ANGULAR_SPEED    (PI / 2.0) // rad/s
+#define LINEAR_SPEED     0.5        // m/s
+#define LATENCY_US       50000
+#define NB_POSES         200
+
+/** Rotation of the given angle around the vertical axis. */
+wvb::Quaternion yaw(double angle)
+{
+    return {0, static_cast<float>(std::sin(angle / 2.0)), 0, static_cast<float>(std::cos(angle / 2.0))};
+}
+
+/** Simulated head motion: turning and moving forward at constant speeds. */
+wvb::TimedPose head_pose(int64_t timestamp_us)
+{
+    const double t = static_cast<double>(timestamp_us) / 1e6;
+    return {
+        .timestamp_us = timestamp_us,
+        .pose =
+            {
+                .orientation = yaw(ANGULAR_SPEED * t),
+                .position    = {0, 1.7f, static_cast<float>(-LINEAR_SPEED * t)},
+            },
+    };
+}
+
+/** Feeds the simulated motion to the predictor, predicting the pose LATENCY_US ahead after each one. Returns the mean errors. */
+void run_simulation(wvb::PosePredictor &predictor, double &mean_orientation_error, double &mean_position_error)
+{
+    size_t nb_errors       = 0;
+    mean_orientation_error = 0;
+    mean_position_error    = 0;
+
+    for (int64_t i = 0; i < NB_POSES; i++)
+    {
+        predictor.add_pose(head_pose(1000000 + i * POSE_INTERVAL_US));
+
+        wvb::Pose predicted;
+        predictor.predict(predictor.history().latest().timestamp_us + LATENCY_US, predicted);
+
+        wvb::PosePredictionError error;
+        while (predictor.pop_error(error))
+        {
+            mean_orientation_error += error.orientation_error;
+            mean_position_error += error.position_error;
+            nb_errors++;
+        }
+    }
+
+    if (nb_errors > 0)
+    {
+        mean_orientation_error /= static_cast<double>(nb_errors);
+        mean_position_error /= static_cast<double>(nb_errors);
+    }
+}
+
+TEST
+{
+    // Quaternion math
+    const auto rotation = wvb::quaternion_slerp(yaw(0), yaw(PI / 6.0), 0.5);
+    EXPECT_TRUE(wvb::quaternion_angle(rotation, yaw(PI / 12.0)) < 1e-3f);
+    const auto extrapolated = wvb::quaternion_slerp(yaw(0), yaw(PI / 6.0), 2.0);
+    EXPECT_TRUE(wvb::quaternion_angle(extrapolated, yaw(PI / 3.0)) < 1e-3f);
+    EXPECT_TRUE(std::abs(wvb::quaternion_angle(yaw(0), yaw(PI / 2.0)) - PI / 2.0) < 1e-3);
+    // Both signs represent the same orientation
+    const auto q = yaw(0.3);
+    EXPECT_TRUE(wvb::quaternion_angle(q, {-q.x, -q.y, -q.z, -q.w}) < 1e-3f);
+    const auto rotated = wvb::quaternion_rotate(yaw(PI / 2.0), {1, 0, 0});
+    EXPECT_TRUE(std::abs(rotated.x) < 1e-5f && std::abs(rotated.y) < 1e-5f && std::abs(rotated.z + 1) < 1e-5f);
+
+    // Moving an eye with the head keeps its offset from the head
+    const wvb::Pose head       = head_pose(0).pose;
+    const wvb::Pose moved_head = head_pose(100000).pose;
+    const wvb::Pose eye        = {.orientation = head.orientation, .position = {-0.032f, 1.7f, -0.05f}};
+    const wvb::Pose moved_eye  = wvb::pose_apply_motion(eye, head, moved_head);
+    const auto      eye_offset = wvb::quaternion_rotate(moved_head.orientation, {-0.032f, 0, -0.05f});
+    EXPECT_TRUE(wvb::quaternion_angle(moved_eye.orientation, moved_head.orientation) < 1e-3f);
+    EXPECT_TRUE(std::abs(moved_eye.position.x - (moved_head.position.x + eye_offset.x)) < 1e-5f);
+    EXPECT_TRUE(std::abs(moved_eye.position.y - (moved_head.position.y + eye_offset.y)) < 1e-5f);
+    EXPECT_TRUE(std::abs(moved_eye.position.z - (moved_head.position.z + eye_offset.z)) < 1e-5f);
+    // Without motion, the pose is unchanged
+    const wvb::Pose same_eye = wvb::pose_apply_motion(eye, head, head);
+    EXPECT_TRUE(wvb::quaternion_angle(same_eye.orientation, eye.orientation) < 1e-3f);
+    EXPECT_TRUE(std::abs(same_eye.position.z - eye.position.z) < 1e-5f);
+
+    // History
+    wvb::PoseHistory history;
+    EXPECT_TRUE(history.add(head_pose(0)));
+    EXPECT_TRUE(history.add(head_pose(20000)));
+    EXPECT_FALSE(history.add(head_pose(10000)));
+    EXPECT_EQ(history.size(), (size_t) 2);
+
+    wvb::Pose interpolated;
+    EXPECT_TRUE(history.interpolate(10000, interpolated));
+    EXPECT_TRUE(wvb::quaternion_angle(interpolated.orientation, head_pose(10000).pose.orientation) < 1e-3f);
+    EXPECT_TRUE(std::abs(interpolated.position.z - head_pose(10000).pose.position.z) < 1e-5f);
+    EXPECT_FALSE(history.interpolate(30000, interpolated));
+
+    // The history is a ring, only the latest poses are kept
+    for (int64_t i = 2; i < WVB_POSE_HISTORY_CAPACITY + 10; i++)
+    {
+        history.add(head_pose(i * 10000));
+    }
+    EXPECT_EQ(history.size(), (size_t) WVB_POSE_HISTORY_CAPACITY);
+    EXPECT_EQ(history.latest().timestamp_us, (int64_t) (WVB_POSE_HISTORY_CAPACITY + 9) * 10000);
+    EXPECT_FALSE(history.interpolate(0, interpolated));
+
+    // Without prediction, the error corresponds to the motion during the latency
+    double orientation_error_none = 0;
+    double position_error_none    = 0;
+    wvb::PosePredictor predictor_none({.model = wvb::PosePredictionModel::NONE});
+    run_simulation(predictor_none, orientation_error_none, position_error_none);
+    std::cout << "No prediction: " << orientation_error_none * 180.0 / PI << " deg, " << position_error_none * 1000.0 << " mm\n";
+    EXPECT_TRUE(std::abs(orientation_error_none - ANGULAR_SPEED * LATENCY_US / 1e6) < 1e-2);
+    EXPECT_TRUE(std::abs(position_error_none - LINEAR_SPEED * LATENCY_US / 1e6) < 1e-3);
+
+    // With constant velocity, it should be almost perfect on a constant motion
+    double orientation_error_velocity = 0;
+    double position_error_velocity    = 0;
+    wvb::PosePredictor predictor_velocity({.model = wvb::PosePredictionModel::CONSTANT_VELOCITY});
+    run_simulation(predictor_velocity, orientation_error_velocity, position_error_velocity);
+    std::cout << "Constant velocity: " << orientation_error_velocity * 180.0 / PI << " deg, " << position_error_velocity * 1000.0
+              << " mm\n";
+    EXPECT_TRUE(orientation_error_velocity < orientation_error_none / 20.0);
+    EXPECT_TRUE(position_error_velocity < position_error_none / 20.0);
+
+    // The extrapolation is limited
+    wvb::PosePredictor predictor_limited({.model = wvb::PosePredictionModel::CONSTANT_VELOCITY, .max_extrapolation_us = 10000});
+    predictor_limited.add_pose(head_pose(0));
+    predictor_limited.add_pose(head_pose(POSE_INTERVAL_US));
+    wvb::Pose limited;
+    EXPECT_TRUE(predictor_limited.predict(POSE_INTERVAL_US + 1000000, limited));
+    EXPECT_TRUE(wvb::quaternion_angle(limited.orientation, head_pose(POSE_INTERVAL_US + 10000).pose.orientation) < 1e-3f);
+
+    // The extrapolation can be done elsewhere, with the same result
+    const auto extrapolation = predictor_velocity.extrapolation();
+    EXPECT_TRUE(extrapolation.is_valid);
+    const auto target = predictor_velocity.history().latest().timestamp_us + LATENCY_US;
+    wvb::Pose  predicted;
+    predictor_velocity.predict(target, predicted);
+    const auto extrapolated_pose = extrapolation.predict(target);
+    EXPECT_TRUE(wvb::quaternion_angle(extrapolated_pose.orientation, predicted.orientation) < 1e-5f);
+    EXPECT_TRUE(std::abs(extrapolated_pose.position.z - predicted.position.z) < 1e-6f);
+
+    // Its error is measured once it is given back to the predictor
+    wvb::PosePredictor predictor_remote({.model = wvb::PosePredictionModel::CONSTANT_VELOCITY});
+    predictor_remote.add_pose(head_pose(0));
+    predictor_remote.add_pose(head_pose(POSE_INTERVAL_US));
+    const auto remote_target = 2 * POSE_INTERVAL_US;
+    predictor_remote.add_prediction({
+        .pose_timestamp_us   = POSE_INTERVAL_US,
+        .target_timestamp_us = remote_target,
+        .predicted_pose      = predictor_remote.extrapolation().predict(remote_target),
+    });
+    predictor_remote.add_pose(head_pose(remote_target));
+    wvb::PosePredictionError remote_error;
+    EXPECT_TRUE(predictor_remote.pop_error(remote_error));
+    EXPECT_EQ(remote_error.target_timestamp_us, (int64_t) remote_target);
+    EXPECT_TRUE(remote_error.orientation_error < 1e-3f);
+
+    // Nothing to predict without poses
+    predictor_limited.reset();
+    EXPECT_FALSE(predictor_limited.predict(0, limited));
+    EXPECT_FALSE(predictor_limited.extrapolation().is_valid);
+}
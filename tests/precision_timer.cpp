@@ -0,0 +1,89 @@
+#include <wvb_common/precision_timer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <test_framework.hpp>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <time.h>
+#endif
+
+#define NB_WAITS 500
+// Roughly the time left before the vsync when a frame is presented at 90 Hz
+#define WAIT_INTERVAL_US 5000
+// Spin margin of the driver's previous vsync wait
+#define FIXED_SPIN_MARGIN_US 2000
+
+#ifdef __linux__
+int64_t thread_cpu_time_ns()
+{
+    timespec ts {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/** Sorts the errors and prints their percentiles, and the CPU time used per wait. */
+void print_wait_stats(const char *name, std::vector<int64_t> &wakeup_errors_ns, int64_t cpu_time_ns)
+{
+    std::sort(wakeup_errors_ns.begin(), wakeup_errors_ns.end());
+    std::cout << name << " wakeup error: p50 " << wakeup_errors_ns[wakeup_errors_ns.size() / 2] / 1000 << " us, p99 "
+              << wakeup_errors_ns[wakeup_errors_ns.size() * 99 / 100] / 1000 << " us, p99.9 "
+              << wakeup_errors_ns[wakeup_errors_ns.size() * 999 / 1000] / 1000 << " us, max " << wakeup_errors_ns.back() / 1000
+              << " us. CPU time per wait: " << cpu_time_ns / NB_WAITS / 1000 << " us\n";
+}
+#endif
+
+TEST
+{
+    using clock = wvb::PrecisionTimer::clock;
+
+    wvb::PrecisionTimer timer;
+    EXPECT_EQ(timer.spin_margin().count(), (int64_t) WVB_PRECISION_TIMER_INITIAL_MARGIN_US);
+
+    // Deadlines in the past return immediately
+    const auto past = clock::now() - std::chrono::milliseconds(1);
+    EXPECT_TRUE(timer.wait_until(past) >= past);
+
+    // A wait never ends before its deadline
+    std::vector<int64_t> wakeup_errors_ns;
+    wakeup_errors_ns.reserve(NB_WAITS);
+    bool ended_early = false;
+#ifdef __linux__
+    int64_t cpu_time_start = thread_cpu_time_ns();
+#endif
+    for (uint32_t i = 0; i < NB_WAITS; i++)
+    {
+        const auto deadline = clock::now() + std::chrono::microseconds(WAIT_INTERVAL_US);
+        const auto end      = timer.wait_until(deadline);
+        ended_early         = ended_early || end < deadline || clock::now() < deadline;
+        wakeup_errors_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - deadline).count());
+    }
+    EXPECT_FALSE(ended_early);
+
+    // The margin adapted to the wakeup errors of the system, within its bounds
+    EXPECT_TRUE(timer.spin_margin().count() >= WVB_PRECISION_TIMER_MIN_MARGIN_US);
+    EXPECT_TRUE(timer.spin_margin().count() <= WVB_PRECISION_TIMER_MAX_MARGIN_US);
+
+#ifdef __linux__
+    print_wait_stats("Precision timer", wakeup_errors_ns, thread_cpu_time_ns() - cpu_time_start);
+    std::cout << "Adapted spin margin: " << timer.spin_margin().count() << " us\n";
+
+    // Compare with a sleep followed by a fixed spin, like the driver did before
+    wakeup_errors_ns.clear();
+    cpu_time_start = thread_cpu_time_ns();
+    for (uint32_t i = 0; i < NB_WAITS; i++)
+    {
+        const auto deadline = clock::now() + std::chrono::microseconds(WAIT_INTERVAL_US);
+        std::this_thread::sleep_for(std::chrono::microseconds(WAIT_INTERVAL_US - FIXED_SPIN_MARGIN_US));
+        auto now = clock::now();
+        while (now < deadline)
+        {
+            now = clock::now();
+        }
+        wakeup_errors_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline).count());
+    }
+    print_wait_stats("Sleep and fixed spin", wakeup_errors_ns, thread_cpu_time_ns() - cpu_time_start);
+#endif
+}
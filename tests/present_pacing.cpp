@@ -0,0 +1,136 @@
+#include <wvb_common/present_pacing.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <test_framework.hpp>
+#include <vector>
+
+// 90 Hz
+#define FRAME_INTERVAL_US 11111
+#define ENCODE_TIME_US    3000
+#define NB_FRAMES         2000
+// Frames ignored at the beginning and after a change of render time, while the controller converges
+#define NB_SETTLING_FRAMES 100
+
+struct PacingStats
+{
+    /** Frames presented after the vsync they targeted. */
+    uint32_t nb_missed_vsyncs = 0;
+    int64_t  p50_error_us     = 0;
+    int64_t  p99_error_us     = 0;
+    /** Average time between the release of the app and the vsync, i.e. the latency added by pacing. */
+    int64_t mean_release_to_vsync_us = 0;
+};
+
+/**
+ * Simulates the driver's frame loop with the given render times. Like in the driver, the frame waits for the vsync if it is
+ * presented early, and the vsync is delayed if it is presented late.
+ */
+PacingStats simulate(wvb::PresentPacer &pacer, const std::vector<int64_t> &render_times_us, size_t first_measured_frame)
+{
+    int64_t vsync_us           = 0;
+    int64_t server_finished_us = ENCODE_TIME_US;
+
+    std::vector<int64_t> errors_us;
+    PacingStats          stats;
+    int64_t              total_release_to_vsync_us = 0;
+    for (size_t i = 0; i < render_times_us.size(); i++)
+    {
+        const int64_t next_vsync_us = vsync_us + FRAME_INTERVAL_US;
+
+        // Wait until the release deadline, but the app can't start before the server finished the previous frame
+        const int64_t release_us = std::max(server_finished_us, pacer.release_deadline_us(next_vsync_us));
+        pacer.on_frame_started(release_us);
+
+        const int64_t present_us = release_us + render_times_us[i];
+        const int64_t error_us   = pacer.on_frame_presented(present_us, next_vsync_us);
+
+        vsync_us           = std::max(present_us, next_vsync_us);
+        server_finished_us = vsync_us + ENCODE_TIME_US;
+        pacer.on_frame_encoded(vsync_us, server_finished_us);
+
+        if (i >= first_measured_frame)
+        {
+            errors_us.push_back(error_us);
+            total_release_to_vsync_us += next_vsync_us - release_us;
+            if (present_us > next_vsync_us)
+            {
+                stats.nb_missed_vsyncs++;
+            }
+        }
+    }
+
+    std::sort(errors_us.begin(), errors_us.end());
+    stats.p50_error_us             = errors_us[errors_us.size() / 2];
+    stats.p99_error_us             = errors_us[errors_us.size() * 99 / 100];
+    stats.mean_release_to_vsync_us = total_release_to_vsync_us / static_cast<int64_t>(errors_us.size());
+    return stats;
+}
+
+/** Normally distributed render times, with a fixed seed so that the test is deterministic. */
+std::vector<int64_t> make_render_times(size_t nb_frames, double mean_us, double stddev_us, uint32_t seed)
+{
+    std::mt19937                     generator(seed);
+    std::normal_distribution<double> distribution(mean_us, stddev_us);
+
+    std::vector<int64_t> render_times_us(nb_frames);
+    for (auto &render_time_us : render_times_us)
+    {
+        render_time_us = std::max(static_cast<int64_t>(distribution(generator)), static_cast<int64_t>(0));
+    }
+    return render_times_us;
+}
+
+void print_stats(const char *name, const PacingStats &stats)
+{
+    std::cout << name << ": " << stats.nb_missed_vsyncs << " missed vsyncs, deadline error p50 " << stats.p50_error_us
+              << " us, p99 " << stats.p99_error_us << " us, release to vsync " << stats.mean_release_to_vsync_us << " us\n";
+}
+
+TEST
+{
+    // Estimator
+    wvb::DurationEstimator estimator(0.1, 2.0);
+    EXPECT_FALSE(estimator.has_sample());
+    EXPECT_EQ(estimator.estimate_us(), (int64_t) 0);
+    for (int i = 0; i < 200; i++)
+    {
+        estimator.add(i % 2 == 0 ? 4000 : 6000);
+    }
+    EXPECT_TRUE(std::abs(estimator.mean_us() - 5000) < 200);
+    EXPECT_TRUE(std::abs(estimator.deviation_us() - 1000) < 100);
+    EXPECT_TRUE(estimator.estimate_us() > estimator.mean_us());
+
+    // Steady render times: the frames are presented around the target lead, without missing vsyncs
+    const wvb::PresentPacingSettings settings {};
+    wvb::PresentPacer                steady_pacer(FRAME_INTERVAL_US, settings);
+    const auto steady_stats = simulate(steady_pacer, make_render_times(NB_FRAMES, 5000, 300, 1), NB_SETTLING_FRAMES);
+    print_stats("Steady", steady_stats);
+    EXPECT_TRUE(std::abs(steady_stats.p50_error_us) < 200);
+    EXPECT_TRUE(steady_stats.p99_error_us < static_cast<int64_t>(settings.target_lead_us));
+    EXPECT_TRUE(steady_stats.nb_missed_vsyncs < NB_FRAMES / 100);
+    // Without pacing, the app would be released as soon as the server finished, a full frame before the vsync
+    EXPECT_TRUE(steady_stats.mean_release_to_vsync_us < FRAME_INTERVAL_US - ENCODE_TIME_US - 1000);
+
+    // The render time suddenly increases: the controller converges again
+    auto changing_render_times = make_render_times(NB_FRAMES / 2, 4000, 300, 2);
+    auto slower_render_times   = make_render_times(NB_FRAMES / 2, 6500, 300, 3);
+    changing_render_times.insert(changing_render_times.end(), slower_render_times.begin(), slower_render_times.end());
+    wvb::PresentPacer changing_pacer(FRAME_INTERVAL_US, settings);
+    const auto        changing_stats = simulate(changing_pacer, changing_render_times, NB_FRAMES / 2 + NB_SETTLING_FRAMES);
+    print_stats("After render time increase", changing_stats);
+    EXPECT_TRUE(std::abs(changing_stats.p50_error_us) < 200);
+    EXPECT_TRUE(changing_stats.nb_missed_vsyncs < NB_FRAMES / 100);
+
+    // Render time too long for the frame rate: the margin is capped, the app is released as soon as the server finished
+    wvb::PresentPacer slow_pacer(FRAME_INTERVAL_US, settings);
+    simulate(slow_pacer, make_render_times(NB_FRAMES / 4, 10000, 300, 4), 0);
+    EXPECT_TRUE(slow_pacer.wait_margin_us() <= FRAME_INTERVAL_US - slow_pacer.encode_time().mean_us());
+    EXPECT_TRUE(slow_pacer.deadline_error_us() > 0);
+
+    slow_pacer.reset();
+    EXPECT_FALSE(slow_pacer.render_time().has_sample());
+    EXPECT_EQ(slow_pacer.deadline_error_us(), (int64_t) 0);
+}
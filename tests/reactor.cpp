@@ -0,0 +1,173 @@
+#include <wvb_common/ipc.h>
+#include <wvb_common/reactor.h>
+#include <wvb_common/socket.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <test_framework.hpp>
+#include <thread>
+#include <vector>
+
+#define RECEIVER_PORT 12430
+#define SENDER_PORT   12431
+#define NB_PACKETS    1000
+// Bound on the time to get a callback, for a loaded CI machine. The measured latency is printed.
+#define MAX_DISPATCH_LATENCY std::chrono::milliseconds(50)
+
+/** Sends packets at random intervals from another thread, and returns the time between each send and its callback. */
+std::vector<int64_t> measure_socket_dispatch_latencies(wvb::Reactor &reactor)
+{
+    wvb::UDPSocket receiver(RECEIVER_PORT);
+    wvb::UDPSocket sender(SENDER_PORT);
+
+    std::atomic<int64_t> send_time_ns = 0;
+    std::vector<int64_t> latencies_ns;
+    uint8_t              buffer[64];
+    const auto           id = reactor.add_socket(receiver.native_handle(),
+                                       [&]
+                                       {
+                                           const auto now = std::chrono::steady_clock::now().time_since_epoch();
+                                           size_t     size = 0;
+                                           while (receiver.receive_from(buffer, sizeof(buffer), &size, nullptr))
+                                           {
+                                               latencies_ns.push_back(
+                                                   std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()
+                                                   - send_time_ns.load());
+                                           }
+                                       });
+
+    std::thread sending_thread(
+        [&]
+        {
+            const uint8_t packet = 42;
+            for (uint32_t i = 0; i < NB_PACKETS; i++)
+            {
+                // Let the reactor go back to sleep
+                std::this_thread::sleep_for(std::chrono::microseconds(200 + (i * 37) % 300));
+                send_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count();
+                (void) sender.send_to({INET_ADDR_LOOPBACK, RECEIVER_PORT}, &packet, sizeof(packet));
+            }
+        });
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (latencies_ns.size() < NB_PACKETS && std::chrono::steady_clock::now() < deadline)
+    {
+        reactor.run_once(100);
+    }
+    sending_thread.join();
+    reactor.remove(id);
+
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    return latencies_ns;
+}
+
+TEST
+{
+    wvb::Reactor reactor;
+
+    // Nothing registered: the wait times out without calling anything
+    const auto idle_start = std::chrono::steady_clock::now();
+    EXPECT_EQ(reactor.run_once(20), (uint32_t) 0);
+    EXPECT_TRUE(std::chrono::steady_clock::now() - idle_start >= std::chrono::milliseconds(19));
+
+    // Posted callbacks wake up the loop
+    {
+        std::atomic<bool> called = false;
+        std::thread       posting_thread(
+            [&]
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                reactor.post([&] { called = true; });
+            });
+        const auto start = std::chrono::steady_clock::now();
+        reactor.run_once(NO_TIMEOUT);
+        EXPECT_TRUE(called.load());
+        EXPECT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(10) + MAX_DISPATCH_LATENCY);
+        posting_thread.join();
+    }
+
+    // One-shot and repeating timers
+    {
+        uint32_t   nb_one_shot = 0;
+        uint32_t   nb_repeat   = 0;
+        const auto start       = std::chrono::steady_clock::now();
+        reactor.add_timer(std::chrono::milliseconds(5), [&] { nb_one_shot++; });
+        wvb::ReactorHandlerId repeat_id = INVALID_REACTOR_HANDLER_ID;
+        repeat_id                       = reactor.add_timer(std::chrono::milliseconds(1),
+                                      [&]
+                                      {
+                                          // Handlers can remove themselves
+                                          if (++nb_repeat == 10)
+                                          {
+                                              reactor.remove(repeat_id);
+                                          }
+                                      },
+                                      std::chrono::milliseconds(2));
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100))
+        {
+            reactor.run_once(10);
+        }
+        EXPECT_EQ(nb_one_shot, (uint32_t) 1);
+        EXPECT_EQ(nb_repeat, (uint32_t) 10);
+    }
+
+    // Sockets: the callback is called as soon as a packet arrives
+    {
+        const auto latencies_ns = measure_socket_dispatch_latencies(reactor);
+        EXPECT_EQ(latencies_ns.size(), (size_t) NB_PACKETS);
+        if (!latencies_ns.empty())
+        {
+            std::cout << "Socket dispatch latency: p50 " << latencies_ns[latencies_ns.size() / 2] / 1000 << " us, p99 "
+                      << latencies_ns[latencies_ns.size() * 99 / 100] / 1000 << " us\n";
+            EXPECT_TRUE(latencies_ns[latencies_ns.size() / 2]
+                        < std::chrono::duration_cast<std::chrono::nanoseconds>(MAX_DISPATCH_LATENCY).count());
+        }
+    }
+
+    // Inter-process events
+    {
+        wvb::InterProcessEvent sender("TEST_REACTOR_EVENT", true);
+        wvb::InterProcessEvent receiver("TEST_REACTOR_EVENT", false);
+
+        uint32_t   nb_events = 0;
+        const auto id        = reactor.add_event(receiver, [&] { nb_events++; });
+        for (uint32_t i = 0; i < 5; i++)
+        {
+            sender.signal();
+            reactor.run_once(1000);
+        }
+        EXPECT_EQ(nb_events, (uint32_t) 5);
+
+        // Removing the handler stops its thread
+        reactor.remove(id);
+        sender.signal();
+        reactor.run_once(20);
+        EXPECT_EQ(nb_events, (uint32_t) 5);
+    }
+
+    // Removing an event handler doesn't signal the event, since another receiver could get it
+    {
+        wvb::InterProcessEvent sender("TEST_REACTOR_MANUAL_EVENT", true, wvb::EventResetMode::MANUAL);
+        wvb::InterProcessEvent receiver("TEST_REACTOR_MANUAL_EVENT", false, wvb::EventResetMode::MANUAL);
+
+        const auto id = reactor.add_event(receiver, [] {});
+        reactor.remove(id);
+        EXPECT_FALSE(receiver.is_signaled());
+    }
+
+    // Stopping from another thread
+    {
+        std::thread stopping_thread(
+            [&]
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                reactor.stop();
+            });
+        reactor.run();
+        stopping_thread.join();
+    }
+}
@@ -0,0 +1,204 @@
+#include <wvb_common/repetition_scheduler.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <test_framework.hpp>
+#include <vector>
+
+#define EXPORT_FILE_PATH "repetition_scheduler_test.csv"
+#define MIN_RUNS         3
+#define MAX_RUNS         40
+// 200 us
+#define TARGET_HALF_WIDTH_NS 200000.0
+
+constexpr double NOT_MEASURED = std::numeric_limits<double>::quiet_NaN();
+
+/** Mean latencies of the stages in a run, around a fixed value with a normal noise of the given standard deviation. */
+std::array<double, WVB_LATENCY_STAGE_COUNT> sample_run(std::mt19937 &generator, double stddev_ns)
+{
+    std::normal_distribution<double>            noise(0, stddev_ns);
+    std::array<double, WVB_LATENCY_STAGE_COUNT> means {};
+    for (size_t i = 0; i < means.size(); i++)
+    {
+        means[i] = 1000000.0 * static_cast<double>(i + 1) + noise(generator);
+    }
+    return means;
+}
+
+/** Number of runs until the scheduler stops, or MAX_RUNS + 1 if it doesn't. */
+uint32_t run_until_stop(wvb::RepetitionScheduler &scheduler, std::mt19937 &generator, double stddev_ns)
+{
+    for (uint32_t i = 1; i <= MAX_RUNS; i++)
+    {
+        if (scheduler.add_run(sample_run(generator, stddev_ns)) != wvb::RepetitionStopReason::NONE)
+        {
+            return i;
+        }
+    }
+    return MAX_RUNS + 1;
+}
+
+TEST
+{
+    // Running statistics match the two-pass formulas
+    const std::vector<double> values = {1e9 + 4, 1e9 + 7, 1e9 + 13, 1e9 + 16};
+    wvb::RunningStatistics    statistics;
+    for (const double value : values)
+    {
+        statistics.add(value);
+    }
+    EXPECT_EQ(statistics.count, 4u);
+    EXPECT_TRUE(std::abs(statistics.mean - (1e9 + 10)) < 1e-6);
+    // Squared differences: 36 + 9 + 9 + 36
+    EXPECT_TRUE(std::abs(statistics.variance() - 30) < 1e-6);
+    EXPECT_TRUE(std::abs(statistics.confidence_half_width() - 3.182446 * std::sqrt(30.0 / 4)) < 1e-6);
+
+    wvb::RunningStatistics single;
+    single.add(5);
+    EXPECT_EQ(single.variance(), 0.0);
+    EXPECT_TRUE(std::isinf(single.confidence_half_width()));
+
+    // The quantiles decrease towards the normal one, without a jump past the table
+    EXPECT_TRUE(std::abs(wvb::student_t_95(1) - 12.706205) < 1e-6);
+    EXPECT_TRUE(std::abs(wvb::student_t_95(30) - 2.042272) < 1e-6);
+    EXPECT_TRUE(std::abs(wvb::student_t_95(31) - 2.039513) < 1e-4);
+    EXPECT_TRUE(std::abs(wvb::student_t_95(120) - 1.979930) < 1e-4);
+    EXPECT_TRUE(wvb::student_t_95(1000) > 1.959964 && wvb::student_t_95(1000) < 1.963);
+
+    std::mt19937 generator(42);
+
+    // Without a target, the pass always runs the maximum number of times, however stable it is
+    {
+        wvb::RepetitionScheduler scheduler(MIN_RUNS, MAX_RUNS, 0);
+        EXPECT_EQ(run_until_stop(scheduler, generator, 0), static_cast<uint32_t>(MAX_RUNS));
+        EXPECT_TRUE(scheduler.stop_reason() == wvb::RepetitionStopReason::MAX_REPETITIONS);
+    }
+
+    // A stable configuration stops as soon as allowed
+    {
+        wvb::RepetitionScheduler scheduler(MIN_RUNS, MAX_RUNS, TARGET_HALF_WIDTH_NS);
+        EXPECT_EQ(run_until_stop(scheduler, generator, 1000), static_cast<uint32_t>(MIN_RUNS));
+        EXPECT_TRUE(scheduler.stop_reason() == wvb::RepetitionStopReason::PRECISION_REACHED);
+        EXPECT_TRUE(scheduler.max_half_width() <= TARGET_HALF_WIDTH_NS);
+    }
+
+    // A noisy configuration runs up to the maximum without reaching the target
+    {
+        wvb::RepetitionScheduler scheduler(MIN_RUNS, MAX_RUNS, TARGET_HALF_WIDTH_NS);
+        EXPECT_EQ(run_until_stop(scheduler, generator, 5000000), static_cast<uint32_t>(MAX_RUNS));
+        EXPECT_TRUE(scheduler.stop_reason() == wvb::RepetitionStopReason::MAX_REPETITIONS);
+        EXPECT_TRUE(scheduler.max_half_width() > TARGET_HALF_WIDTH_NS);
+    }
+
+    // In between, the pass stops at the first run whose confidence intervals are all within the target
+    {
+        // The half-width is about 2.1 * stddev / sqrt(n), so each stage reaches the target after about 10 runs, and all of them
+        // after about 15
+        const double             stddev_ns = 300000;
+        wvb::RepetitionScheduler scheduler(MIN_RUNS, MAX_RUNS, TARGET_HALF_WIDTH_NS);
+        std::mt19937             reference_generator = generator;
+        const uint32_t           nb_runs             = run_until_stop(scheduler, generator, stddev_ns);
+        EXPECT_TRUE(scheduler.stop_reason() == wvb::RepetitionStopReason::PRECISION_REACHED);
+        EXPECT_TRUE(nb_runs > MIN_RUNS && nb_runs < MAX_RUNS);
+
+        std::array<std::vector<double>, WVB_LATENCY_STAGE_COUNT> samples;
+        for (uint32_t run = 1; run <= nb_runs; run++)
+        {
+            const auto means          = sample_run(reference_generator, stddev_ns);
+            double     max_half_width = 0;
+            for (size_t i = 0; i < means.size(); i++)
+            {
+                samples[i].push_back(means[i]);
+                double mean = 0;
+                for (const double sample : samples[i])
+                {
+                    mean += sample / run;
+                }
+                double variance = 0;
+                for (const double sample : samples[i])
+                {
+                    variance += (sample - mean) * (sample - mean) / (run - 1);
+                }
+                max_half_width = std::max(max_half_width, wvb::student_t_95(run - 1) * std::sqrt(variance / run));
+            }
+            // Stopped on this run, and not before
+            if (run >= MIN_RUNS)
+            {
+                EXPECT_EQ(max_half_width <= TARGET_HALF_WIDTH_NS, run == nb_runs);
+            }
+            if (run == nb_runs)
+            {
+                EXPECT_TRUE(std::abs(max_half_width - scheduler.max_half_width()) < 1e-3);
+            }
+        }
+    }
+
+    // Stages that are never measured are ignored, but a stage measured only once blocks the stop
+    {
+        wvb::RepetitionScheduler scheduler(2, MAX_RUNS, TARGET_HALF_WIDTH_NS);
+        const auto               means         = sample_run(generator, 0);
+        auto                     partial_means = means;
+        partial_means[static_cast<size_t>(wvb::LatencyStage::NETWORK)] = NOT_MEASURED;
+        EXPECT_TRUE(scheduler.add_run(partial_means) == wvb::RepetitionStopReason::NONE);
+        partial_means[static_cast<size_t>(wvb::LatencyStage::DECODE)] = NOT_MEASURED;
+        EXPECT_TRUE(scheduler.add_run(partial_means) == wvb::RepetitionStopReason::NONE);
+        EXPECT_EQ(scheduler.stage(wvb::LatencyStage::DECODE).count, 1u);
+        partial_means[static_cast<size_t>(wvb::LatencyStage::DECODE)] = means[static_cast<size_t>(wvb::LatencyStage::DECODE)];
+        EXPECT_TRUE(scheduler.add_run(partial_means) == wvb::RepetitionStopReason::PRECISION_REACHED);
+        EXPECT_EQ(scheduler.nb_runs(), 3u);
+        EXPECT_EQ(scheduler.stage(wvb::LatencyStage::NETWORK).count, 0u);
+    }
+
+    // Nothing measured: the precision is unknown
+    {
+        wvb::RepetitionScheduler                    scheduler(2, 3, TARGET_HALF_WIDTH_NS);
+        std::array<double, WVB_LATENCY_STAGE_COUNT> means {};
+        means.fill(NOT_MEASURED);
+        EXPECT_TRUE(scheduler.add_run(means) == wvb::RepetitionStopReason::NONE);
+        EXPECT_TRUE(scheduler.add_run(means) == wvb::RepetitionStopReason::NONE);
+        EXPECT_TRUE(scheduler.add_run(means) == wvb::RepetitionStopReason::MAX_REPETITIONS);
+        EXPECT_TRUE(std::isinf(scheduler.max_half_width()));
+    }
+
+    // Settings of a pass, with a minimum above the maximum
+    {
+        const wvb::BenchmarkPass pass {.num_repetitions = 2, .min_repetitions = 5, .target_ci_half_width_us = 200};
+        wvb::RepetitionScheduler scheduler(pass);
+        EXPECT_EQ(scheduler.target_half_width(), TARGET_HALF_WIDTH_NS);
+        EXPECT_TRUE(scheduler.add_run(sample_run(generator, 0)) == wvb::RepetitionStopReason::NONE);
+        EXPECT_TRUE(scheduler.add_run(sample_run(generator, 0)) == wvb::RepetitionStopReason::PRECISION_REACHED);
+    }
+
+    // Runs given as histograms use the mean of each stage
+    {
+        wvb::RepetitionScheduler scheduler(2, MAX_RUNS, TARGET_HALF_WIDTH_NS);
+        for (int64_t run = 0; run < 2; run++)
+        {
+            wvb::StageLatencyHistograms latencies;
+            latencies.record(wvb::LatencyStage::ENCODE, 3000000 + run * 1000);
+            latencies.record(wvb::LatencyStage::ENCODE, 5000000 + run * 1000);
+            scheduler.add_run(latencies);
+        }
+        EXPECT_TRUE(scheduler.stop_reason() == wvb::RepetitionStopReason::PRECISION_REACHED);
+        EXPECT_TRUE(std::abs(scheduler.stage(wvb::LatencyStage::ENCODE).mean - 4000500) < 1e-6);
+        EXPECT_EQ(scheduler.stage(wvb::LatencyStage::SEND).count, 0u);
+
+        std::ofstream file(EXPORT_FILE_PATH);
+        wvb::RepetitionScheduler::export_csv(file, scheduler);
+        file.close();
+        std::ifstream            input(EXPORT_FILE_PATH);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(input, line);)
+        {
+            lines.push_back(line);
+        }
+        ASSERT_EQ(lines.size(), static_cast<size_t>(WVB_LATENCY_STAGE_COUNT + 1));
+        EXPECT_EQ(lines[0], std::string("stage,nb_runs,mean,stddev,ci_half_width,target_ci_half_width,stop_reason"));
+        // Half-width: 12.706205 * 707.1 / sqrt(2)
+        EXPECT_EQ(lines[1], std::string("ENCODE,2,4000500,707,6353,200000,PRECISION_REACHED"));
+        EXPECT_EQ(lines[2], std::string("SEND,0,0,0,-1,200000,PRECISION_REACHED"));
+        input.close();
+        std::remove(EXPORT_FILE_PATH);
+    }
+}
@@ -1,7 +1,59 @@
 #include <wvb_common/rtp_clock.h>
 
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <random>
 #include <test_framework.hpp>
+#include <thread>
+#include <vector>
+
+#define NB_COST_CALLS 1000000
+// The TSC is compared to CLOCK_MONOTONIC over this duration, which spans many recalibrations
+#define DRIFT_TEST_DURATION std::chrono::seconds(60)
+#define DRIFT_TEST_INTERVAL std::chrono::milliseconds(100)
+#define MAX_TSC_ERROR       std::chrono::microseconds(50)
+#define NB_SLEW_READERS     2
+#define NB_SLEWS            10000
+#define SLEW_AMOUNT         std::chrono::microseconds(500)
+#define SLEW_DURATION       std::chrono::microseconds(1)
+#define SLEW_INTERVAL       std::chrono::microseconds(50)
+// Rounding of the applied slew
+#define MAX_SLEW_READ_ERROR std::chrono::microseconds(1)
+
+/** Returns the mean duration of a call, in nanoseconds. */
+double measure_cost(const std::function<int64_t()> &call)
+{
+    int64_t    sum   = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < NB_COST_CALLS; i++)
+    {
+        sum += call();
+    }
+    const auto duration = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    // Use the sum so that the calls aren't optimized out
+    return sum == 0 ? -1 : duration.count() / NB_COST_CALLS;
+}
+
+/** Difference between a source and steady_clock, read just before and after it. The fastest of a few reads is kept, since the
+ * thread may be preempted between them. */
+std::chrono::nanoseconds source_error(const wvb::rtp::TimestampSource &source)
+{
+    std::chrono::nanoseconds error {0};
+    std::chrono::nanoseconds min_read_duration = std::chrono::nanoseconds::max();
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        const auto before = std::chrono::steady_clock::now();
+        const auto time   = source.now();
+        const auto after  = std::chrono::steady_clock::now();
+        if (after - before < min_read_duration)
+        {
+            min_read_duration = after - before;
+            error             = time - (before + (after - before) / 2);
+        }
+    }
+    return error;
+}
 
 TEST
 {
@@ -69,4 +121,194 @@ TEST
     // System clocks should be the same
     EXPECT_TRUE(rtp_clock2.ntp_epoch() == rtp_clock.ntp_epoch());
 
-}
\ No newline at end of file
+    // Slew the clock: it should be moved back by 1 ms over 100 ms, without ever going back in time
+    wvb::rtp::RTPClock slewed_clock;
+    const auto         reference_epoch = slewed_clock.steady_time_epoch();
+    slewed_clock.slew_epoch(std::chrono::microseconds(1000), std::chrono::microseconds(100000));
+    EXPECT_TRUE(slewed_clock.remaining_slew().count() > 0);
+
+    auto previous   = slewed_clock.now();
+    bool monotonic  = true;
+    auto slew_start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - slew_start < std::chrono::milliseconds(150))
+    {
+        const auto current = slewed_clock.now();
+        monotonic          = monotonic && current >= previous;
+        previous           = current;
+    }
+    EXPECT_TRUE(monotonic);
+    EXPECT_EQ(slewed_clock.remaining_slew().count(), (int64_t) 0);
+
+    // Once finished, the shift should be the requested one
+    const auto steady_now = std::chrono::steady_clock::now();
+    const auto shift      = std::chrono::duration_cast<std::chrono::microseconds>(
+        (steady_now - reference_epoch) - slewed_clock.from_steady_timepoint(steady_now).time_since_epoch());
+    std::cout << "shift after slew: " << shift.count() << " us" << std::endl;
+    EXPECT_TRUE(std::abs(shift.count() - 1000) <= 11);
+
+    // A slew without duration is applied immediately
+    slewed_clock.slew_epoch(std::chrono::microseconds(-1000), std::chrono::microseconds(0));
+    EXPECT_EQ(slewed_clock.remaining_slew().count(), (int64_t) 0);
+    EXPECT_TRUE(slewed_clock.steady_time_epoch() == reference_epoch);
+
+    // Slews from the synchronization thread while other threads read the time. Each slew ends before the next one and they
+    // alternate directions, so a consistent epoch always shifts the time by 0 to SLEW_AMOUNT. A torn read mixing the new epoch with
+    // the previous slew would shift it by -SLEW_AMOUNT or twice SLEW_AMOUNT.
+    std::atomic<bool>        slewing              = true;
+    std::atomic<uint32_t>    nb_slewed_reads      = 0;
+    std::atomic<bool>        slewed_within_bounds = true;
+    std::vector<std::thread> slew_readers;
+    for (uint32_t i = 0; i < NB_SLEW_READERS; i++)
+    {
+        slew_readers.emplace_back(
+            [&]
+            {
+                while (slewing)
+                {
+                    const auto steady_now = std::chrono::steady_clock::now();
+                    const auto current    = std::chrono::nanoseconds(slewed_clock.ns_from_steady_timepoint(steady_now));
+                    const auto shift      = (steady_now - reference_epoch) - current;
+                    if (shift < -MAX_SLEW_READ_ERROR || shift > SLEW_AMOUNT + MAX_SLEW_READ_ERROR)
+                    {
+                        slewed_within_bounds = false;
+                    }
+                    nb_slewed_reads++;
+                }
+            });
+    }
+    for (uint32_t i = 0; i < NB_SLEWS; i++)
+    {
+        slewed_clock.slew_epoch(i % 2 == 0 ? SLEW_AMOUNT : -SLEW_AMOUNT, SLEW_DURATION);
+        std::this_thread::sleep_for(SLEW_INTERVAL);
+    }
+    slewing = false;
+    for (auto &reader: slew_readers)
+    {
+        reader.join();
+    }
+    std::cout << "reads during slews: " << nb_slewed_reads << std::endl;
+    EXPECT_TRUE(nb_slewed_reads > 0);
+    EXPECT_TRUE(slewed_within_bounds);
+
+    // Nanosecond timeline: same epoch as the RTP timestamps, with a finer resolution
+    const auto timeline_steady = std::chrono::steady_clock::now();
+    const auto timeline_ns     = rtp_clock.ns_from_steady_timepoint(timeline_steady);
+    EXPECT_EQ(wvb::rtp::RTPClock::to_ticks(std::chrono::nanoseconds(timeline_ns)).count(),
+              rtp_clock.from_steady_timepoint(timeline_steady).time_since_epoch().count());
+    EXPECT_EQ(rtp_clock.rtp_timestamp_from_ns(timeline_ns),
+              rtp_clock.to_rtp_timestamp(rtp_clock.from_steady_timepoint(timeline_steady)));
+    // RTP timestamps are placed on the timeline at the start of their tick
+    const uint32_t timeline_rtp = rtp_clock.rtp_timestamp_from_ns(timeline_ns);
+    EXPECT_EQ(rtp_clock.rtp_timestamp_from_ns(rtp_clock.ns_from_rtp_timestamp(timeline_rtp)), timeline_rtp);
+    EXPECT_TRUE(timeline_ns - rtp_clock.ns_from_rtp_timestamp(timeline_rtp) < NS_PER_SEC / 90000 + 1);
+    // Sub-tick intervals are measurable
+    const int64_t timeline_start = rtp_clock.now_ns();
+    int64_t       timeline_end   = rtp_clock.now_ns();
+    while (timeline_end == timeline_start)
+    {
+        timeline_end = rtp_clock.now_ns();
+    }
+    std::cout << "smallest measurable interval: " << timeline_end - timeline_start << " ns" << std::endl;
+    EXPECT_TRUE(timeline_end - timeline_start < NS_PER_SEC / 90000);
+
+    // Fixed-point conversion, compared to the division over a few days
+    std::mt19937_64                        random(42);
+    std::uniform_int_distribution<int64_t> durations_ns(-NS_PER_SEC * 3600LL * 24 * 5, NS_PER_SEC * 3600LL * 24 * 5);
+    uint32_t                               nb_conversion_errors = 0;
+    for (uint32_t i = 0; i < 1000000; i++)
+    {
+        const auto duration = std::chrono::nanoseconds(durations_ns(random));
+        const auto expected = std::chrono::duration_cast<wvb::rtp::RTPClock::ticks>(duration);
+        nb_conversion_errors += wvb::rtp::RTPClock::to_ticks(duration) != expected;
+    }
+    for (int64_t ticks = 0; ticks < 100000; ticks++)
+    {
+        // Exact tick boundaries
+        const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(wvb::rtp::RTPClock::ticks(ticks * 9));
+        nb_conversion_errors += wvb::rtp::RTPClock::to_ticks(duration).count() != ticks * 9;
+    }
+    EXPECT_EQ(nb_conversion_errors, (uint32_t) 0);
+
+    // Cost of the sources
+    const auto monotonic_source = wvb::rtp::TimestampSource::monotonic();
+    const auto tsc_source       = wvb::rtp::TimestampSource::tsc();
+    std::cout << "default source: " << wvb::rtp::to_string(rtp_clock.timestamp_source()->type()) << std::endl;
+
+    wvb::rtp::RTPClock monotonic_clock;
+    monotonic_clock.set_timestamp_source(monotonic_source);
+    std::cout << "steady_clock::now():           "
+              << measure_cost([] { return std::chrono::steady_clock::now().time_since_epoch().count(); }) << " ns/call" << std::endl;
+    std::cout << "RTPClock::now() (MONOTONIC):   "
+              << measure_cost([&] { return monotonic_clock.now().time_since_epoch().count(); }) << " ns/call" << std::endl;
+
+    if (tsc_source == nullptr)
+    {
+        std::cout << "No invariant TSC, skipping the TSC measurements" << std::endl;
+        return;
+    }
+
+    wvb::rtp::RTPClock tsc_clock;
+    tsc_clock.set_timestamp_source(tsc_source);
+    const auto *tsc = dynamic_cast<const wvb::rtp::TSCTimestampSource *>(tsc_source.get());
+    ASSERT_TRUE(tsc != nullptr);
+    std::cout << "TSC frequency: " << tsc->frequency_hz() / 1e6 << " MHz" << std::endl;
+    std::cout << "TSC source now():              " << measure_cost([&] { return tsc->now().time_since_epoch().count(); })
+              << " ns/call" << std::endl;
+    std::cout << "RTPClock::now() (TSC):         " << measure_cost([&] { return tsc_clock.now().time_since_epoch().count(); })
+              << " ns/call" << std::endl;
+    std::cout << "RTPClock::now_rtp_timestamp(): " << measure_cost([&] { return (int64_t) tsc_clock.now_rtp_timestamp() + 1; })
+              << " ns/call" << std::endl;
+
+    // Forced recalibrations keep the time monotonic
+    bool tsc_monotonic = true;
+    auto previous_tsc  = tsc->now();
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        tsc->recalibrate();
+        for (uint32_t j = 0; j < 100; j++)
+        {
+            const auto current = tsc->now();
+            tsc_monotonic      = tsc_monotonic && current >= previous_tsc;
+            previous_tsc       = current;
+        }
+    }
+    EXPECT_TRUE(tsc_monotonic);
+
+    // Drift: the TSC stays close to CLOCK_MONOTONIC across recalibrations, while another thread reads it continuously
+    std::atomic<bool> reading              = true;
+    std::atomic<bool> reader_monotonic     = true;
+    std::thread       reader(
+        [&]
+        {
+            auto previous = tsc->now();
+            while (reading)
+            {
+                const auto current = tsc->now();
+                if (current < previous)
+                {
+                    reader_monotonic = false;
+                }
+                previous = current;
+            }
+        });
+
+    std::cout << "Measuring the TSC drift over " << std::chrono::duration_cast<std::chrono::seconds>(DRIFT_TEST_DURATION).count()
+              << " s..." << std::endl;
+    const auto               start_error = source_error(*tsc);
+    std::chrono::nanoseconds max_error {0};
+    const auto               drift_start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - drift_start < DRIFT_TEST_DURATION)
+    {
+        std::this_thread::sleep_for(DRIFT_TEST_INTERVAL);
+        max_error = std::max(max_error, std::chrono::abs(source_error(*tsc)));
+    }
+    const auto end_error = source_error(*tsc);
+    reading              = false;
+    reader.join();
+
+    std::cout << "TSC error: " << start_error.count() << " ns at start, " << end_error.count() << " ns after "
+              << std::chrono::duration_cast<std::chrono::seconds>(DRIFT_TEST_DURATION).count() << " s, max " << max_error.count()
+              << " ns" << std::endl;
+    EXPECT_TRUE(reader_monotonic);
+    EXPECT_TRUE(max_error < MAX_TSC_ERROR);
+}
@@ -0,0 +1,95 @@
+#include <wvb_common/triple_buffer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <test_framework.hpp>
+#include <thread>
+#include <vector>
+
+#define NB_WRITES 1000000
+// Same order of magnitude as a driver pose
+#define VALUE_NB_WORDS 24
+
+struct Value
+{
+    uint64_t words[VALUE_NB_WORDS];
+};
+
+Value make_value(uint64_t sequence)
+{
+    Value value {};
+    std::fill(std::begin(value.words), std::end(value.words), sequence);
+    return value;
+}
+
+/** All words are written with the same value, so a torn read has different words. */
+bool is_torn(const Value &value)
+{
+    return std::any_of(std::begin(value.words), std::end(value.words), [&](uint64_t word) { return word != value.words[0]; });
+}
+
+TEST
+{
+    // Single thread
+    wvb::TripleBuffer<Value> buffer(make_value(0));
+    EXPECT_FALSE(buffer.has_new_value());
+    EXPECT_EQ(buffer.read().words[0], (uint64_t) 0);
+
+    // Only the latest value is read
+    buffer.write(make_value(1));
+    buffer.write(make_value(2));
+    EXPECT_TRUE(buffer.has_new_value());
+    EXPECT_EQ(buffer.read().words[0], (uint64_t) 2);
+    EXPECT_FALSE(buffer.has_new_value());
+    EXPECT_EQ(buffer.read().words[0], (uint64_t) 2);
+
+    // The writer and the reader run concurrently, like the event thread and SteamVR's pose queries
+    wvb::TripleBuffer<Value> shared_buffer(make_value(0));
+    std::atomic<bool>        writer_done = false;
+
+    std::thread writer(
+        [&]
+        {
+            for (uint64_t i = 1; i <= NB_WRITES; i++)
+            {
+                shared_buffer.write(make_value(i));
+            }
+            writer_done = true;
+        });
+
+    std::vector<int64_t> read_durations_ns;
+    read_durations_ns.reserve(NB_WRITES);
+    uint64_t nb_torn_reads = 0;
+    uint64_t last_value    = 0;
+    bool     is_monotonic  = true;
+    while (!writer_done)
+    {
+        const auto   start = std::chrono::steady_clock::now();
+        const Value &value = shared_buffer.read();
+        read_durations_ns.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+        if (is_torn(value))
+        {
+            nb_torn_reads++;
+        }
+        is_monotonic = is_monotonic && value.words[0] >= last_value;
+        last_value   = value.words[0];
+    }
+    writer.join();
+
+    EXPECT_EQ(nb_torn_reads, (uint64_t) 0);
+    EXPECT_TRUE(is_monotonic);
+    // Once the writer is done, the last value is visible
+    EXPECT_EQ(shared_buffer.read().words[0], (uint64_t) NB_WRITES);
+
+    if (!read_durations_ns.empty())
+    {
+        std::sort(read_durations_ns.begin(), read_durations_ns.end());
+        std::cout << read_durations_ns.size() << " reads during " << NB_WRITES << " writes: p50 "
+                  << read_durations_ns[read_durations_ns.size() / 2] << " ns, p99 "
+                  << read_durations_ns[read_durations_ns.size() * 99 / 100] << " ns, max " << read_durations_ns.back() << " ns\n";
+    }
+}
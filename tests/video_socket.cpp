@@ -7,6 +7,8 @@
 #define MAX_REPEAT  250
 #define INTERVAL_MS 1
 
+const wvb::Pose RENDERED_POSE = {.orientation = {0.1f, 0.2f, 0.3f, 0.9f}, .position = {-0.5f, 1.7f, 2.25f}};
+
 bool repeat(const std::function<bool()> &task)
 {
     for (uint32_t i = 0; i < MAX_REPEAT; i++)
@@ -45,6 +47,7 @@ TEST
                      bool                                  save_frame                = false;
                      uint32_t                              frame_index               = 0;
                      uint32_t                              pose_timestamp            = 0;
+                     wvb::Pose                             rendered_pose             = {};
                      std::chrono::steady_clock::time_point last_packet_received_time = std::chrono::steady_clock::now();
                      success                                                         = repeat(
                          [&client_socket,
@@ -54,6 +57,7 @@ TEST
                           &frame_index,
                           &end_of_stream,
                           &pose_timestamp,
+                          &rendered_pose,
                           &last_packet_received_time,
                           &save_frame]
                          {
@@ -64,6 +68,7 @@ TEST
                                                                  &end_of_stream,
                                                                  &timestamp,
                                                                  &pose_timestamp,
+                                                                 &rendered_pose,
                                                                  &last_packet_received_time,
                                                                  &save_frame);
                          });
@@ -73,6 +78,11 @@ TEST
                      EXPECT_EQ(timestamp, 124578u);
                      ASSERT_EQ(size, (size_t) 1024 * 1024);
                      EXPECT_EQ(frame_index, 1u);
+                     EXPECT_EQ(pose_timestamp, 456789u);
+                     EXPECT_EQ(rendered_pose.orientation.y, RENDERED_POSE.orientation.y);
+                     EXPECT_EQ(rendered_pose.orientation.w, RENDERED_POSE.orientation.w);
+                     EXPECT_EQ(rendered_pose.position.x, RENDERED_POSE.position.x);
+                     EXPECT_EQ(rendered_pose.position.z, RENDERED_POSE.position.z);
                      for (auto i = 0; i < 1024 * 1024; i++)
                      {
                          EXPECT_EQ(data[i], static_cast<uint8_t>(i % 256));
@@ -102,7 +112,8 @@ TEST
                          data_to_send.push_back(static_cast<uint8_t>(i % 256));
                      }
 
-                     server_socket.send_packet(data_to_send.data(), data_to_send.size(), 1, false, 124578u, 456789, true, 0);
+                     server_socket
+                         .send_packet(data_to_send.data(), data_to_send.size(), 1, false, 124578u, 456789, RENDERED_POSE, true, 0);
 
                      std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
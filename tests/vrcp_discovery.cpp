@@ -0,0 +1,131 @@
+#include <wvb_common/vrcp_socket.h>
+
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <test_framework.hpp>
+
+#define ADVERTISEMENT_PORT 12440
+#define DISCOVERY_PORT     12441
+// Long enough that the client can only find the server with its probe
+#define ADVERTISEMENT_INTERVAL_SEC 30
+// The target is well under 100 ms. On loopback, it should be around a millisecond.
+#define MAX_TIME_TO_CONNECTED std::chrono::milliseconds(50)
+#define CONNECT_TIMEOUT       std::chrono::seconds(2)
+
+struct SessionResult
+{
+    bool                     connected = false;
+    wvb::SocketAddr          server_addr {};
+    std::chrono::nanoseconds client_time_to_connected {0};
+    std::chrono::nanoseconds server_time_to_connected {0};
+};
+
+const std::vector<wvb::InetAddr> bcast_addrs {INET_ADDR_LOOPBACK};
+const wvb::VRCPServerParams      server_params {
+         .video_port             = 8722,
+         .supported_video_codecs = {"h264"},
+};
+
+/** Runs both sides of the handshake until they are connected. If no server address is given, the client discovers it first. */
+SessionResult establish_session(const wvb::VRCPSocket          &server,
+                                const wvb::VRCPSocket          &client,
+                                std::optional<wvb::SocketAddr> server_addr)
+{
+    wvb::VRCPClientParams client_params {
+        .video_port = 8931,
+        .specs =
+            {
+                .system_name       = "Quest 2",
+                .manufacturer_name = "Oculus",
+                .eye_resolution    = {1832, 1920},
+                .refresh_rate      = {90, 1},
+                .ipd               = 0.064f,
+            },
+        .supported_video_codecs = {"h264"},
+        .ntp_timestamp          = 22123456789,
+    };
+    wvb::VRCPClientParams received_params {0};
+    wvb::VRCPConnectResp  server_resp {0};
+    wvb::VRCPConnectResp  client_resp {0};
+
+    if (!server_addr.has_value())
+    {
+        client.discover(bcast_addrs, DISCOVERY_PORT);
+    }
+
+    bool       server_connected = false;
+    bool       client_connected = false;
+    const auto deadline         = std::chrono::steady_clock::now() + CONNECT_TIMEOUT;
+    while (!(server_connected && client_connected) && std::chrono::steady_clock::now() < deadline)
+    {
+        if (!server_connected)
+        {
+            server_connected = server.listen(bcast_addrs, server_params, &received_params, &server_resp);
+        }
+
+        if (!server_addr.has_value())
+        {
+            const auto &servers = client.available_servers();
+            if (!servers.empty())
+            {
+                server_addr = servers[0].addr;
+            }
+        }
+        else if (!client_connected)
+        {
+            client_connected = client.connect(server_addr.value(), client_params, &client_resp);
+        }
+    }
+
+    return {
+        .connected                = server_connected && client_connected,
+        .server_addr              = server_addr.value_or(wvb::SocketAddr {}),
+        .client_time_to_connected = client.time_to_connected(),
+        .server_time_to_connected = server.time_to_connected(),
+    };
+}
+
+void print_session(const char *name, const SessionResult &result)
+{
+    std::cout << "Time to connected with " << name << ": client "
+              << std::chrono::duration<double, std::milli>(result.client_time_to_connected).count() << " ms, server "
+              << std::chrono::duration<double, std::milli>(result.server_time_to_connected).count() << " ms\n";
+}
+
+TEST
+{
+    auto server = wvb::VRCPSocket::create_server(ADVERTISEMENT_INTERVAL_SEC, PORT_AUTO, PORT_AUTO, DISCOVERY_PORT, ADVERTISEMENT_PORT);
+    ASSERT_TRUE(server.is_valid());
+
+    // Send the first periodic advertisement before the client listens, so that it is lost
+    {
+        wvb::VRCPClientParams received_params {0};
+        wvb::VRCPConnectResp  resp {0};
+        EXPECT_FALSE(server.listen(bcast_addrs, server_params, &received_params, &resp));
+    }
+
+    auto client = wvb::VRCPSocket::create_client(PORT_AUTO, PORT_AUTO, ADVERTISEMENT_PORT);
+    ASSERT_TRUE(client.is_valid());
+    EXPECT_EQ(client.time_to_connected().count(), (int64_t) 0);
+
+    // Discovery: the server answers the probe right away
+    const auto discovered = establish_session(server, client, std::nullopt);
+    ASSERT_TRUE(discovered.connected);
+    print_session("discovery", discovered);
+    EXPECT_TRUE(discovered.client_time_to_connected > std::chrono::nanoseconds::zero());
+    EXPECT_TRUE(discovered.client_time_to_connected < MAX_TIME_TO_CONNECTED);
+    EXPECT_TRUE(discovered.server_time_to_connected > std::chrono::nanoseconds::zero());
+    EXPECT_TRUE(discovered.server_time_to_connected <= discovered.client_time_to_connected);
+
+    // Fast path: reconnect to the last server straight away
+    server.reset_server();
+    client.reset_client();
+    EXPECT_EQ(client.time_to_connected().count(), (int64_t) 0);
+
+    const auto reconnected = establish_session(server, client, discovered.server_addr);
+    ASSERT_TRUE(reconnected.connected);
+    print_session("last server", reconnected);
+    EXPECT_TRUE(reconnected.client_time_to_connected > std::chrono::nanoseconds::zero());
+    EXPECT_TRUE(reconnected.client_time_to_connected < MAX_TIME_TO_CONNECTED);
+}
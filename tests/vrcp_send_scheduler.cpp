@@ -0,0 +1,170 @@
+#include <wvb_common/vrcp_socket.h>
+
+#include <iostream>
+#include <test_framework.hpp>
+#ifdef __linux__
+#include <cstring>
+#endif
+
+#define MAX_REPEAT        30000
+#define INTERVAL_MS       1
+#define NB_BULK_PACKETS   2000
+#define BULK_PACKET_ROWS  UINT8_MAX
+#define BULK_BUDGET_BYTES (16 * 1024)
+
+bool repeat(const std::function<bool()> &task)
+{
+    for (uint32_t i = 0; i < MAX_REPEAT; i++)
+    {
+        bool success = task();
+        if (success)
+        {
+            return true;
+        }
+
+        // Wait a bit before trying again
+        std::this_thread::sleep_for(std::chrono::milliseconds(INTERVAL_MS));
+    }
+    return false;
+}
+
+TEST
+{
+    wvb::InetAddr         bcast_addr = INET_ADDR_LOOPBACK;
+    wvb::VRCPClientParams client_params {
+        .video_port = 8931,
+        .specs =
+            {
+                .system_name          = "Quest 2",
+                .manufacturer_name    = "Oculus",
+                .eye_resolution       = {1832, 1920},
+                .refresh_rate         = {90, 1},
+                .ipd                  = 0.064f,
+                .eye_to_head_distance = 0.0f,
+            },
+        .supported_video_codecs = {"h264"},
+        .ntp_timestamp          = 22123456789,
+    };
+    wvb::VRCPServerParams server_params {
+        .video_port             = 8722,
+        .supported_video_codecs = {"h264"},
+    };
+
+    START_THREAD(server,
+                 [&]()
+                 {
+                     auto bucket = std::make_shared<wvb::SocketMeasurementBucket>();
+                     bucket->set_clock(std::make_shared<wvb::rtp::RTPClock>());
+                     bucket->set_as_accept_all();
+
+                     auto socket = wvb::VRCPSocket::create_server(3,
+                                                                  PORT_AUTO,
+                                                                  PORT_AUTO,
+                                                                  PORT_AUTO,
+                                                                  VRCP_DEFAULT_ADVERTISEMENT_PORT,
+                                                                  bucket);
+                     ASSERT_TRUE(socket.is_valid());
+                     socket.set_bulk_budget(BULK_BUDGET_BYTES);
+
+                     wvb::VRCPClientParams      received_params {0};
+                     wvb::VRCPConnectResp       resp {0};
+                     std::vector<wvb::InetAddr> bcast_addrs {bcast_addr};
+
+                     bool connected = repeat([&socket, &bcast_addrs, &server_params, &received_params, &resp]()
+                                             { return socket.listen(bcast_addrs, server_params, &received_params, &resp); });
+                     ASSERT_TRUE(connected);
+
+                     // Queue a large bulk transfer in one go, each packet containing its index
+                     constexpr size_t     packet_size = BULK_PACKET_ROWS * VRCP_ROW_SIZE;
+                     std::vector<uint8_t> bulk(NB_BULK_PACKETS * packet_size, 0);
+                     for (uint32_t i = 0; i < NB_BULK_PACKETS; i++)
+                     {
+                         auto *header   = reinterpret_cast<wvb::vrcp::VRCPUserDataHeader *>(&bulk[i * packet_size]);
+                         header->ftype  = wvb::vrcp::VRCPFieldType::USER_DATA;
+                         header->n_rows = BULK_PACKET_ROWS;
+                         header->size   = sizeof(uint32_t);
+                         memcpy(header + 1, &i, sizeof(i));
+                     }
+                     socket.reliable_send(reinterpret_cast<wvb::vrcp::VRCPBaseHeader *>(bulk.data()),
+                                          bulk.size(),
+                                          wvb::SendPriority::BULK);
+
+                     // Only a bounded part of the transfer was handed to the socket
+                     EXPECT_TRUE(socket.queued_bytes(wvb::SendPriority::BULK) > 0);
+
+                     // A control message queued afterwards should be sent right away
+                     wvb::vrcp::VRCPSyncFinished sync_finished {};
+                     socket.reliable_send(reinterpret_cast<wvb::vrcp::VRCPBaseHeader *>(&sync_finished), sizeof(sync_finished));
+                     EXPECT_EQ(socket.queued_bytes(wvb::SendPriority::CONTROL), (size_t) 0);
+
+                     // Send the rest
+                     bool flushed = repeat([&socket]() { return socket.flush_send_queues(); });
+                     EXPECT_TRUE(flushed);
+
+                     // Queueing delays were measured for each class
+                     const auto &measurements = bucket->get_send_queue_measurements();
+                     EXPECT_EQ(measurements[static_cast<uint8_t>(wvb::SendPriority::CONTROL)].packets_sent, (uint32_t) 1);
+                     EXPECT_EQ(measurements[static_cast<uint8_t>(wvb::SendPriority::BULK)].packets_sent, (uint32_t) NB_BULK_PACKETS);
+                     EXPECT_EQ(measurements[static_cast<uint8_t>(wvb::SendPriority::MEASUREMENTS)].packets_sent, (uint32_t) 0);
+                     std::cout << "Max control delay: " << measurements[static_cast<uint8_t>(wvb::SendPriority::CONTROL)].max_delay_us
+                               << " us, max bulk delay: " << measurements[static_cast<uint8_t>(wvb::SendPriority::BULK)].max_delay_us
+                               << " us\n";
+
+                     // Wait for the client to read everything before closing
+                     std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                 });
+
+    START_THREAD(client,
+                 [&]()
+                 {
+                     auto socket = wvb::VRCPSocket::create_client();
+                     ASSERT_TRUE(socket.is_valid());
+
+                     bool has_list = repeat([&socket]() { return !socket.available_servers().empty(); });
+                     ASSERT_TRUE(has_list);
+                     const auto server_addr = socket.available_servers()[0].addr;
+
+                     wvb::VRCPConnectResp resp      = {0};
+                     auto                 connected = repeat([&socket, &server_addr, &client_params, &resp]()
+                                             { return socket.connect(server_addr, client_params, &resp); });
+                     ASSERT_TRUE(connected);
+
+                     uint32_t next_bulk_index              = 0;
+                     int64_t  bulk_received_before_control = -1;
+                     bool     bulk_in_order                = true;
+
+                     bool received_all = repeat(
+                         [&]()
+                         {
+                             const wvb::vrcp::VRCPBaseHeader *packet      = nullptr;
+                             size_t                           packet_size = 0;
+                             while (socket.reliable_receive(&packet, &packet_size))
+                             {
+                                 if (packet->ftype == wvb::vrcp::VRCPFieldType::SYNC_FINISHED)
+                                 {
+                                     bulk_received_before_control = next_bulk_index;
+                                 }
+                                 else if (packet->ftype == wvb::vrcp::VRCPFieldType::USER_DATA)
+                                 {
+                                     // Bulk packets should arrive complete and in order
+                                     uint32_t index = 0;
+                                     memcpy(&index, reinterpret_cast<const wvb::vrcp::VRCPUserDataHeader *>(packet) + 1, sizeof(index));
+                                     bulk_in_order = bulk_in_order && packet_size == BULK_PACKET_ROWS * VRCP_ROW_SIZE
+                                                     && index == next_bulk_index;
+                                     next_bulk_index++;
+                                 }
+                             }
+                             return next_bulk_index == NB_BULK_PACKETS && bulk_received_before_control >= 0;
+                         });
+                     EXPECT_TRUE(received_all);
+                     EXPECT_TRUE(bulk_in_order);
+
+                     // The control message overtook most of the transfer
+                     std::cout << "Control message received after " << bulk_received_before_control << " bulk packets\n";
+                     EXPECT_TRUE(bulk_received_before_control >= 0);
+                     EXPECT_TRUE(bulk_received_before_control * BULK_PACKET_ROWS * VRCP_ROW_SIZE <= BULK_BUDGET_BYTES + BULK_PACKET_ROWS * VRCP_ROW_SIZE);
+                 });
+
+    server.join();
+    client.join();
+}
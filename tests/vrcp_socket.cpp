@@ -47,6 +47,9 @@ TEST
     wvb::VRCPServerParams server_params {
         .video_port     = 8722,
         .supported_video_codecs = {"h264"},
+        // Not the defaults, so that the client can only know them from the CONN_ACCEPT
+        .clock_sync_ping_count           = 7,
+        .clock_sync_target_confidence_us = 350,
     };
 
     START_THREAD(server,
@@ -155,6 +158,8 @@ TEST
 
                      EXPECT_EQ(resp.peer_video_port, server_params.video_port);
                      EXPECT_EQ(resp.chosen_video_codec, std::string("h264"));
+                     EXPECT_EQ(resp.clock_sync_ping_count, server_params.clock_sync_ping_count);
+                     EXPECT_EQ(resp.clock_sync_target_confidence_us, server_params.clock_sync_target_confidence_us);
 
                      // Wait for a (small) while
                      std::this_thread::sleep_for(std::chrono::milliseconds(1));
@@ -0,0 +1,135 @@
+#include <wvb_common/pose_prediction.h>
+#include <wvb_common/vrcp.h>
+
+#include <cmath>
+#include <iostream>
+#include <test_framework.hpp>
+
+#define PI             3.14159265358979323846
+#define FRAME_INTERVAL 1000       // ticks
+#define ANGULAR_SPEED  (PI / 2.0) // rad/s
+#define TICKS_PER_SEC  90000.0
+#define NB_FRAMES      50
+
+/** Rotation of the given angle around an arbitrary axis. */
+wvb::Quaternion rotation(double angle)
+{
+    const double s = std::sin(angle / 2.0);
+    return wvb::quaternion_normalize({static_cast<float>(s * 0.36), static_cast<float>(s * 0.48), static_cast<float>(s * 0.8),
+                                      static_cast<float>(std::cos(angle / 2.0))});
+}
+
+/** Simulated head motion. */
+wvb::PastPose head_pose(uint32_t pose_timestamp)
+{
+    const double t = static_cast<double>(pose_timestamp) / TICKS_PER_SEC;
+    return {
+        .pose_timestamp = pose_timestamp,
+        .pose =
+            {
+                .orientation = rotation(ANGULAR_SPEED * t),
+                .position    = {static_cast<float>(0.3 * std::sin(t)), 1.7f, static_cast<float>(-0.5 * t)},
+            },
+    };
+}
+
+/** Largest difference between the components of the quaternions, more precise than the angle for small errors. */
+float orientation_error(const wvb::Quaternion &a, const wvb::Quaternion &b)
+{
+    // q and -q are the same orientation
+    const float sign = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w < 0 ? -1.0f : 1.0f;
+    return std::max({std::abs(a.x - sign * b.x), std::abs(a.y - sign * b.y), std::abs(a.z - sign * b.z), std::abs(a.w - sign * b.w)});
+}
+
+float position_error(const wvb::Pose &a, const wvb::Pose &b)
+{
+    const float dx = a.position.x - b.position.x;
+    const float dy = a.position.y - b.position.y;
+    const float dz = a.position.z - b.position.z;
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+TEST
+{
+    // Smaller than the full tracking data
+    std::cout << "Compact tracking data: " << sizeof(wvb::vrcp::VRCPCompactTrackingData) << " bytes instead of "
+              << sizeof(wvb::vrcp::VRCPTrackingData) << " bytes\n";
+    EXPECT_TRUE(sizeof(wvb::vrcp::VRCPCompactTrackingData) < sizeof(wvb::vrcp::VRCPTrackingData));
+
+    float max_orientation_error      = 0;
+    float max_position_error         = 0;
+    float max_past_orientation_error = 0;
+    float max_past_position_error    = 0;
+
+    for (uint32_t frame = WVB_TRACKING_PAST_POSES_CAPACITY; frame < NB_FRAMES; frame++)
+    {
+        // Latest pose, and the previous ones
+        const auto         latest = head_pose(frame * FRAME_INTERVAL);
+        wvb::TrackingState state {
+            .sample_timestamp = frame * FRAME_INTERVAL - 100,
+            .pose_timestamp   = latest.pose_timestamp,
+            .pose             = latest.pose,
+            .nb_past_poses    = WVB_TRACKING_PAST_POSES_CAPACITY,
+        };
+        for (uint32_t i = 0; i < WVB_TRACKING_PAST_POSES_CAPACITY; i++)
+        {
+            state.past_poses[i] = head_pose((frame - i - 1) * FRAME_INTERVAL);
+        }
+
+        // Round trip
+        const wvb::vrcp::VRCPCompactTrackingData msg {state};
+        wvb::TrackingState                       decoded {};
+        msg.to_tracking_state(decoded);
+
+        EXPECT_EQ(decoded.sample_timestamp, state.sample_timestamp);
+        EXPECT_EQ(decoded.pose_timestamp, state.pose_timestamp);
+        EXPECT_EQ(decoded.nb_past_poses, (uint32_t) WVB_TRACKING_PAST_POSES_CAPACITY);
+        max_orientation_error = std::max(max_orientation_error, orientation_error(decoded.pose.orientation, state.pose.orientation));
+        max_position_error    = std::max(max_position_error, position_error(decoded.pose, state.pose));
+
+        for (uint32_t i = 0; i < decoded.nb_past_poses; i++)
+        {
+            EXPECT_EQ(decoded.past_poses[i].pose_timestamp, state.past_poses[i].pose_timestamp);
+            max_past_orientation_error =
+                std::max(max_past_orientation_error,
+                         orientation_error(decoded.past_poses[i].pose.orientation, state.past_poses[i].pose.orientation));
+            max_past_position_error =
+                std::max(max_past_position_error, position_error(decoded.past_poses[i].pose, state.past_poses[i].pose));
+        }
+    }
+
+    std::cout << "Latest pose error: " << max_orientation_error << " (quaternion), " << max_position_error * 1000.0 << " mm\n";
+    std::cout << "Past poses error: " << max_past_orientation_error << " (quaternion), " << max_past_position_error * 1000.0
+              << " mm\n";
+    EXPECT_TRUE(max_orientation_error < 1e-5f);
+    EXPECT_TRUE(max_position_error < 1e-5f);
+    EXPECT_TRUE(max_past_orientation_error < 5e-4f);
+    EXPECT_TRUE(max_past_position_error < 1e-4f);
+
+    // The largest component may be negative
+    wvb::TrackingState negative {.pose = {.orientation = {0.1f, -0.2f, 0.3f, -0.9273618f}}};
+    wvb::TrackingState decoded_negative {};
+    wvb::vrcp::VRCPCompactTrackingData {negative}.to_tracking_state(decoded_negative);
+    EXPECT_TRUE(orientation_error(decoded_negative.pose.orientation, negative.pose.orientation) < 1e-5f);
+
+    // Past poses too far from the latest one are dropped, and the FOV is left untouched
+    wvb::TrackingState far_state {
+        .pose_timestamp = 100000,
+        .pose           = head_pose(100000).pose,
+        .nb_past_poses  = 2,
+        .past_poses     = {head_pose(99000), head_pose(10000)},
+    };
+    wvb::TrackingState decoded_far {.fov_left = {.left = 1.0f}};
+    wvb::vrcp::VRCPCompactTrackingData {far_state}.to_tracking_state(decoded_far);
+    EXPECT_EQ(decoded_far.nb_past_poses, (uint32_t) 1);
+    EXPECT_EQ(decoded_far.past_poses[0].pose_timestamp, (uint32_t) 99000);
+    EXPECT_EQ(decoded_far.fov_left.left, 1.0f);
+
+    // FOV
+    const wvb::Fov     fov_left {.left = -0.8f, .right = 0.7f, .up = 0.75f, .down = -0.9f};
+    const wvb::Fov     fov_right {.left = -0.7f, .right = 0.8f, .up = 0.75f, .down = -0.9f};
+    wvb::TrackingState fov_state {};
+    wvb::vrcp::VRCPFovData {fov_left, fov_right}.to_tracking_state(fov_state);
+    EXPECT_TRUE(fov_state.fov_left == fov_left);
+    EXPECT_TRUE(fov_state.fov_right == fov_right);
+}
@@ -0,0 +1,128 @@
+#include <wvb_common/vsync_phase_lock.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <test_framework.hpp>
+#include <vector>
+
+// 90 Hz
+#define NOMINAL_PERIOD_US (1000000.0 / 90.0)
+// The client's display clock runs slightly faster than the synchronized clock
+#define CLOCK_DRIFT_PPM 300
+#define PHASE_OFFSET_US 25000
+// The client reports its display timing every few frames
+#define REPORT_INTERVAL_FRAMES 10
+#define NB_FRAMES              3000
+#define NB_SETTLING_FRAMES     500
+// RTP timestamps have a resolution of 1/90000 s
+#define RTP_TICK_US (1000000.0 / 90000.0)
+
+struct PhaseStats
+{
+    double p50_abs_error_us = 0;
+    double p99_abs_error_us = 0;
+    double max_abs_error_us = 0;
+};
+
+/** Distance between the vsync and the nearest target on the real display grid. */
+double real_phase_error(double vsync_us, double display_start_us, double display_period_us)
+{
+    double phase = std::fmod(vsync_us - (display_start_us - PHASE_OFFSET_US), display_period_us);
+    if (phase < -display_period_us / 2)
+    {
+        phase += display_period_us;
+    }
+    else if (phase >= display_period_us / 2)
+    {
+        phase -= display_period_us;
+    }
+    return phase;
+}
+
+/**
+ * Simulates the driver's vsync loop against a drifting display. The vsyncs are slightly jittered, like the real wait. If
+ * use_phase_lock is false, the vsync interval stays at the nominal period, like before.
+ */
+PhaseStats simulate(bool use_phase_lock, double initial_phase_us)
+{
+    const double display_period_us = NOMINAL_PERIOD_US * (1.0 - CLOCK_DRIFT_PPM / 1000000.0);
+    const double display_start_us  = 1000000.0;
+
+    std::mt19937                     generator(42);
+    std::normal_distribution<double> jitter_us(0, 20);
+
+    wvb::VsyncPhaseLock phase_lock(NOMINAL_PERIOD_US);
+    double              vsync_us = display_start_us - PHASE_OFFSET_US + initial_phase_us;
+
+    std::vector<double> abs_errors_us;
+    for (uint32_t frame = 0; frame < NB_FRAMES; frame++)
+    {
+        // Quantized display time of the latest frame, with the nominal period as reported by the client
+        if (frame % REPORT_INTERVAL_FRAMES == 0)
+        {
+            const double latest_display_us =
+                display_start_us + std::floor((vsync_us - display_start_us) / display_period_us) * display_period_us;
+            const auto display_timestamp_us = static_cast<int64_t>(std::floor(latest_display_us / RTP_TICK_US) * RTP_TICK_US);
+            phase_lock.set_reference(display_timestamp_us, NOMINAL_PERIOD_US, PHASE_OFFSET_US);
+        }
+
+        const double interval_us = phase_lock.on_vsync(static_cast<int64_t>(vsync_us));
+        if (frame >= NB_SETTLING_FRAMES)
+        {
+            abs_errors_us.push_back(std::abs(real_phase_error(vsync_us, display_start_us, display_period_us)));
+        }
+        vsync_us += (use_phase_lock ? interval_us : NOMINAL_PERIOD_US) + jitter_us(generator);
+    }
+
+    std::sort(abs_errors_us.begin(), abs_errors_us.end());
+    return {
+        .p50_abs_error_us = abs_errors_us[abs_errors_us.size() / 2],
+        .p99_abs_error_us = abs_errors_us[abs_errors_us.size() * 99 / 100],
+        .max_abs_error_us = abs_errors_us.back(),
+    };
+}
+
+void print_stats(const char *name, const PhaseStats &stats)
+{
+    std::cout << name << ": phase error p50 " << stats.p50_abs_error_us << " us, p99 " << stats.p99_abs_error_us << " us, max "
+              << stats.max_abs_error_us << " us\n";
+}
+
+TEST
+{
+    // Without reference, the nominal period is kept
+    wvb::VsyncPhaseLock phase_lock(NOMINAL_PERIOD_US);
+    EXPECT_FALSE(phase_lock.has_reference());
+    EXPECT_EQ(phase_lock.on_vsync(1000), NOMINAL_PERIOD_US);
+
+    // Late vsyncs shorten the next interval, early ones lengthen it, by a bounded amount
+    phase_lock.set_reference(100000, NOMINAL_PERIOD_US, 0);
+    EXPECT_TRUE(phase_lock.on_vsync(100000 + 1000) < NOMINAL_PERIOD_US);
+    EXPECT_TRUE(phase_lock.phase_error_us() > 0);
+    phase_lock.reset();
+    phase_lock.set_reference(100000, NOMINAL_PERIOD_US, 0);
+    EXPECT_TRUE(phase_lock.on_vsync(100000 - 1000) > NOMINAL_PERIOD_US);
+    EXPECT_TRUE(phase_lock.on_vsync(100000 + 5000) >= NOMINAL_PERIOD_US * 0.95);
+
+    // The error wraps to the nearest target
+    phase_lock.reset();
+    phase_lock.set_reference(100000, NOMINAL_PERIOD_US, 0);
+    phase_lock.on_vsync(100000 + 10 * static_cast<int64_t>(NOMINAL_PERIOD_US) + 10000);
+    EXPECT_TRUE(phase_lock.phase_error_us() < 0);
+
+    // With clock drift, the phase lock converges from any initial phase and stays locked
+    for (const double initial_phase_us : {-5000.0, 0.0, 2000.0, 5500.0})
+    {
+        const auto stats = simulate(true, initial_phase_us);
+        print_stats("Phase lock", stats);
+        EXPECT_TRUE(stats.p50_abs_error_us < 50);
+        EXPECT_TRUE(stats.p99_abs_error_us < 150);
+    }
+
+    // Free-running vsync for comparison: the phase drifts away
+    const auto free_stats = simulate(false, 0);
+    print_stats("Nominal period", free_stats);
+    EXPECT_TRUE(free_stats.max_abs_error_us > 1000);
+}
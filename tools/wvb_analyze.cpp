@@ -0,0 +1,141 @@
+/**
+ * Analyzes the measurement files of a benchmark: fits the clock error of the client across the runs, and summarizes the stage
+ * latencies and the frame rates of each pass. This replaces the slow parts of wvb_measurements.py for large benchmarks.
+ *
+ * Usage: wvb_analyze <measurement directory> [--output <directory>] [--format csv|binary] [--threads <count>]
+ *                    [--no-clock-correction]
+ * One file is written per pass, named wvb_analysis_pass_<pass>. A summary is written to the standard output, progress is logged
+ * to the error output.
+ */
+
+#include <wvb_common/columnar_file.h>
+#include <wvb_common/measurement_analysis.h>
+
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#define ANALYSIS_FILE_PREFIX "wvb_analysis_pass_"
+
+bool write_csv(const std::string &path, const wvb::MeasurementAnalysis &analysis, const wvb::PassAnalysis &pass)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    file << "stage_latency_measurements\n";
+    wvb::StageLatencyHistograms::export_csv(file, pass.latencies);
+    file << "---\n";
+    file << "frame_rate_measurements\n";
+    wvb::PassAnalysis::export_csv(file, pass);
+    file << "---\n";
+    file << "client_clock_error_fit\n";
+    wvb::ClientClockErrorFit::export_csv(file, analysis.client_clock_error);
+    file << "---\n";
+    return file.good();
+}
+
+bool write_binary(const std::string &path, const wvb::MeasurementAnalysis &analysis, const wvb::PassAnalysis &pass)
+{
+    wvb::ColumnarFileWriter file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    wvb::StageLatencyHistograms::export_columns(file, "stage_latency_measurements", pass.latencies);
+    wvb::PassAnalysis::export_columns(file, "frame_rate_measurements", pass);
+    wvb::ClientClockErrorFit::export_columns(file, "client_clock_error_fit", analysis.client_clock_error);
+    return file.close();
+}
+
+int main(int argc, char **argv)
+{
+    std::string directory;
+    std::string output_directory = ".";
+    std::string format           = "csv";
+    uint32_t    nb_threads       = 0;
+    bool        correct_clock    = true;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc)
+        {
+            output_directory = argv[++i];
+        }
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            format = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            nb_threads = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--no-clock-correction")
+        {
+            correct_clock = false;
+        }
+        else if (directory.empty() && !arg.starts_with("--"))
+        {
+            directory = arg;
+        }
+        else
+        {
+            directory.clear();
+            break;
+        }
+    }
+    if (directory.empty())
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " <measurement directory> [--output <directory>] [--format csv|binary] [--threads <count>]"
+                     " [--no-clock-correction]\n";
+        return 1;
+    }
+    if (format != "csv" && format != "binary")
+    {
+        std::cerr << "Unknown format \"" << format << "\", expected csv or binary\n";
+        return 1;
+    }
+
+    std::cerr << "Analyzing the measurements of " << directory << "...\n";
+    const auto               start = std::chrono::steady_clock::now();
+    wvb::MeasurementAnalysis analysis;
+    try
+    {
+        analysis = wvb::analyze_measurements(directory, correct_clock, nb_threads);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Unable to analyze the measurements: " << e.what() << "\n";
+        return 1;
+    }
+    const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Analyzed " << analysis.passes.size() << " passes in " << elapsed_ms << " ms\n";
+
+    const auto &fit = analysis.client_clock_error;
+    std::cout << "Client clock error: " << fit.slope << " * t + " << fit.intercept_ns << " ns (" << fit.nb_samples << " samples)\n";
+
+    bool success = true;
+    for (const auto &pass : analysis.passes)
+    {
+        const auto &motion_to_photon = pass.latencies.stages[static_cast<size_t>(wvb::LatencyStage::MOTION_TO_PHOTON)];
+        std::cout << "Pass " << pass.pass_id << ": " << pass.nb_runs << " runs, " << pass.nb_frames << " frames, "
+                  << pass.driver_fps << " driver fps, " << pass.client_fps << " client fps, motion to photon p50 "
+                  << motion_to_photon.value_at_quantile(0.5) << " ns\n";
+
+        const std::string path = output_directory + "/" ANALYSIS_FILE_PREFIX + std::to_string(pass.pass_id)
+                               + (format == "csv" ? ".csv" : ".wvbm");
+        if (!(format == "csv" ? write_csv(path, analysis, pass) : write_binary(path, analysis, pass)))
+        {
+            std::cerr << "Unable to write " << path << "\n";
+            success = false;
+        }
+    }
+
+    return success ? 0 : 1;
+}
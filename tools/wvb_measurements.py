@@ -3,6 +3,7 @@
 from matplotlib import image
 import pandas as pd
 import os
+import struct
 import numpy as np
 import matplotlib.pyplot as plt
 import skimage
@@ -11,6 +12,47 @@ EXPECTING_TABLE_NAME = 0
 EXPECTING_COLUMN_NAMES = 1
 EXPECTING_VALUES = 2
 
+# Binary columnar files, see ColumnarFileWriter
+COLUMNAR_FILE_MAGIC = b"WVBC"
+COLUMNAR_FILE_VERSION = 1
+COLUMN_TYPE_STRING = 5
+COLUMN_DTYPES = {
+    0: np.dtype("<u1"),  # BOOL
+    1: np.dtype("<i4"),  # INT32
+    2: np.dtype("<u4"),  # UINT32
+    3: np.dtype("<i8"),  # INT64
+    4: np.dtype("<f4"),  # FLOAT32
+}
+
+# Times are exported in nanoseconds since the synchronized epoch, which never wraps.
+# They are loaded in microseconds, with their sub-microsecond part.
+NS_PER_US = 1000
+TIME_TABLES = [
+    "driver_frame_time_measurements",
+    "driver_tracking_measurements",
+    "driver_pose_access_measurements",
+    "driver_pose_prediction_measurements",
+    "server_frame_time_measurements",
+    "server_tracking_measurements",
+    "client_frame_time_measurements",
+    "client_tracking_measurements",
+    "stage_latency_measurements",
+    "repetition_measurements",
+]
+NON_TIME_COLUMNS = [
+    "frame_id",
+    "frame_index",
+    "dropped",
+    "frame_delay",
+    "present_deadline_error",
+    "orientation_error",
+    "position_error",
+    "stage",
+    "count",
+    "nb_runs",
+    "stop_reason",
+]
+
 
 def wvb_combine_frame_times(measurement):
     """Combine the separate frame time tables into a single data frame."""
@@ -37,6 +79,7 @@ def wvb_combine_frame_times(measurement):
         "wait_for_present_called",
         "server_finished",
         "pose_updated_event",
+        "present_deadline_error",
         # Server times
         "frame_event_received",
         "present_info_received",
@@ -66,8 +109,8 @@ def wvb_combine_frame_times(measurement):
     # Replace nan with 0
     df = df.fillna(0)
 
-    # Convert all columns to int
-    df = df.astype('int64')
+    # Convert all columns to numbers, times keep their sub-microsecond part
+    df = df.astype('float64')
 
     return df
 
@@ -110,8 +153,8 @@ def wvb_combine_tracking_times(measurement, client_tracking=False):
             driver_tracking_time, on="pose_timestamp")
     df = df.merge(driver_access_time, on="pose_timestamp")
 
-    # Convert all columns to int
-    df = df.astype('int64')
+    # Convert all columns to numbers, times keep their sub-microsecond part
+    df = df.astype('float64')
 
     return df
 
@@ -155,6 +198,10 @@ def wvb_combine_all_times(measurement, client_tracking=False, keep_dropped=False
 def wvb_load_measurements(path):
     """Loads a WVB measurement file into a pandas DataFrame."""
 
+    with open(path, "rb") as f:
+        if f.read(len(COLUMNAR_FILE_MAGIC)) == COLUMNAR_FILE_MAGIC:
+            return wvb_load_binary_measurements(path)
+
     # A wvb file is a concatenation of csv's in the format
 
     # table_name
@@ -218,17 +265,98 @@ def wvb_load_measurements(path):
                     measurements[table_name].loc[len(
                         measurements[table_name])] = values
 
+    wvb_convert_times_to_us(measurements)
+
     return measurements
 
 
+def wvb_load_binary_measurements(path):
+    """Loads a binary columnar WVB measurement file into a dict of pandas DataFrames, like wvb_load_measurements."""
+
+    with open(path, "rb") as f:
+        data = f.read()
+
+    offset = 0
+
+    def read(fmt):
+        nonlocal offset
+        values = struct.unpack_from(fmt, data, offset)
+        offset += struct.calcsize(fmt)
+        return values[0]
+
+    def read_string():
+        nonlocal offset
+        size = read("<I")
+        value = data[offset:offset + size].decode("utf-8")
+        offset += size
+        return value
+
+    if data[:len(COLUMNAR_FILE_MAGIC)] != COLUMNAR_FILE_MAGIC:
+        raise ValueError(f"{path} is not a columnar measurement file")
+    offset = len(COLUMNAR_FILE_MAGIC)
+    version = read("<I")
+    if version != COLUMNAR_FILE_VERSION:
+        raise ValueError(f"Unsupported columnar file version: {version}")
+
+    measurements = {}
+    while offset < len(data):
+        table_name = read_string()
+        n_cols = read("<I")
+        n_rows = read("<I")
+
+        columns = {}
+        for _ in range(n_cols):
+            column_name = read_string()
+            column_type = read("<B")
+            size = read("<Q")
+            column_data = data[offset:offset + size]
+            offset += size
+
+            if column_type == COLUMN_TYPE_STRING:
+                values = []
+                string_offset = 0
+                while string_offset < size:
+                    (length,) = struct.unpack_from("<I", column_data, string_offset)
+                    string_offset += 4
+                    values.append(column_data[string_offset:string_offset + length].decode("utf-8"))
+                    string_offset += length
+                columns[column_name] = values
+            elif column_type in COLUMN_DTYPES:
+                columns[column_name] = np.frombuffer(column_data, dtype=COLUMN_DTYPES[column_type])
+            else:
+                raise ValueError(f"Invalid column type {column_type} in table {table_name}")
+
+            if len(columns[column_name]) != n_rows:
+                raise ValueError(f"Invalid number of values in column {column_name} of table {table_name}")
+
+        measurements[table_name] = pd.DataFrame(columns)
+
+    wvb_convert_times_to_us(measurements)
+
+    return measurements
+
+
+def wvb_convert_times_to_us(measurements):
+    """Converts the times of the loaded tables from nanoseconds to microseconds."""
+
+    for table_name in TIME_TABLES:
+        if table_name not in measurements:
+            continue
+
+        df = measurements[table_name]
+        for column in df.columns:
+            if column not in NON_TIME_COLUMNS:
+                df[column] = df[column].astype('int64') / NS_PER_US
+
+
 def wvb_load_measurement_pass(directory: str, pass_id: int):
     """Loads a measurement pass from a directory."""
 
-    # List all wvb_measurements_pass_<pass_id>_<run_id>.csv files
+    # List all wvb_measurements_pass_<pass_id>_<run_id>.csv (or .wvbm, in the binary format) files
     files = os.listdir(directory)
     files = [f for f in files if f.startswith(
         f"wvb_measurements_pass_{pass_id}_")]
-    files = [f for f in files if f.endswith(".csv")]
+    files = [f for f in files if f.endswith(".csv") or f.endswith(".wvbm")]
 
     print(f"Found {len(files)} files for pass {pass_id}")
 
@@ -239,6 +367,27 @@ def wvb_load_measurement_pass(directory: str, pass_id: int):
     return measurements
 
 
+def wvb_load_pass_latencies(directory: str, pass_id: int):
+    """Loads the stage latency percentiles of a whole pass, as summarized by the server."""
+
+    path = os.path.join(directory, f"wvb_latencies_pass_{pass_id}.wvbm")
+    if not os.path.exists(path):
+        path = os.path.join(directory, f"wvb_latencies_pass_{pass_id}.csv")
+    return wvb_load_measurements(path)["stage_latency_measurements"]
+
+
+def wvb_load_pass_repetitions(directory: str, pass_id: int):
+    """Loads the number of runs of a pass, the confidence interval of the mean latency of each stage and why the pass stopped."""
+
+    path = os.path.join(directory, f"wvb_latencies_pass_{pass_id}.wvbm")
+    if not os.path.exists(path):
+        path = os.path.join(directory, f"wvb_latencies_pass_{pass_id}.csv")
+    df = wvb_load_measurements(path)["repetition_measurements"]
+    # Stages measured in less than 2 runs have no confidence interval
+    df.loc[df["ci_half_width"] < 0, "ci_half_width"] = float("nan")
+    return df
+
+
 def wvb_average_table(measurements, table_name):
     """Averages a table from a measurement list."""
 
@@ -268,7 +417,7 @@ def wvb_convert_time_to_delay(df):
     """Converts absolute timestamps to delays relative to the present_called column."""
 
     excluded = ["frame_id", "dropped", "frame_index",
-                "frame_delay", "present_called"]
+                "frame_delay", "present_called", "present_deadline_error"]
 
     df.loc[:, ~df.columns.isin(excluded)] = df.loc[:, ~df.columns.isin(
         excluded)].sub(df["present_called"], axis=0)
@@ -403,6 +552,73 @@ def wvb_combine_delays(measurements):
     return df
 
 
+def wvb_stage_latencies(df):
+    """Latencies of the pipeline stages of each frame of a combined frame time table, like StageLatencyHistograms::record_frames().
+    Returns the latencies by stage name. Frames that miss one of the times of a stage are left out of it."""
+
+    server = (df["present_called"] != 0) & (df["dropped"] == 0)
+    # The texture is only acquired when it has to be copied
+    acquired = df["shared_texture_acquired"].where(df["shared_texture_acquired"] != 0, df["encoder_frame_pushed"])
+    stages = {
+        "ENCODE": (acquired, df["after_last_get_next_packet"], server),
+        "SEND": (df["after_last_get_next_packet"], df["after_last_send_packet"], server),
+        "NETWORK": (df["after_last_send_packet"], df["last_packet_received"], server),
+        "DECODE": (df["pushed_to_decoder"], df["after_render"], None),
+        "RENDER": (df["after_render"], df["end_frame"], None),
+        "MOTION_TO_PHOTON": (df["tracking_sampled"], df["predicted_present_time"], None),
+    }
+
+    latencies = {}
+    for stage, (start, end, rows) in stages.items():
+        measured = (start != 0) & (end != 0)
+        if rows is not None:
+            measured &= rows
+        latencies[stage] = (end - start)[measured].to_numpy()
+    return latencies
+
+
+def wvb_summarize_pass(measurements, m=None, c=None):
+    """Summarizes the runs of a pass like wvb_analyze: percentiles of the stage latencies over all the frames, and frame rates of
+    the driver and of the client averaged over the runs. Client times are corrected with the clock error function of
+    wvb_get_client_clock_error_fn() if it is given. Times are in microseconds."""
+
+    summary = {"nb_runs": len(measurements), "nb_frames": 0, "driver_fps": 0.0, "client_fps": 0.0}
+    latencies = {}
+    for measurement in measurements:
+        df = wvb_combine_frame_times(measurement)
+        summary["nb_frames"] += len(measurement["client_frame_time_measurements"])
+
+        # Times that weren't measured are 0, and must stay so after the correction
+        unmeasured = df == 0
+        if m is not None and c is not None:
+            wvb_fix_client_clock_error(df, m, c)
+            df = df.mask(unmeasured, 0)
+
+        for stage, values in wvb_stage_latencies(df).items():
+            latencies[stage] = np.concatenate([latencies.get(stage, []), values])
+
+        # Average rate over the span of the run
+        for key, times in (("driver_fps", df["present_called"]), ("client_fps", df["end_frame"])):
+            times = times[times != 0]
+            if len(times) >= 2 and times.max() > times.min():
+                summary[key] += (len(times) - 1) * 1000000 / (times.max() - times.min())
+
+    summary["driver_fps"] /= max(len(measurements), 1)
+    summary["client_fps"] /= max(len(measurements), 1)
+
+    for stage, values in latencies.items():
+        summary[f"{stage}_count"] = len(values)
+        if len(values) == 0:
+            continue
+        summary[f"{stage}_min"] = values.min()
+        summary[f"{stage}_mean"] = values.mean()
+        for name, quantile in (("p50", 50), ("p90", 90), ("p99", 99)):
+            summary[f"{stage}_{name}"] = np.percentile(values, quantile, method="inverted_cdf")
+        summary[f"{stage}_max"] = values.max()
+
+    return pd.Series(summary)
+
+
 def wvb_plot_frame_times(df, codec_name, n=10, start=0, plot_tracking=True):
     """Bar plot displaying the parallel execution of the video pipeline, as well
     as the latency taken by each pipeline stage."""
@@ -617,15 +833,17 @@ def wvb_load_rgba_image(path, width, height):
 
 
 def wvb_psnr(image1, image2):
-    """Compute the PSNR between two images."""
+    """Compute the PSNR between two RGBA images, ignoring alpha like the server's image quality measurements."""
 
-    mse = np.mean((image1 - image2) ** 2)
+    # Promote the samples, so that differences of uint8 images don't wrap around
+    diff = image1[:, :, :3].astype(np.float64) - image2[:, :, :3].astype(np.float64)
+    mse = np.mean(diff**2)
     if mse == 0:
         return np.inf
     return 20 * np.log10(255.0 / np.sqrt(mse))
 
 
 def wvb_ssim(image1, image2):
-    """Compute the SSIM between two images."""
+    """Compute the SSIM between two RGBA images, ignoring alpha like the server's image quality measurements."""
 
-    return skimage.metrics.structural_similarity(image1, image2, multichannel=True, channel_axis=2)
+    return skimage.metrics.structural_similarity(image1[:, :, :3], image2[:, :, :3], channel_axis=2, data_range=255)
@@ -33,7 +33,7 @@ namespace wvb::client
         void init(const ApplicationInfo &app_info);
         void shutdown();
         void set_decoder(const std::shared_ptr<IVideoDecoder> &video_decoder);
-        bool push_frame_data(const uint8_t *data, size_t size, uint32_t frame_index, bool end_of_stream, uint32_t timestamp, uint32_t pose_timestamp, uint32_t last_packet_received_timestamp, bool save_frame) const;
+        bool push_frame_data(const uint8_t *data, size_t size, uint32_t frame_index, bool end_of_stream, uint32_t timestamp, uint32_t pose_timestamp, const Pose &rendered_pose, int64_t last_packet_received_ns, bool save_frame) const;
         [[nodiscard]] VRSystemSpecs specs() const;
         [[nodiscard]] uint64_t      ntp_epoch() const;
         void                        soft_shutdown();
@@ -44,6 +44,8 @@ namespace wvb::client
         [[nodiscard]] bool new_frame(ClientFrameTimeMeasurements &frame_execution_time);
         void               render(ClientFrameTimeMeasurements &frame_execution_time);
         uint32_t get_decoder_frame_delay() const;
+        /** Time between two refreshes of the display, as predicted by the runtime for the current frame. 0 if unknown. */
+        [[nodiscard]] uint32_t get_display_period_ns() const;
 
         bool save_frame_if_needed(IOBuffer &image) const;
     };
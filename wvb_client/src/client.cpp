@@ -1,6 +1,7 @@
 #include "wvb_client/client.h"
 
 #include <wvb_client/vr_system.h>
+#include <wvb_common/clock_sync.h>
 #include <wvb_common/module.h>
 #include <wvb_common/network_utils.h>
 #include <wvb_common/rtp.h>
@@ -9,6 +10,8 @@
 #include <wvb_common/vrcp_socket.h>
 
 #include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <optional>
 #include <sys/prctl.h>
@@ -18,12 +21,22 @@
 #define VIDEO_PORT          PORT_AUTO
 #define POLL_INTERVAL_MS    500
 #define WVB_MAX_PACKET_SIZE 1500
-#define PING_INTERVAL_MS    std::chrono::milliseconds(200)
 #define PING_TIMEOUT_MS     std::chrono::milliseconds(500)
-#define PING_COUNT          20
 #define FRAGMENT_SIZE       400
 #define EMPTY_DEPACKETIZER_EACH_FRAME true
 
+// Startup clock sync: bursts of back-to-back pings until the offset is precise enough, with at most ping_count replies
+#define PING_BURST_SIZE        4
+#define PING_BURST_INTERVAL_MS std::chrono::milliseconds(20)
+// Interval between pings once the app is running, to keep the clocks in sync
+#define CLOCK_SYNC_INTERVAL_MS std::chrono::milliseconds(1000)
+// Number of frames between two display timing updates, on which the driver locks its vsync
+#define DISPLAY_TIMING_INTERVAL_FRAMES 10
+// Session establishment: probes are answered right away by the servers, so they only need to be repeated in case of loss
+#define DISCOVERY_PROBE_INTERVAL    std::chrono::milliseconds(100)
+#define LAST_SERVER_CONNECT_TIMEOUT std::chrono::milliseconds(500)
+#define LAST_SERVER_FILE_NAME       "last_server"
+
 namespace wvb::client
 {
     // =======================================================================================
@@ -48,6 +61,19 @@ namespace wvb::client
         std::shared_ptr<rtp::RTPClock> rtp_clock = std::make_shared<rtp::RTPClock>();
         std::thread                    syncing_thread;
 
+        ClockSyncEstimator                    clock_sync_estimator;
+        uint16_t                              ping_id                = 0;
+        bool                                  waiting_for_ping_reply = false;
+        std::chrono::steady_clock::time_point last_ping_send_time {};
+
+        /** Latest sent poses, newest first. They are repeated in the next tracking updates to mask packet losses. */
+        PastPose sent_poses[WVB_TRACKING_PAST_POSES_CAPACITY] {};
+        uint32_t nb_sent_poses = 0;
+        /** FOV is only sent when it changes. */
+        std::optional<std::pair<Fov, Fov>> sent_fov = std::nullopt;
+        /** Frames rendered since the display timing was last sent. */
+        uint32_t frames_since_display_timing = DISPLAY_TIMING_INTERVAL_FRAMES;
+
         std::vector<Module> modules;
         Module              chosen_module;
 
@@ -59,6 +85,13 @@ namespace wvb::client
         VRCPConnectResp           connect_resp {};
         std::optional<SocketAddr> server_addr = std::nullopt;
 
+        // Discovery
+        std::vector<InetAddr>                                bcast_addrs;
+        std::chrono::steady_clock::time_point                last_probe_time {};
+        bool                                                 tried_last_server         = false;
+        bool                                                 connecting_to_last_server = false;
+        std::optional<std::chrono::steady_clock::time_point> last_server_connect_start = std::nullopt;
+
         bool        sent_eos = false;
         std::thread render_thread;
         VRSystem    vr_system;
@@ -75,9 +108,18 @@ namespace wvb::client
 
         void select_server();
 
+        /** The server of the previous session is saved, so that the next session can connect to it without discovery. */
+        [[nodiscard]] std::string               last_server_path() const;
+        [[nodiscard]] std::optional<SocketAddr> load_last_server() const;
+        void                                    save_last_server() const;
+        /** Falls back on discovery when the server of the previous session doesn't answer. */
+        void forget_last_server();
+
         void poll_vrcp_socket();
 
-        void send_tracking_update() const;
+        void send_tracking_update();
+        /** Regularly sends the display time of the frame to the server, so that the driver can lock its vsync on the display. */
+        void send_display_timing_if_needed(const ClientFrameTimeMeasurements &frame_time);
 
         void save_and_send_frame_if_needed() const;
 
@@ -87,6 +129,20 @@ namespace wvb::client
 
         void syncing_thread_main();
 
+        /** Sends a ping and waits for the reply. Returns the result, or std::nullopt in case of timeout. */
+        std::optional<ClockSyncSample> ping_server();
+
+        /** Sends a new ping to the server if the previous one is old enough. */
+        void update_clock_sync();
+
+        /** Converts the result of a ping into a sample for the clock synchronization. */
+        [[nodiscard]] ClockSyncSample make_clock_sync_sample(uint32_t                              reply_timestamp,
+                                                             std::chrono::steady_clock::time_point send_time,
+                                                             std::chrono::steady_clock::time_point reply_time) const;
+
+        /** Updates the clock sync estimation with the given sample, and progressively corrects the clock towards it. */
+        void correct_clock(const ClockSyncSample &sample);
+
         [[nodiscard]] inline bool is_running() const { return state == ClientState::RUNNING; }
 
         [[nodiscard]] inline bool is_syncing() const { return state == ClientState::SYNCING; }
@@ -167,6 +223,32 @@ namespace wvb::client
             return;
         }
 
+        // Fast path: the server of the previous session is likely still there (e.g. for the next pass), so connect to it straight
+        // away
+        if (!tried_last_server)
+        {
+            tried_last_server = true;
+            server_addr       = load_last_server();
+            if (server_addr.has_value())
+            {
+                LOG("Connecting to last server %s\n", wvb::to_string(server_addr.value()).c_str());
+                connecting_to_last_server = true;
+                return;
+            }
+        }
+
+        // Ask the servers to answer right away instead of waiting for their next advertisement
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_probe_time >= DISCOVERY_PROBE_INTERVAL)
+        {
+            if (bcast_addrs.empty())
+            {
+                bcast_addrs = get_broadcast_addresses();
+            }
+            vrcp_socket.discover(bcast_addrs);
+            last_probe_time = now;
+        }
+
         // Listen for servers
         const auto &server_candidates = vrcp_socket.available_servers();
 
@@ -200,12 +282,45 @@ namespace wvb::client
             {
                 params.supported_video_codecs.push_back(module.codec_id);
             }
-            if (!vrcp_socket.connect(server_addr.value(), params, &connect_resp))
+            if (connecting_to_last_server && !last_server_connect_start.has_value())
+            {
+                last_server_connect_start = std::chrono::steady_clock::now();
+            }
+
+            bool vrcp_connected = false;
+            try
+            {
+                vrcp_connected = vrcp_socket.connect(server_addr.value(), params, &connect_resp);
+            }
+            catch (const std::runtime_error &e)
+            {
+                if (!connecting_to_last_server)
+                {
+                    throw;
+                }
+                LOG("Last server is not available (%s)\n", e.what());
+                forget_last_server();
+                return false;
+            }
+
+            if (!vrcp_connected)
             {
+                if (connecting_to_last_server
+                    && std::chrono::steady_clock::now() - last_server_connect_start.value() > LAST_SERVER_CONNECT_TIMEOUT)
+                {
+                    LOG("Last server didn't answer\n");
+                    forget_last_server();
+                }
+
                 // Try again later
                 return false;
             }
 
+            LOG("VRCP session established in %.2f ms\n",
+                std::chrono::duration<double, std::milli>(vrcp_socket.time_to_connected()).count());
+            connecting_to_last_server = false;
+            save_last_server();
+
             setup_codec(connect_resp.chosen_video_codec);
         }
 
@@ -290,6 +405,18 @@ namespace wvb::client
                 state = ClientState::RUNNING;
             }
         }
+        else if (packet->ftype == vrcp::VRCPFieldType::PING_REPLY && size == sizeof(vrcp::VRCPPingReply) && is_running())
+        {
+            const auto  reply_time = std::chrono::steady_clock::now();
+            const auto *reply      = reinterpret_cast<const vrcp::VRCPPingReply *>(packet);
+
+            // Ignore late replies to previous pings
+            if (waiting_for_ping_reply && ntohs(reply->ping_id) == ping_id)
+            {
+                waiting_for_ping_reply = false;
+                correct_clock(make_clock_sync_sample(ntohl(reply->reply_timestamp), last_ping_send_time, reply_time));
+            }
+        }
     }
 
     void Client::Data::poll_vrcp_socket()
@@ -310,15 +437,41 @@ namespace wvb::client
             // Handle packet
             handle_vrcp_packet(buffer, size);
         }
-        // Then unreliable poll
-        while (vrcp_socket.unreliable_receive(&buffer, &size))
+        // Then unreliable poll. During the sync, the ping replies are read by the syncing thread.
+        while (!is_syncing() && vrcp_socket.unreliable_receive(&buffer, &size))
         {
             // Handle packet
             handle_vrcp_packet(buffer, size);
         }
+
+        // Continue sending queued reliable packets
+        vrcp_socket.flush_send_queues();
+    }
+
+    void Client::Data::send_display_timing_if_needed(const ClientFrameTimeMeasurements &frame_time)
+    {
+        frames_since_display_timing++;
+        if (!is_running() || frames_since_display_timing < DISPLAY_TIMING_INTERVAL_FRAMES)
+        {
+            return;
+        }
+
+        const uint32_t display_period_ns = vr_system.get_display_period_ns();
+        if (display_period_ns == 0)
+        {
+            return;
+        }
+
+        vrcp::VRCPDisplayTiming msg {};
+        msg.display_timestamp = htonl(rtp_clock->rtp_timestamp_from_ns(frame_time.predicted_present_ns));
+        msg.display_period_ns = htonl(display_period_ns);
+        if (vrcp_socket.unreliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(&msg), sizeof(msg)))
+        {
+            frames_since_display_timing = 0;
+        }
     }
 
-    void Client::Data::send_tracking_update() const
+    void Client::Data::send_tracking_update()
     {
         if (!is_running())
         {
@@ -331,8 +484,30 @@ namespace wvb::client
             return;
         }
 
-        vrcp::VRCPTrackingData msg {tracking_state};
+        if (!sent_fov.has_value() || sent_fov->first != tracking_state.fov_left || sent_fov->second != tracking_state.fov_right)
+        {
+            vrcp::VRCPFovData fov_msg {tracking_state.fov_left, tracking_state.fov_right};
+            vrcp_socket.reliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(&fov_msg), sizeof(fov_msg), SendPriority::TRACKING);
+            sent_fov = std::make_pair(tracking_state.fov_left, tracking_state.fov_right);
+        }
+
+        // Repeat the previous poses, so that the server can recover the ones of lost packets
+        tracking_state.nb_past_poses = nb_sent_poses;
+        for (uint32_t i = 0; i < nb_sent_poses; i++)
+        {
+            tracking_state.past_poses[i] = sent_poses[i];
+        }
+
+        vrcp::VRCPCompactTrackingData msg {tracking_state};
         vrcp_socket.unreliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(&msg), sizeof(msg));
+
+        // Shift the history
+        nb_sent_poses = std::min(nb_sent_poses + 1, static_cast<uint32_t>(WVB_TRACKING_PAST_POSES_CAPACITY));
+        for (uint32_t i = nb_sent_poses - 1; i > 0; i--)
+        {
+            sent_poses[i] = sent_poses[i - 1];
+        }
+        sent_poses[0] = {.pose_timestamp = tracking_state.pose_timestamp, .pose = tracking_state.pose};
     }
 
     void Client::Data::save_and_send_frame_if_needed() const
@@ -382,10 +557,10 @@ namespace wvb::client
                     packet->last = 1;
                 }
 
-                // Send packet
+                // Queue packet. Captures are large, so they must not delay more urgent messages
                 vrcp_socket.reliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(packet),
                                           sizeof(vrcp::VRCPFrameCaptureFragment) + packet_data_size,
-                                          0);
+                                          SendPriority::BULK);
             }
 
             measurement_bucket->add_saved_frame();
@@ -412,6 +587,7 @@ namespace wvb::client
         uint32_t                              previous_frame_index    = 0;
         uint32_t                              previous_timestamp      = 0;
         uint32_t                              previous_pose_timestamp = 0;
+        Pose                                  previous_rendered_pose  = {};
         std::chrono::steady_clock::time_point previous_last_packet_received_time;
         bool                                  previous_save_frame = false;
         bool                                  end_of_stream       = false;
@@ -426,6 +602,7 @@ namespace wvb::client
             previous_frame_index    = 0;
             previous_timestamp      = 0;
             previous_pose_timestamp = 0;
+            previous_rendered_pose  = {};
             previous_save_frame     = false;
             end_of_stream           = false;
             push_cooldown           = 0;
@@ -451,6 +628,9 @@ namespace wvb::client
                     continue;
                 }
 
+                // The measurements of this frame use the phase computed here
+                measurement_bucket->update_phase();
+
                 // Poll for new packets
                 bool should_try_again = true;
                 while (has_decoder && push_cooldown == 0 && should_try_again)
@@ -462,6 +642,7 @@ namespace wvb::client
                     uint32_t                              frame_index    = 0;
                     uint32_t                              timestamp      = 0;
                     uint32_t                              pose_timestamp = 0;
+                    Pose                                  rendered_pose  = {};
                     std::chrono::steady_clock::time_point last_packet_received_time;
                     bool                                  save_frame = false;
                     bool                                  eos        = false;
@@ -477,7 +658,8 @@ namespace wvb::client
                             false,
                             previous_timestamp,
                             previous_pose_timestamp,
-                            rtp_clock->to_rtp_timestamp(rtp_clock->from_steady_timepoint(previous_last_packet_received_time)),
+                            previous_rendered_pose,
+                            rtp_clock->ns_from_steady_timepoint(previous_last_packet_received_time),
                             previous_save_frame);
                         if (!pushed)
                         {
@@ -490,6 +672,7 @@ namespace wvb::client
                                                          &eos,
                                                          &timestamp,
                                                          &pose_timestamp,
+                                                         &rendered_pose,
                                                          &last_packet_received_time,
                                                          &save_frame))
                     {
@@ -506,13 +689,12 @@ namespace wvb::client
                         previous_frame_index               = frame_index;
                         previous_timestamp                 = timestamp;
                         previous_pose_timestamp            = pose_timestamp;
+                        previous_rendered_pose             = rendered_pose;
                         previous_last_packet_received_time = last_packet_received_time;
                         previous_save_frame                = save_frame;
                         end_of_stream                      = eos;
 
-                        // Convert to RTP
-                        const auto last_packet_received_timestamp =
-                            rtp_clock->to_rtp_timestamp(rtp_clock->from_steady_timepoint(previous_last_packet_received_time));
+                        const auto last_packet_received_ns = rtp_clock->ns_from_steady_timepoint(previous_last_packet_received_time);
 
                         // Decode packet
                         vr_system.push_frame_data(previous_data,
@@ -521,7 +703,8 @@ namespace wvb::client
                                                   false,
                                                   previous_timestamp,
                                                   previous_pose_timestamp,
-                                                  last_packet_received_timestamp,
+                                                  previous_rendered_pose,
+                                                  last_packet_received_ns,
                                                   previous_save_frame);
 
                         if (!end_of_stream)
@@ -550,6 +733,7 @@ namespace wvb::client
 
                 // Send tracking update
                 send_tracking_update();
+                send_display_timing_if_needed(frame_time);
 
                 if (measurement_bucket)
                 {
@@ -580,92 +764,69 @@ namespace wvb::client
         android_app->activity->vm->AttachCurrentThread(&env, nullptr);
         prctl(PR_SET_NAME, reinterpret_cast<unsigned long>("wvb_sync"), 0, 0, 0);
 
-        uint16_t                  ping_id             = 0;
-        uint16_t                  nb_received_replies = 0;
-        std::chrono::microseconds round_trip_time {0};
-
-        const vrcp::VRCPBaseHeader *packet = nullptr;
-        size_t                      size   = 0;
+        uint16_t             nb_received_replies  = 0;
+        uint16_t             nb_sent_pings        = 0;
+        ClockSyncBurstFilter burst_filter;
+        const auto           sync_start_time      = std::chrono::steady_clock::now();
+        // Chosen by the server, and sent when the connection was accepted
+        const uint16_t       ping_count           = connect_resp.clock_sync_ping_count;
+        const uint16_t       target_confidence_us = connect_resp.clock_sync_target_confidence_us;
 
-#if PING_COUNT > 0
-        while (!should_exit())
+        while (!should_exit() && nb_received_replies < ping_count && nb_sent_pings < ping_count * 2)
         {
-            // Send ping
-            vrcp::VRCPPing ping {
-                .ping_id = htons(++ping_id),
-            };
-            const auto send_time = std::chrono::high_resolution_clock::now();
-            vrcp_socket.unreliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(&ping), sizeof(ping));
-
-            // Wait for reply
-            bool reply_received = false;
-            while (!should_exit() && !reply_received)
+            // Send a burst of pings, each one right after the reply of the previous one. Samples are gathered quickly, and some of
+            // them will be lucky enough to avoid the queueing delays.
+            for (uint32_t i = 0; i < PING_BURST_SIZE && !should_exit() && nb_received_replies < ping_count; i++)
             {
-                // Process received packets
-                while (!should_exit() && vrcp_socket.unreliable_receive(&packet, &size))
+                nb_sent_pings++;
+                const auto sample = ping_server();
+                if (!sample.has_value())
                 {
-                    if (packet->ftype == vrcp::VRCPFieldType::PING_REPLY)
-                    {
-                        const auto  reply_time     = std::chrono::high_resolution_clock::now();
-                        const auto  reply_time_rtp = rtp_clock->now();
-                        const auto *reply          = reinterpret_cast<const vrcp::VRCPPingReply *>(packet);
-                        if (size == sizeof(vrcp::VRCPPingReply))
-                        {
-                            const auto packet_ping_id = ntohs(reply->ping_id);
-                            if (ping_id == packet_ping_id)
-                            {
-                                // Valid reply
-                                reply_received = true;
-                                nb_received_replies++;
-                                round_trip_time   = std::chrono::duration_cast<std::chrono::microseconds>(reply_time - send_time);
-                                const auto offset = round_trip_time / 2;
-                                const auto expected_timestamp = ntohl(reply->reply_timestamp)
-                                                                + std::chrono::duration_cast<rtp::RTPClock::duration>(offset).count();
-                                // Compute error, the amount that has to be added to the actual timestamp to reach the expected
-                                // timestamp
-                                const auto error = rtp::rtp_timestamps_distance_us(reply_time_rtp.time_since_epoch().count(),
-                                                                                   expected_timestamp,
-                                                                                   *rtp_clock);
-
-                                // Update clock. we need to use the opposite of the error, since moving the epoch back in time
-                                // increases the value of the timestamps. So, for example, to remove 5 seconds from the timestamp, we
-                                // need to advance the epoch by 5 seconds.
-                                rtp_clock->move_epoch(-error);
-
-                                if (measurement_bucket)
-                                {
-                                    measurement_bucket->add_network_measurement({
-                                        .rtt_us         = static_cast<uint32_t>(round_trip_time.count()),
-                                        .clock_error_us = static_cast<int32_t>(error.count()),
-                                    });
-                                }
-                            }
-                        }
-                    }
+                    continue;
                 }
+                nb_received_replies++;
 
-                if (!reply_received)
-                {
-                    const auto now = std::chrono::high_resolution_clock::now();
-                    if (now - send_time > PING_TIMEOUT_MS)
-                    {
-                        // Timeout. Move on to the next ping
-                        break;
-                    }
+                burst_filter.add_sample(*sample);
+                // Also start the continuous estimation, which will take over once the app is running
+                clock_sync_estimator.add_sample(*sample);
+
+                // Compute error, the amount that has to be added to the actual time to reach the best estimation of the server time
+                const auto steady_now     = std::chrono::steady_clock::now();
+                const auto steady_now_us  = std::chrono::duration_cast<std::chrono::microseconds>(steady_now.time_since_epoch());
+                const auto expected       = steady_now_us + std::chrono::microseconds(std::llround(burst_filter.offset_us()));
+                const auto steady_now_rtp = rtp_clock->from_steady_timepoint(steady_now);
+                const auto actual         = std::chrono::duration_cast<std::chrono::microseconds>(steady_now_rtp.time_since_epoch());
+                const auto error          = expected - actual;
 
-                    // Don't sleep, as we want an accurate RTT measurement
+                // Update clock. we need to use the opposite of the error, since moving the epoch back in time
+                // increases the value of the timestamps. So, for example, to remove 5 seconds from the timestamp, we
+                // need to advance the epoch by 5 seconds.
+                rtp_clock->move_epoch(-error);
+
+                if (measurement_bucket)
+                {
+                    measurement_bucket->add_network_measurement({
+                        .rtt_us         = static_cast<uint32_t>(sample->rtt_us()),
+                        .clock_error_us = static_cast<int32_t>(error.count()),
+                    });
                 }
             }
 
-            if (nb_received_replies >= PING_COUNT || ping_id >= PING_COUNT * 2)
+            if (target_confidence_us > 0 && burst_filter.confidence_us() <= target_confidence_us)
             {
+                // Precise enough
                 break;
             }
 
-            // Wait before sending the next ping
-            std::this_thread::sleep_for(PING_INTERVAL_MS);
+            // Let the network change a bit before the next burst, so that the samples aren't all affected the same way
+            std::this_thread::sleep_for(PING_BURST_INTERVAL_MS);
         }
-#endif
+
+        const auto sync_duration =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sync_start_time);
+        // The bound is infinite if not enough replies were received
+        const auto sync_error_bound = static_cast<uint32_t>(std::min(burst_filter.confidence_us(), static_cast<double>(UINT32_MAX)));
+        measurement_bucket->set_sync_stats(static_cast<uint32_t>(sync_duration.count()), sync_error_bound);
 
         vrcp::VRCPSyncFinished sync_finished {};
         vrcp_socket.reliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(&sync_finished), sizeof(sync_finished));
@@ -690,12 +851,126 @@ namespace wvb::client
             min_clock_error,
             max_clock_error,
             med_clock_error);
+        LOG("Sync took %u ms and %u pings (%u replies), error bound: %u us\n",
+            static_cast<uint32_t>(sync_duration.count() / 1000),
+            nb_sent_pings,
+            nb_received_replies,
+            sync_error_bound);
         LOG("Ready to start the app...\n");
 
+        // New session: the server doesn't know the FOV nor the previous poses yet
+        sent_fov      = std::nullopt;
+        nb_sent_poses = 0;
+
         state = ClientState::RUNNING;
         android_app->activity->vm->DetachCurrentThread();
     }
 
+    std::optional<ClockSyncSample> Client::Data::ping_server()
+    {
+        const vrcp::VRCPBaseHeader *packet = nullptr;
+        size_t                      size   = 0;
+
+        vrcp::VRCPPing ping {
+            .ping_id = htons(++ping_id),
+        };
+        const auto send_time = std::chrono::steady_clock::now();
+        vrcp_socket.unreliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(&ping), sizeof(ping));
+
+        // Wait for reply. Don't sleep, as we want an accurate RTT measurement
+        while (!should_exit() && std::chrono::steady_clock::now() - send_time <= PING_TIMEOUT_MS)
+        {
+            while (!should_exit() && vrcp_socket.unreliable_receive(&packet, &size))
+            {
+                const auto reply_time = std::chrono::steady_clock::now();
+                if (packet->ftype == vrcp::VRCPFieldType::PING_REPLY && size == sizeof(vrcp::VRCPPingReply))
+                {
+                    const auto *reply = reinterpret_cast<const vrcp::VRCPPingReply *>(packet);
+                    if (ntohs(reply->ping_id) == ping_id)
+                    {
+                        // Valid reply
+                        return make_clock_sync_sample(ntohl(reply->reply_timestamp), send_time, reply_time);
+                    }
+                }
+            }
+        }
+
+        // Timeout
+        return std::nullopt;
+    }
+
+    void Client::Data::update_clock_sync()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_ping_send_time < CLOCK_SYNC_INTERVAL_MS)
+        {
+            return;
+        }
+
+        // If the previous ping wasn't answered, it is considered lost
+        vrcp::VRCPPing ping {
+            .ping_id = htons(++ping_id),
+        };
+        last_ping_send_time    = std::chrono::steady_clock::now();
+        waiting_for_ping_reply = vrcp_socket.unreliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(&ping), sizeof(ping));
+    }
+
+    ClockSyncSample Client::Data::make_clock_sync_sample(uint32_t                              reply_timestamp,
+                                                         std::chrono::steady_clock::time_point send_time,
+                                                         std::chrono::steady_clock::time_point reply_time) const
+    {
+        // The server timestamp is expressed in the local RTP time domain: this way, it doesn't wrap around, and it doesn't depend
+        // on the corrections done on the local clock
+        const auto mid_time  = send_time + (reply_time - send_time) / 2;
+        const auto mid_rtp   = rtp_clock->from_steady_timepoint(mid_time);
+        const auto remote_us = std::chrono::duration_cast<std::chrono::microseconds>(mid_rtp.time_since_epoch())
+                               + rtp::rtp_timestamps_distance_us(rtp_clock->to_rtp_timestamp(mid_rtp), reply_timestamp, *rtp_clock);
+
+        return {
+            .local_send_us    = std::chrono::duration_cast<std::chrono::microseconds>(send_time.time_since_epoch()).count(),
+            .local_receive_us = std::chrono::duration_cast<std::chrono::microseconds>(reply_time.time_since_epoch()).count(),
+            .remote_us        = remote_us.count(),
+        };
+    }
+
+    void Client::Data::correct_clock(const ClockSyncSample &sample)
+    {
+        if (!clock_sync_estimator.add_sample(sample))
+        {
+            // Filtered out, probably delayed by the network
+            return;
+        }
+
+        // Compare the estimated server time with the time the local clock will give once the current slew is finished
+        const auto steady_now    = std::chrono::steady_clock::now();
+        const auto steady_now_us = std::chrono::duration_cast<std::chrono::microseconds>(steady_now.time_since_epoch()).count();
+        const auto expected_us   = static_cast<double>(steady_now_us) + clock_sync_estimator.offset_at(steady_now_us);
+        const auto actual        = std::chrono::duration_cast<std::chrono::microseconds>(
+                                rtp_clock->from_steady_timepoint(steady_now).time_since_epoch() - rtp_clock->remaining_slew());
+        const auto error = std::chrono::microseconds(static_cast<int64_t>(expected_us) - actual.count());
+
+        if (std::abs(error.count()) > WVB_CLOCK_SYNC_STEP_THRESHOLD_US)
+        {
+            // Too far away to be slewed in a reasonable time
+            rtp_clock->slew_epoch(-error, std::chrono::microseconds(0));
+        }
+        else
+        {
+            // Slew it progressively so that the timestamps of the current frames stay consistent
+            rtp_clock->slew_epoch(-error, std::chrono::microseconds(std::abs(error.count()) * 1000000 / WVB_CLOCK_SYNC_MAX_SLEW_PPM));
+        }
+
+        if (measurement_bucket)
+        {
+            measurement_bucket->add_network_measurement({
+                .rtt_us         = static_cast<uint32_t>(sample.rtt_us()),
+                .clock_error_us = static_cast<int32_t>(error.count()),
+                .drift_ppm      = static_cast<float>(clock_sync_estimator.drift_ppm()),
+                .residual_us    = static_cast<uint32_t>(clock_sync_estimator.residual_us()),
+            });
+        }
+    }
+
     void Client::Data::soft_shutdown()
     {
         if (state == ClientState::RUNNING)
@@ -721,7 +996,8 @@ namespace wvb::client
             vrcp_socket_measurements.emplace_back(socket_measurement);
         }
         vrcp_socket.reliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(vrcp_socket_measurements.data()),
-                                  vrcp_socket_measurements.size() * sizeof(vrcp::VRCPSocketMeasurement));
+                                  vrcp_socket_measurements.size() * sizeof(vrcp::VRCPSocketMeasurement),
+                                  SendPriority::MEASUREMENTS);
 
         std::vector<vrcp::VRCPNetworkMeasurement> vrcp_network_measurements;
         const auto                               &network_measurements = measurement_bucket->get_network_measurements();
@@ -730,7 +1006,8 @@ namespace wvb::client
             vrcp_network_measurements.emplace_back(network_measurement);
         }
         vrcp_socket.reliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(vrcp_network_measurements.data()),
-                                  vrcp_network_measurements.size() * sizeof(vrcp::VRCPNetworkMeasurement));
+                                  vrcp_network_measurements.size() * sizeof(vrcp::VRCPNetworkMeasurement),
+                                  SendPriority::MEASUREMENTS);
 
         std::vector<vrcp::VRCPFrameTimeMeasurement> vrcp_frame_time_measurements;
         const auto                                 &frame_time_measurements = measurement_bucket->get_frame_time_measurements();
@@ -739,7 +1016,8 @@ namespace wvb::client
             vrcp_frame_time_measurements.emplace_back(frame_time_measurement);
         }
         vrcp_socket.reliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(vrcp_frame_time_measurements.data()),
-                                  vrcp_frame_time_measurements.size() * sizeof(vrcp::VRCPFrameTimeMeasurement));
+                                  vrcp_frame_time_measurements.size() * sizeof(vrcp::VRCPFrameTimeMeasurement),
+                                  SendPriority::MEASUREMENTS);
 
         std::vector<vrcp::VRCPImageQualityMeasurement> vrcp_image_quality_measurements;
         const auto &image_quality_measurements = measurement_bucket->get_image_quality_measurements();
@@ -748,7 +1026,8 @@ namespace wvb::client
             vrcp_image_quality_measurements.emplace_back(image_quality_measurement);
         }
         vrcp_socket.reliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(vrcp_image_quality_measurements.data()),
-                                  vrcp_image_quality_measurements.size() * sizeof(vrcp::VRCPImageQualityMeasurement));
+                                  vrcp_image_quality_measurements.size() * sizeof(vrcp::VRCPImageQualityMeasurement),
+                                  SendPriority::MEASUREMENTS);
 
         std::vector<vrcp::VRCPTrackingTimeMeasurement> vrcp_tracking_time_measurements;
         const auto                                    &tracking_time_measurements = measurement_bucket->get_tracking_measurements();
@@ -757,15 +1036,29 @@ namespace wvb::client
             vrcp_tracking_time_measurements.emplace_back(tracking_time_measurement);
         }
         vrcp_socket.reliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(vrcp_tracking_time_measurements.data()),
-                                  vrcp_tracking_time_measurements.size() * sizeof(vrcp::VRCPTrackingTimeMeasurement));
+                                  vrcp_tracking_time_measurements.size() * sizeof(vrcp::VRCPTrackingTimeMeasurement),
+                                  SendPriority::MEASUREMENTS);
+
+        std::vector<vrcp::VRCPSendQueueMeasurement> vrcp_send_queue_measurements;
+        for (const auto &send_queue_measurement : measurement_bucket->get_send_queue_measurements())
+        {
+            vrcp_send_queue_measurements.emplace_back(send_queue_measurement);
+        }
+        vrcp_socket.reliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(vrcp_send_queue_measurements.data()),
+                                  vrcp_send_queue_measurements.size() * sizeof(vrcp::VRCPSendQueueMeasurement),
+                                  SendPriority::MEASUREMENTS);
 
         // We sent everything
         vrcp::VRCPMeasurementTransferFinished packet {
             .decoder_frame_delay  = static_cast<uint8_t>(measurement_bucket->get_decoder_frame_delay()),
             .nb_dropped_frames    = htonl(measurement_bucket->get_nb_dropped_frames()),
             .nb_catched_up_frames = htonl(measurement_bucket->get_nb_catched_up_frames()),
+            .sync_duration        = htonl(measurement_bucket->get_sync_duration_us()),
+            .sync_error_bound     = htonl(measurement_bucket->get_sync_error_bound_us()),
         };
-        vrcp_socket.reliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(&packet), sizeof(packet));
+        // The bulk queue is the last one to be emptied, and it is FIFO: sending the end marker through it ensures that the server
+        // receives it after all measurements and frame captures
+        vrcp_socket.reliable_send(reinterpret_cast<vrcp::VRCPBaseHeader *>(&packet), sizeof(packet), SendPriority::BULK);
 
         LOG("Delay: %u vs %u\n", measurement_bucket->get_decoder_frame_delay(), vr_system.get_decoder_frame_delay());
 
@@ -789,6 +1082,59 @@ namespace wvb::client
             .vr_system          = VRSystem(rtp_clock, std::move(measurement_bucket)),
         };
     }
+
+    std::string Client::Data::last_server_path() const
+    {
+        if (android_app == nullptr || android_app->activity->internalDataPath == nullptr)
+        {
+            return "";
+        }
+        return std::string(android_app->activity->internalDataPath) + "/" + LAST_SERVER_FILE_NAME;
+    }
+
+    std::optional<SocketAddr> Client::Data::load_last_server() const
+    {
+        const auto path = last_server_path();
+        if (path.empty())
+        {
+            return std::nullopt;
+        }
+
+        std::ifstream file(path);
+        SocketAddr    addr {};
+        if (!(file >> addr.addr >> addr.port) || addr.port == 0)
+        {
+            return std::nullopt;
+        }
+        return addr;
+    }
+
+    void Client::Data::save_last_server() const
+    {
+        const auto path = last_server_path();
+        if (path.empty() || !server_addr.has_value())
+        {
+            return;
+        }
+
+        std::ofstream file(path, std::ios::trunc);
+        file << server_addr->addr << " " << server_addr->port << "\n";
+    }
+
+    void Client::Data::forget_last_server()
+    {
+        connecting_to_last_server = false;
+        last_server_connect_start = std::nullopt;
+        server_addr               = std::nullopt;
+        vrcp_socket.reset_client();
+
+        const auto path = last_server_path();
+        if (!path.empty())
+        {
+            std::remove(path.c_str());
+        }
+    }
+
     DEFAULT_PIMPL_DESTRUCTOR(Client);
 
     bool Client::init(const ApplicationInfo &app_info)
@@ -849,6 +1195,9 @@ namespace wvb::client
                 // Poll for new packets
                 m_data->video_socket.update();
 
+                // Keep the clock in sync with the server
+                m_data->update_clock_sync();
+
                 if (m_data->measurement_bucket->measurements_complete())
                 {
                     if (m_data->measurement_bucket->has_saved_frames())
@@ -3,6 +3,7 @@
 #include "wvb_common/module.h"
 #include <wvb_common/benchmark.h>
 #include <wvb_common/global.h>
+#include <wvb_common/pose_prediction.h>
 #include <wvb_common/rtp.h>
 #include <wvb_common/video_encoder.h>
 
@@ -74,11 +75,12 @@ namespace wvb::client
     {
         uint32_t frame_id                       = 0;
         bool     end_of_stream                  = false;
-        uint32_t pose_timestamp                 = 0;
-        uint32_t push_timestamp                 = 0;
-        uint32_t last_packet_received_timestamp = 0;
-        size_t   frame_size                     = 0;
-        bool     should_save_frame              = false;
+        uint32_t pose_timestamp          = 0;
+        Pose     rendered_pose           = {};
+        int64_t  push_ns                 = 0;
+        int64_t  last_packet_received_ns = 0;
+        size_t   frame_size              = 0;
+        bool     should_save_frame       = false;
     };
 
     struct GLFramebufferImage
@@ -97,9 +99,12 @@ namespace wvb::client
     {
         uint32_t pose_timestamp   = 0;
         uint32_t sample_timestamp = 0;
+        int64_t  sample_ns        = 0;
         XrTime   xr_time          = 0;
-        XrPosef  poses[NB_EYES] {};
-        XrFovf   fovs[NB_EYES] {};
+        /** Pose sent to the driver, from which the eye poses are offset */
+        XrPosef head_pose {};
+        XrPosef poses[NB_EYES] {};
+        XrFovf  fovs[NB_EYES] {};
     };
 
     struct VertexShaderSettings
@@ -182,6 +187,7 @@ namespace wvb::client
         [[nodiscard]] XrTime                                to_xr_time(uint32_t rtp_timestamp) const;
         [[nodiscard]] rtp::RTPClock::time_point             to_rtp_time_point(XrTime xr_time) const;
         [[nodiscard]] uint32_t                              to_rtp_timestamp(XrTime xr_time) const;
+        [[nodiscard]] int64_t                               to_ns(XrTime xr_time) const;
         [[nodiscard]] inline uint64_t                       ntp_epoch() const { return rtp_clock->ntp_epoch(); }
         void                                                begin_session();
         void                                                end_session();
@@ -381,6 +387,13 @@ namespace wvb::client
         return rtp_clock->rtp_timestamp_from_timespec(ts);
     }
 
+    int64_t VRSystem::Data::to_ns(XrTime xr_time) const
+    {
+        timespec ts {};
+        xr_check(xrConvertTimeToTimespecTimeKHR(xr_instance, xr_time, &ts));
+        return rtp_clock->ns_from_timespec(ts);
+    }
+
     constexpr Quaternion to_quat(const XrQuaternionf &quat)
     {
         return Quaternion {quat.x, quat.y, quat.z, quat.w};
@@ -410,6 +423,14 @@ namespace wvb::client
         };
     }
 
+    constexpr XrPosef to_xr_pose(const Pose &pose)
+    {
+        return XrPosef {
+            .orientation = {pose.orientation.x, pose.orientation.y, pose.orientation.z, pose.orientation.w},
+            .position    = {pose.position.x, pose.position.y, pose.position.z},
+        };
+    }
+
     constexpr Fov to_fov(const XrFovf &fov)
     {
         return Fov {
@@ -1235,7 +1256,7 @@ namespace wvb::client
         bool                          something_was_rendered = false;
 
         // Begin frame
-        frame_execution_time.begin_frame_timestamp = rtp_clock->now_rtp_timestamp();
+        frame_execution_time.begin_frame_ns = rtp_clock->now_ns();
         XrFrameBeginInfo frame_begin_info {XR_TYPE_FRAME_BEGIN_INFO};
         xr_check(xrBeginFrame(xr_session, &frame_begin_info));
 
@@ -1253,7 +1274,7 @@ namespace wvb::client
             swapchain_wait_info.timeout = XR_INFINITE_DURATION;
             xr_check(xrWaitSwapchainImage(xr_swapchain, &swapchain_wait_info));
 
-            frame_execution_time.after_wait_swapchain_timestamp = rtp_clock->now_rtp_timestamp();
+            frame_execution_time.after_wait_swapchain_ns = rtp_clock->now_ns();
 
             // Update frame texture
             get_frame_from_decoder(frame, frame_info);
@@ -1300,9 +1321,9 @@ namespace wvb::client
             }
             if (frame.has_value() && frame_info.has_value())
             {
-                frame_execution_time.frame_id                       = frame_info->frame_id;
-                frame_execution_time.last_packet_received_timestamp = frame_info->last_packet_received_timestamp;
-                frame_execution_time.pushed_to_decoder_timestamp    = frame_info->push_timestamp;
+                frame_execution_time.frame_id                = frame_info->frame_id;
+                frame_execution_time.last_packet_received_ns = frame_info->last_packet_received_ns;
+                frame_execution_time.pushed_to_decoder_ns    = frame_info->push_ns;
 
                 something_was_rendered = draw_frame(frame, swapchain_framebuffer.images[image_index].framebuffer);
             }
@@ -1311,7 +1332,7 @@ namespace wvb::client
             XrSwapchainImageReleaseInfo release_info {XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
             xr_check(xrReleaseSwapchainImage(xr_swapchain, &release_info));
 
-            frame_execution_time.after_render_timestamp = rtp_clock->now_rtp_timestamp();
+            frame_execution_time.after_render_ns = rtp_clock->now_ns();
 
             if (something_was_rendered)
             {
@@ -1321,16 +1342,27 @@ namespace wvb::client
                 if (latest_frame_pose.has_value())
                 {
                     debug_pose = *latest_frame_pose.value();
-                    // Use the value that was given to the driver
+                    if (frame.has_value())
+                    {
+                        // The driver may have rendered the frame with a predicted pose instead of the one it was given: move the
+                        // eyes along with the head to that pose
+                        const Pose head_pose = to_pose(debug_pose.head_pose);
+                        for (auto &eye_pose : debug_pose.poses)
+                        {
+                            eye_pose = to_xr_pose(pose_apply_motion(to_pose(eye_pose), head_pose, frame_info.value().rendered_pose));
+                        }
+                    }
+
+                    // Use the value that was used by the driver
                     for (uint32_t i = 0; i < NB_EYES; i++)
                     {
                         views[i].type = XR_TYPE_VIEW;
-                        views[i].pose = latest_frame_pose.value()->poses[i];
-                        views[i].fov  = latest_frame_pose.value()->fovs[i];
+                        views[i].pose = debug_pose.poses[i];
+                        views[i].fov  = debug_pose.fovs[i];
                     }
-                    display_time                            = latest_frame_pose.value()->xr_time;
-                    frame_execution_time.tracking_timestamp = latest_frame_pose.value()->sample_timestamp;
-                    frame_execution_time.pose_timestamp     = latest_frame_pose.value()->pose_timestamp;
+                    display_time                        = debug_pose.xr_time;
+                    frame_execution_time.tracking_ns    = debug_pose.sample_ns;
+                    frame_execution_time.pose_timestamp = debug_pose.pose_timestamp;
                 }
                 else if (debug_pose.pose_timestamp != 0)
                 {
@@ -1341,9 +1373,9 @@ namespace wvb::client
                         views[i].pose = debug_pose.poses[i];
                         views[i].fov  = debug_pose.fovs[i];
                     }
-                    display_time                            = debug_pose.xr_time;
-                    frame_execution_time.tracking_timestamp = debug_pose.sample_timestamp;
-                    frame_execution_time.pose_timestamp     = debug_pose.pose_timestamp;
+                    display_time                        = debug_pose.xr_time;
+                    frame_execution_time.tracking_ns    = debug_pose.sample_ns;
+                    frame_execution_time.pose_timestamp = debug_pose.pose_timestamp;
                 }
                 else
                 {
@@ -1434,26 +1466,24 @@ namespace wvb::client
                 delta_s);
         }
 
-        frame_execution_time.end_frame_timestamp = rtp_clock->now_rtp_timestamp();
+        frame_execution_time.end_frame_ns = rtp_clock->now_ns();
 
-        if (frame_execution_time.tracking_timestamp != 0)
+        if (frame_execution_time.tracking_ns != 0)
         {
             // We know when the tracking was measured, and when the frame was rendered
             // We can compute how many frames ago the tracking was measured, to improve
             // the prediction of the timing of new frames
-            const auto delay  = rtp::rtp_timestamps_distance_us(frame_execution_time.tracking_timestamp,
-                                                               frame_execution_time.predicted_present_timestamp,
-                                                               *rtp_clock);
-            frames_in_advance = (delay.count() / specs.refresh_rate.inter_frame_delay_us()) - 1;
+            const int64_t delay_us = (frame_execution_time.predicted_present_ns - frame_execution_time.tracking_ns) / 1000;
+            frames_in_advance      = (delay_us / specs.refresh_rate.inter_frame_delay_us()) - 1;
         }
 
         if (something_was_rendered)
         {
+            // The quality is measured by the server, which has the reference frame
             measurements_bucket->add_image_quality_measurement({
                 .frame_id        = static_cast<uint32_t>(frame_info->frame_id),
                 .codestream_size = static_cast<uint32_t>(frame_info->frame_size),
                 .raw_size        = static_cast<uint32_t>(frame->size),
-                .psnr            = 0 // TODO
             });
         }
     }
@@ -1569,16 +1599,16 @@ namespace wvb::client
 
         frame_index++;
 
-        frame_execution_time.frame_index        = frame_index;
-        frame_execution_time.tracking_timestamp = 0;
-        frame_execution_time.pose_timestamp     = 0;
+        frame_execution_time.frame_index    = frame_index;
+        frame_execution_time.tracking_ns    = 0;
+        frame_execution_time.pose_timestamp = 0;
 
         // Wait frame
-        frame_execution_time.begin_wait_frame_timestamp = rtp_clock->now_rtp_timestamp();
+        frame_execution_time.begin_wait_frame_ns = rtp_clock->now_ns();
         XrFrameWaitInfo wait_info {XR_TYPE_FRAME_WAIT_INFO};
         xr_check(xrWaitFrame(xr_session, &wait_info, &xr_frame_state));
 
-        frame_execution_time.predicted_present_timestamp = to_rtp_timestamp(xr_frame_state.predictedDisplayTime);
+        frame_execution_time.predicted_present_ns = to_ns(xr_frame_state.predictedDisplayTime);
 
         return true;
     }
@@ -1868,7 +1898,8 @@ namespace wvb::client
                                    bool           end_of_stream,
                                    uint32_t       timestamp,
                                    uint32_t       pose_timestamp,
-                                   uint32_t       last_packet_received_timestamp,
+                                   const Pose    &rendered_pose,
+                                   int64_t        last_packet_received_ns,
                                    bool           save_frame) const
     {
         if (m_data->video_decoder == nullptr || !m_data->video_decoder_initialized)
@@ -1876,20 +1907,21 @@ namespace wvb::client
             throw std::runtime_error("Video decoder must not be null");
         }
 
-        m_data->app_running       = true;
-        const auto push_timestamp = m_data->rtp_clock->now_rtp_timestamp();
-        bool       pushed         = m_data->video_decoder->push_packet(data, size, end_of_stream);
+        m_data->app_running = true;
+        const auto push_ns  = m_data->rtp_clock->now_ns();
+        bool       pushed   = m_data->video_decoder->push_packet(data, size, end_of_stream);
         if (pushed)
         {
             m_data->measurements_bucket->add_decoder_pushed_frame();
             m_data->frame_info_queue.push_back({
-                .frame_id                       = frame_id,
-                .end_of_stream                  = end_of_stream,
-                .pose_timestamp                 = pose_timestamp,
-                .push_timestamp                 = push_timestamp,
-                .last_packet_received_timestamp = last_packet_received_timestamp,
-                .frame_size                     = size,
-                .should_save_frame              = save_frame,
+                .frame_id                = frame_id,
+                .end_of_stream           = end_of_stream,
+                .pose_timestamp          = pose_timestamp,
+                .rendered_pose           = rendered_pose,
+                .push_ns                 = push_ns,
+                .last_packet_received_ns = last_packet_received_ns,
+                .frame_size              = size,
+                .should_save_frame       = save_frame,
             });
         }
         return pushed;
@@ -1957,7 +1989,8 @@ namespace wvb::client
 
     bool VRSystem::get_pose(XrTime xr_time, TrackingState &out_tracking_state) const
     {
-        const auto now = m_data->rtp_clock->now_rtp_timestamp();
+        const auto now_ns = m_data->rtp_clock->now_ns();
+        const auto now    = m_data->rtp_clock->rtp_timestamp_from_ns(now_ns);
 
         XrViewLocateInfo view_locate_info {XR_TYPE_VIEW_LOCATE_INFO};
         view_locate_info.viewConfigurationType = VIEW_CONFIGURATION_TYPE;
@@ -1985,7 +2018,9 @@ namespace wvb::client
         auto &cache_slot            = m_data->pose_cache[m_data->pose_cache_index];
         cache_slot.pose_timestamp   = rtp_timestamp;
         cache_slot.sample_timestamp = now;
+        cache_slot.sample_ns        = now_ns;
         cache_slot.xr_time          = xr_time;
+        cache_slot.head_pose        = xr_space_location.pose;
         cache_slot.poses[EYE_LEFT]  = xr_views[EYE_LEFT].pose;
         cache_slot.poses[EYE_RIGHT] = xr_views[EYE_RIGHT].pose;
         cache_slot.fovs[EYE_LEFT]   = xr_views[EYE_LEFT].fov;
@@ -1999,9 +2034,9 @@ namespace wvb::client
         out_tracking_state.fov_right        = to_fov(xr_views[EYE_RIGHT].fov);
 
         m_data->measurements_bucket->add_tracking_time_measurement({
-            .pose_timestamp               = rtp_timestamp,
-            .tracking_received_timestamp  = now,
-            .tracking_processed_timestamp = m_data->rtp_clock->now_rtp_timestamp(),
+            .pose_timestamp        = rtp_timestamp,
+            .tracking_received_ns  = now_ns,
+            .tracking_processed_ns = m_data->rtp_clock->now_ns(),
         });
 
         return true;
@@ -2060,6 +2095,11 @@ namespace wvb::client
         return m_data->video_decoder->get_frame_delay();
     }
 
+    uint32_t VRSystem::get_display_period_ns() const
+    {
+        return static_cast<uint32_t>(std::max(m_data->xr_frame_state.predictedDisplayPeriod, static_cast<XrDuration>(0)));
+    }
+
     bool VRSystem::save_frame_if_needed(IOBuffer &image) const
     {
         return m_data->save_frame_if_needed(image);
@@ -2,18 +2,24 @@
 
 #include "driver_logger.h"
 #include <wvb_common/benchmark.h>
+#include <wvb_common/ipc.h>
+#include <wvb_common/pose_prediction.h>
+#include <wvb_common/precision_timer.h>
+#include <wvb_common/present_pacing.h>
 #include <wvb_common/rtp_clock.h>
 #include <wvb_common/server_shared_state.h>
 #include <wvb_common/vr_structs.h>
+#include <wvb_common/vsync_phase_lock.h>
 
 #include <chrono>
 #include <memory>
-#include <openvr_driver.h>
-
 #include <mutex>
+#include <openvr_driver.h>
 
 #define WVB_WAIT_TIMEOUT_MS 50
 #define WVB_MAX_WAIT_COUNT  10
+// Number of predictions made by GetPose that can wait for the event thread to measure their error
+#define WVB_POSE_PREDICTIONS_RING_CAPACITY 64
 
 namespace wvb::driver
 {
@@ -54,18 +60,22 @@ namespace wvb::driver
         std::shared_ptr<DriverMeasurementBucket> m_measurement_bucket         = nullptr;
         DriverFrameTimeMeasurements              m_current_frame_measurements = {};
 
-        uint64_t                                       m_frame_number    = 0;
-        std::chrono::high_resolution_clock::time_point m_last_vsync_time = {};
-        std::chrono::high_resolution_clock::time_point m_last_wait_time  = {};
-        uint32_t                                       m_wait_margin_us  = 0;
-
-        VRSystemSpecs                                  m_specs                          = {};
-        vr::DriverPose_t                               m_pose                           = {};
-        Fov                                            m_fov[NB_EYES]                   = {};
-        uint32_t                                       m_latest_pose_timestamp          = 0;
-        uint32_t                                       m_latest_accessed_pose_timestamp = 0;
-        std::chrono::high_resolution_clock::time_point m_start_time                     = {};
-        bool                                           m_frame_logged                   = false;
+        uint64_t                              m_frame_number    = 0;
+        std::chrono::steady_clock::time_point m_last_vsync_time = {};
+        // Only used by the compositor thread, which calls Present and WaitForPresent
+        /** Paces the presents on the vsync, and the release of the app before it. */
+        PrecisionTimer m_vsync_timer;
+        /** Decides when to release the app so that its frames are presented just before the vsync. */
+        PresentPacer m_present_pacer;
+        /** Keeps the vsync at a constant phase from the client's display refreshes. */
+        VsyncPhaseLock m_vsync_phase_lock;
+        /** Time between the last vsync and the next one, adjusted by the phase lock. */
+        std::chrono::microseconds m_vsync_interval {};
+
+        VRSystemSpecs                         m_specs        = {};
+        Fov                                   m_fov[NB_EYES] = {};
+        std::chrono::steady_clock::time_point m_start_time   = {};
+        bool                                  m_frame_logged = false;
 
         std::shared_ptr<ServerDriverSharedMemory> m_shared_memory = nullptr;
         std::shared_ptr<ServerEvents>             m_server_events = nullptr;
@@ -75,7 +85,36 @@ namespace wvb::driver
 
         std::atomic<bool> m_event_thread_running = false;
         std::thread       m_event_thread         = {};
-        std::mutex        m_pose_mutex           = {};
+
+        // Pose handoff between the event thread and SteamVR's pose queries. None of them can block the other.
+        /** Latest received pose, with what is needed to predict it. */
+        struct PublishedPose
+        {
+            vr::DriverPose_t pose = {};
+            /** RTP timestamp of the pose */
+            uint32_t          pose_timestamp = 0;
+            PoseExtrapolation extrapolation  = {};
+        };
+        /** Written by the event thread, read by GetPose, which SteamVR calls from several threads. */
+        SeqLock<PublishedPose> m_published_pose {};
+        /** Pose returned by the latest GetPose, forwarded to the server with the frame so that the client displays it with it. */
+        struct AccessedPose
+        {
+            /** RTP timestamp of the received pose it comes from */
+            uint32_t pose_timestamp = 0;
+            /** Pose given to SteamVR, predicted if enabled */
+            Pose pose = {};
+        };
+        /** Serializes what the GetPose calls publish: the latest accessed pose, the predictions and the pose access measurements. */
+        std::mutex   m_pose_access_mutex;
+        AccessedPose m_latest_accessed_pose {};
+        /** Predictions made by GetPose, evaluated by the event thread once the real pose is received. */
+        SharedRing<PosePrediction, WVB_POSE_PREDICTIONS_RING_CAPACITY> m_pose_predictions {};
+
+        // Only used by the event thread
+        vr::DriverPose_t m_pose                  = {};
+        uint32_t         m_latest_pose_timestamp = 0;
+        PosePredictor    m_pose_predictor {};
 
         std::chrono::high_resolution_clock::time_point m_last_log         = std::chrono::high_resolution_clock::now();
         uint32_t                                       m_nb_pose_accesses = 0;
@@ -123,5 +162,13 @@ namespace wvb::driver
         void SendLeaveStandbySignal();
         /** Sleep until the next vsync time - margin_us. */
         void WaitForVsync(uint32_t margin_us);
+        /** Called after each vsync. Locks the next one on the latest display timing sent by the client. */
+        void UpdateVsyncInterval();
+
+      private:
+        /** Publishes the measurement to the server if the benchmark is in its timing phase. */
+        template<typename T>
+        void PublishMeasurement(SharedRing<T, WVB_DRIVER_MEASUREMENT_RING_CAPACITY> DriverMeasurementRings::*ring,
+                                const T                                                           &measurement);
     };
 } // namespace wvb::driver
\ No newline at end of file
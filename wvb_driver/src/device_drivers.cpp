@@ -14,13 +14,28 @@
 #include <cstring>
 #endif
 
-#define PI                    3.14159265358979323846f
-#define ACTIVE_WAIT_MARGIN_US 2000
-#define FPS_MARGIN            0.00f
-#define WAIT_MARGIN_OFFSET_US 3000
+#define PI         3.14159265358979323846f
+#define FPS_MARGIN 0.00f
 
 namespace wvb::driver
 {
+    int64_t rtp_timestamp_to_us(const rtp::RTPClock &clock, uint32_t rtp_timestamp)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(clock.from_rtp_timestamp(rtp_timestamp).time_since_epoch())
+            .count();
+    }
+
+    int64_t steady_to_us(std::chrono::steady_clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    }
+
+    uint32_t us_to_rtp_timestamp(const rtp::RTPClock &clock, int64_t timestamp_us)
+    {
+        return clock.to_rtp_timestamp(
+            rtp::RTPClock::time_point(std::chrono::duration_cast<rtp::RTPClock::duration>(std::chrono::microseconds(timestamp_us))));
+    }
+
     ShutdownDeviceDriver::ShutdownDeviceDriver() = default;
     vr::EVRInitError ShutdownDeviceDriver::Activate(uint32_t object_id)
     {
@@ -53,6 +68,7 @@ namespace wvb::driver
         {
             auto lock = m_shared_memory->lock();
             m_rtp_clock.set_epoch(lock->ntp_epoch);
+            m_pose_predictor.set_settings(lock->pose_prediction_settings);
         }
     }
 
@@ -102,7 +118,7 @@ namespace wvb::driver
         vr::VRProperties()->SetFloatProperty(prop_container, vr::Prop_DisplayFrequency_Float, m_specs.refresh_rate.to_float());
         vr::VRProperties()->SetFloatProperty(prop_container,
                                              vr::Prop_SecondsFromVsyncToPhotons_Float,
-                                             0.01f); // TODO possible to get this data from headset
+                                             WVB_VSYNC_TO_PHOTONS_US / 1000000.f); // TODO possible to get this data from headset
 
         // Disable motion smoothing (already done in headset driver)
         vr::VRSettings()->SetBool(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_MotionSmoothing_Bool, false);
@@ -126,11 +142,15 @@ namespace wvb::driver
         m_pose.vecPosition[2]             = 0;
         m_pose.qWorldFromDriverRotation.w = 1;
         m_pose.qDriverFromHeadRotation.w  = 1;
+        m_published_pose.store({.pose = m_pose, .extrapolation = {.settings = m_pose_predictor.settings()}});
 
         // Vsync init
-        m_start_time = std::chrono::high_resolution_clock::now();
+        m_start_time = std::chrono::steady_clock::now();
         // Remove interval from start time to get last vsync
-        m_last_vsync_time = m_start_time - std::chrono::microseconds(GetFrameIntervalUs());
+        m_last_vsync_time  = m_start_time - std::chrono::microseconds(GetFrameIntervalUs());
+        m_present_pacer    = PresentPacer(GetFrameIntervalUs());
+        m_vsync_phase_lock = VsyncPhaseLock(GetFrameIntervalUs());
+        m_vsync_interval   = std::chrono::microseconds(GetFrameIntervalUs());
 
         m_event_thread_running = true;
         m_logger->log("Starting event thread");
@@ -176,15 +196,69 @@ namespace wvb::driver
 
     vr::DriverPose_t VirtualHMDDriver::GetPose()
     {
-        std::lock_guard<std::mutex> lock(m_pose_mutex);
+        // The event thread can't block SteamVR's pose query: the read is only retried while a new pose is being written, which is
+        // short and never interrupted by a dead writer
+        PublishedPose published;
+        m_published_pose.load(published, UINT32_MAX);
+        const auto pose_accessed_ns = m_rtp_clock.now_ns();
+
+        // Predict the pose at the time the frame rendered with it will be displayed: next vsync, plus the time to get it to the
+        // client and on its screen
+        const auto now             = std::chrono::steady_clock::now();
+        const auto next_vsync_time = m_last_vsync_time + std::chrono::microseconds(GetFrameIntervalUs());
+        const auto until_vsync_us  = std::max(std::chrono::duration_cast<std::chrono::microseconds>(next_vsync_time - now).count(),
+                                              static_cast<int64_t>(0));
+
+        const auto target_us = std::chrono::duration_cast<std::chrono::microseconds>(m_rtp_clock.now().time_since_epoch()).count()
+                               + until_vsync_us + WVB_VSYNC_TO_PHOTONS_US + published.extrapolation.settings.horizon_us;
+
+        auto pose = published.pose;
+        if (published.extrapolation.is_valid)
+        {
+            const Pose predicted_pose = published.extrapolation.predict(target_us);
 
-        m_latest_accessed_pose_timestamp = m_latest_pose_timestamp;
-        m_measurement_bucket->add_pose_access_measurement({
-            .pose_timestamp          = m_latest_pose_timestamp,
-            .pose_accessed_timestamp = m_rtp_clock.now_rtp_timestamp(),
-        });
+            // Let the event thread measure its error. If it is late, the prediction is simply not measured.
+            // SteamVR calls GetPose from several threads, but the ring has a single producer.
+            {
+                std::lock_guard lock(m_pose_access_mutex);
+                m_pose_predictions.push({
+                    .pose_timestamp_us   = published.extrapolation.latest.timestamp_us,
+                    .target_timestamp_us = target_us,
+                    .predicted_pose      = predicted_pose,
+                });
+            }
+
+            pose.qRotation      = {predicted_pose.orientation.w,
+                                   predicted_pose.orientation.x,
+                                   predicted_pose.orientation.y,
+                                   predicted_pose.orientation.z};
+            pose.vecPosition[0] = predicted_pose.position.x;
+            pose.vecPosition[1] = predicted_pose.position.y;
+            pose.vecPosition[2] = predicted_pose.position.z;
+        }
 
-        return m_pose;
+        // The frame rendered with this pose must be displayed with it
+        const Pose rendered_pose = {
+            .orientation = {static_cast<float>(pose.qRotation.x),
+                            static_cast<float>(pose.qRotation.y),
+                            static_cast<float>(pose.qRotation.z),
+                            static_cast<float>(pose.qRotation.w)},
+            .position    = {static_cast<float>(pose.vecPosition[0]),
+                            static_cast<float>(pose.vecPosition[1]),
+                            static_cast<float>(pose.vecPosition[2])},
+        };
+        {
+            // SteamVR calls GetPose from several threads, but the measurement ring has a single producer
+            std::lock_guard lock(m_pose_access_mutex);
+            m_latest_accessed_pose = {.pose_timestamp = published.pose_timestamp, .pose = rendered_pose};
+            PublishMeasurement(&DriverMeasurementRings::pose_access_time,
+                               PoseAccessTimeMeasurements {
+                                   .pose_timestamp   = published.pose_timestamp,
+                                   .pose_accessed_ns = pose_accessed_ns,
+                               });
+        }
+
+        return pose;
     }
 
     void *VirtualHMDDriver::GetComponent(const char *component_name_and_version)
@@ -212,19 +286,21 @@ namespace wvb::driver
         m_frame_logged                        = false;
         m_current_frame_measurements.frame_id = m_frame_number;
 
-        const auto expected_next_vsync_time = m_last_vsync_time + std::chrono::microseconds(GetFrameIntervalUs());
-        const auto now                      = std::chrono::high_resolution_clock::now();
+        const auto expected_next_vsync_time = m_last_vsync_time + m_vsync_interval;
+        const auto now                      = std::chrono::steady_clock::now();
 
-        m_current_frame_measurements.present_called_timestamp = m_rtp_clock.now_rtp_timestamp();
+        m_current_frame_measurements.present_called_ns = m_rtp_clock.now_ns();
 
-        // Try to have guess the time the frame took to render, so we can wait less and try to get the Present call closer to the vsync
-        if (m_frame_number > 1)
+        // Measure how far from its target the frame was presented, to adapt the release time of the next frames
+        m_current_frame_measurements.present_deadline_error_us =
+            static_cast<int32_t>(m_present_pacer.on_frame_presented(steady_to_us(now), steady_to_us(expected_next_vsync_time)));
+        if (m_frame_number % 100 == 0)
         {
-            m_wait_margin_us = std::chrono::duration_cast<std::chrono::microseconds>(now - m_last_wait_time).count() + WAIT_MARGIN_OFFSET_US;
-            if (m_frame_number % 100 == 0)
-            {
-                m_logger->debug_log("Frame %lu: margin %u", m_frame_number, m_wait_margin_us);
-            }
+            m_logger->debug_log("Frame %lu: deadline error %d us, margin %d us, render time %d us",
+                                m_frame_number,
+                                static_cast<int>(m_present_pacer.deadline_error_us()),
+                                static_cast<int>(m_present_pacer.wait_margin_us()),
+                                static_cast<int>(m_present_pacer.render_time().mean_us()));
         }
 
         //        if (now < expected_next_vsync_time)
@@ -233,8 +309,9 @@ namespace wvb::driver
         // If the render time doesn't vary much, the wait time shouldn't be too long
         WaitForVsync(0);
         //        }
-        m_last_vsync_time                            = std::chrono::high_resolution_clock::now();
-        m_current_frame_measurements.vsync_timestamp = m_rtp_clock.now_rtp_timestamp();
+        m_last_vsync_time                     = std::chrono::steady_clock::now();
+        m_current_frame_measurements.vsync_ns = m_rtp_clock.now_ns();
+        UpdateVsyncInterval();
 
         if (m_frame_number % 100 == 0)
         {
@@ -242,33 +319,36 @@ namespace wvb::driver
                 std::chrono::duration_cast<std::chrono::microseconds>(m_last_vsync_time.time_since_epoch()).count()
                 - std::chrono::duration_cast<std::chrono::microseconds>(expected_next_vsync_time.time_since_epoch()).count();
             m_logger->debug_log(
-                "Frame %lu: %d us after expected Vsync, waited %d us in Present()",
+                "Frame %lu: %d us after expected Vsync, waited %d us in Present(), spin margin %d us",
                 m_frame_number,
                 static_cast<int>(delay),
-                static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(m_last_vsync_time - now).count()));
+                static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(m_last_vsync_time - now).count()),
+                static_cast<int>(m_vsync_timer.spin_margin().count()));
         }
 
-        // Forward info to server
+        AccessedPose accessed_pose;
         {
-            auto                        lock = m_shared_memory->lock();
-            std::lock_guard<std::mutex> pose_lock(m_pose_mutex);
-
-            lock->latest_present_info = OpenVRPresentInfo {
-                .backbuffer_texture_handle = present_info->backbufferTextureHandle,
-                .frame_id                  = present_info->nFrameId,
-                .vsync_time_in_seconds     = present_info->flVSyncTimeInSeconds,
-                .sample_rtp_timestamp      = m_rtp_clock.now_rtp_timestamp(),
-                .pose_rtp_timestamp        = m_latest_accessed_pose_timestamp,
-            };
+            std::lock_guard lock(m_pose_access_mutex);
+            accessed_pose = m_latest_accessed_pose;
         }
+
+        // Forward info to server. It is published without locking the shared memory, so the server can't make the driver wait.
+        m_shared_memory->unlocked()->latest_present_info.store({
+            .backbuffer_texture_handle = present_info->backbufferTextureHandle,
+            .frame_id                  = present_info->nFrameId,
+            .vsync_time_in_seconds     = present_info->flVSyncTimeInSeconds,
+            .sample_rtp_timestamp      = m_rtp_clock.now_rtp_timestamp(),
+            .pose_rtp_timestamp        = accessed_pose.pose_timestamp,
+            .rendered_pose             = accessed_pose.pose,
+        });
         m_driver_events->new_present_info.signal();
 
-        m_current_frame_measurements.frame_sent_timestamp = m_rtp_clock.now_rtp_timestamp();
+        m_current_frame_measurements.frame_sent_ns = m_rtp_clock.now_ns();
     }
 
     void VirtualHMDDriver::WaitForPresent()
     {
-        m_current_frame_measurements.wait_for_present_called_timestamp = m_rtp_clock.now_rtp_timestamp();
+        m_current_frame_measurements.wait_for_present_called_ns = m_rtp_clock.now_ns();
 
         // Wait until the server has finished rendering the frame, or until we are told to exit
         uint8_t wait_count = 0;
@@ -277,13 +357,16 @@ namespace wvb::driver
             wait_count++;
         }
 
-        m_current_frame_measurements.server_finished_timestamp = m_rtp_clock.now_rtp_timestamp();
+        m_current_frame_measurements.server_finished_ns = m_rtp_clock.now_ns();
+        m_present_pacer.on_frame_encoded(steady_to_us(m_last_vsync_time), steady_to_us(std::chrono::steady_clock::now()));
 
-        //        WaitForVsync(m_wait_margin_us);
+        // Release the app just in time for its next frame to be presented before the vsync
+        WaitForVsync(static_cast<uint32_t>(m_present_pacer.wait_margin_us()));
+        m_present_pacer.on_frame_started(steady_to_us(std::chrono::steady_clock::now()));
 
         // Compute time left before next vsync
-        const auto expected_next_vsync_time = m_last_vsync_time + std::chrono::microseconds(GetFrameIntervalUs());
-        const auto now                      = std::chrono::high_resolution_clock::now();
+        const auto expected_next_vsync_time = m_last_vsync_time + m_vsync_interval;
+        const auto now                      = std::chrono::steady_clock::now();
         double     time_left_sec =
             static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(expected_next_vsync_time - now).count())
             / 1000000.0;
@@ -307,15 +390,15 @@ namespace wvb::driver
         //                                                       {tanf(-m_fov[EYE_RIGHT].up), tanf(m_fov[EYE_RIGHT].left)},
         //                                                   });
 
-        m_current_frame_measurements.pose_updated_event_timestamp = m_rtp_clock.now_rtp_timestamp();
+        m_current_frame_measurements.pose_updated_event_ns = m_rtp_clock.now_ns();
 
         // Save frame time
-        m_measurement_bucket->add_frame_time_measurement(m_current_frame_measurements);
+        PublishMeasurement(&DriverMeasurementRings::frame_time, m_current_frame_measurements);
     }
 
     bool VirtualHMDDriver::GetTimeSinceLastVsync(float *seconds_since_last_vsync, uint64_t *frame_counter)
     {
-        const auto now = std::chrono::high_resolution_clock::now();
+        const auto now = std::chrono::steady_clock::now();
 
         // Calculate time since last vsync
         *seconds_since_last_vsync =
@@ -403,30 +486,27 @@ namespace wvb::driver
             // Wait for new tracking
             if (m_server_events->new_tracking_data.wait(WVB_WAIT_TIMEOUT_MS))
             {
-                tracking_time_measurements.tracking_received_timestamp = m_rtp_clock.now_rtp_timestamp();
+                tracking_time_measurements.tracking_received_ns = m_rtp_clock.now_ns();
 
-                // Read tracking
-                auto lock = m_shared_memory->lock();
-                if (!lock.is_valid())
+                // Read tracking. It is published without locking the shared memory, and the read never blocks the server.
+                TrackingState tracking_state;
+                if (!m_shared_memory->unlocked()->tracking_state.load(tracking_state))
                 {
                     continue;
                 }
 
                 {
-                    // Get pose mutex
-                    std::lock_guard<std::mutex> pose_lock(m_pose_mutex);
-
                     // Convert OpenXR pose to OpenVR pose
                     // In OpenXR, each eye is tracked independently, but in OpenVR, the pose is the same for both eyes
-                    const auto &orientation = lock->tracking_state.pose.orientation;
+                    const auto &orientation = tracking_state.pose.orientation;
                     m_pose.qRotation        = {orientation.w, orientation.x, orientation.y, orientation.z};
 
-                    const auto &position  = lock->tracking_state.pose.position;
+                    const auto &position  = tracking_state.pose.position;
                     m_pose.vecPosition[0] = position.x;
                     m_pose.vecPosition[1] = position.y;
                     m_pose.vecPosition[2] = position.z;
-                    m_fov[EYE_LEFT]       = lock->tracking_state.fov_left;
-                    m_fov[EYE_RIGHT]      = lock->tracking_state.fov_right;
+                    m_fov[EYE_LEFT]       = tracking_state.fov_left;
+                    m_fov[EYE_RIGHT]      = tracking_state.fov_right;
 
                     m_pose.poseTimeOffset       = 0;
                     m_pose.poseIsValid          = true;
@@ -434,16 +514,57 @@ namespace wvb::driver
                     m_pose.willDriftInYaw       = false;
                     m_pose.shouldApplyHeadModel = false;
                     m_pose.result               = vr::TrackingResult_Running_OK;
-                    m_latest_pose_timestamp     = lock->tracking_state.pose_timestamp;
+                    m_latest_pose_timestamp     = tracking_state.pose_timestamp;
+
+                    // Collect the predictions made by GetPose since the previous pose, so that they are evaluated with the new ones
+                    PosePrediction prediction;
+                    while (m_pose_predictions.pop(prediction))
+                    {
+                        m_pose_predictor.add_prediction(prediction);
+                    }
+
+                    // Keep it in the history for the prediction, and measure the error of the past predictions now that the real
+                    // pose is known. Past poses fill the gaps left by lost packets, the ones already received are ignored.
+                    for (uint32_t i = tracking_state.nb_past_poses; i > 0; i--)
+                    {
+                        const auto &past_pose = tracking_state.past_poses[i - 1];
+                        m_pose_predictor.add_pose({
+                            .timestamp_us = rtp_timestamp_to_us(m_rtp_clock, past_pose.pose_timestamp),
+                            .pose         = past_pose.pose,
+                        });
+                    }
+                    m_pose_predictor.add_pose({
+                        .timestamp_us = rtp_timestamp_to_us(m_rtp_clock, m_latest_pose_timestamp),
+                        .pose         = tracking_state.pose,
+                    });
+
+                    // Hand the new pose to GetPose
+                    m_published_pose.store({
+                        .pose           = m_pose,
+                        .pose_timestamp = m_latest_pose_timestamp,
+                        .extrapolation  = m_pose_predictor.extrapolation(),
+                    });
+
+                    PosePredictionError error;
+                    while (m_pose_predictor.pop_error(error))
+                    {
+                        PublishMeasurement(&DriverMeasurementRings::pose_prediction,
+                                           PosePredictionMeasurements {
+                                               .pose_timestamp    = us_to_rtp_timestamp(m_rtp_clock, error.pose_timestamp_us),
+                                               .target_ns         = error.target_timestamp_us * 1000,
+                                               .orientation_error = error.orientation_error * 180.0f / PI,
+                                               .position_error    = error.position_error * 1000.0f,
+                                           });
+                    }
 
                     // Update tracking time measurements
-                    tracking_time_measurements.pose_timestamp               = m_latest_pose_timestamp;
-                    tracking_time_measurements.tracking_processed_timestamp = m_rtp_clock.now_rtp_timestamp();
+                    tracking_time_measurements.pose_timestamp        = m_latest_pose_timestamp;
+                    tracking_time_measurements.tracking_processed_ns = m_rtp_clock.now_ns();
                 }
             }
 
             // Save measurements
-            m_measurement_bucket->add_tracking_time_measurement(tracking_time_measurements);
+            PublishMeasurement(&DriverMeasurementRings::tracking_time, tracking_time_measurements);
         }
     }
 
@@ -468,30 +589,54 @@ namespace wvb::driver
 
     void VirtualHMDDriver::WaitForVsync(uint32_t margin_us)
     {
-        // Wait for VSync
-        auto       now      = std::chrono::high_resolution_clock::now();
-        auto       elapsed  = std::chrono::duration_cast<std::chrono::microseconds>(now - m_last_vsync_time).count();
-        const auto interval = GetFrameIntervalUs();
-
         // Wait until the next VSync
-        const auto should_wait = interval - elapsed - margin_us;
-        if (should_wait <= 0)
+        const auto deadline = m_last_vsync_time + m_vsync_interval - std::chrono::microseconds(margin_us);
+        if (std::chrono::steady_clock::now() >= deadline)
         {
             return;
         }
 
-        // Sleep for the major part of the wait to save resources, but wake up isn't very precise
-        if (should_wait > ACTIVE_WAIT_MARGIN_US)
+        // Sleeps for the major part of the wait to save resources, and spins only for the last part to end on the exact time
+        m_vsync_timer.wait_until(deadline);
+    }
+
+    void VirtualHMDDriver::UpdateVsyncInterval()
+    {
+        // The display timing is published by the server without locking the shared memory
+        DisplayTiming display_timing {};
+        if (m_shared_memory->unlocked()->display_timing.load(display_timing) && display_timing.display_period_ns != 0)
         {
-            std::this_thread::sleep_for(std::chrono::microseconds(should_wait - ACTIVE_WAIT_MARGIN_US));
+            m_vsync_phase_lock.set_reference(rtp_timestamp_to_us(m_rtp_clock, display_timing.display_timestamp),
+                                             static_cast<double>(display_timing.display_period_ns) / 1000.0,
+                                             display_timing.phase_offset_us);
         }
-        // Active wait for the last 2ms to end on the exact desired time
-        while (elapsed < interval)
+
+        const double interval_us = m_vsync_phase_lock.on_vsync(m_current_frame_measurements.vsync_ns / 1000);
+        m_vsync_interval = std::chrono::microseconds(std::lround(interval_us));
+
+        if (m_frame_number % 100 == 0 && m_vsync_phase_lock.has_reference())
         {
-            now     = std::chrono::high_resolution_clock::now();
-            elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - m_last_vsync_time).count();
+            m_logger->debug_log("Frame %lu: vsync phase error %d us, period correction %d us",
+                                m_frame_number,
+                                static_cast<int>(m_vsync_phase_lock.phase_error_us()),
+                                static_cast<int>(m_vsync_phase_lock.period_correction_us()));
         }
+    }
 
-        m_last_wait_time = now;
+    template<typename T>
+    void VirtualHMDDriver::PublishMeasurement(SharedRing<T, WVB_DRIVER_MEASUREMENT_RING_CAPACITY> DriverMeasurementRings::*ring,
+                                              const T &measurement)
+    {
+        if (!m_measurement_bucket->is_in_timing_phase())
+        {
+            return;
+        }
+
+        // Never blocks. If the server doesn't drain the ring fast enough, the measurement is dropped and counted.
+        auto *shared_data = m_shared_memory->unlocked();
+        if (shared_data != nullptr)
+        {
+            (shared_data->driver_measurements.*ring).push(measurement);
+        }
     }
 } // namespace wvb::driver
\ No newline at end of file
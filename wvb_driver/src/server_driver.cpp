@@ -158,12 +158,9 @@ namespace wvb::driver
 
         // Disconnect from server and reset driver state
         {
-            auto data                                 = m_shared_memory->lock();
-            data->driver_state                        = DriverState::NOT_RUNNING;
-            data->frame_time_measurements_count       = 0;
-            data->tracking_time_measurements_count    = 0;
-            data->pose_access_time_measurements_count = 0;
-            data->latest_present_info                 = {};
+            auto data          = m_shared_memory->lock();
+            data->driver_state = DriverState::NOT_RUNNING;
+            data->latest_present_info.store({});
         }
         m_driver_events->driver_state_changed.signal();
         m_device_driver.reset();
@@ -171,6 +168,9 @@ namespace wvb::driver
 
     void ServerDriver::RunFrame()
     {
+        // The measurements of this frame use the phase computed here
+        m_measurement_bucket->update_phase();
+
         if (m_device_driver != nullptr)
         {
             m_device_driver->RunFrame();
@@ -223,7 +223,8 @@ namespace wvb::driver
             m_logger->log("Sending measurements to server");
 
             // Server finished its window and is collecting measurements
-            // We need to stop measuring if not already done, and send the measurements to the server
+            // We need to stop measuring if not already done. The measurements were already published as they were taken, so the
+            // server only needs to know that there won't be any other one.
             m_measurement_bucket->reset_window();
             {
                 auto data = m_shared_memory->lock();
@@ -233,31 +234,6 @@ namespace wvb::driver
                     return;
                 }
 
-                // Fill in the measurements
-                const auto &frame_time_measurements = m_measurement_bucket->get_frame_time_measurements();
-                data->frame_time_measurements_count = std::min(static_cast<uint32_t>(frame_time_measurements.size()),
-                                                               static_cast<uint32_t>(WVB_BENCHMARK_TIMING_PHASE_CAPACITY));
-                for (uint32_t i = 0; i < data->frame_time_measurements_count; i++)
-                {
-                    data->frame_time_measurements[i] = frame_time_measurements[i];
-                }
-
-                const auto &tracking_measurements      = m_measurement_bucket->get_tracking_measurements();
-                data->tracking_time_measurements_count = std::min(static_cast<uint32_t>(tracking_measurements.size()),
-                                                                  static_cast<uint32_t>(WVB_BENCHMARK_TIMING_PHASE_CAPACITY));
-                for (uint32_t i = 0; i < data->tracking_time_measurements_count; i++)
-                {
-                    data->tracking_time_measurements[i] = tracking_measurements[i];
-                }
-
-                const auto &pose_access_measurements      = m_measurement_bucket->get_pose_access_measurements();
-                data->pose_access_time_measurements_count = std::min(static_cast<uint32_t>(pose_access_measurements.size()),
-                                                                     static_cast<uint32_t>(WVB_BENCHMARK_TIMING_PHASE_CAPACITY));
-                for (uint32_t i = 0; i < data->pose_access_time_measurements_count; i++)
-                {
-                    data->pose_access_time_measurements[i] = pose_access_measurements[i];
-                }
-
                 data->driver_state = DriverState::READY; // Stop spamming server with frame it will not use
             }
 
@@ -9,6 +9,7 @@ namespace wvb::server
         NONE,
         BENCHMARK_PASSES,
         NETWORK_SETTINGS,
+        PREDICTION_SETTINGS,
     };
 
     typedef bool (*ParseFieldFunc)(std::string &field, uint32_t field_index, void *user_data);
@@ -96,6 +97,25 @@ namespace wvb::server
                 }
                 pass->num_repetitions = val.value();
             }
+            else if (field == "nmin")
+            {
+                // The confidence intervals need at least 2 runs
+                auto val = parse_numerical_field(str_val, "nmin", 2);
+                if (!val.has_value())
+                {
+                    return false;
+                }
+                pass->min_repetitions = val.value();
+            }
+            else if (field == "ci")
+            {
+                auto val = parse_numerical_field(str_val, "ci");
+                if (!val.has_value())
+                {
+                    return false;
+                }
+                pass->target_ci_half_width_us = val.value();
+            }
             else if (field == "ds")
             {
                 auto val = parse_numerical_field(str_val, "ds");
@@ -202,6 +222,15 @@ namespace wvb::server
             }
             settings->ping_count = val.value();
         }
+        else if (field == "sc")
+        {
+            auto val = parse_numerical_field(str_val, "sc");
+            if (!val.has_value())
+            {
+                return false;
+            }
+            settings->clock_sync_target_confidence_us = val.value();
+        }
         else if (field == "pi")
         {
             auto val = parse_numerical_field(str_val, "pi");
@@ -229,6 +258,67 @@ namespace wvb::server
         return true;
     }
 
+    bool parse_pose_prediction_settings_field(std::string &field, uint32_t field_index, PosePredictionSettings *settings)
+    {
+        if (field.empty())
+        {
+            // Skip
+            return true;
+        }
+
+        // Split by '='
+        std::string str_val   = "";
+        size_t      split_pos = field.find('=');
+        if (split_pos != std::string::npos)
+        {
+            str_val = field.substr(split_pos + 1);
+            field   = field.substr(0, split_pos);
+        }
+
+        // Parse field
+        if (field == "model")
+        {
+            if (str_val == "none")
+            {
+                settings->model = PosePredictionModel::NONE;
+            }
+            else if (str_val == "velocity")
+            {
+                settings->model = PosePredictionModel::CONSTANT_VELOCITY;
+            }
+            else
+            {
+                LOGE("Invalid prediction model \"%s\". Expected \"none\" or \"velocity\".\n", str_val.c_str());
+                return false;
+            }
+        }
+        else if (field == "h")
+        {
+            auto val = parse_numerical_field(str_val, "h");
+            if (!val.has_value())
+            {
+                return false;
+            }
+            settings->horizon_us = val.value();
+        }
+        else if (field == "max")
+        {
+            auto val = parse_numerical_field(str_val, "max");
+            if (!val.has_value())
+            {
+                return false;
+            }
+            settings->max_extrapolation_us = val.value();
+        }
+        else
+        {
+            LOGE("Invalid field \"%s\" for pose prediction settings.\n", field.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
     int32_t parse_multi_arg(std::string &arg, ParseFieldFunc pfn_parse_field, void *user_data)
     {
         // Split by ';' and iterate
@@ -319,6 +409,11 @@ namespace wvb::server
                     // Specify network settings
                     prev_arg_type = MultiArgType::NETWORK_SETTINGS;
                 }
+                else if (str_arg == "-p" || str_arg == "--prediction")
+                {
+                    // Specify pose prediction settings
+                    prev_arg_type = MultiArgType::PREDICTION_SETTINGS;
+                }
                 else if (str_arg == "-ri" || str_arg == "--run-interval")
                 {
                     auto value = parse_numerical_field(str_val, "--run-interval");
@@ -328,6 +423,22 @@ namespace wvb::server
                     }
                     settings.benchmark_settings.duration_inter_run_interval_ms = value.value();
                 }
+                else if (str_arg == "-f" || str_arg == "--format")
+                {
+                    if (str_val == "csv")
+                    {
+                        settings.benchmark_settings.export_format = MeasurementExportFormat::CSV;
+                    }
+                    else if (str_val == "binary")
+                    {
+                        settings.benchmark_settings.export_format = MeasurementExportFormat::BINARY;
+                    }
+                    else
+                    {
+                        LOGE("Invalid measurement format \"%s\". Expected \"csv\" or \"binary\".\n", str_val.c_str());
+                        return std::nullopt;
+                    }
+                }
                 else if (str_arg == "-sp" || str_arg == "--steamvr-path")
                 {
                     if (str_val.size() <= 2 || str_val[0] != '"' || str_val[str_val.size() - 1] != '"') // Minimum two ""
@@ -385,6 +496,18 @@ namespace wvb::server
                 // Can only have one network settings argument
                 prev_arg_type = MultiArgType::NONE;
             }
+            else if (prev_arg_type == MultiArgType::PREDICTION_SETTINGS)
+            {
+                if (parse_multi_arg(str_arg,
+                                    reinterpret_cast<ParseFieldFunc>(&parse_pose_prediction_settings_field),
+                                    &settings.pose_prediction_settings)
+                    == -1)
+                {
+                    return std::nullopt;
+                }
+                // Can only have one pose prediction settings argument
+                prev_arg_type = MultiArgType::NONE;
+            }
             else
             {
                 valid = false;
@@ -416,7 +539,10 @@ namespace wvb::server
             "(see "
             "below)\n");
         LOG("    -n,  --network      \t\tSpecify network settings (see below)\n");
+        LOG("    -p,  --prediction   \t\tSpecify pose prediction settings (see below)\n");
         LOG("    -ri, --run-interval \t\tSpecify the interval between two benchmark runs in milliseconds. Default = 5000\n");
+        LOG("    -f,  --format       \t\tSpecify the format of the measurement files: csv or binary (columnar, faster). "
+            "Default = csv\n");
         LOG("    -c,  --codec        \t\tSpecify the codec to use when in normal mode (see available ones below). Ignored for "
             "benchmarking. Default = h265\n");
         LOG("    -sp, --steamvr-path \t\tSpecify the path to the SteamVR installation. Default = \"C:\\Program Files "
@@ -432,6 +558,11 @@ namespace wvb::server
         LOG("        av1:  AV1\n\n");
         LOG("    Available options:\n");
         LOG("        n=<number of repetitions>:   Number of runs with this configuration.              Default = 10\n");
+        LOG("                                     Maximum number of runs if ci is set.\n");
+        LOG("        nmin=<min repetitions>:      Number of runs before the pass can stop early.       Default = 3\n");
+        LOG("        ci=<target precision>:       Stop once the 95%% confidence interval of the mean   Default = 0\n");
+        LOG("                                     latency of each stage is within +-ci microseconds.\n");
+        LOG("                                     0 to always run n times.\n");
         LOG("        ds=<startup phase duration>: Duration of the startup phase in milliseconds.       Default = 15000\n");
         LOG("        dt=<timing phase duration>:  Duration of the timing phase in milliseconds.        Default = 4000\n");
         LOG("        dq=<quality phase duration>: Duration of the frame quality phase in milliseconds. Default = 200\n");
@@ -445,9 +576,19 @@ namespace wvb::server
         LOG("    Available options:\n");
         LOG("        pc=<ping count>:    Number of ping sent by the client during the sync phase.      Default = 10\n");
         LOG("                            Client will send between pc and 2*pc pings depending on packet losses.\n");
+        LOG("        sc=<confidence>:    Precision in microseconds at which the sync phase ends early. Default = 200\n");
+        LOG("                            0 disables the early end, and the client waits for pc replies.\n");
         LOG("        pi=<ping interval>: Interval in milliseconds between reply/timeout and next ping. Default = 200\n");
         LOG("        pt=<ping timeout>:  Timeout in milliseconds for a ping reply.                     Default = 500\n");
 
+        LOG("\nPose prediction settings syntax:\n");
+        LOG("    -p \"<option key>=<value>[;<option key>=<value>]\"\n");
+        LOG("    Available options:\n");
+        LOG("        model=<model>:   Prediction model, \"none\" or \"velocity\" (constant velocity).     Default = velocity\n");
+        LOG("        h=<horizon>:     Time in microseconds between vsync and display on the client.   Default = 0\n");
+        LOG("                         Added to the time until the next vsync to get the prediction target.\n");
+        LOG("        max=<max>:       Maximum extrapolation in microseconds past the latest pose.     Default = 100000\n");
+
         LOG("\nExamples:\n");
         LOG("    wvb_server --benchmark \"h264;n=10;ds=10000;dt=2000;dq=200\" \"h265;n=10;ds=10000;dt=2000;dq=200\" --network "
             "\"pc=10;pi=200;pt=500\" --run-interval=3000\n");
@@ -455,6 +596,8 @@ namespace wvb::server
             "values.\n");
         LOG("    wvb_server -b \"h264\" \"h265\"\n");
         LOG("        Shorter equivalent to the above command.\n");
+        LOG("    wvb_server -b \"h264;n=30;ci=200\"\n");
+        LOG("        Repeat the h264 pass until the mean latency of each stage is known within +-200 us, with 3 to 30 runs.\n");
         LOG("    wvb_server -c=h265\n");
         LOG("        Run in normal mode with h265 codec.\n");
     }
@@ -1,8 +1,12 @@
 #include "wvb_server/server.h"
 
 #include <wvb_common/benchmark.h>
+#include <wvb_common/export_worker.h>
+#include <wvb_common/image_quality.h>
 #include <wvb_common/module.h>
 #include <wvb_common/network_utils.h>
+#include <wvb_common/reactor.h>
+#include <wvb_common/repetition_scheduler.h>
 #include <wvb_common/rtp.h>
 #include <wvb_common/server_shared_state.h>
 #include <wvb_common/socket.h>
@@ -16,12 +20,14 @@
 #include <memory>
 #include <random>
 #include <thread>
+#include <unordered_map>
 
 #define VIDEO_PORT                PORT_AUTO
 #define EXPORT_FILE_TABLE_DIVIDER "---"
-#define EXPORT_FILE_SERVER_ID     "server"
-#define EXPORT_FILE_DRIVER_ID     "driver"
-#define EXPORT_FILE_CLIENT_ID     "client"
+// Advertisements are sent by VRCPSocket::listen() at their own interval, which must be a multiple of this one
+#define ADVERTISEMENT_CHECK_INTERVAL std::chrono::seconds(1)
+// The driver measurement rings must be drained long before they are full
+#define DRIVER_MEASUREMENTS_DRAIN_INTERVAL std::chrono::milliseconds(50)
 
 namespace wvb::server
 {
@@ -29,6 +35,32 @@ namespace wvb::server
     // =                                       Structs                                       =
     // =======================================================================================
 
+    /**
+     * Measurements of a finished run, handed off to the export worker so that the next run can start right away.
+     * The client and driver buckets are moved as a whole, since new ones are created for the next run. The server bucket is shared
+     * with the sockets and reset in place, so its records are merged into the snapshot.
+     */
+    struct RunMeasurements
+    {
+        std::vector<SocketMeasurements>                            server_socket_measurements;
+        std::array<SendQueueMeasurements, WVB_SEND_PRIORITY_COUNT> server_send_queue_measurements;
+        std::vector<ServerFrameTimeMeasurements>                   server_frame_times;
+        std::vector<TrackingTimeMeasurements>                      server_tracking_measurements;
+        std::vector<ImageQualityMeasurements>                      server_image_quality_measurements;
+        uint32_t                                                   server_dropped_frames = 0;
+        uint32_t                                                   encoder_frame_delay   = 0;
+        std::vector<ClientFrameTimeMeasurements>                   client_frame_times;
+        std::vector<ImageQualityMeasurements>                      client_image_quality_measurements;
+        std::unique_ptr<ClientMeasurementBucket>                   client_bucket = nullptr;
+        std::unique_ptr<DriverMeasurementBucket>                   driver_bucket = nullptr;
+        StageLatencyHistograms                                     latencies;
+        rtp::RTPClock                                              rtp_clock;
+        /** Frames captured by both the server and the client, compared once their files are written. */
+        std::vector<uint32_t> saved_frame_ids;
+        Extent2D              capture_extent;
+        std::string           capture_prefix;
+    };
+
     struct Server::Data
     {
         std::vector<Module> modules;
@@ -61,6 +93,11 @@ namespace wvb::server
         VideoPipeline                  video_pipeline;
         std::shared_ptr<IVideoEncoder> video_encoder = nullptr;
 
+        // Event loop
+        Reactor reactor;
+        /** Handlers of the sockets watched while connecting, replaced when the sockets change. */
+        std::vector<ReactorHandlerId> connection_socket_handlers;
+
         // States
         DriverConnectionState driver_connection_state = DriverConnectionState::AWAITING_DRIVER;
         ClientConnectionState client_connection_state = ClientConnectionState::AWAITING_CLIENT;
@@ -69,11 +106,23 @@ namespace wvb::server
 
         // Tracking
         std::optional<uint32_t> latest_tracking_timestamp = std::nullopt;
+        /** Latest published tracking state, kept to update it partially (e.g. the FOV). */
+        TrackingState tracking_state {};
 
         // Benchmark
         std::shared_ptr<ServerMeasurementBucket> measurement_bucket        = std::make_shared<ServerMeasurementBucket>();
         std::unique_ptr<DriverMeasurementBucket> driver_measurement_bucket = nullptr;
         std::unique_ptr<ClientMeasurementBucket> client_measurement_bucket = nullptr;
+        /** Client and network stages of the current run, recorded as the client measurements arrive. */
+        StageLatencyHistograms client_latencies;
+        /** Frames measured by the server during the current run, by frame id, to compute the network stage of the client frames. */
+        std::unordered_map<uint32_t, ServerFrameTimeMeasurements> run_server_frames;
+        /** Stage latencies of the runs of the current pass. */
+        StageLatencySketches pass_latencies;
+        /** Decides when the current pass has enough runs. */
+        RepetitionScheduler repetition_scheduler;
+        /** Writes the measurement files in the background. Its results are posted to the reactor. */
+        std::unique_ptr<ExportWorker> export_worker = nullptr;
 
         // Capture
         IOBuffer capture_buffer;
@@ -82,9 +131,23 @@ namespace wvb::server
 
         void handle_driver_state_changed();
         void handle_new_driver_measurements();
+        /** Moves the measurements published by the driver so far into the driver measurement bucket. */
+        void drain_driver_measurements();
         void setup_codec(std::string codec_id);
         void handle_vrcp_packet(const vrcp::VRCPBaseHeader *header, size_t size);
+        /** Forwards the tracking data to the driver if it is newer than the latest one. T is a VRCP tracking data message. */
+        template<typename T>
+        void handle_tracking_data(const T &tracking_data, int64_t received_ns);
+        /** Publishes the tracking state to the driver, without locking the shared memory. */
+        void publish_tracking_state();
+        /** Forwards the client's display timing to the driver, with the phase offset at which its vsync should happen. */
+        void handle_display_timing(const vrcp::VRCPDisplayTiming &display_timing);
         void poll_vrcp();
+        /** Calls on_ready when one of the sockets can be read, instead of the previously watched ones. */
+        void watch_connection_sockets(const std::vector<NativeSocketHandle> &handles, const Reactor::Callback &on_ready);
+        void unwatch_connection_sockets();
+        /** Called regularly in benchmark mode. */
+        void update_benchmark();
         bool connect_to_client();
         void setup_benchmark_window();
         void launch_driver();
@@ -92,6 +155,11 @@ namespace wvb::server
         void ensure_client_bucket_exists();
         /** If all measurements were received, save them and move on to the next pass. */
         void handle_measurements_received();
+        void handle_export_result(const ExportResult &result);
+        /** Waits for the measurement files that are still being written, and reports the failed exports. */
+        void finish_exports();
+        /** Saves and logs the stage latencies of the runs of the current pass, which is over. */
+        void export_pass_latencies();
     };
 
     // =======================================================================================
@@ -149,9 +217,10 @@ namespace wvb::server
                 // Driver asks for client specs
                 LOG("Sending client info\n");
                 {
-                    auto lock             = shared_memory->lock();
-                    lock->vr_system_specs = client_params.specs;
-                    lock->ntp_epoch       = ntp_epoch;
+                    auto lock                      = shared_memory->lock();
+                    lock->vr_system_specs          = client_params.specs;
+                    lock->pose_prediction_settings = settings.pose_prediction_settings;
+                    lock->ntp_epoch                = ntp_epoch;
                 }
                 server_events->new_system_specs.signal();
             }
@@ -191,35 +260,52 @@ namespace wvb::server
         }
     }
 
-    void Server::Data::handle_new_driver_measurements()
+    void Server::Data::drain_driver_measurements()
     {
+        auto *shared_data = shared_memory->unlocked();
+        if (shared_data == nullptr)
         {
-            auto lock = shared_memory->lock();
-
-            LOG("Received driver measurements\n");
-            FLUSH_LOG();
+            return;
+        }
+        auto &rings = shared_data->driver_measurements;
 
+        // The driver only publishes measurements in its timing phase, so all of them are accepted
+        if (driver_measurement_bucket == nullptr)
+        {
             driver_measurement_bucket = std::make_unique<DriverMeasurementBucket>();
             driver_measurement_bucket->set_clock(std::make_shared<rtp::RTPClock>(ntp_epoch));
             driver_measurement_bucket->set_as_accept_all();
+        }
 
-            for (uint32_t i = 0; i < lock->frame_time_measurements_count; i++)
-            {
-                driver_measurement_bucket->add_frame_time_measurement(lock->frame_time_measurements[i]);
-            }
+        rings.frame_time.drain([this](const auto &measurement)
+                               { driver_measurement_bucket->add_frame_time_measurement(measurement); });
+        rings.tracking_time.drain([this](const auto &measurement)
+                                  { driver_measurement_bucket->add_tracking_time_measurement(measurement); });
+        rings.pose_access_time.drain([this](const auto &measurement)
+                                     { driver_measurement_bucket->add_pose_access_measurement(measurement); });
+        rings.pose_prediction.drain([this](const auto &measurement)
+                                    { driver_measurement_bucket->add_pose_prediction_measurement(measurement); });
+    }
 
-            for (uint32_t i = 0; i < lock->pose_access_time_measurements_count; i++)
-            {
-                driver_measurement_bucket->add_pose_access_measurement(lock->pose_access_time_measurements[i]);
-            }
+    void Server::Data::handle_new_driver_measurements()
+    {
+        LOG("Received driver measurements\n");
+        FLUSH_LOG();
 
-            for (uint32_t i = 0; i < lock->tracking_time_measurements_count; i++)
+        // The measurements were drained while they were taken: only the last ones remain
+        drain_driver_measurements();
+        driver_measurement_bucket->set_as_finished();
+
+        {
+            auto lock = shared_memory->lock();
+
+            const auto nb_dropped = lock->driver_measurements.nb_dropped();
+            if (nb_dropped > 0)
             {
-                driver_measurement_bucket->add_tracking_time_measurement(lock->tracking_time_measurements[i]);
+                LOGE("%llu driver measurements were dropped because the server didn't drain them fast enough\n",
+                     static_cast<unsigned long long>(nb_dropped));
             }
 
-            driver_measurement_bucket->set_as_finished();
-
             // Now that we have all the data locally, we can tell the driver that it is no longer needed
             lock->server_state = ServerState::PROCESSING_MEASUREMENTS;
         }
@@ -228,9 +314,58 @@ namespace wvb::server
         handle_measurements_received();
     }
 
+    void Server::Data::publish_tracking_state()
+    {
+        auto *shared_data = shared_memory->unlocked();
+        if (shared_data != nullptr)
+        {
+            shared_data->tracking_state.store(tracking_state);
+        }
+    }
+
+    void Server::Data::handle_display_timing(const vrcp::VRCPDisplayTiming &display_timing)
+    {
+        auto *shared_data = shared_memory->unlocked();
+        if (shared_data != nullptr)
+        {
+            // The pose is predicted for the client display, so the vsync should happen the same time before it
+            shared_data->display_timing.store({
+                .display_timestamp = ntohl(display_timing.display_timestamp),
+                .display_period_ns = ntohl(display_timing.display_period_ns),
+                .phase_offset_us   = WVB_VSYNC_TO_PHOTONS_US + settings.pose_prediction_settings.horizon_us,
+            });
+        }
+    }
+
+    template<typename T>
+    void Server::Data::handle_tracking_data(const T &tracking_data, int64_t received_ns)
+    {
+        const auto timestamp = ntohl(tracking_data.sample_timestamp);
+        if (!latest_tracking_timestamp.has_value()
+            || rtp::compare_rtp_timestamps(latest_tracking_timestamp.value(), timestamp)) // true if a < b
+        {
+            latest_tracking_timestamp = timestamp;
+        }
+        else
+        {
+            return;
+        }
+
+        tracking_data.to_tracking_state(tracking_state);
+        publish_tracking_state();
+        server_events->new_tracking_data.signal();
+
+        measurement_bucket->add_tracking_time_measurement({
+            .pose_timestamp        = ntohl(tracking_data.pose_timestamp),
+            .tracking_received_ns  = received_ns,
+            .tracking_processed_ns = rtp_clock.now_ns(),
+        });
+    }
+
     void Server::Data::handle_vrcp_packet(const vrcp::VRCPBaseHeader *header, size_t size)
     {
-        const auto now = rtp_clock.now_rtp_timestamp();
+        const auto now_ns = rtp_clock.now_ns();
+        const auto now    = rtp_clock.rtp_timestamp_from_ns(now_ns);
 
         // Ping
         if (header->ftype == vrcp::VRCPFieldType::PING)
@@ -246,36 +381,33 @@ namespace wvb::server
             }
         }
         // Tracking
+        else if (header->ftype == vrcp::VRCPFieldType::COMPACT_TRACKING_DATA)
+        {
+            if (size == sizeof(vrcp::VRCPCompactTrackingData))
+            {
+                handle_tracking_data(*reinterpret_cast<const vrcp::VRCPCompactTrackingData *>(header), now_ns);
+            }
+        }
         else if (header->ftype == vrcp::VRCPFieldType::TRACKING_DATA)
         {
-            const auto *tracking_data = reinterpret_cast<const vrcp::VRCPTrackingData *>(header);
             if (size == sizeof(vrcp::VRCPTrackingData))
             {
-                const auto timestamp = ntohl(tracking_data->sample_timestamp);
-                if (!latest_tracking_timestamp.has_value()
-                    || rtp::compare_rtp_timestamps(latest_tracking_timestamp.value(), timestamp)) // true if a < b
-                {
-                    latest_tracking_timestamp = timestamp;
-                }
-                else
-                {
-                    return;
-                }
-
-                {
-                    auto lock = shared_memory->lock();
-                    if (lock.is_valid())
-                    {
-                        tracking_data->to_tracking_state(lock->tracking_state);
-                    }
-                }
-                server_events->new_tracking_data.signal();
-
-                measurement_bucket->add_tracking_time_measurement({
-                    .pose_timestamp               = ntohl(tracking_data->pose_timestamp),
-                    .tracking_received_timestamp  = now,
-                    .tracking_processed_timestamp = rtp_clock.now_rtp_timestamp(),
-                });
+                handle_tracking_data(*reinterpret_cast<const vrcp::VRCPTrackingData *>(header), now_ns);
+            }
+        }
+        else if (header->ftype == vrcp::VRCPFieldType::FOV_DATA)
+        {
+            if (size == sizeof(vrcp::VRCPFovData))
+            {
+                reinterpret_cast<const vrcp::VRCPFovData *>(header)->to_tracking_state(tracking_state);
+                publish_tracking_state();
+            }
+        }
+        else if (header->ftype == vrcp::VRCPFieldType::DISPLAY_TIMING)
+        {
+            if (size == sizeof(vrcp::VRCPDisplayTiming))
+            {
+                handle_display_timing(*reinterpret_cast<const vrcp::VRCPDisplayTiming *>(header));
             }
         }
         else if (header->ftype == vrcp::VRCPFieldType::SYNC_FINISHED)
@@ -314,6 +446,10 @@ namespace wvb::server
                 // Save measurement
                 ensure_client_bucket_exists(); // Lazily create bucket when it is needed, typically after the measurement period
                 client_measurement_bucket->add_frame_time_measurement(frame_time);
+
+                const auto server_frame = run_server_frames.find(frame_time.frame_id);
+                client_latencies.record_client_frame(frame_time,
+                                                     server_frame != run_server_frames.end() ? &server_frame->second : nullptr);
             }
         }
         else if (header->ftype == vrcp::VRCPFieldType::IMAGE_QUALITY_MEASUREMENT)
@@ -330,7 +466,7 @@ namespace wvb::server
         }
         else if (header->ftype == vrcp::VRCPFieldType::TRACKING_TIME_MEASUREMENT)
         {
-            if (size == sizeof(vrcp::VRCPFieldType::TRACKING_TIME_MEASUREMENT))
+            if (size == sizeof(vrcp::VRCPTrackingTimeMeasurement))
             {
                 const auto              *tracking_time_vrcp = reinterpret_cast<const vrcp::VRCPTrackingTimeMeasurement *>(header);
                 TrackingTimeMeasurements tracking_time;
@@ -364,6 +500,18 @@ namespace wvb::server
                 client_measurement_bucket->add_socket_measurements(std::move(socket_measurement));
             }
         }
+        else if (header->ftype == vrcp::VRCPFieldType::SEND_QUEUE_MEASUREMENT)
+        {
+            if (size == sizeof(vrcp::VRCPSendQueueMeasurement))
+            {
+                const auto           *send_queue_measurement_vrcp = reinterpret_cast<const vrcp::VRCPSendQueueMeasurement *>(header);
+                SendQueueMeasurements send_queue_measurement;
+                send_queue_measurement_vrcp->to_send_queue_measurements(send_queue_measurement);
+                // Save measurement
+                ensure_client_bucket_exists(); // Lazily create bucket when it is needed, typically after the measurement period
+                client_measurement_bucket->add_send_queue_measurements(send_queue_measurement);
+            }
+        }
         else if (header->ftype == vrcp::VRCPFieldType::MEASUREMENT_TRANSFER_FINISHED)
         {
             if (size == sizeof(vrcp::VRCPMeasurementTransferFinished))
@@ -378,6 +526,8 @@ namespace wvb::server
                 client_measurement_bucket->set_decoder_frame_delay(measurement_transfer_finished_vrcp->decoder_frame_delay);
                 client_measurement_bucket->set_nb_dropped_frames(ntohl(measurement_transfer_finished_vrcp->nb_dropped_frames));
                 client_measurement_bucket->set_nb_catched_up_frames(ntohl(measurement_transfer_finished_vrcp->nb_catched_up_frames));
+                client_measurement_bucket->set_sync_stats(ntohl(measurement_transfer_finished_vrcp->sync_duration),
+                                                          ntohl(measurement_transfer_finished_vrcp->sync_error_bound));
 
                 client_measurement_bucket->set_as_finished();
                 handle_measurements_received();
@@ -441,14 +591,20 @@ namespace wvb::server
                                                    + std::to_string(current_run) + "_client_"
                                                    + std::to_string(client_measurement_bucket->get_nb_saved_frames() - 1) + ".rgba";
 
-                            std::ofstream file(filename, std::ios::binary);
-                            if (file.is_open())
-                            {
-                                file.write((const char *) capture_buffer.data, capture_buffer.size);
-                                file.close();
-                            }
-
-                            capture_buffer = {};
+                            // Written in the background, since there can be several captures per run
+                            auto capture = std::make_shared<IOBuffer>(std::move(capture_buffer));
+                            export_worker->submit(filename,
+                                                  [capture](const std::string &path)
+                                                  {
+                                                      std::ofstream file(path, std::ios::binary);
+                                                      if (!file.is_open())
+                                                      {
+                                                          return false;
+                                                      }
+                                                      file.write((const char *) capture->data, capture->size);
+                                                      file.close();
+                                                      return !file.fail();
+                                                  });
                         }
                     }
                 }
@@ -486,6 +642,9 @@ namespace wvb::server
         {
             handle_vrcp_packet(header, size);
         }
+
+        // Continue sending queued reliable packets
+        client_vrcp_socket.flush_send_queues();
     }
 
     void Server::Data::setup_codec(std::string codec_id)
@@ -598,7 +757,9 @@ namespace wvb::server
     bool Server::Data::connect_to_client()
     {
         VRCPServerParams params {
-            .video_port = video_socket->local_addr().port,
+            .video_port                      = video_socket->local_addr().port,
+            .clock_sync_ping_count           = settings.network_settings.ping_count,
+            .clock_sync_target_confidence_us = settings.network_settings.clock_sync_target_confidence_us,
         };
 
         // Check if preference is supported
@@ -672,50 +833,106 @@ namespace wvb::server
 
         VRCPConnectResp resp {0};
 
-        // Await valid client connection
-        while (!should_stop)
+        // Await valid client connection. listen() progresses each time the client sends something, including discovery probes
+        // which are answered right away, and the timer makes it send the periodic advertisements.
+        bool       client_connected = false;
+        const auto try_listen       = [&]
         {
-            if (client_vrcp_socket.listen(bcast_addrs, params, &client_params, &resp))
-            {
-                // Client connected
-                ntp_epoch = resp.ntp_timestamp;
-                rtp_clock.set_epoch(ntp_epoch);
-                measurement_bucket->set_clock(std::make_shared<rtp::RTPClock>(ntp_epoch));
-
-                // Setup codec
-                setup_codec(resp.chosen_video_codec);
-
-                // Now, wait for the client to connect to the video socket
-                SocketAddr client_video_addr {
-                    .addr = client_vrcp_socket.peer_inet_addr(),
-                    .port = resp.peer_video_port,
-                };
-                LOG("Awaiting %s to connect to %s\n",
-                    wvb::to_string(client_video_addr).c_str(),
-                    wvb::to_string(video_socket->local_addr()).c_str());
+            client_connected = client_vrcp_socket.listen(bcast_addrs, params, &client_params, &resp);
+        };
+        const auto advertisement_timer =
+            reactor.add_timer(std::chrono::microseconds::zero(), try_listen, ADVERTISEMENT_CHECK_INTERVAL);
+        while (!client_connected && !should_stop)
+        {
+            // The listening socket is replaced when a connection is accepted
+            watch_connection_sockets(client_vrcp_socket.native_handles(), try_listen);
+            reactor.run_once(NO_TIMEOUT);
+        }
+        reactor.remove(advertisement_timer);
+        unwatch_connection_sockets();
+        if (!client_connected)
+        {
+            return false;
+        }
 
-                while (!video_socket->listen(client_video_addr) && !should_stop)
-                {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                }
+        // Client connected
+        LOG("VRCP session established in %.2f ms\n",
+            std::chrono::duration<double, std::milli>(client_vrcp_socket.time_to_connected()).count());
+        ntp_epoch = resp.ntp_timestamp;
+        rtp_clock.set_epoch(ntp_epoch);
+        measurement_bucket->set_clock(std::make_shared<rtp::RTPClock>(ntp_epoch));
 
-                if (should_stop || !client_vrcp_socket.is_connected_refresh())
-                {
-                    return false;
-                }
+        // Setup codec
+        setup_codec(resp.chosen_video_codec);
 
-                LOG("Client connected. Syncing clocks...\n");
-                FLUSH_LOG();
-                client_connection_state = ClientConnectionState::SYNCING_CLOCKS;
+        // Now, wait for the client to connect to the video socket
+        SocketAddr client_video_addr {
+            .addr = client_vrcp_socket.peer_inet_addr(),
+            .port = resp.peer_video_port,
+        };
+        LOG("Awaiting %s to connect to %s\n",
+            wvb::to_string(client_video_addr).c_str(),
+            wvb::to_string(video_socket->local_addr()).c_str());
 
-                return true;
-            }
-            else
-            {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            }
+        bool video_connected = video_socket->listen(client_video_addr);
+        while (!video_connected && !should_stop)
+        {
+            // The listening socket is replaced when another peer connected
+            watch_connection_sockets({video_socket->native_handle()},
+                                     [&] { video_connected = video_socket->listen(client_video_addr); });
+            reactor.run_once(NO_TIMEOUT);
+        }
+        unwatch_connection_sockets();
+
+        if (should_stop || !client_vrcp_socket.is_connected_refresh())
+        {
+            return false;
+        }
+
+        LOG("Client connected. Syncing clocks...\n");
+        FLUSH_LOG();
+        client_connection_state = ClientConnectionState::SYNCING_CLOCKS;
+
+        return true;
+    }
+
+    void Server::Data::watch_connection_sockets(const std::vector<NativeSocketHandle> &handles, const Reactor::Callback &on_ready)
+    {
+        // Always register them again: a closed socket is unregistered by the OS, and its handle may have been reused
+        unwatch_connection_sockets();
+        for (const auto handle : handles)
+        {
+            connection_socket_handlers.push_back(reactor.add_socket(handle, on_ready));
+        }
+    }
+
+    void Server::Data::unwatch_connection_sockets()
+    {
+        for (const auto id : connection_socket_handlers)
+        {
+            reactor.remove(id);
+        }
+        connection_socket_handlers.clear();
+    }
+
+    void Server::Data::update_benchmark()
+    {
+        if (app_state != AppState::RUNNING)
+        {
+            return;
+        }
+
+        // Keep the driver measurement rings empty so that the driver never has to drop measurements
+        drain_driver_measurements();
+
+        // Check if the measurement window is over and the last frame has been saved
+        if (measurement_bucket->measurements_complete() && measurement_bucket->has_saved_frames())
+        {
+            // Measurements have stop, so now we will gather the results, then proceed to the next pass
+            // We can stop the pipeline now
+            // It will do a graceful stop, it will try to send one last frame
+            video_pipeline.send_stop_signal();
         }
-        return false;
     }
 
     void Server::Data::launch_driver()
@@ -737,110 +954,333 @@ namespace wvb::server
             client_measurement_bucket = std::make_unique<ClientMeasurementBucket>();
             client_measurement_bucket->set_clock(std::make_shared<rtp::RTPClock>(ntp_epoch));
             client_measurement_bucket->set_as_accept_all();
+
+            // The client sends its measurements once the timing phase is over, so the server ones are complete
+            for (const auto &server_frame : measurement_bucket->get_frame_time_measurements())
+            {
+                if (!server_frame.dropped)
+                {
+                    run_server_frames[server_frame.frame_id] = server_frame;
+                }
+            }
             LOG("Received first client measurement\n");
             FLUSH_LOG();
         }
     }
 
-    void Server::Data::handle_measurements_received()
+    static std::vector<uint8_t> read_capture(const std::string &path)
     {
-        // Don't do anything if we didn't receive all measurements
-        if (driver_measurement_bucket == nullptr || client_measurement_bucket == nullptr)
+        std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file.is_open())
         {
-            return;
+            return {};
         }
-        // Driver is received in one go, so it is always complete if not null
-        if (!client_measurement_bucket->measurements_complete())
+        std::vector<uint8_t> capture(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(reinterpret_cast<char *>(capture.data()), static_cast<std::streamsize>(capture.size()));
+        return file.fail() ? std::vector<uint8_t> {} : capture;
+    }
+
+    static void set_image_quality(std::vector<ImageQualityMeasurements> &measurements,
+                                  uint32_t                               frame_id,
+                                  const ImageQualityMetrics             &metrics)
+    {
+        for (auto &measurement : measurements)
         {
-            return;
+            if (measurement.frame_id == frame_id)
+            {
+                measurement.psnr    = static_cast<float>(metrics.psnr);
+                measurement.ssim    = static_cast<float>(metrics.ssim);
+                measurement.ms_ssim = static_cast<float>(metrics.ms_ssim);
+            }
         }
+    }
 
-        LOG("All measurements received. Exporting...\n");
+    /**
+     * Compares the frames captured by the server with the same frames decoded by the client, and fills the quality of these frames
+     * in the image quality measurements of both sides.
+     * Server captures keep the row pitch of the staging texture, while client captures are tightly packed.
+     */
+    static void measure_capture_quality(RunMeasurements &run)
+    {
+        const uint32_t width  = run.capture_extent.width;
+        const uint32_t height = run.capture_extent.height;
+
+        for (uint32_t i = 0; i < run.saved_frame_ids.size(); i++)
+        {
+            const std::string suffix    = "_" + std::to_string(i) + ".rgba";
+            auto              reference = read_capture(run.capture_prefix + "server" + suffix);
+            auto              decoded   = read_capture(run.capture_prefix + "client" + suffix);
+            if (height == 0 || reference.size() % height != 0 || reference.size() / height < width * 4
+                || decoded.size() != static_cast<size_t>(width) * height * 4)
+            {
+                LOGE("Missing or invalid files for capture %u, skipping its quality\n", i);
+                continue;
+            }
 
-        // Export measurement
-        // const auto offset =
-        //     rtp_clock.from_rtp_timestamp(0).time_since_epoch().count(); // should be added to timestamp before converting to time
-        // rtp_clock.offset = -offset; // rtp clock's offset is added during time->timestamp conversion and subtracted during
-        //                             // timestamp->time conversion, so we need to negate it here
+            RawFrame reference_frame {.format = ImageFormat::R8G8B8A8_UNORM, .width = width, .height = height};
+            reference_frame.data[0]  = reference.data();
+            reference_frame.pitch[0] = static_cast<uint32_t>(reference.size() / height);
+            RawFrame decoded_frame   = reference_frame;
+            decoded_frame.data[0]    = decoded.data();
+            decoded_frame.pitch[0]   = width * 4;
 
-        std::string filename =
-            "wvb_measurements_pass_" + std::to_string(current_pass) + "_run_" + std::to_string(current_run) + ".csv";
-        std::ofstream file(filename, std::ios::out | std::ios::trunc);
+            try
+            {
+                const auto metrics = compute_image_quality(reference_frame, decoded_frame);
+                set_image_quality(run.server_image_quality_measurements, run.saved_frame_ids[i], metrics);
+                set_image_quality(run.client_image_quality_measurements, run.saved_frame_ids[i], metrics);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                LOGE("Failed to measure the quality of capture %u: %s\n", i, e.what());
+            }
+        }
+    }
+
+    /** Exports the measurements of a run. Returns false if the file couldn't be written. */
+    static bool export_measurements_csv(const std::string &path, const RunMeasurements &run)
+    {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
         if (!file.is_open())
         {
-            LOGE("Failed to open output file %s\n", filename.c_str());
-            return;
+            LOGE("Failed to open output file %s\n", path.c_str());
+            return false;
         }
 
         // Sockets
         file << "socket_measurements\n";
         SocketMeasurements::export_csv_header(file);
-        SocketMeasurements::export_csv_body(file, measurement_bucket->get_socket_measurements(), EXPORT_FILE_SERVER_ID);
-        SocketMeasurements::export_csv_body(file, client_measurement_bucket->get_socket_measurements(), EXPORT_FILE_CLIENT_ID);
+        SocketMeasurements::export_csv_body(file, run.server_socket_measurements, EXPORT_FILE_SERVER_ID);
+        SocketMeasurements::export_csv_body(file, run.client_bucket->get_socket_measurements(), EXPORT_FILE_CLIENT_ID);
+        file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
+
+        file << "send_queue_measurements\n";
+        SendQueueMeasurements::export_csv_header(file);
+        SendQueueMeasurements::export_csv_body(file, run.server_send_queue_measurements, EXPORT_FILE_SERVER_ID);
+        SendQueueMeasurements::export_csv_body(file, run.client_bucket->get_send_queue_measurements(), EXPORT_FILE_CLIENT_ID);
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         // Driver
         file << "driver_frame_time_measurements\n";
-        DriverFrameTimeMeasurements::export_csv(file, rtp_clock, driver_measurement_bucket->get_frame_time_measurements());
+        DriverFrameTimeMeasurements::export_csv(file, run.driver_bucket->get_frame_time_measurements());
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         file << "driver_tracking_measurements\n";
-        TrackingTimeMeasurements::export_csv(file, rtp_clock, driver_measurement_bucket->get_tracking_measurements());
+        TrackingTimeMeasurements::export_csv(file, run.rtp_clock, run.driver_bucket->get_tracking_measurements());
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         file << "driver_pose_access_measurements\n";
-        PoseAccessTimeMeasurements::export_csv(file, rtp_clock, driver_measurement_bucket->get_pose_access_measurements());
+        PoseAccessTimeMeasurements::export_csv(file, run.rtp_clock, run.driver_bucket->get_pose_access_measurements());
+        file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
+
+        file << "driver_pose_prediction_measurements\n";
+        PosePredictionMeasurements::export_csv(file, run.rtp_clock, run.driver_bucket->get_pose_prediction_measurements());
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         // Server
         file << "server_frame_time_measurements\n";
-        ServerFrameTimeMeasurements::export_csv(file, rtp_clock, measurement_bucket->get_frame_time_measurements());
+        ServerFrameTimeMeasurements::export_csv(file, run.server_frame_times);
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         file << "server_tracking_measurements\n";
-        TrackingTimeMeasurements::export_csv(file, rtp_clock, measurement_bucket->get_tracking_time_measurements());
+        TrackingTimeMeasurements::export_csv(file, run.rtp_clock, run.server_tracking_measurements);
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         file << "server_image_quality_measurements\n";
-        ImageQualityMeasurements::export_csv(file, measurement_bucket->get_image_quality_measurements());
+        ImageQualityMeasurements::export_csv(file, run.server_image_quality_measurements);
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         // Client
         file << "client_frame_time_measurements\n";
-        ClientFrameTimeMeasurements::export_csv(file, rtp_clock, client_measurement_bucket->get_frame_time_measurements());
+        ClientFrameTimeMeasurements::export_csv(file, run.rtp_clock, run.client_frame_times);
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         file << "client_tracking_measurements\n";
-        TrackingTimeMeasurements::export_csv(file, rtp_clock, client_measurement_bucket->get_tracking_measurements());
+        TrackingTimeMeasurements::export_csv(file, run.rtp_clock, run.client_bucket->get_tracking_measurements());
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         file << "client_image_quality_measurements\n";
-        ImageQualityMeasurements::export_csv(file, client_measurement_bucket->get_image_quality_measurements());
+        ImageQualityMeasurements::export_csv(file, run.client_image_quality_measurements);
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         file << "network_measurements\n";
-        NetworkMeasurements::export_csv(file, client_measurement_bucket->get_network_measurements());
+        NetworkMeasurements::export_csv(file, run.client_bucket->get_network_measurements());
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         // Misc
         file << "misc_measurements\n";
         export_misc_measurements_csv(file,
-                                     measurement_bucket->get_dropped_frames(),
-                                     client_measurement_bucket->get_nb_dropped_frames(),
-                                     client_measurement_bucket->get_nb_catched_up_frames(),
-                                     video_encoder->get_frame_delay(),
-                                     client_measurement_bucket->get_decoder_frame_delay());
+                                     run.server_dropped_frames,
+                                     run.client_bucket->get_nb_dropped_frames(),
+                                     run.client_bucket->get_nb_catched_up_frames(),
+                                     run.encoder_frame_delay,
+                                     run.client_bucket->get_decoder_frame_delay(),
+                                     run.client_bucket->get_sync_duration_us(),
+                                     run.client_bucket->get_sync_error_bound_us());
+        file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
+
+        file << "stage_latency_measurements\n";
+        StageLatencyHistograms::export_csv(file, run.latencies);
         file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
 
         file.close();
+        return !file.fail();
+    }
 
-        LOG("Measurements exported to %s\n", filename.c_str());
-        FLUSH_LOG();
+    static bool export_measurements_binary(const std::string &path, const RunMeasurements &run)
+    {
+        ColumnarFileWriter file(path);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        // Sockets
+        SocketMeasurements::export_columns(file,
+                                           "socket_measurements",
+                                           run.server_socket_measurements,
+                                           run.client_bucket->get_socket_measurements());
+        SendQueueMeasurements::export_columns(file,
+                                              "send_queue_measurements",
+                                              run.server_send_queue_measurements,
+                                              run.client_bucket->get_send_queue_measurements());
+
+        // Driver
+        DriverFrameTimeMeasurements::export_columns(file,
+                                                    "driver_frame_time_measurements",
+                                                    run.driver_bucket->get_frame_time_measurements());
+        TrackingTimeMeasurements::export_columns(file,
+                                                 "driver_tracking_measurements",
+                                                 run.rtp_clock,
+                                                 run.driver_bucket->get_tracking_measurements());
+        PoseAccessTimeMeasurements::export_columns(file,
+                                                   "driver_pose_access_measurements",
+                                                   run.rtp_clock,
+                                                   run.driver_bucket->get_pose_access_measurements());
+        PosePredictionMeasurements::export_columns(file,
+                                                   "driver_pose_prediction_measurements",
+                                                   run.rtp_clock,
+                                                   run.driver_bucket->get_pose_prediction_measurements());
+
+        // Server
+        ServerFrameTimeMeasurements::export_columns(file, "server_frame_time_measurements", run.server_frame_times);
+        TrackingTimeMeasurements::export_columns(file,
+                                                 "server_tracking_measurements",
+                                                 run.rtp_clock,
+                                                 run.server_tracking_measurements);
+        ImageQualityMeasurements::export_columns(file,
+                                                 "server_image_quality_measurements",
+                                                 run.server_image_quality_measurements);
+
+        // Client
+        ClientFrameTimeMeasurements::export_columns(file, "client_frame_time_measurements", run.rtp_clock, run.client_frame_times);
+        TrackingTimeMeasurements::export_columns(file,
+                                                 "client_tracking_measurements",
+                                                 run.rtp_clock,
+                                                 run.client_bucket->get_tracking_measurements());
+        ImageQualityMeasurements::export_columns(file, "client_image_quality_measurements", run.client_image_quality_measurements);
+        NetworkMeasurements::export_columns(file, "network_measurements", run.client_bucket->get_network_measurements());
+
+        // Misc
+        export_misc_measurements_columns(file,
+                                         "misc_measurements",
+                                         run.server_dropped_frames,
+                                         run.client_bucket->get_nb_dropped_frames(),
+                                         run.client_bucket->get_nb_catched_up_frames(),
+                                         run.encoder_frame_delay,
+                                         run.client_bucket->get_decoder_frame_delay(),
+                                         run.client_bucket->get_sync_duration_us(),
+                                         run.client_bucket->get_sync_error_bound_us());
+
+        StageLatencyHistograms::export_columns(file, "stage_latency_measurements", run.latencies);
+        return file.close();
+    }
+
+    void Server::Data::handle_measurements_received()
+    {
+        // Don't do anything if we didn't receive all measurements
+        if (driver_measurement_bucket == nullptr || client_measurement_bucket == nullptr)
+        {
+            return;
+        }
+        // The driver bucket is finished when the driver has signaled that it has no other measurement
+        if (!driver_measurement_bucket->measurements_complete() || !client_measurement_bucket->measurements_complete())
+        {
+            return;
+        }
+
+        LOG("All measurements received. Exporting...\n");
+
+        // Frames captured by both sides are compared during the export, once the client captures are written
+        const std::string capture_prefix =
+            "wvb_capture_pass_" + std::to_string(current_pass) + "_run_" + std::to_string(current_run) + "_";
+        const auto &eye_resolution  = client_params.specs.eye_resolution;
+        auto        saved_frame_ids = measurement_bucket->get_saved_frame_ids();
+        saved_frame_ids.resize(std::min(measurement_bucket->get_nb_saved_frames(), client_measurement_bucket->get_nb_saved_frames()));
+
+        // Hand off the measurements of the run, so that the next one doesn't wait for the disk
+        auto run = std::make_shared<RunMeasurements>(RunMeasurements {
+            .server_socket_measurements        = measurement_bucket->get_socket_measurements(),
+            .server_send_queue_measurements    = measurement_bucket->get_send_queue_measurements(),
+            .server_frame_times                = measurement_bucket->get_frame_time_measurements(),
+            .server_tracking_measurements      = measurement_bucket->get_tracking_time_measurements(),
+            .server_image_quality_measurements = measurement_bucket->get_image_quality_measurements(),
+            .server_dropped_frames             = measurement_bucket->get_dropped_frames(),
+            .encoder_frame_delay               = video_encoder->get_frame_delay(),
+            .client_frame_times                = client_measurement_bucket->get_frame_time_measurements(),
+            .client_image_quality_measurements = client_measurement_bucket->get_image_quality_measurements(),
+            .client_bucket                     = std::move(client_measurement_bucket),
+            .driver_bucket                     = std::move(driver_measurement_bucket),
+            .rtp_clock                         = rtp_clock,
+            .saved_frame_ids                   = std::move(saved_frame_ids),
+            .capture_extent                    = {eye_resolution.width * 2, eye_resolution.height},
+            .capture_prefix                    = capture_prefix,
+        });
+
+        // Stage latencies were recorded as the measurements arrived. They are also accumulated over the pass.
+        run->latencies = measurement_bucket->get_stage_latencies();
+        run->latencies.merge(client_latencies);
+        client_latencies.reset();
+        run_server_frames.clear();
+        pass_latencies.add(run->latencies);
+        if (current_run == 0)
+        {
+            repetition_scheduler = RepetitionScheduler(settings.benchmark_settings.passes[current_pass]);
+        }
+        const auto stop_reason = repetition_scheduler.add_run(run->latencies);
+        LOG("Pass %u run %u: widest 95%% confidence interval of the stage latencies +-%.1f us\n",
+            current_pass,
+            current_run,
+            repetition_scheduler.max_half_width() / 1000);
+
+        const std::string filename = "wvb_measurements_pass_" + std::to_string(current_pass) + "_run_" + std::to_string(current_run);
+        if (settings.benchmark_settings.export_format == MeasurementExportFormat::BINARY)
+        {
+            export_worker->submit(filename + ".wvbm",
+                                  [run](const std::string &path)
+                                  {
+                                      measure_capture_quality(*run);
+                                      return export_measurements_binary(path, *run);
+                                  });
+        }
+        else
+        {
+            export_worker->submit(filename + ".csv",
+                                  [run](const std::string &path)
+                                  {
+                                      measure_capture_quality(*run);
+                                      return export_measurements_csv(path, *run);
+                                  });
+        }
 
         // Move on to next run
         current_run++;
-        if (current_run == settings.benchmark_settings.passes[current_pass].num_repetitions)
+        if (stop_reason != RepetitionStopReason::NONE)
         {
+            LOG("Pass %u finished after %u runs (%s)\n", current_pass, current_run, to_string(stop_reason).c_str());
+            export_pass_latencies();
+
             // Move on to next pass
             current_pass++;
             current_run = 0;
@@ -901,10 +1341,8 @@ namespace wvb::server
             delete[] packet;
         }
 
-        // Reset
+        // Reset. The client and driver buckets were moved to the export.
         measurement_bucket->reset();
-        client_measurement_bucket = nullptr;
-        driver_measurement_bucket = nullptr;
         latest_tracking_timestamp = std::nullopt;
 
         // Wait for a bit
@@ -921,14 +1359,114 @@ namespace wvb::server
             if (lock.is_valid())
             {
                 lock->server_state       = ServerState::READY;
-                lock->tracking_state     = {};
                 lock->measurement_window = {};
             }
         }
+        tracking_state = {};
+        publish_tracking_state();
+        // The previous driver is not measuring anymore, discard what it may have published after the end of its run
+        auto *shared_data = shared_memory->unlocked();
+        if (shared_data != nullptr)
+        {
+            shared_data->driver_measurements.clear();
+        }
         server_events->server_state_changed.signal();
         launch_driver();
     }
 
+    void Server::Data::export_pass_latencies()
+    {
+        LOG("Stage latencies of pass %u:\n", current_pass);
+        for (size_t i = 0; i < pass_latencies.stages.size(); i++)
+        {
+            const auto &stage = pass_latencies.stages[i];
+            LOG("    %-16s p50 %8.1f us, p99 %8.1f us, max %8.1f us (%llu frames)\n",
+                to_string(static_cast<LatencyStage>(i)).c_str(),
+                stage.value_at_quantile(0.5) / 1000,
+                stage.value_at_quantile(0.99) / 1000,
+                stage.max() / 1000,
+                static_cast<unsigned long long>(stage.count()));
+        }
+
+        // The repetitions are exported with the latencies, to know how precise they are
+        auto              latencies   = std::make_shared<StageLatencySketches>(std::move(pass_latencies));
+        auto              repetitions = std::make_shared<RepetitionScheduler>(repetition_scheduler);
+        const std::string filename    = "wvb_latencies_pass_" + std::to_string(current_pass);
+        if (settings.benchmark_settings.export_format == MeasurementExportFormat::BINARY)
+        {
+            export_worker->submit(filename + ".wvbm",
+                                  [latencies, repetitions](const std::string &path)
+                                  {
+                                      ColumnarFileWriter file(path);
+                                      if (!file.is_open())
+                                      {
+                                          return false;
+                                      }
+                                      StageLatencySketches::export_columns(file, "stage_latency_measurements", *latencies);
+                                      RepetitionScheduler::export_columns(file, "repetition_measurements", *repetitions);
+                                      return file.close();
+                                  });
+        }
+        else
+        {
+            export_worker->submit(filename + ".csv",
+                                  [latencies, repetitions](const std::string &path)
+                                  {
+                                      std::ofstream file(path, std::ios::out | std::ios::trunc);
+                                      if (!file.is_open())
+                                      {
+                                          LOGE("Failed to open output file %s\n", path.c_str());
+                                          return false;
+                                      }
+                                      file << "stage_latency_measurements\n";
+                                      StageLatencySketches::export_csv(file, *latencies);
+                                      file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
+                                      file << "repetition_measurements\n";
+                                      RepetitionScheduler::export_csv(file, *repetitions);
+                                      file << EXPORT_FILE_TABLE_DIVIDER << std::endl;
+                                      file.close();
+                                      return !file.fail();
+                                  });
+        }
+        FLUSH_LOG();
+
+        pass_latencies.reset();
+    }
+
+    void Server::Data::handle_export_result(const ExportResult &result)
+    {
+        if (result.success)
+        {
+            LOG("Exported %s\n", result.path.c_str());
+            FLUSH_LOG();
+        }
+        else
+        {
+            LOGE("Failed to export %s\n", result.path.c_str());
+            FLUSH_LOGE();
+        }
+    }
+
+    void Server::Data::finish_exports()
+    {
+        if (export_worker == nullptr)
+        {
+            return;
+        }
+
+        if (export_worker->nb_pending() != 0)
+        {
+            LOG("Waiting for %zu measurement files to be written...\n", export_worker->nb_pending());
+            FLUSH_LOG();
+        }
+        export_worker->wait_idle();
+        if (export_worker->nb_failed() != 0)
+        {
+            LOGE("%u measurement files couldn't be exported\n", export_worker->nb_failed());
+            FLUSH_LOGE();
+        }
+    }
+
     void Server::Data::setup_benchmark_window()
     {
         const auto &pass = settings.benchmark_settings.passes[current_pass];
@@ -1012,11 +1550,19 @@ namespace wvb::server
 
         // Log settings
         LOG("Mode: %s\n", wvb::to_string(m_data->settings.app_mode).c_str());
+        LOG("Pose prediction: %s, horizon %u us\n",
+            wvb::to_string(m_data->settings.pose_prediction_settings.model).c_str(),
+            m_data->settings.pose_prediction_settings.horizon_us);
 
         // Init sockets
         m_data->video_socket = std::make_shared<ServerVideoSocket>(VIDEO_PORT, m_data->measurement_bucket);
         m_data->client_vrcp_socket =
-            VRCPSocket::create_server(3, PORT_AUTO, PORT_AUTO, PORT_AUTO, VRCP_DEFAULT_ADVERTISEMENT_PORT, m_data->measurement_bucket);
+            VRCPSocket::create_server(3,
+                                      PORT_AUTO,
+                                      PORT_AUTO,
+                                      VRCP_DEFAULT_DISCOVERY_PORT,
+                                      VRCP_DEFAULT_ADVERTISEMENT_PORT,
+                                      m_data->measurement_bucket);
 
         // Find broadcast addresses
         m_data->bcast_addrs = wvb::get_broadcast_addresses();
@@ -1045,6 +1591,11 @@ namespace wvb::server
 
         m_data->modules = load_modules();
 
+        // Measurement files are written in the background, and their results are handled by the event loop
+        Data *data            = m_data;
+        m_data->export_worker = std::make_unique<ExportWorker>(
+            [data](const ExportResult &result) { data->reactor.post([data, result] { data->handle_export_result(result); }); });
+
         // Prepare driver subprocess
         std::string steamvr_path = settings.steamvr_path;
         if (steamvr_path.empty())
@@ -1095,51 +1646,58 @@ namespace wvb::server
             return;
         }
 
-        // Main event loop
-        while (!m_data->should_stop)
+        auto &reactor = m_data->reactor;
+
+        // Driver events
+        const ReactorHandlerId driver_state_handler =
+            reactor.add_event(m_data->driver_events->driver_state_changed, [this] { m_data->handle_driver_state_changed(); });
+        const ReactorHandlerId driver_measurements_handler =
+            reactor.add_event(m_data->driver_events->new_measurements, [this] { m_data->handle_new_driver_measurements(); });
+
+        // Client packets. The TCP socket also becomes readable when the connection is closed.
+        std::vector<ReactorHandlerId> client_socket_handlers;
+        for (const auto handle : m_data->client_vrcp_socket.native_handles())
         {
-            // Poll driver
-            DriverEvent driver_event = DriverEvent::NO_EVENT;
-            while (m_data->driver_events->poll(driver_event))
-            {
-                switch (driver_event)
+            client_socket_handlers.push_back(reactor.add_socket(
+                handle,
+                [this]
                 {
-                    case DriverEvent::DRIVER_STATE_CHANGED: m_data->handle_driver_state_changed(); break;
-                    case DriverEvent::NEW_MEASUREMENTS: m_data->handle_new_driver_measurements(); break;
-                    default: break;
-                }
-            }
+                    if (!m_data->client_vrcp_socket.is_connected_refresh())
+                    {
+                        m_data->should_stop = true;
+                        return;
+                    }
+                    m_data->poll_vrcp();
+                },
+                [this] { m_data->client_vrcp_socket.flush_send_queues(); }));
+        }
 
-            if (!m_data->client_vrcp_socket.is_connected_refresh())
-            {
-                m_data->should_stop = true;
-            }
+        ReactorHandlerId benchmark_timer = INVALID_REACTOR_HANDLER_ID;
+        if (m_data->settings.app_mode == AppMode::BENCHMARK)
+        {
+            benchmark_timer = reactor.add_timer(DRIVER_MEASUREMENTS_DRAIN_INTERVAL,
+                                                [this] { m_data->update_benchmark(); },
+                                                DRIVER_MEASUREMENTS_DRAIN_INTERVAL);
+        }
 
-            m_data->poll_vrcp();
+        // Main event loop: sleep until something happens
+        while (!m_data->should_stop)
+        {
+            reactor.run_once(NO_TIMEOUT);
 
-            // If no app is running, sleep longer to avoid wasting CPU
-            if (m_data->app_state == AppState::NOT_READY && m_data->client_connection_state != ClientConnectionState::SYNCING_CLOCKS)
-            {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            }
-            else
-            {
-                //                std::this_thread::sleep_for(std::chrono::microseconds(500));
-            }
+            // Only wait for the TCP socket to be writable while reliable packets are queued, since it almost always is
+            reactor.set_writable_notifications(client_socket_handlers.front(), !m_data->client_vrcp_socket.flush_send_queues());
+        }
 
-            if (m_data->settings.app_mode == AppMode::BENCHMARK && m_data->app_state == AppState::RUNNING
-                && m_data->measurement_bucket->measurements_complete())
-            {
-                // Check if the measurement window is over and the last frame has been saved
-                if (m_data->measurement_bucket->has_saved_frames())
-                {
-                    // Measurements have stop, so now we will gather the results, then proceed to the next pass
-                    // We can stop the pipeline now
-                    // It will do a graceful stop, it will try to send one last frame
-                    m_data->video_pipeline.send_stop_signal();
-                }
-            }
+        reactor.remove(benchmark_timer);
+        for (const auto id : client_socket_handlers)
+        {
+            reactor.remove(id);
         }
+        reactor.remove(driver_measurements_handler);
+        reactor.remove(driver_state_handler);
+
+        m_data->finish_exports();
 
         m_data->video_pipeline.send_kill_signal();
         m_data->client_vrcp_socket.close();
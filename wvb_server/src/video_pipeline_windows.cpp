@@ -44,13 +44,14 @@ namespace wvb::server
         uint32_t frame_id             = 0;
         uint32_t sample_rtp_timestamp = 0;
         uint32_t pose_rtp_timestamp   = 0;
+        Pose     rendered_pose        = {};
         // Info of the push phase
-        uint32_t frame_event_received_timestamp    = 0;
-        uint32_t present_info_received_timestamp   = 0;
-        uint32_t shared_texture_opened_timestamp   = 0; // optional
-        uint32_t shared_texture_acquired_timestamp = 0; // optional
-        uint32_t staging_texture_mapped_timestamp  = 0; // optional
-        uint32_t frame_pushed_timestamp            = 0;
+        int64_t frame_event_received_ns    = 0;
+        int64_t present_info_received_ns   = 0;
+        int64_t shared_texture_opened_ns   = 0; // optional
+        int64_t shared_texture_acquired_ns = 0; // optional
+        int64_t staging_texture_mapped_ns  = 0; // optional
+        int64_t frame_pushed_ns            = 0;
     };
 
     struct VideoPipeline::Data
@@ -395,36 +396,33 @@ namespace wvb::server
                     break;
                 }
 
-                // Reset frame time measurements
+                // Reset frame time measurements. Checking if the measurements are complete also updates the phase for this frame.
                 frame_time                   = {};
                 const bool should_save_frame = measurements->measurements_complete() && !measurements->has_saved_frames();
 
-                frame_time.frame_event_received_timestamp = rtp_clock.now_rtp_timestamp();
+                frame_time.frame_event_received_ns = rtp_clock.now_ns();
 
-                // Load present info
+                // Load present info. It is published without the mutex, so this doesn't wait for the driver or the measurements.
+                auto *shared_data = shared_memory->unlocked();
+                if (shared_data == nullptr || !shared_data->latest_present_info.load(present_info))
                 {
-                    auto present_info_lock = shared_memory->lock(WAIT_TIMEOUT_MS);
-                    if (!present_info_lock.is_valid())
-                    {
-                        server_events->frame_finished.signal();
-                        frame_time.finished_signal_sent_timestamp = rtp_clock.now_rtp_timestamp();
-                        measurements->add_dropped_frame();
-                        frame_time.dropped = true;
-                        measurements->add_frame_time_measurement(frame_time);
-                        std::cerr << "Failed to lock shared memory\n";
-                        continue;
-                    }
-                    present_info = present_info_lock->latest_present_info;
+                    server_events->frame_finished.signal();
+                    frame_time.finished_signal_sent_ns = rtp_clock.now_ns();
+                    measurements->add_dropped_frame();
+                    frame_time.dropped = true;
+                    measurements->add_frame_time_measurement(frame_time);
+                    std::cerr << "Failed to read present info from shared memory\n";
+                    continue;
                 }
 
                 frame_time.frame_id                        = present_info.frame_id;
-                frame_time.present_info_received_timestamp = rtp_clock.now_rtp_timestamp();
+                frame_time.present_info_received_ns = rtp_clock.now_ns();
 
                 // SteamVR uses triple buffering. So we can tell it that it can begin the next frame if it wants to.
                 // If it is too fast (it finishes the next frame before the current one is sent), it will block after submitting it,
                 // until the next iteration of this loop and the signal is sent.
                 server_events->frame_finished.signal();
-                frame_time.finished_signal_sent_timestamp = rtp_clock.now_rtp_timestamp();
+                frame_time.finished_signal_sent_ns = rtp_clock.now_ns();
 
                 // The timestamp indicates when the frame was created.
                 // If too big of a delay is created, drop frames early to catch up and to avoid congesting the network
@@ -464,7 +462,7 @@ namespace wvb::server
                         continue;
                     }
 
-                    frame_time.shared_texture_opened_timestamp = rtp_clock.now_rtp_timestamp();
+                    frame_time.shared_texture_opened_ns = rtp_clock.now_ns();
 
                     backbuffer_mutex = nullptr;
                     HRESULT result   = src_backbuffer_texture->QueryInterface(__uuidof(IDXGIKeyedMutex), (void **) &backbuffer_mutex);
@@ -487,7 +485,7 @@ namespace wvb::server
                         continue;
                     }
 
-                    frame_time.shared_texture_acquired_timestamp = rtp_clock.now_rtp_timestamp();
+                    frame_time.shared_texture_acquired_ns = rtp_clock.now_ns();
 
                     ID3D11Texture2D *intermediate_texture = src_backbuffer_texture;
 
@@ -542,7 +540,7 @@ namespace wvb::server
                         }
 
                         raw_size                                    = mapped_subresource.RowPitch * specs.eye_resolution.height;
-                        frame_time.staging_texture_mapped_timestamp = rtp_clock.now_rtp_timestamp();
+                        frame_time.staging_texture_mapped_ns = rtp_clock.now_ns();
 
                         wvb::RawFrame frame {
                             .format = staging_texture_format,
@@ -580,31 +578,32 @@ namespace wvb::server
                 }
 
                 frame_info_queue.push_back({
-                    .frame_id                          = static_cast<uint32_t>(present_info.frame_id),
-                    .sample_rtp_timestamp              = present_info.sample_rtp_timestamp,
-                    .pose_rtp_timestamp                = present_info.pose_rtp_timestamp,
-                    .frame_event_received_timestamp    = frame_time.frame_event_received_timestamp,
-                    .present_info_received_timestamp   = frame_time.present_info_received_timestamp,
-                    .shared_texture_opened_timestamp   = frame_time.shared_texture_opened_timestamp,
-                    .shared_texture_acquired_timestamp = frame_time.shared_texture_acquired_timestamp,
-                    .staging_texture_mapped_timestamp  = frame_time.staging_texture_mapped_timestamp,
-                    .frame_pushed_timestamp            = rtp_clock.now_rtp_timestamp(),
+                    .frame_id                   = static_cast<uint32_t>(present_info.frame_id),
+                    .sample_rtp_timestamp       = present_info.sample_rtp_timestamp,
+                    .pose_rtp_timestamp         = present_info.pose_rtp_timestamp,
+                    .rendered_pose              = present_info.rendered_pose,
+                    .frame_event_received_ns    = frame_time.frame_event_received_ns,
+                    .present_info_received_ns   = frame_time.present_info_received_ns,
+                    .shared_texture_opened_ns   = frame_time.shared_texture_opened_ns,
+                    .shared_texture_acquired_ns = frame_time.shared_texture_acquired_ns,
+                    .staging_texture_mapped_ns  = frame_time.staging_texture_mapped_ns,
+                    .frame_pushed_ns            = rtp_clock.now_ns(),
                 });
                 // --- End of push phase ---
 
                 // --- Start of pull/send phase ---
                 // Because of delay, the frame that the encoder will give us may not be the one we just pushed
                 // This is why we needed to enqueue everything
-                const auto frame_info                        = frame_info_queue.front();
-                frame_time                                   = {};
-                frame_time.frame_id                          = frame_info.frame_id;
-                frame_time.frame_event_received_timestamp    = frame_info.frame_event_received_timestamp;
-                frame_time.present_info_received_timestamp   = frame_info.present_info_received_timestamp;
-                frame_time.shared_texture_opened_timestamp   = frame_info.shared_texture_opened_timestamp;
-                frame_time.shared_texture_acquired_timestamp = frame_info.shared_texture_acquired_timestamp;
-                frame_time.staging_texture_mapped_timestamp  = frame_info.staging_texture_mapped_timestamp;
-                frame_time.frame_pushed_timestamp            = frame_info.frame_pushed_timestamp;
-                frame_time.frame_pulled_timestamp            = rtp_clock.now_rtp_timestamp();
+                const auto frame_info                 = frame_info_queue.front();
+                frame_time                            = {};
+                frame_time.frame_id                   = frame_info.frame_id;
+                frame_time.frame_event_received_ns    = frame_info.frame_event_received_ns;
+                frame_time.present_info_received_ns   = frame_info.present_info_received_ns;
+                frame_time.shared_texture_opened_ns   = frame_info.shared_texture_opened_ns;
+                frame_time.shared_texture_acquired_ns = frame_info.shared_texture_acquired_ns;
+                frame_time.staging_texture_mapped_ns  = frame_info.staging_texture_mapped_ns;
+                frame_time.frame_pushed_ns            = frame_info.frame_pushed_ns;
+                frame_time.frame_pulled_ns            = rtp_clock.now_ns();
 
                 encoded_size = 0;
 
@@ -614,9 +613,9 @@ namespace wvb::server
                 size_t         packet_size = 0;
 
                 // Pull frame from encoder
-                frame_time.before_last_get_next_packet_timestamp = rtp_clock.now_rtp_timestamp();
+                frame_time.before_last_get_next_packet_ns = rtp_clock.now_ns();
                 video_encoder->get_next_packet(&packet, &packet_size);
-                frame_time.after_last_get_next_packet_timestamp = rtp_clock.now_rtp_timestamp();
+                frame_time.after_last_get_next_packet_ns = rtp_clock.now_ns();
                 if (packet == nullptr)
                 {
                     // No packet to send
@@ -642,17 +641,18 @@ namespace wvb::server
                     i                 = 0;
                 }
 
-                frame_time.before_last_send_packet_timestamp = rtp_clock.now_rtp_timestamp();
+                frame_time.before_last_send_packet_ns = rtp_clock.now_ns();
                 video_socket->send_packet(packet,
                                           packet_size,
                                           static_cast<uint32_t>(frame_info.frame_id),
                                           last_frame,
                                           frame_info.sample_rtp_timestamp,
                                           frame_info.pose_rtp_timestamp,
+                                          frame_info.rendered_pose,
                                           should_save_frame,
                                           true,
                                           0);
-                frame_time.after_last_send_packet_timestamp = rtp_clock.now_rtp_timestamp();
+                frame_time.after_last_send_packet_ns = rtp_clock.now_ns();
                 if (last_frame)
                 {
                     last_frame_sent = true;
@@ -671,15 +671,14 @@ namespace wvb::server
                     save_texture(src_backbuffer_texture);
                     backbuffer_mutex->ReleaseSync(0);
                     backbuffer_mutex->Release();
-                    measurements->add_saved_frame();
+                    measurements->add_saved_frame(static_cast<uint32_t>(frame_info.frame_id));
                 }
 
-                // Save measurements
+                // Save measurements. The quality of the saved frames is filled during the export
                 measurements->add_image_quality_measurement({
                     .frame_id        = static_cast<uint32_t>(frame_info.frame_id),
                     .codestream_size = static_cast<uint32_t>(encoded_size),
                     .raw_size        = static_cast<uint32_t>(raw_size),
-                    .psnr            = 0, // TODO
                 });
                 measurements->add_frame_time_measurement(frame_time);
             }